@@ -18,6 +18,9 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #ifndef PIC_ALGORITHMS_COLOR_TO_GRAY_HPP
 #define PIC_ALGORITHMS_COLOR_TO_GRAY_HPP
 
+#include <vector>
+#include <random>
+
 #include "image.hpp"
 #include "filtering/filter_channel.hpp"
 #include "tone_mapping/exposure_fusion.hpp"
@@ -58,6 +61,333 @@ Image *ColorToGray(Image *imgIn, Image *imgOut)
     return imgOut;
 }
 
+/**
+ * @brief The Decolorization class is contrast-preserving decolorization
+ * (Lu, Xu, and Jia 2012): the gray image is a linear combination of
+ * the RGB channels, and the weights are chosen from a discrete simplex
+ * by maximizing the likelihood that gray differences match color
+ * differences. Differences are computed on a fixed number of samples,
+ * i.e. neighbor pairs on a coarse grid and random global pairs, so the
+ * optimization does not depend on image size.
+ */
+class Decolorization
+{
+protected:
+    int nSamples;
+    float sigma, tau;
+    unsigned int seed;
+
+    //color differences of pairs and their magnitude (SoA)
+    std::vector<float> dR, dG, dB, delta;
+
+    float weights[3];
+
+    /**
+     * @brief AddPair
+     * @param a
+     * @param b
+     */
+    void AddPair(float *a, float *b)
+    {
+        float r = a[0] - b[0];
+        float g = a[1] - b[1];
+        float bl = a[2] - b[2];
+
+        //the magnitude is normalized by sqrt(2) as in the original paper
+        float d = sqrtf(r * r + g * g + bl * bl) * 0.70710678f;
+
+        if(d >= tau) {
+            dR.push_back(r);
+            dG.push_back(g);
+            dB.push_back(bl);
+            delta.push_back(d);
+        }
+    }
+
+    /**
+     * @brief Sample gathers global and local pairs.
+     * @param imgIn
+     */
+    void Sample(Image *imgIn)
+    {
+        dR.clear();
+        dG.clear();
+        dB.clear();
+        delta.clear();
+
+        int width = imgIn->width;
+        int height = imgIn->height;
+        int channels = imgIn->channels;
+
+        //nearest neighbor grid of about nSamples pixels
+        float scale = sqrtf(float(nSamples) / float(width * height));
+        int w = CLAMPi(int(float(width) * scale + 0.5f), 1, width);
+        int h = CLAMPi(int(float(height) * scale + 0.5f), 1, height);
+
+        std::vector<float> grid(w * h * 3);
+
+        #pragma omp parallel for
+
+        for(int i = 0; i < h; i++) {
+            int y = MIN((i * height) / h, height - 1);
+
+            for(int j = 0; j < w; j++) {
+                int x = MIN((j * width) / w, width - 1);
+
+                float *src = &imgIn->data[(y * width + x) * channels];
+                float *dst = &grid[(i * w + j) * 3];
+
+                dst[0] = src[0];
+                dst[1] = src[1];
+                dst[2] = src[2];
+            }
+        }
+
+        //global pairs: a fixed random permutation
+        int n = w * h;
+        std::vector<int> perm(n);
+        for(int i = 0; i < n; i++) {
+            perm[i] = i;
+        }
+
+        std::mt19937 m(seed);
+        std::shuffle(perm.begin(), perm.end(), m);
+
+        for(int i = 0; i < n; i++) {
+            AddPair(&grid[i * 3], &grid[perm[i] * 3]);
+        }
+
+        //local pairs: neighbors on a half resolution grid
+        int w2 = MAX(w >> 1, 1);
+        int h2 = MAX(h >> 1, 1);
+        std::vector<float> half(w2 * h2 * 3, 0.0f);
+
+        for(int i = 0; i < h2; i++) {
+            for(int j = 0; j < w2; j++) {
+                float *dst = &half[(i * w2 + j) * 3];
+                int count = 0;
+
+                for(int k = 0; k < 2; k++) {
+                    int y = MIN((i << 1) + k, h - 1);
+
+                    for(int l = 0; l < 2; l++) {
+                        int x = MIN((j << 1) + l, w - 1);
+                        float *src = &grid[(y * w + x) * 3];
+
+                        dst[0] += src[0];
+                        dst[1] += src[1];
+                        dst[2] += src[2];
+                        count++;
+                    }
+                }
+
+                float inv = 1.0f / float(count);
+                dst[0] *= inv;
+                dst[1] *= inv;
+                dst[2] *= inv;
+            }
+        }
+
+        for(int i = 0; i < h2; i++) {
+            for(int j = 0; j < (w2 - 1); j++) {
+                int ind = (i * w2 + j) * 3;
+                AddPair(&half[ind], &half[ind + 3]);
+            }
+        }
+
+        for(int i = 0; i < (h2 - 1); i++) {
+            for(int j = 0; j < w2; j++) {
+                int ind = (i * w2 + j) * 3;
+                AddPair(&half[ind], &half[ind + w2 * 3]);
+            }
+        }
+    }
+
+    /**
+     * @brief Energy computes the mean log-likelihood of a set of weights;
+     * each term is log(exp(-(l + d)^2 / s^2) + exp(-(l - d)^2 / s^2)),
+     * which is evaluated in a stable way.
+     * @param wr
+     * @param wg
+     * @param wb
+     * @return
+     */
+    double Energy(float wr, float wg, float wb)
+    {
+        int n = int(delta.size());
+
+        float sigma_sq_inv = 1.0f / (sigma * sigma);
+
+        const float *pr = &dR[0];
+        const float *pg = &dG[0];
+        const float *pb = &dB[0];
+        const float *pd = &delta[0];
+
+        double ret = 0.0;
+
+        for(int i = 0; i < n; i++) {
+            float l = wr * pr[i] + wg * pg[i] + wb * pb[i];
+            float d = pd[i];
+
+            float a = fabsf(l) - d;
+            float e = -a * a * sigma_sq_inv;
+            float c = 4.0f * fabsf(l) * d * sigma_sq_inv;
+
+            ret += double(e + log1pf(expf(-c)));
+        }
+
+        return ret / double(n);
+    }
+
+public:
+
+    /**
+     * @brief Decolorization
+     * @param nSamples is the number of pixels used for sampling pairs.
+     * @param sigma is the standard deviation of the likelihood.
+     * @param tau is the minimum color difference of a pair.
+     */
+    Decolorization(int nSamples = 4096, float sigma = 0.05f, float tau = 0.05f)
+    {
+        seed = 1;
+        Update(nSamples, sigma, tau);
+
+        weights[0] = 0.299f;
+        weights[1] = 0.587f;
+        weights[2] = 0.114f;
+    }
+
+    /**
+     * @brief Update
+     * @param nSamples
+     * @param sigma
+     * @param tau
+     */
+    void Update(int nSamples, float sigma, float tau)
+    {
+        this->nSamples = nSamples > 16 ? nSamples : 4096;
+        this->sigma = sigma > 0.0f ? sigma : 0.05f;
+        this->tau = tau >= 0.0f ? tau : 0.05f;
+    }
+
+    /**
+     * @brief Compute computes the weights for an RGB image.
+     * @param imgIn
+     * @return It returns false if weights could not be computed.
+     */
+    bool Compute(Image *imgIn)
+    {
+        if(imgIn == NULL) {
+            return false;
+        }
+
+        if(!imgIn->isValid() || (imgIn->channels != 3)) {
+            return false;
+        }
+
+        Sample(imgIn);
+
+        if(delta.empty()) {
+            weights[0] = 0.299f;
+            weights[1] = 0.587f;
+            weights[2] = 0.114f;
+            return true;
+        }
+
+        //66 weights in {0, 0.1, ..., 1} whose sum is 1
+        std::vector<int> cand;
+        for(int i = 0; i <= 10; i++) {
+            for(int j = 0; j <= (10 - i); j++) {
+                cand.push_back(i * 11 + j);
+            }
+        }
+
+        int nCand = int(cand.size());
+        std::vector<double> energy(nCand);
+
+        #pragma omp parallel for schedule(dynamic)
+
+        for(int i = 0; i < nCand; i++) {
+            float wr = float(cand[i] / 11) * 0.1f;
+            float wg = float(cand[i] % 11) * 0.1f;
+            float wb = MAX(1.0f - wr - wg, 0.0f);
+            energy[i] = Energy(wr, wg, wb);
+        }
+
+        int best = 0;
+        for(int i = 1; i < nCand; i++) {
+            if(energy[i] > energy[best]) {
+                best = i;
+            }
+        }
+
+        weights[0] = float(cand[best] / 11) * 0.1f;
+        weights[1] = float(cand[best] % 11) * 0.1f;
+        weights[2] = MAX(1.0f - weights[0] - weights[1], 0.0f);
+
+        return true;
+    }
+
+    /**
+     * @brief getWeights
+     * @return It returns the RGB weights of the last Compute.
+     */
+    float *getWeights()
+    {
+        return weights;
+    }
+
+    /**
+     * @brief Process
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *Process(Image *imgIn, Image *imgOut)
+    {
+        if(!Compute(imgIn)) {
+            return ColorToGray(imgIn, imgOut);
+        }
+
+        if(imgOut == NULL) {
+            imgOut = new Image(1, imgIn->width, imgIn->height, 1);
+        } else {
+            if((imgOut->width != imgIn->width) || (imgOut->height != imgIn->height) ||
+               (imgOut->channels != 1)) {
+                imgOut = new Image(1, imgIn->width, imgIn->height, 1);
+            }
+        }
+
+        int n = imgIn->width * imgIn->height;
+        float wr = weights[0];
+        float wg = weights[1];
+        float wb = weights[2];
+
+        #pragma omp parallel for
+
+        for(int i = 0; i < n; i++) {
+            float *src = &imgIn->data[i * 3];
+            imgOut->data[i] = wr * src[0] + wg * src[1] + wb * src[2];
+        }
+
+        imgOut->InvalidateCache();
+
+        return imgOut;
+    }
+
+    /**
+     * @brief Execute
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    static Image *Execute(Image *imgIn, Image *imgOut = NULL)
+    {
+        Decolorization dec;
+        return dec.Process(imgIn, imgOut);
+    }
+};
+
 } // end namespace pic
 
 #endif /* PIC_ALGORITHMS_COLOR_TO_GRAY_HPP */
@@ -20,32 +20,29 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include "image.hpp"
 #include "util/tile_list.hpp"
+#include "util/fast_dct.hpp"
 
 namespace pic {
 
 /**
- * @brief The DCT class provides a reference
- * implementation for Discret Cosine Transform.
+ * @brief The DCT class computes the blockwise orthonormal
+ * Discrete Cosine Transform using FastDCT.
  */
 class DCT
 {
-public:
-
-    /**
-     * @brief DCT
-     */
-    DCT()
-    {
-    }
+protected:
 
     /**
-     * @brief Transform computes the forward DCT transformation.
-     * @param imgIn is an input image.
-     * @param imgOut is an output image; i.e. imgIn in the DCT domain.
-     * @param size is the size of blocks (size * size) for computing the DCT.
+     * @brief ProcessBlocks transforms each size x size block of imgIn;
+     * blocks are processed in parallel. Partial blocks on the borders
+     * read clamped pixels.
+     * @param imgIn
+     * @param imgOut
+     * @param size
+     * @param bForward
      * @return
      */
-    static Image *Transform(Image *imgIn, Image *imgOut, int size = 8)
+    static Image *ProcessBlocks(Image *imgIn, Image *imgOut, int size, bool bForward)
     {
         if(imgIn == NULL) {
             return imgOut;
@@ -59,71 +56,80 @@ public:
             size = 8;
         }
 
-        float size2 = float(size * 2);
-        float squareRoot2 = sqrtf(2.0f);
-        float squareRoot = sqrtf(2.0f / float(size));
-        float squareRootPow2 = squareRoot * squareRoot;
-
         int channels = imgIn->channels;
 
-        TileList tiles(size, imgOut->width, imgOut->height);
-
-        for(unsigned int t = 0; t < tiles.tiles.size(); t++) {
-            BBox box;
-            tiles.genBBox(t, &box);
-
-            for(int v = box.y0; v < box.y1; v++) {
-                int vr = v % size;
-
-                for(int u = box.x0; u < box.x1; u++) {
-                    int ur = u % size;
+        FastDCT dct(size);
 
-                    float *dataOut = (*imgOut)(u, v);
-
-                    for(int p = 0; p < channels; p++) {
-                        dataOut[p] = 0.0f;
-                    }
+        TileList tiles(size, imgOut->width, imgOut->height);
+        int nTiles = int(tiles.tiles.size());
 
-                    for(int y = 0; y < size; y++) {
-                        int yi		=  y + box.y0;
-                        int	val		= vr * (2 * y + 1);
-                        float cosU	= cosf(C_PI * float(val) / size2);
+        #pragma omp parallel
+        {
+            float *block = new float[size * size * channels];
+            float *tmp = new float[dct.getBlockScratchSize(channels)];
 
-                        for(int x = 0; x < size; x++) {
-                            int xi		=  x + box.x0;
-                            val			= ur * (2 * x + 1);
-                            float tot	= cosU * cosf(C_PI * float(val) / size2);
+            #pragma omp for schedule(dynamic, 16)
+            for(int t = 0; t < nTiles; t++) {
+                BBox box;
+                tiles.genBBox(t, &box);
 
-                            float *dataIn = (*imgIn)(xi, yi);
+                for(int y = 0; y < size; y++) {
+                    for(int x = 0; x < size; x++) {
+                        float *dataIn = (*imgIn)(box.x0 + x, box.y0 + y);
+                        float *b = &block[(y * size + x) * channels];
 
-                            for(int p = 0; p < channels; p++) {
-                                dataOut[p] += tot * dataIn[p];
-                            }
-                        }
-                    }
-
-                    if(ur == 0) {
                         for(int p = 0; p < channels; p++) {
-                            dataOut[p] /= squareRoot2;
+                            b[p] = dataIn[p];
                         }
                     }
+                }
+
+                if(bForward) {
+                    dct.Forward2D(block, channels, tmp);
+                } else {
+                    dct.Inverse2D(block, channels, tmp);
+                }
+
+                for(int y = box.y0; y < box.y1; y++) {
+                    for(int x = box.x0; x < box.x1; x++) {
+                        float *dataOut = (*imgOut)(x, y);
+                        float *b = &block[((y - box.y0) * size + (x - box.x0)) * channels];
 
-                    if(vr == 0) {
                         for(int p = 0; p < channels; p++) {
-                            dataOut[p] /= squareRoot2;
+                            dataOut[p] = b[p];
                         }
                     }
-
-                    for(int p = 0; p < channels; p++) {
-                        dataOut[p] *= squareRootPow2;
-                    }
                 }
             }
+
+            delete[] block;
+            delete[] tmp;
         }
 
         return imgOut;
     }
 
+public:
+
+    /**
+     * @brief DCT
+     */
+    DCT()
+    {
+    }
+
+    /**
+     * @brief Transform computes the forward DCT transformation.
+     * @param imgIn is an input image.
+     * @param imgOut is an output image; i.e. imgIn in the DCT domain.
+     * @param size is the size of blocks (size * size) for computing the DCT.
+     * @return
+     */
+    static Image *Transform(Image *imgIn, Image *imgOut, int size = 8)
+    {
+        return ProcessBlocks(imgIn, imgOut, size, true);
+    }
+
     /**
      * @brief Inverse computes the inverse DCT transformation.
      * @param imgIn is an input image in the DCT domain.
@@ -133,77 +139,7 @@ public:
      */
     static Image *Inverse(Image *imgIn, Image *imgOut, int size = 8)
     {
-        if(imgIn == NULL) {
-            return imgOut;
-        }
-
-        if(imgOut == NULL) {
-            imgOut = imgIn->AllocateSimilarOne();
-        }
-
-        if(size < 1) {
-            size = 8;
-        }
-
-        float size2 = float(size * 2);
-        float squareRoot2 = sqrtf(2.0f);
-        float squareRoot = sqrtf(2.0f / float(size));
-        float squareRootPow2 = squareRoot * squareRoot;
-
-        int channels = imgIn->channels;
-
-        TileList tiles(size, imgOut->width, imgOut->height);
-
-        for(unsigned int t = 0; t < tiles.tiles.size(); t++) {
-            BBox box;
-            tiles.genBBox(t, &box);
-
-            for(int y = box.y0; y < box.y1; y++) {
-                int yr = y % size;
-
-                for(int x = box.x0; x < box.x1; x++) {
-                    int xr = x % size;
-
-                    float *dataOut = (*imgOut)(x, y);
-
-                    for(int p = 0; p < channels; p++) {
-                        dataOut[p] = 0.0f;
-                    }
-
-                    for(int v = 0; v < size; v++) {
-                        int vi		= box.y0 + v;
-                        int	val		= v * (2 * yr + 1);
-                        float cosU	= cosf(C_PI * float(val) / size2);
-
-                        if(v == 0) {
-                            cosU /= squareRoot2;
-                        }
-
-                        for(int u = 0; u < size; u++) {
-                            int ui		= box.x0 + u;
-                            val			= u * (2 * xr + 1);
-                            float tot	= cosU * cosf(C_PI * float(val) / size2);
-
-                            if(u == 0) {
-                                tot /= squareRoot2;
-                            }
-
-                            float *dataIn = (*imgIn)(ui, vi);
-
-                            for(int p = 0; p < channels; p++) {
-                                dataOut[p] += tot * dataIn[p];
-                            }
-                        }
-                    }
-
-                    for(int p = 0; p < channels; p++) {
-                        dataOut[p] *= squareRootPow2;
-                    }
-                }
-            }
-        }
-
-        return imgOut;
+        return ProcessBlocks(imgIn, imgOut, size, false);
     }
 };
 
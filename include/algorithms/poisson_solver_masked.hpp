@@ -0,0 +1,538 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_ALGORITHMS_POISSON_SOLVER_MASKED_HPP
+#define PIC_ALGORITHMS_POISSON_SOLVER_MASKED_HPP
+
+#include <vector>
+
+#include "base.hpp"
+#include "image.hpp"
+
+namespace pic {
+
+/**
+ * @brief The PoissonSolverMasked class solves a Poisson equation on the
+ * pixels of a mask: known pixels are Dirichlet boundary conditions and
+ * the image border is a Neumann boundary. Unknowns are indexed once per
+ * mask in red-black order, so the 5-point operator only couples the two
+ * colors, and the system is solved by conjugate gradient with an IC(0)
+ * preconditioner, which is exact block elimination in this ordering.
+ * Iterations stop when the relative residual is below a tolerance.
+ */
+class PoissonSolverMasked
+{
+protected:
+    int width, height;
+    int nRed, nUnknowns;
+
+    std::vector<bool> maskCur;
+    std::vector<int>  pixel;    //pixel of each unknown
+    std::vector<int>  nbr;      //four neighbors per unknown; -1 means known or outside
+    std::vector<int>  nbrPixel; //four neighbor pixels per unknown; -1 means outside
+    std::vector<float> diag, diagInv, schurInv;
+
+    std::vector<float> x, b, r, z, p, q;
+
+    float tolerance;
+    int maxIter;
+
+    int iterations;
+    float residual;
+
+    /**
+     * @brief Apply computes out = A * in.
+     * @param in
+     * @param out
+     * @return It returns the dot product of in and out.
+     */
+    double Apply(float *in, float *out)
+    {
+        double ret = 0.0;
+
+        #pragma omp parallel for reduction(+:ret)
+
+        for(int i = 0; i < nUnknowns; i++) {
+            const int *n = &nbr[i << 2];
+            float val = diag[i] * in[i];
+
+            for(int k = 0; k < 4; k++) {
+                if(n[k] > -1) {
+                    val -= in[n[k]];
+                }
+            }
+
+            out[i] = val;
+            ret += double(in[i]) * double(val);
+        }
+
+        return ret;
+    }
+
+    /**
+     * @brief Precondition computes out = M^-1 * in, where M is the IC(0)
+     * factorization in red-black order: a forward substitution onto black
+     * unknowns, a diagonal solve, and a backward substitution onto red ones.
+     * @param in
+     * @param out
+     */
+    void Precondition(float *in, float *out)
+    {
+        #pragma omp parallel for
+
+        for(int i = nRed; i < nUnknowns; i++) {
+            const int *n = &nbr[i << 2];
+            float val = in[i];
+
+            for(int k = 0; k < 4; k++) {
+                if(n[k] > -1) {
+                    val += in[n[k]] * diagInv[n[k]];
+                }
+            }
+
+            out[i] = val * schurInv[i];
+        }
+
+        #pragma omp parallel for
+
+        for(int i = 0; i < nRed; i++) {
+            const int *n = &nbr[i << 2];
+            float val = in[i];
+
+            for(int k = 0; k < 4; k++) {
+                if(n[k] > -1) {
+                    val += out[n[k]];
+                }
+            }
+
+            out[i] = val * diagInv[i];
+        }
+    }
+
+    /**
+     * @brief Dot
+     * @param a
+     * @param b
+     * @return
+     */
+    double Dot(float *a, float *b)
+    {
+        double ret = 0.0;
+
+        #pragma omp parallel for reduction(+:ret)
+
+        for(int i = 0; i < nUnknowns; i++) {
+            ret += double(a[i]) * double(b[i]);
+        }
+
+        return ret;
+    }
+
+    /**
+     * @brief SolveChannel runs PCG on b starting from x.
+     * @return It returns the relative residual.
+     */
+    float SolveChannel()
+    {
+        if(nUnknowns < 1) {
+            return 0.0f;
+        }
+
+        float *px = &x[0];
+        float *pr = &r[0];
+        float *pz = &z[0];
+        float *pp = &p[0];
+        float *pq = &q[0];
+
+        double bNorm = sqrt(Dot(&b[0], &b[0]));
+
+        if(bNorm <= 0.0) {
+            bNorm = 1.0;
+        }
+
+        Apply(px, pq);
+
+        #pragma omp parallel for
+
+        for(int i = 0; i < nUnknowns; i++) {
+            pr[i] = b[i] - pq[i];
+        }
+
+        double rNorm = sqrt(Dot(pr, pr)) / bNorm;
+        if(rNorm <= tolerance) {
+            return float(rNorm);
+        }
+
+        Precondition(pr, pz);
+        memcpy(pp, pz, sizeof(float) * nUnknowns);
+        double rz = Dot(pr, pz);
+
+        int i = 0;
+        for(; i < maxIter; i++) {
+            double pq_dot = Apply(pp, pq);
+            if(pq_dot <= 0.0) {
+                break;
+            }
+
+            float alpha = float(rz / pq_dot);
+            double rr = 0.0;
+
+            #pragma omp parallel for reduction(+:rr)
+
+            for(int j = 0; j < nUnknowns; j++) {
+                px[j] += alpha * pp[j];
+                pr[j] -= alpha * pq[j];
+                rr += double(pr[j]) * double(pr[j]);
+            }
+
+            rNorm = sqrt(rr) / bNorm;
+            if(rNorm <= tolerance) {
+                i++;
+                break;
+            }
+
+            Precondition(pr, pz);
+            double rz_new = Dot(pr, pz);
+            float beta = float(rz_new / rz);
+            rz = rz_new;
+
+            #pragma omp parallel for
+
+            for(int j = 0; j < nUnknowns; j++) {
+                pp[j] = pz[j] + beta * pp[j];
+            }
+        }
+
+        iterations = MAX(iterations, i);
+
+        return float(rNorm);
+    }
+
+public:
+
+    /**
+     * @brief PoissonSolverMasked
+     * @param tolerance is the relative residual for stopping; 1e-6 is
+     * within 3e-5 of a direct solve. Looser values (e.g., 1e-4) are
+     * off by about 3e-3, which is fine when a warm start is refined
+     * over a stream of frames.
+     * @param maxIter is the maximum number of iterations per channel.
+     */
+    PoissonSolverMasked(float tolerance = 1e-6f, int maxIter = 1000)
+    {
+        width = -1;
+        height = -1;
+        nRed = 0;
+        nUnknowns = 0;
+
+        iterations = 0;
+        residual = 0.0f;
+
+        Update(tolerance, maxIter);
+    }
+
+    /**
+     * @brief Update
+     * @param tolerance
+     * @param maxIter
+     */
+    void Update(float tolerance, int maxIter)
+    {
+        this->tolerance = tolerance > 0.0f ? tolerance : 1e-6f;
+        this->maxIter = maxIter > 0 ? maxIter : 1000;
+    }
+
+    /**
+     * @brief Setup indexes the unknowns of a mask; it does nothing if the
+     * mask did not change since the last call.
+     * @param mask is true for unknown pixels.
+     * @param width
+     * @param height
+     * @return It returns true if the index was rebuilt.
+     */
+    bool Setup(bool *mask, int width, int height)
+    {
+        if(mask == NULL) {
+            return false;
+        }
+
+        int n = width * height;
+
+        if((this->width == width) && (this->height == height)) {
+            bool bSame = true;
+
+            for(int i = 0; i < n; i++) {
+                if(maskCur[i] != mask[i]) {
+                    bSame = false;
+                    break;
+                }
+            }
+
+            if(bSame) {
+                return false;
+            }
+        }
+
+        this->width = width;
+        this->height = height;
+        maskCur.assign(mask, mask + n);
+
+        //red-black compact index
+        std::vector<int> index(n, -1);
+        pixel.clear();
+
+        for(int color = 0; color < 2; color++) {
+            for(int i = 0; i < height; i++) {
+                int tmp = i * width;
+
+                for(int j = ((i + color) & 1); j < width; j += 2) {
+                    if(mask[tmp + j]) {
+                        index[tmp + j] = int(pixel.size());
+                        pixel.push_back(tmp + j);
+                    }
+                }
+            }
+
+            if(color == 0) {
+                nRed = int(pixel.size());
+            }
+        }
+
+        nUnknowns = int(pixel.size());
+
+        nbr.resize(nUnknowns * 4);
+        nbrPixel.resize(nUnknowns * 4);
+        diag.resize(nUnknowns);
+        diagInv.resize(nUnknowns);
+        schurInv.resize(nUnknowns);
+
+        const int dx[4] = {1, -1, 0, 0};
+        const int dy[4] = {0, 0, 1, -1};
+
+        #pragma omp parallel for
+
+        for(int i = 0; i < nUnknowns; i++) {
+            int y = pixel[i] / width;
+            int x = pixel[i] - y * width;
+
+            int d = 0;
+            for(int k = 0; k < 4; k++) {
+                int xk = x + dx[k];
+                int yk = y + dy[k];
+
+                int ind = (i << 2) + k;
+
+                if((xk < 0) || (xk >= width) || (yk < 0) || (yk >= height)) {
+                    nbr[ind] = -1;
+                    nbrPixel[ind] = -1;
+                } else {
+                    nbrPixel[ind] = yk * width + xk;
+                    nbr[ind] = index[nbrPixel[ind]];
+                    d++;
+                }
+            }
+
+            diag[i] = float(d);
+            diagInv[i] = d > 0 ? 1.0f / float(d) : 0.0f;
+        }
+
+        #pragma omp parallel for
+
+        for(int i = 0; i < nUnknowns; i++) {
+            float s = diag[i];
+
+            if(i >= nRed) {
+                const int *n = &nbr[i << 2];
+
+                for(int k = 0; k < 4; k++) {
+                    if(n[k] > -1) {
+                        s -= diagInv[n[k]];
+                    }
+                }
+
+                if(s <= 0.0f) {
+                    s = diag[i];
+                }
+            }
+
+            schurInv[i] = s > 0.0f ? 1.0f / s : 0.0f;
+        }
+
+        x.resize(nUnknowns);
+        b.resize(nUnknowns);
+        r.resize(nUnknowns);
+        z.resize(nUnknowns);
+        p.resize(nUnknowns);
+        q.resize(nUnknowns);
+
+        return true;
+    }
+
+    /**
+     * @brief Solve solves the Poisson equation for each channel.
+     * @param imgIn contains the values of known pixels.
+     * @param laplacian is the target Laplacian of unknown pixels (the
+     * convention of FilterLaplacian); if NULL it is zero, i.e. a membrane.
+     * If its width or height differs from imgIn, nothing is solved.
+     * @param imgOut is the output; known pixels are copied from imgIn.
+     * @param imgStart is a warm start (e.g., the previous frame); if NULL,
+     * the unknowns start from imgIn. It can be imgOut.
+     * @return
+     */
+    Image *Solve(Image *imgIn, Image *laplacian, Image *imgOut, Image *imgStart = NULL)
+    {
+        if(imgIn == NULL) {
+            return imgOut;
+        }
+
+        if((imgIn->width != width) || (imgIn->height != height)) {
+            return imgOut;
+        }
+
+        if(imgStart != NULL) {
+            if(!imgStart->SimilarType(imgIn)) {
+                imgStart = NULL;
+            }
+        }
+
+        if(laplacian != NULL) {
+            if((laplacian->width != width) || (laplacian->height != height)) {
+                return imgOut;
+            }
+        }
+
+        int channels = imgIn->channels;
+
+        //warm start is read before imgOut is written
+        std::vector<float> start;
+        if(imgStart != NULL) {
+            start.resize(nUnknowns * channels);
+
+            #pragma omp parallel for
+
+            for(int i = 0; i < nUnknowns; i++) {
+                float *src = &imgStart->data[pixel[i] * channels];
+
+                for(int k = 0; k < channels; k++) {
+                    start[i * channels + k] = src[k];
+                }
+            }
+        }
+
+        if(imgOut == NULL) {
+            imgOut = imgIn->Clone();
+        } else {
+            if(imgOut != imgIn) {
+                imgOut->Assign(imgIn);
+            }
+        }
+
+        iterations = 0;
+        residual = 0.0f;
+
+        for(int k = 0; k < channels; k++) {
+            #pragma omp parallel for
+
+            for(int i = 0; i < nUnknowns; i++) {
+                const int *n = &nbrPixel[i << 2];
+                const int *nu = &nbr[i << 2];
+
+                float val = 0.0f;
+
+                if(laplacian != NULL) {
+                    val = -laplacian->data[pixel[i] * laplacian->channels +
+                                           MIN(k, laplacian->channels - 1)];
+                }
+
+                for(int l = 0; l < 4; l++) {
+                    if((n[l] > -1) && (nu[l] < 0)) {
+                        val += imgIn->data[n[l] * channels + k];
+                    }
+                }
+
+                b[i] = val;
+                x[i] = (imgStart != NULL) ? start[i * channels + k] :
+                                            imgIn->data[pixel[i] * channels + k];
+            }
+
+            residual = MAX(residual, SolveChannel());
+
+            #pragma omp parallel for
+
+            for(int i = 0; i < nUnknowns; i++) {
+                imgOut->data[pixel[i] * channels + k] = x[i];
+            }
+        }
+
+        imgOut->InvalidateCache();
+
+        return imgOut;
+    }
+
+    /**
+     * @brief getIterations
+     * @return It returns the maximum number of iterations over channels
+     * of the last Solve.
+     */
+    int getIterations()
+    {
+        return iterations;
+    }
+
+    /**
+     * @brief getResidual
+     * @return It returns the maximum relative residual over channels
+     * of the last Solve.
+     */
+    float getResidual()
+    {
+        return residual;
+    }
+
+    /**
+     * @brief getUnknowns
+     * @return
+     */
+    int getUnknowns()
+    {
+        return nUnknowns;
+    }
+
+    /**
+     * @brief Execute
+     * @param imgIn
+     * @param laplacian
+     * @param mask
+     * @param imgOut
+     * @return
+     */
+    static Image *Execute(Image *imgIn, Image *laplacian, bool *mask, Image *imgOut = NULL)
+    {
+        if((imgIn == NULL) || (mask == NULL)) {
+            return imgOut;
+        }
+
+        PoissonSolverMasked solver;
+        solver.Setup(mask, imgIn->width, imgIn->height);
+        return solver.Solve(imgIn, laplacian, imgOut);
+    }
+};
+
+} // end namespace pic
+
+#endif /* PIC_ALGORITHMS_POISSON_SOLVER_MASKED_HPP */
+
@@ -18,35 +18,376 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #ifndef PIC_ALGORITHMS_PUSHPULL_HPP
 #define PIC_ALGORITHMS_PUSHPULL_HPP
 
+#include <vector>
+
 #include "image.hpp"
-#include "image_samplers/image_sampler_bsplines.hpp"
 #include "filtering/filter_down_pp.hpp"
-#include "filtering/filter_up_pp.hpp"
+#include "filtering/filter_expand_2d.hpp"
 
 namespace pic {
 
+enum PUSHPULL_MASK{PP_VALUE, PP_MASK, PP_BITS};
+
 /**
- * @brief The PushPull class
+ * @brief The PushPull class fills holes with a push-pull pyramid: a masked
+ * REDUCE (5-tap binomial) that averages only valid samples, followed by an
+ * EXPAND that writes only missing samples. Holes are marked by a value, by a
+ * bool mask, or by a bit-packed mask; masks are read in place. All coarse
+ * levels live in a single arena, which is kept between calls so frames of the
+ * same size do not allocate.
  */
 class PushPull
 {
 protected:
 
-    FilterDownPP    *flt_down;
-    FilterUpPP      *flt_up;
-    ImageVec        stack;
+    /**
+     * @brief The PushPullLevel struct
+     */
+    struct PushPullLevel
+    {
+        int width, height;
+        float *data;
+        unsigned char *flags;
+    };
+
+    int width, height, channels;
+
+    std::vector<PushPullLevel> levels;
+    std::vector<float> arena;
+    std::vector<unsigned char> arenaFlags;
+
+    std::vector<float> value;
+    float threshold;
+
+    PUSHPULL_MASK maskType;
+    bool *mask;
+    unsigned long long *bits;
+
+    /**
+     * @brief Allocate sets up the levels; the arena is reallocated only when
+     * the size of the input changes.
+     * @param imgOut
+     */
+    void Allocate(Image *imgOut)
+    {
+        if((width != imgOut->width) || (height != imgOut->height) ||
+           (channels != imgOut->channels) || levels.empty()) {
+            width = imgOut->width;
+            height = imgOut->height;
+            channels = imgOut->channels;
+
+            int w = width;
+            int h = height;
+            int size = 0;
+            int sizeFlags = 0;
+
+            std::vector<int> offset;
+            while(MIN(w, h) > 1) {
+                w = w >> 1;
+                h = h >> 1;
+
+                offset.push_back(sizeFlags);
+                size += w * h * channels;
+                sizeFlags += w * h;
+            }
+
+            arena.resize(MAX(size, 1));
+            arenaFlags.resize(MAX(sizeFlags, 1));
+
+            levels.resize(offset.size() + 1);
+            w = width;
+            h = height;
+            for(unsigned int i = 1; i < levels.size(); i++) {
+                w = w >> 1;
+                h = h >> 1;
+
+                levels[i].width = w;
+                levels[i].height = h;
+                levels[i].data = &arena[offset[i - 1] * channels];
+                levels[i].flags = &arenaFlags[offset[i - 1]];
+            }
+
+            levels[0].width = width;
+            levels[0].height = height;
+            levels[0].flags = NULL;
+        }
+
+        levels[0].data = imgOut->data;
+    }
+
+    /**
+     * @brief ValidRow writes 1.0f for valid samples and 0.0f for missing
+     * samples of a row of a level.
+     * @param l
+     * @param y
+     * @param m
+     */
+    void ValidRow(int l, int y, float *m)
+    {
+        PushPullLevel &lev = levels[l];
+
+        if(l > 0) {
+            unsigned char *f = &lev.flags[y * lev.width];
+
+            for(int x = 0; x < lev.width; x++) {
+                m[x] = f[x] ? 1.0f : 0.0f;
+            }
+
+            return;
+        }
+
+        switch(maskType) {
+        case PP_MASK: {
+            bool *f = &mask[y * lev.width];
+
+            for(int x = 0; x < lev.width; x++) {
+                m[x] = f[x] ? 0.0f : 1.0f;
+            }
+        }
+        break;
+
+        case PP_BITS: {
+            unsigned long long *f = &bits[y * ((lev.width + 63) >> 6)];
+
+            for(int x = 0; x < lev.width; x++) {
+                m[x] = ((f[x >> 6] >> (x & 63)) & 1ULL) ? 0.0f : 1.0f;
+            }
+        }
+        break;
+
+        default: {
+            float *row = &lev.data[y * lev.width * channels];
+
+            for(int x = 0; x < lev.width; x++) {
+                float d = FilterDownPP::distance(&row[x * channels], &value[0], channels);
+                m[x] = (d > threshold) ? 1.0f : 0.0f;
+            }
+        }
+        break;
+        }
+    }
+
+    /**
+     * @brief Reduce computes level l + 1 from level l with a masked binomial
+     * filter; the filter is separable because numerator and weights are
+     * filtered with the same kernel.
+     * @param l
+     */
+    void Reduce(int l)
+    {
+        PushPullLevel &src = levels[l];
+        PushPullLevel &dst = levels[l + 1];
+
+        const float kernel[5] = {1.0f, 4.0f, 6.0f, 4.0f, 1.0f};
+
+        int w = src.width;
+        int n = w * channels;
+
+        #pragma omp parallel
+        {
+            std::vector<float> acc(n), accW(w), m(w);
+
+            #pragma omp for schedule(static)
+            for(int i2 = 0; i2 < dst.height; i2++) {
+                int i = i2 << 1;
+
+                for(int x = 0; x < n; x++) {
+                    acc[x] = 0.0f;
+                }
+
+                for(int x = 0; x < w; x++) {
+                    accW[x] = 0.0f;
+                }
+
+                //vertical pass
+                for(int k = 0; k < 5; k++) {
+                    int y = i + k - 2;
+
+                    if((y < 0) || (y >= src.height)) {
+                        continue;
+                    }
+
+                    ValidRow(l, y, &m[0]);
+
+                    float *row = &src.data[y * n];
+                    float kk = kernel[k];
+
+                    for(int x = 0; x < w; x++) {
+                        float wx = kk * m[x];
+                        accW[x] += wx;
+
+                        float *a = &acc[x * channels];
+                        float *r = &row[x * channels];
+                        for(int c = 0; c < channels; c++) {
+                            a[c] += r[c] * wx;
+                        }
+                    }
+                }
+
+                //horizontal pass
+                float *out = &dst.data[i2 * dst.width * channels];
+                unsigned char *flags = &dst.flags[i2 * dst.width];
+
+                for(int j2 = 0; j2 < dst.width; j2++) {
+                    int j = j2 << 1;
+                    float *o = &out[j2 * channels];
+
+                    for(int c = 0; c < channels; c++) {
+                        o[c] = 0.0f;
+                    }
+
+                    float weight = 0.0f;
+                    for(int k = 0; k < 5; k++) {
+                        int x = j + k - 2;
+
+                        if((x < 0) || (x >= w)) {
+                            continue;
+                        }
+
+                        float kk = kernel[k];
+                        weight += kk * accW[x];
+
+                        float *a = &acc[x * channels];
+                        for(int c = 0; c < channels; c++) {
+                            o[c] += a[c] * kk;
+                        }
+                    }
+
+                    if(weight > 0.0f) {
+                        float inv = 1.0f / weight;
+                        for(int c = 0; c < channels; c++) {
+                            o[c] *= inv;
+                        }
+
+                        flags[j2] = 1;
+                    } else {
+                        for(int c = 0; c < channels; c++) {
+                            o[c] = value[c];
+                        }
+
+                        flags[j2] = 0;
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Expand writes the missing samples of level l by expanding
+     * level l + 1.
+     * @param l
+     */
+    void Expand(int l)
+    {
+        PushPullLevel &dst = levels[l];
+        PushPullLevel &src = levels[l + 1];
+
+        int n = src.width * channels;
+
+        #pragma omp parallel
+        {
+            std::vector<float> row(n), m(dst.width);
+
+            int   indX[3], indY[3];
+            float weightX[3], weightY[3];
+
+            #pragma omp for schedule(static)
+            for(int i = 0; i < dst.height; i++) {
+                ValidRow(l, i, &m[0]);
+
+                bool bMissing = false;
+                for(int j = 0; j < dst.width; j++) {
+                    if(m[j] == 0.0f) {
+                        bMissing = true;
+                        break;
+                    }
+                }
+
+                if(!bMissing) {
+                    continue;
+                }
+
+                //vertical pass
+                int nTapsY = FilterExpand2D::getTaps(i, src.height, indY, weightY);
+
+                float *r = &src.data[indY[0] * n];
+                for(int x = 0; x < n; x++) {
+                    row[x] = r[x] * weightY[0];
+                }
+
+                for(int k = 1; k < nTapsY; k++) {
+                    r = &src.data[indY[k] * n];
+                    float wy = weightY[k];
+
+                    for(int x = 0; x < n; x++) {
+                        row[x] += r[x] * wy;
+                    }
+                }
+
+                //horizontal pass at missing samples only
+                float *out = &dst.data[i * dst.width * channels];
+
+                for(int j = 0; j < dst.width; j++) {
+                    if(m[j] > 0.0f) {
+                        continue;
+                    }
+
+                    int nTapsX = FilterExpand2D::getTaps(j, src.width, indX, weightX);
+
+                    float *o = &out[j * channels];
+                    for(int c = 0; c < channels; c++) {
+                        o[c] = 0.0f;
+                    }
+
+                    for(int k = 0; k < nTapsX; k++) {
+                        float *tmp = &row[indX[k] * channels];
+                        float wx = weightX[k];
+
+                        for(int c = 0; c < channels; c++) {
+                            o[c] += tmp[c] * wx;
+                        }
+                    }
+                }
+            }
+        }
+    }
 
     /**
-     * @brief Release
+     * @brief ProcessAux
+     * @param imgIn
+     * @param imgOut
+     * @return
      */
-    void Release() {
-        for(unsigned int i = 1; i < stack.size(); i++) {
-            if(stack[i] != NULL){
-                delete stack[i];
+    Image *ProcessAux(Image *imgIn, Image *imgOut)
+    {
+        if(imgOut == NULL) {
+            imgOut = imgIn->Clone();
+        } else {
+            if(imgOut != imgIn) {
+                *imgOut = *imgIn;
             }
         }
 
-        stack.clear();
+        if(int(value.size()) < imgOut->channels) {
+            value.resize(imgOut->channels, 0.0f);
+        }
+
+        Allocate(imgOut);
+
+        //Pull
+        int n = int(levels.size()) - 1;
+        for(int i = 0; i < n; i++) {
+            Reduce(i);
+        }
+
+        //Push
+        for(int i = (n - 1); i >= 0; i--) {
+            Expand(i);
+        }
+
+        imgOut->InvalidateCache();
+
+        return imgOut;
     }
 
 public:
@@ -56,19 +397,28 @@ public:
      */
     PushPull()
     {
-        flt_down = NULL;
-        flt_up = NULL;
+        width = -1;
+        height = -1;
+        channels = -1;
+
+        threshold = 1e-6f;
+
+        maskType = PP_VALUE;
+        mask = NULL;
+        bits = NULL;
     }
 
     ~PushPull()
     {
-        Release();
     }
 
     /**
-     * @brief Process computes push-pull.
-     * @param img
-     * @param value
+     * @brief Process computes push-pull; missing samples are the ones
+     * equal to value.
+     * @param imgIn
+     * @param imgOut
+     * @param value is the color of missing samples; if NULL it is black.
+     * @param threshold is the squared distance under which a sample is missing.
      * @return
      */
     Image *Process(Image *imgIn, Image *imgOut, float *value = NULL, float threshold = 1e-6f)
@@ -77,54 +427,60 @@ public:
             return imgOut;
         }
 
-        if(imgOut == NULL) {
-            imgOut = imgIn->Clone();
-        } else {
-            *imgOut = *imgIn;
+        this->value.assign(imgIn->channels, 0.0f);
+        if(value != NULL) {
+            for(int i = 0; i < imgIn->channels; i++) {
+                this->value[i] = value[i];
+            }
         }
 
-        if(flt_down == NULL) {
-            flt_down = new FilterDownPP(value, threshold);
-        } else {
-            flt_down->Update(value, threshold);
-        }
+        this->threshold = threshold > 0.0f ? threshold : 1e-4f;
 
-        if(flt_up == NULL) {
-            flt_up = new FilterUpPP(value, threshold);
-        } else {
-            flt_up->Update(value, threshold);
-        }
+        maskType = PP_VALUE;
+        return ProcessAux(imgIn, imgOut);
+    }
 
-        Image *work = imgOut;
+    /**
+     * @brief ProcessMask computes push-pull; missing samples are marked
+     * as true in mask.
+     * @param imgIn
+     * @param imgOut
+     * @param mask is a width * height mask.
+     * @return
+     */
+    Image *ProcessMask(Image *imgIn, Image *imgOut, bool *mask)
+    {
+        if((imgIn == NULL) || (mask == NULL)) {
+            return imgOut;
+        }
 
-        if(stack.empty()) { //creating the pyramid: Pull
-            stack.push_back(imgOut);
+        value.assign(imgIn->channels, 0.0f);
 
-            while(MIN(work->width, work->height) > 1) {
-                Image *tmp = flt_down->Process(Single(work), NULL);
+        maskType = PP_MASK;
+        this->mask = mask;
+        return ProcessAux(imgIn, imgOut);
+    }
 
-                if(tmp != NULL) {
-                    stack.push_back(tmp);
-                    work = tmp;
-                }
-            }
-        } else { //updating previously created pyramid: Pull
-            int c = 1;
-            while(MIN(work->width, work->height) > 1) {
-                flt_down->Process(Single(work), stack[c]);
-                work = stack[c];
-                c++;
-            }
+    /**
+     * @brief ProcessBits computes push-pull; missing samples are set bits
+     * in a mask packed as in MaskMorphology, i.e. rows of (width + 63) / 64
+     * words and pixel x at bit (x & 63) of word (x >> 6).
+     * @param imgIn
+     * @param imgOut
+     * @param bits
+     * @return
+     */
+    Image *ProcessBits(Image *imgIn, Image *imgOut, unsigned long long *bits)
+    {
+        if((imgIn == NULL) || (bits == NULL)) {
+            return imgOut;
         }
 
-        //sampling from the pyramid (stack): Push
-        int n = (stack.size() - 2);
-
-        for(int i = n; i >= 0; i--) {
-            flt_up->ProcessP(Single(stack[i + 1]), stack[i]);
-        }
+        value.assign(imgIn->channels, 0.0f);
 
-        return imgOut;
+        maskType = PP_BITS;
+        this->bits = bits;
+        return ProcessAux(imgIn, imgOut);
     }
 
     /**
@@ -135,30 +491,34 @@ public:
      */
     static Image *Execute(Image *img, float value)
     {
-        PushPull pp;
-
-        float *tmp_value = new float[img->channels];
-        for(int i = 0; i < img->channels; i++) {
-            tmp_value[i] = value;
+        if(img == NULL) {
+            return NULL;
         }
 
-        return pp.Process(img, NULL, tmp_value);
+        PushPull pp;
 
-        delete tmp_value;
+        std::vector<float> tmp_value(img->channels, value);
+        return pp.Process(img, NULL, &tmp_value[0]);
     }
 
     /**
-     * @brief Execute
+     * @brief Execute fills the image in place.
      * @param name
      * @param nameOut
      * @return
      */
     static Image *Execute(std::string name, std::string nameOut)
     {
-        Image img(name);
-        Image *imgOut = Execute(&img, 0.0f);
-        imgOut->Write(nameOut);
-        return imgOut;
+        Image *img = new Image(name);
+
+        if(img->isValid()) {
+            PushPull pp;
+            std::vector<float> tmp_value(img->channels, 0.0f);
+            pp.Process(img, img, &tmp_value[0]);
+            img->Write(nameOut);
+        }
+
+        return img;
     }
 };
 
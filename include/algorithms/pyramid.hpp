@@ -19,10 +19,8 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #define PIC_ALGORITHMS_PYRAMID_HPP
 
 #include "image.hpp"
-#include "filtering/filter_gaussian_2d.hpp"
-#include "filtering/filter_sampler_2d.hpp"
-#include "filtering/filter_sampler_2dsub.hpp"
-#include "filtering/filter_sampler_2dadd.hpp"
+#include "filtering/filter_reduce_2d.hpp"
+#include "filtering/filter_expand_2d.hpp"
 
 namespace pic {
 
@@ -35,18 +33,12 @@ protected:
     bool    lapGauss;
     int     limitLevel;
 
-    FilterGaussian2D	*flt_gauss;
-    FilterSampler2D		*flt_sampler;
-    FilterSampler2DSub	*flt_sub;
-    FilterSampler2DAdd  *flt_add;
+    FilterReduce2D      flt_reduce;
+    FilterExpand2D      flt_sub;
+    FilterExpand2D      flt_add;
 
     ImageVec trackerRec, trackerUp;
 
-    /**
-     * @brief InitFilters
-     */
-    void InitFilters();
-
     /**
      * @brief Create
      * @param img
@@ -118,6 +110,16 @@ public:
      */
     void Add(const Pyramid *pyr);
 
+    /**
+     * @brief MulAdd is a fused multiply-accumulate between pyramids
+     * ( this += pyr * weight ). Each level is traversed once, and the work
+     * is split across levels and rows.
+     * @param pyr
+     * @param weight is a pyramid with one channel or with the same
+     * number of channels of pyr.
+     */
+    void MulAdd(const Pyramid *pyr, const Pyramid *weight);
+
     /**
      * @brief Reconstruct evaluates a Gaussian/Laplacian pyramid.
      * @param imgOut
@@ -152,26 +154,18 @@ public:
     }
 };
 
-Pyramid::Pyramid(Image *img, bool lapGauss, int limitLevel = 1)
+Pyramid::Pyramid(Image *img, bool lapGauss, int limitLevel = 1) :
+    flt_sub(EO_SUB), flt_add(EO_ADD)
 {
-    flt_gauss = NULL;
-    flt_sampler = NULL;
-    flt_sub = NULL;
-    flt_add = NULL;
-
     if(img != NULL) {
         Create(img, img->width, img->height, img->channels, lapGauss, limitLevel);
     }
 }
 
 
-Pyramid::Pyramid(int width, int height, int channels, bool lapGauss, int limitLevel = 1)
+Pyramid::Pyramid(int width, int height, int channels, bool lapGauss, int limitLevel = 1) :
+    flt_sub(EO_SUB), flt_add(EO_ADD)
 {
-    flt_gauss = NULL;
-    flt_sampler = NULL;
-    flt_sub = NULL;
-    flt_add = NULL;
-
 //    Image *img = new Image(1, width, height, channels);
 //    *img = 0.0f;
 
@@ -187,45 +181,6 @@ Pyramid::~Pyramid()
             delete stack[i];
         }
     }
-
-    if(flt_gauss != NULL) {
-        delete flt_gauss;
-        flt_gauss = NULL;
-    }
-
-    if(flt_sampler != NULL) {
-        delete flt_sampler;
-        flt_sampler = NULL;
-    }
-
-    if(flt_sub != NULL) {
-        delete flt_sub;
-        flt_sub = NULL;
-    }
-
-    if(flt_add != NULL) {
-        delete flt_add;
-        flt_add = NULL;
-    }
-}
-
-void Pyramid::InitFilters()
-{
-    if(flt_gauss == NULL) {
-        flt_gauss = new FilterGaussian2D(1.0f);
-    }
-
-    if(flt_sampler == NULL) {
-        flt_sampler = new FilterSampler2D(0.5f);
-    }
-
-    if(flt_sub == NULL) {
-        flt_sub = new FilterSampler2DSub(NULL);
-    }
-
-    if(flt_add == NULL) {
-        flt_add = new FilterSampler2DAdd(NULL);
-    }
 }
 
 void Pyramid::Create(Image *img, int width, int height, int channels, bool lapGauss, int limitLevel = 1)
@@ -238,8 +193,6 @@ void Pyramid::Create(Image *img, int width, int height, int channels, bool lapGa
 
     this->limitLevel = limitLevel;
 
-    InitFilters();
-
     int levels = MAX(log2(MIN(width, height)) - limitLevel, 1);
 
     if(img == NULL) {
@@ -274,15 +227,13 @@ void Pyramid::Create(Image *img, int width, int height, int channels, bool lapGa
 
     for(int i = 0; i < levels; i++) {
 
-        tmpG = flt_gauss->ProcessP(Single(tmpImg), NULL);
-
-        tmpD = flt_sampler->ProcessP(Single(tmpG), NULL);
+        tmpD = flt_reduce.ProcessP(Single(tmpImg), NULL);
 
         if(lapGauss) {	//Laplacian Pyramid
-            flt_sub->ProcessP(Double(tmpImg, tmpD), tmpG);
+            tmpG = flt_sub.ProcessP(Double(tmpImg, tmpD), NULL);
             stack.push_back(tmpG);
         } else {			//Gaussian Pyramid
-            tmpG->Assign(tmpImg);
+            tmpG = tmpImg->Clone();
             stack.push_back(tmpG);
         }
 
@@ -326,16 +277,16 @@ void Pyramid::Update(Image *img)
 
     for(unsigned int i = 0; i < levels; i++) {
 
-        tmpG = flt_gauss->ProcessP(Single(tmpImg), stack[i]);
-
         if(i == (levels - 1)) {
-            tmpD = flt_sampler->ProcessP(Single(tmpG), stack[i + 1]);
+            tmpD = flt_reduce.ProcessP(Single(tmpImg), stack[i + 1]);
         } else {
-            tmpD = flt_sampler->ProcessP(Single(tmpG), trackerUp[i]);
+            tmpD = flt_reduce.ProcessP(Single(tmpImg), trackerUp[i]);
         }
 
+        tmpG = stack[i];
+
         if(lapGauss) {	//Laplacian Pyramid
-            flt_sub->ProcessP(Double(tmpImg, tmpD), tmpG);
+            flt_sub.ProcessP(Double(tmpImg, tmpD), tmpG);
         } else {		//Gaussian Pyramid
             tmpG->Assign(tmpImg);
         }
@@ -355,7 +306,7 @@ Image *Pyramid::Reconstruct(Image *imgOut = NULL)
 
     if(trackerRec.empty()) {
         for(int i = n; i >= 2; i--) {
-            Image *tmp2 = flt_add->ProcessP(Double(stack[i - 1], tmp), NULL);
+            Image *tmp2 = flt_add.ProcessP(Double(stack[i - 1], tmp), NULL);
             trackerRec.push_back(tmp2);
             tmp = tmp2;
         }
@@ -363,13 +314,13 @@ Image *Pyramid::Reconstruct(Image *imgOut = NULL)
         int c = 0;
 
         for(int i = n; i >= 2; i--) {
-            flt_add->ProcessP(Double(stack[i - 1], tmp), trackerRec[c]);
+            flt_add.ProcessP(Double(stack[i - 1], tmp), trackerRec[c]);
             tmp = trackerRec[c];
             c++;
         }
     }    
 
-    imgOut = flt_add->ProcessP(Double(stack[0], tmp), imgOut);
+    imgOut = flt_add.ProcessP(Double(stack[0], tmp), imgOut);
 
     return imgOut;
 }
@@ -403,6 +354,63 @@ void Pyramid::Add(const Pyramid *pyr)
     }
 }
 
+void Pyramid::MulAdd(const Pyramid *pyr, const Pyramid *weight)
+{
+    if((stack.size() != pyr->stack.size()) ||
+       (stack.size() != weight->stack.size())) {
+        return;
+    }
+
+    //work is split in rows' chunks over all levels
+    std::vector< int > job_level, job_y0;
+
+    for(unsigned int i = 0; i < stack.size(); i++) {
+        int height = stack[i]->height;
+        int rows = MAX(TILE_SIZE * TILE_SIZE / MAX(stack[i]->width, 1), 1);
+
+        for(int j = 0; j < height; j += rows) {
+            job_level.push_back(i);
+            job_y0.push_back(j);
+        }
+    }
+
+    int n = int(job_level.size());
+
+    #pragma omp parallel for schedule(dynamic)
+    for(int k = 0; k < n; k++) {
+        int i = job_level[k];
+
+        Image *out = stack[i];
+        Image *in  = pyr->stack[i];
+        Image *w   = weight->stack[i];
+
+        int channels = out->channels;
+        int rows = MAX(TILE_SIZE * TILE_SIZE / MAX(out->width, 1), 1);
+
+        int ind0 = job_y0[k] * out->width;
+        int ind1 = MIN(job_y0[k] + rows, out->height) * out->width;
+
+        if(w->channels == 1) {
+            for(int ind = ind0; ind < ind1; ind++) {
+                float val = w->data[ind];
+                int c = ind * channels;
+
+                for(int l = 0; l < channels; l++) {
+                    out->data[c + l] += in->data[c + l] * val;
+                }
+            }
+        } else {
+            for(int c = ind0 * channels; c < ind1 * channels; c++) {
+                out->data[c] += in->data[c] * w->data[c];
+            }
+        }
+    }
+
+    for(unsigned int i = 0; i < stack.size(); i++) {
+        stack[i]->InvalidateCache();
+    }
+}
+
 void Pyramid::Blend(Pyramid *pyr, Pyramid *weight)
 {
     if((stack.size() != pyr->stack.size()) && (pyr->stack.size() > 0)) {
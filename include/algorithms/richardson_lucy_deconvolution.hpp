@@ -24,7 +24,8 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 namespace pic {
 
 /**
- * @brief RichardsonLucyDeconvolution
+ * @brief RichardsonLucyDeconvolution; convolutions pick FFTs for large
+ * PSFs, and the spectra of psf and its flipped version are computed once.
  * @param imgIn
  * @param psf
  * @param nIterations
@@ -76,6 +77,9 @@ Image *RichardsonLucyDeconvolution(Image *imgIn, Image *psf, int nIterations = 1
     }
 
     delete img_est_conv;
+    delete img_err;
+    delete img_rel_blur;
+    delete psf_hat;
 
     return imgOut;
 }
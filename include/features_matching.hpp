@@ -22,6 +22,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 //Corner descriptors
 #include "features_matching/general_corner_detector.hpp"
+#include "features_matching/structure_tensor.hpp"
 #include "features_matching/harris_corner_detector.hpp"
 #include "features_matching/susan_corner_detector.hpp"
 #include "features_matching/fast_corner_detector.hpp"
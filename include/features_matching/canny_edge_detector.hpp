@@ -23,9 +23,10 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "image.hpp"
 
 #include "filtering/filter_luminance.hpp"
-#include "filtering/filter_gaussian_2d.hpp"
 #include "filtering/filter_gradient.hpp"
 
+#include "features_matching/structure_tensor.hpp"
+
 namespace pic {
 
 /**
@@ -122,12 +123,8 @@ public:
             lum = FilterLuminance::Execute(img, lum, LT_CIE_LUMINANCE);
         }
 
-        //Filtering the image
-        FilterGaussian2D flt(sigma);
-        Image *lum_flt = flt.ProcessP(Single(lum), NULL);
-
-        FilterGradient fltGrad(0, G_SOBEL);
-        Image *grad = fltGrad.ProcessP(Single(lum_flt), NULL);
+        //Filtering the image and computing its gradient in a single pass
+        Image *grad = StructureTensor::Gradient(lum, NULL, sigma, G_SOBEL);
 
         //non-maximum suppression
         if(imgEdges == NULL) {
@@ -149,29 +146,29 @@ public:
 
                 if(((angle >=   0.0f) && (angle < 22.5f)) ||
                    ((angle >= 157.5f))) {
-                    bMax = (tmp_grad[0] > (*grad)(j + 1, i)[0]) &&
-                           (tmp_grad[0] > (*grad)(j - 1, i)[0]);
+                    bMax = (tmp_grad[2] > (*grad)(j + 1, i)[2]) &&
+                           (tmp_grad[2] > (*grad)(j - 1, i)[2]);
                 }
 
                 if((angle >= 22.5f) && (angle < 67.5f)) {
-                    bMax = (tmp_grad[0] > (*grad)(j + 1, i + 1)[0]) &&
-                           (tmp_grad[0] > (*grad)(j - 1, i - 1)[0]);
+                    bMax = (tmp_grad[2] > (*grad)(j + 1, i + 1)[2]) &&
+                           (tmp_grad[2] > (*grad)(j - 1, i - 1)[2]);
                 }
 
                 if((angle >= 67.5f) && (angle < 112.5f)) {
-                    bMax = (tmp_grad[0] > (*grad)(j, i + 1)[0]) &&
-                           (tmp_grad[0] > (*grad)(j, i - 1)[0]);
+                    bMax = (tmp_grad[2] > (*grad)(j, i + 1)[2]) &&
+                           (tmp_grad[2] > (*grad)(j, i - 1)[2]);
                 }
 
                 if((angle >= 112.5f) && (angle < 157.5f)) {
-                    bMax = (tmp_grad[0] > (*grad)(j - 1, i + 1)[0]) &&
-                           (tmp_grad[0] > (*grad)(j + 1, i - 1)[0]);
+                    bMax = (tmp_grad[2] > (*grad)(j - 1, i + 1)[2]) &&
+                           (tmp_grad[2] > (*grad)(j + 1, i - 1)[2]);
                 }
 
                 float *tmp_img_edges = (*imgEdges)(j, i);
 
                 if(bMax){
-                    tmp_img_edges[0] = tmp_grad[0];
+                    tmp_img_edges[0] = tmp_grad[2];
                 } else {
                     tmp_img_edges[0] = 0.0f;
                 }
@@ -226,7 +223,6 @@ public:
             }
         }
 
-        delete lum_flt;
         delete grad;
 
         return imgEdges;
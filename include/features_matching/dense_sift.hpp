@@ -15,9 +15,13 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 */
 
+
 #ifndef PIC_FEATURES_MATCHING_DENSE_SIFT_HPP
 #define PIC_FEATURES_MATCHING_DENSE_SIFT_HPP
 
+#include <vector>
+#include <functional>
+
 #include "util/array.hpp"
 
 #include "util/rasterizer.hpp"
@@ -30,6 +34,20 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 namespace pic {
 
+/**
+ * @brief DenseSiftRowCallback receives a row of descriptors: the row index,
+ * the number of descriptors, the number of values per descriptor, and the
+ * descriptors stored contiguously.
+ */
+typedef std::function< void(int, int, int, float *) > DenseSiftRowCallback;
+
+/**
+ * @brief The DenseSift class computes a SIFT-like descriptor for each pixel.
+ * Oriented gradient magnitudes are filtered once per orientation with a
+ * separable bilinear-bin kernel, so a descriptor is assembled by fetching
+ * num_bins x num_bins cells. Descriptors can be stored in an Image or
+ * streamed row by row to a callback.
+ */
 class DenseSift
 {
 protected:
@@ -62,12 +80,160 @@ protected:
     float   CONST_GRADIENT_SUPRESSIO_THRESHOLD;
 
     Image *gauss, *L, *L_X, *L_Y, *gX, *gY, *grad, *I_orientation,
-             *I_orientation_flt, *I_mag, *I_theta;
+             *I_orientation_flt;
     int *shifter;
-    float *cos_angles, *sin_angles;
+    float *cos_angles, *sin_angles, *weight;
 
     FilterConv2D fltConv;
 
+    /**
+     * @brief ComputeOrientations computes the filtered orientation channels
+     * of img into I_orientation_flt.
+     * @param img
+     * @param alpha
+     */
+    void ComputeOrientations(Image *img, float alpha)
+    {
+        L = FilterLuminance::Execute(img, L, LT_CIE_LUMINANCE);
+        float maxVal = L->getMaxVal()[0];
+        *L /= maxVal;
+
+        grad = FilterGradient::Execute(gauss, grad);
+
+        gX = FilterChannel::Execute(grad, gX, 0);
+        gY = FilterChannel::Execute(grad, gY, 1);
+
+        float sX = 0.0f;
+        float sY = 0.0f;
+
+        for(int i = 0; i < gX->size(); i++) {
+            sX += fabsf(gX->data[i]);
+            sY += fabsf(gY->data[i]);
+        }
+
+        *gX *= (2.0f / sX);
+        *gY *= (2.0f / sY);
+
+        L_X = fltConv.ProcessP(Double(L, gX), L_X);
+        L_Y = fltConv.ProcessP(Double(L, gY), L_Y);
+
+        //Calculate orientations
+        int width = L->width;
+        int height = L->height;
+
+        if(I_orientation == NULL) {
+            I_orientation = new Image(1, width, height, num_angles);
+        } else {
+            if((I_orientation->width != width) || (I_orientation->height != height)) {
+                delete I_orientation;
+                I_orientation = new Image(1, width, height, num_angles);
+            }
+        }
+
+        int size = width * height;
+
+        #pragma omp parallel for
+        for(int j = 0; j < size; j++) {
+            float x = L_X->data[j];
+            float y = L_Y->data[j];
+
+            //cos and sin of atan2(y, x)
+            float mag = sqrtf(x * x + y * y);
+            float cosI = mag > 0.0f ? x / mag : 1.0f;
+            float sinI = mag > 0.0f ? y / mag : 0.0f;
+
+            float *out = &I_orientation->data[j * num_angles];
+
+            for(int a = 0; a < num_angles; a++) {
+                float tmp = cosI * cos_angles[a] + sinI * sin_angles[a];
+                tmp = MAX(powf(tmp, alpha), 0.0f);
+                out[a] = tmp * mag;
+            }
+        }
+
+        //Convolution of the orientations using a low-pass filter
+        I_orientation_flt = FilterConv2DSP::Execute(I_orientation, I_orientation_flt,
+                            weight, patch_size);
+    }
+
+    /**
+     * @brief NormalizeDescriptor
+     * @param data
+     * @param n
+     */
+    void NormalizeDescriptor(float *data, int n)
+    {
+        float norm = 0.0f;
+        for(int k = 0; k < n; k++) {
+            norm += data[k] * data[k];
+        }
+
+        norm = sqrtf(norm);
+
+        //normalizing large gradients
+        if(norm <= 1.0f) {
+            return;
+        }
+
+        float inv_norm = 1.0f / norm;
+        for(int k = 0; k < n; k++) {
+            data[k] *= inv_norm;
+        }
+
+        //supressing large gradients
+        if(bLargeGradientsSupression) {
+            norm = 0.0f;
+            for(int k = 0; k < n; k++) {
+                data[k] = MIN(data[k], CONST_GRADIENT_SUPRESSIO_THRESHOLD);
+                norm += data[k] * data[k];
+            }
+
+            if(norm > 0.0f) {
+                inv_norm = 1.0f / sqrtf(norm);
+                for(int k = 0; k < n; k++) {
+                    data[k] *= inv_norm;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief AssembleRow computes the descriptors of the row i of the input
+     * image, for the pixels [half_patch_size, width - half_patch_size).
+     * @param i
+     * @param out
+     */
+    void AssembleRow(int i, float *out)
+    {
+        int width = I_orientation_flt->width;
+        int n = width - 2 * half_patch_size;
+        int channels = getChannels();
+
+        for(int j = 0; j < n; j++) {
+            float *sift_data = &out[j * channels];
+
+            int b = 0;
+
+            for(int y = 0; y < num_bins; y++) {
+                float *row = (*I_orientation_flt)(j + half_patch_size, i + shifter[y]);
+
+                for(int x = 0; x < num_bins; x++) {
+                    float *I_ori_data = row + shifter[x] * num_angles;
+
+                    for(int k = 0; k < num_angles; k++) {
+                        sift_data[b + k] = I_ori_data[k];
+                    }
+
+                    b += num_angles;
+                }
+            }
+
+            if(bNormalization) {
+                NormalizeDescriptor(sift_data, channels);
+            }
+        }
+    }
+
 public:
 
     DenseSift(int patch_size, bool bNormalization, bool bLargeGradientsSupression)
@@ -106,11 +272,12 @@ public:
 
         shifter = new int[num_bins];
 
-        for(int i = 0; i < MIN(num_bins, patch_size); i++) {
+        for(int i = 0; i < num_bins; i++) {
             int tmp = ((patch_size + 1) * i) / (num_bins);
             shifter[i] = tmp - half_patch_size;
         }
 
+        weight = GenKernel(patch_size, num_bins);
     }
 
     ~DenseSift()
@@ -128,12 +295,14 @@ public:
         I_orientation = NULL;
         grad = NULL;
         I_orientation_flt = NULL;
-        I_mag = NULL;
-        I_theta = NULL;
     }
 
     void Destroy()
     {
+        if(gauss != NULL) {
+            delete gauss;
+        }
+
         if(L != NULL) {
             delete L;
         }
@@ -154,7 +323,7 @@ public:
             delete gY;
         }
 
-        if(I_orientation == NULL) {
+        if(I_orientation != NULL) {
             delete I_orientation;
         }
 
@@ -177,139 +346,119 @@ public:
         if(sin_angles != NULL) {
             delete[] sin_angles;
         }
+
+        if(weight != NULL) {
+            delete[] weight;
+        }
+
+        SetNULL();
+        gauss = NULL;
+        shifter = NULL;
+        cos_angles = NULL;
+        sin_angles = NULL;
+        weight = NULL;
+    }
+
+    /**
+     * @brief getChannels returns the number of values of a descriptor.
+     * @return
+     */
+    int getChannels()
+    {
+        return num_samples * num_angles;
     }
 
+    /**
+     * @brief get computes the descriptors of img; the descriptor of the pixel
+     * (x, y) is stored at (x - patch_size / 2, y - patch_size / 2).
+     * @param img
+     * @param sift_arr
+     * @param alpha
+     * @return
+     */
     Image *get(Image *img, Image *sift_arr = NULL, float alpha = 9.0f)
     {
         if(img == NULL) {
             return NULL;
         }
 
-        L = FilterLuminance::Execute(img, L, LT_CIE_LUMINANCE);
-        float maxVal = L->getMaxVal()[0];
-        *L /= maxVal;
-
-        grad = FilterGradient::Execute(gauss, grad);
+        ComputeOrientations(img, alpha);
 
-        gX = FilterChannel::Execute(grad, gX, 0);
-        gY = FilterChannel::Execute(grad, gY, 1);
-
-        float sX = 0.0f;
-        float sY = 0.0f;
+        //Final dense sift
+        int width = L->width;
+        int height = L->height;
 
-        for(int i = 0; i < gX->size(); i++) {
-            sX += fabsf(gX->data[i]);
-            sY += fabsf(gY->data[i]);
+        if(sift_arr == NULL) {
+            sift_arr = new Image(1, width, height, getChannels());
         }
 
-        *gX *= (2.0f / sX);
-        *gY *= (2.0f / sY);
-
-        L_X = fltConv.ProcessP(Double(L, gX), L_X);
-        L_Y = fltConv.ProcessP(Double(L, gY), L_Y);
-
-        if(I_mag == NULL) {
-            I_mag = gX;
-        }
+        sift_arr->SetZero();
 
-        if(I_theta == NULL) {
-            I_theta = gY;
+        #pragma omp parallel for schedule(dynamic)
+        for(int i = half_patch_size; i < (height - half_patch_size); i++) {
+            AssembleRow(i, (*sift_arr)(0, i - half_patch_size));
         }
 
-        int size = L->width * L->height;
+        return sift_arr;
+    }
 
-        for(int i = 0; i < size; i++) {
-            float x = L_X->data[i];
-            float y = L_Y->data[i];
-            I_mag->data[i]   = sqrtf(x * x + y * y);
-            I_theta->data[i] = atan2f(y, x);
+    /**
+     * @brief Process computes the descriptors of img without storing all of
+     * them; rows are computed in parallel in bands of nRows rows, and
+     * callback is invoked for each row, in order, from the calling thread.
+     * @param img
+     * @param callback
+     * @param alpha
+     * @param nRows
+     */
+    void Process(Image *img, DenseSiftRowCallback callback, float alpha = 9.0f, int nRows = 32)
+    {
+        if(img == NULL) {
+            return;
         }
 
-        //Calculate orientations
+        ComputeOrientations(img, alpha);
+
         int width = L->width;
         int height = L->height;
 
-        if(I_orientation == NULL) {
-            I_orientation = new Image(1, width, height, num_angles);
-        }
-
-        int size_n = size * num_angles;
-
-        for(int i = 0; i < size_n; i += num_angles) {
-            int j = i / num_angles;
-
-            float cosI = cosf(I_theta->data[j]);
-            float sinI = sinf(I_theta->data[j]);
-
-            float tmp;
-
-            for(int a = 0; a < num_angles; a++) {
-                tmp = cosI * cos_angles[a] + sinI * sin_angles[a];
-                tmp = MAX(powf(tmp, alpha), 0.0f);
-                I_orientation->data[i + a] = tmp * I_mag->data[j];
-            }
-        }
-
-        //Convolution of the orientations using a low-pass filter
-        I_orientation_flt = FilterConv2DSP::Execute(I_orientation, I_orientation_flt,
-                            GenKernel(patch_size, num_bins), patch_size);
+        int n = width - 2 * half_patch_size;
+        int i1 = height - half_patch_size;
 
-        //Final dense sift
-        if(sift_arr == NULL) {
-            sift_arr = new Image(1, width, height, num_bins * num_bins * num_angles);
+        if(n <= 0 || i1 <= half_patch_size) {
+            return;
         }
 
-        sift_arr->SetZero();
-
-        for(int i = half_patch_size; i < (height - half_patch_size); i++) {
-            for(int j = half_patch_size; j < (width - half_patch_size); j++) {
-                float *sift_data = (*sift_arr)(j - half_patch_size, i - half_patch_size);
-
-                int b = 0;
+        int channels = getChannels();
+        nRows = MAX(nRows, 1);
 
-                for(int y = 0; y < num_bins; y++) {
-                    for(int x = 0; x < num_bins; x++) {
-                        float *I_ori_data = (*I_orientation_flt)(j + shifter[x], i + shifter[y]);
+        std::vector< float > band(nRows * n * channels);
 
-                        for(int k = 0; k < num_angles; k++) {
-                            sift_data[b + k] = I_ori_data[k];
-                        }
+        for(int i0 = half_patch_size; i0 < i1; i0 += nRows) {
+            int nb = MIN(nRows, i1 - i0);
 
-                        b += num_angles;
-                    }
-                }
+            #pragma omp parallel for schedule(dynamic)
+            for(int k = 0; k < nb; k++) {
+                AssembleRow(i0 + k, &band[k * n * channels]);
             }
-        }
 
-        if(bNormalization) {
-            Normalization(sift_arr);
+            for(int k = 0; k < nb; k++) {
+                callback(i0 + k - half_patch_size, n, channels, &band[k * n * channels]);
+            }
         }
-
-        return sift_arr;
     }
 
-    void Normalization(Image *sift_arr) //normalziation of the sift
+    /**
+     * @brief Normalization normalizes the descriptors of sift_arr.
+     * @param sift_arr
+     */
+    void Normalization(Image *sift_arr)
     {
-        for(int i = 0; i < sift_arr->height; i++) {
-            for(int j = 0; j < sift_arr->width; j++) {
-                float *tmp_pixel = (*sift_arr)(j, i);
-
-                //normalizing large gradients
-                float norm = Array<float>::norm(tmp_pixel, sift_arr->channels);
-
-                if(norm > 1.0f) {
-                    Array<float>::normalize(tmp_pixel, sift_arr->channels, norm);
-
-                    //supressing large gradients
-                    if(bLargeGradientsSupression) {
-                        for(int k = 0; k < sift_arr->channels; k++) {
-                            tmp_pixel[k] = MIN(tmp_pixel[k], CONST_GRADIENT_SUPRESSIO_THRESHOLD);
-                        }
+        int n = sift_arr->width * sift_arr->height;
 
-                        Array<float>::normalize(tmp_pixel, sift_arr->channels);
-                    }
-                }
-            }
+        #pragma omp parallel for
+        for(int i = 0; i < n; i++) {
+            NormalizeDescriptor(&sift_arr->data[i * sift_arr->channels], sift_arr->channels);
         }
     }
 
@@ -318,4 +467,3 @@ public:
 } // end namespace pic
 
 #endif /* PIC_FEATURES_MATCHING_DENSE_SIFT_HPP */
-
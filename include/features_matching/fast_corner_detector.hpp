@@ -15,13 +15,18 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 */
 
+
 #ifndef PIC_FEATURES_MATCHING_FAST_CORNER_DETECTOR_HPP
 #define PIC_FEATURES_MATCHING_FAST_CORNER_DETECTOR_HPP
 
+#include <vector>
+#include <algorithm>
+
 #include "util/vec.hpp"
 
 #include "image.hpp"
 #include "filtering/filter_luminance.hpp"
+#include "filtering/filter_gaussian_2d.hpp"
 
 #include "features_matching/general_corner_detector.hpp"
 
@@ -33,20 +38,194 @@ namespace pic {
 
 #ifndef PIC_DISABLE_EIGEN
 
+/**
+ * @brief The FastCornerDetector class implements the FAST-9 and FAST-12
+ * segment tests. The 16 samples on the circle are compared against blocks of
+ * pixels at once and packed into 16-bit masks, and contiguous arcs are
+ * detected with a lookup table.
+ */
 class FastCornerDetector: public GeneralCornerDetector
 {
 protected:
-    Image *lum_flt;
+    Image     *lum_flt;
     bool      bComputeThreshold;
 
     float     sigma, threshold;
-    int       radius;
+    int       radius, arc;
+
+    //top-K output
+    int       nBest, grid_x, grid_y;
+
+    /**
+     * @brief ComputeArcTable computes, for each 16-bit mask, the length of
+     * the longest circular run of set bits.
+     * @return
+     */
+    static std::vector< unsigned char > ComputeArcTable()
+    {
+        std::vector< unsigned char > table(65536);
+
+        for(int m = 0; m < 65536; m++) {
+            int best = 0;
+            int run = 0;
+
+            for(int k = 0; k < 32; k++) {
+                if((m >> (k & 15)) & 1) {
+                    run++;
+                    best = MAX(best, run);
+                } else {
+                    run = 0;
+                }
+            }
+
+            table[m] = (unsigned char) MIN(best, 16);
+        }
+
+        return table;
+    }
+
+    /**
+     * @brief getArcTable
+     * @return
+     */
+    static const unsigned char *getArcTable()
+    {
+        static std::vector< unsigned char > table = ComputeArcTable();
+        return &table[0];
+    }
+
+    /**
+     * @brief SegmentTest compares nb contiguous pixels against their
+     * 16 samples on the circle; results are packed into 16-bit masks.
+     * @param p
+     * @param offset
+     * @param bComputeThreshold
+     * @param threshold
+     * @param thr
+     * @param mask_dark
+     * @param mask_bright
+     */
+    template<int nb>
+    static inline void SegmentTest(const float *p, const int *offset, bool bComputeThreshold, float threshold,
+                                   float *thr, int *mask_dark, int *mask_bright)
+    {
+        //local copies avoid aliasing with p
+        float t[nb], p_dark[nb], p_bright[nb];
+        int m_dark[nb], m_bright[nb];
+
+        //computing the threshold
+        if(bComputeThreshold) {
+            for(int b = 0; b < nb; b++) {
+                t[b] = p[b];
+            }
+
+            for(int k = 0; k < 16; k++) {
+                const float *c = p + offset[k];
+                for(int b = 0; b < nb; b++) {
+                    t[b] += c[b];
+                }
+            }
+
+            for(int b = 0; b < nb; b++) {
+                float tmp = 0.2f * t[b] / 16.0f;
+                t[b] = (tmp > 1e-9f) ? tmp : threshold;
+            }
+        } else {
+            for(int b = 0; b < nb; b++) {
+                t[b] = threshold;
+            }
+        }
+
+        for(int b = 0; b < nb; b++) {
+            p_dark[b]   = p[b] - t[b];
+            p_bright[b] = p[b] + t[b];
+            m_dark[b]   = 0;
+            m_bright[b] = 0;
+        }
+
+        //testing
+        for(int k = 0; k < 16; k++) {
+            const float *c = p + offset[k];
+            int bit = 1 << k;
+            for(int b = 0; b < nb; b++) {
+                m_dark[b]   |= (c[b] <= p_dark[b])   ? bit : 0;
+                m_bright[b] |= (c[b] >= p_bright[b]) ? bit : 0;
+            }
+        }
+
+        for(int b = 0; b < nb; b++) {
+            thr[b] = t[b];
+            mask_dark[b]   = m_dark[b];
+            mask_bright[b] = m_bright[b];
+        }
+    }
+
+    /**
+     * @brief SelectBest keeps the best nBest corners spreading them over
+     * a grid_x x grid_y grid.
+     * @param score
+     * @param candidates
+     * @param width
+     * @param height
+     */
+    void SelectBest(std::vector< float > &score, std::vector< int > &candidates,
+                    int width, int height)
+    {
+        int nCells = grid_x * grid_y;
+        int nCell = (nBest + nCells - 1) / nCells;
+
+        std::vector< std::vector< std::pair<float, int> > > cells(nCells);
+
+        for(unsigned int i = 0; i < candidates.size(); i++) {
+            int ind = candidates[i];
+            int cx = MIN(((ind % width) * grid_x) / width,  grid_x - 1);
+            int cy = MIN(((ind / width) * grid_y) / height, grid_y - 1);
+
+            cells[cy * grid_x + cx].push_back(std::make_pair(-score[ind], ind));
+        }
+
+        std::vector< std::pair<float, int> > selected;
+
+        for(int i = 0; i < nCells; i++) {
+            std::vector< std::pair<float, int> > &cell = cells[i];
+
+            int n = MIN(nCell, int(cell.size()));
+            std::partial_sort(cell.begin(), cell.begin() + n, cell.end());
+
+            selected.insert(selected.end(), cell.begin(), cell.begin() + n);
+        }
+
+        std::sort(selected.begin(), selected.end());
+
+        if(int(selected.size()) > nBest) {
+            selected.resize(nBest);
+        }
+
+        candidates.clear();
+        for(unsigned int i = 0; i < selected.size(); i++) {
+            candidates.push_back(selected[i].second);
+        }
+    }
 
 public:
-    FastCornerDetector(float sigma = 1.0f, int radius = 1, float threshold = 0.001f) : GeneralCornerDetector()
+
+    /**
+     * @brief FastCornerDetector
+     * @param sigma is the standard deviation of the Gaussian pre-filter.
+     * @param radius is the radius of the non-maximal suppression.
+     * @param threshold
+     * @param arc is the length of the contiguous arc; 9 or 12.
+     */
+    FastCornerDetector(float sigma = 1.0f, int radius = 1, float threshold = 0.001f, int arc = 12) : GeneralCornerDetector()
     {
+        lum_flt = NULL;
         bComputeThreshold = true;
-        Update(sigma, radius, threshold);
+
+        nBest = 0;
+        grid_x = 1;
+        grid_y = 1;
+
+        Update(sigma, radius, threshold, arc);
     }
 
     ~FastCornerDetector()
@@ -54,9 +233,20 @@ public:
         if(bLum) {
             delete lum;
         }
+
+        if(lum_flt != NULL) {
+            delete lum_flt;
+        }
     }
 
-    void Update(float sigma = 1.0f, int radius = 1, float threshold = 0.001f)
+    /**
+     * @brief Update
+     * @param sigma
+     * @param radius
+     * @param threshold
+     * @param arc
+     */
+    void Update(float sigma = 1.0f, int radius = 1, float threshold = 0.001f, int arc = 12)
     {
         if(sigma > 0.0f) {
             this->sigma = sigma;
@@ -75,8 +265,30 @@ public:
         } else {
             this->threshold = 0.001f;
         }
+
+        this->arc = CLAMPi(arc, 9, 16);
+    }
+
+    /**
+     * @brief SetBest limits the output to the nBest strongest corners, which
+     * are evenly distributed over a grid_x x grid_y grid of cells. In this
+     * mode, corners are sorted by decreasing score.
+     * @param nBest is the maximum number of corners; 0 means no limit.
+     * @param grid_x
+     * @param grid_y
+     */
+    void SetBest(int nBest, int grid_x = 1, int grid_y = 1)
+    {
+        this->nBest = MAX(nBest, 0);
+        this->grid_x = MAX(grid_x, 1);
+        this->grid_y = MAX(grid_y, 1);
     }
 
+    /**
+     * @brief Compute
+     * @param img
+     * @param corners
+     */
     void Compute(Image *img, std::vector< Eigen::Vector3f > *corners)
     {
         if(img == NULL) {
@@ -99,168 +311,127 @@ public:
 
         //Filtering the image
         FilterGaussian2D flt(sigma);
-        lum_flt = flt.ProcessP(Single(lum), NULL);
+        lum_flt = flt.ProcessP(Single(lum), lum_flt);
 
-        int x[] = {0, 1, 2, 3, 3,  3,  2,  1,  0, -1, -2, -3, -3, -3, -2, -1};
-        int y[] = {3, 3, 2, 1, 0, -1, -2, -3, -3, -3, -2, -1,  0,  1,  2,  3};
+        const int x[] = {0, 1, 2, 3, 3,  3,  2,  1,  0, -1, -2, -3, -3, -3, -2, -1};
+        const int y[] = {3, 3, 2, 1, 0, -1, -2, -3, -3, -3, -2, -1,  0,  1,  2,  3};
 
         int width  = lum_flt->width;
         int height = lum_flt->height;
 
-        bool *corners_map = new bool[width * height];
-
-        memset(corners_map, 0, sizeof(bool) * width *  height);
-
-        Image V(1,width, height, 1);
-        V.SetZero();
+        if(width < 7 || height < 7) {
+            return;
+        }
 
-        for(int i=3; i<(height - 3); i++) {
-            for(int j=3; j<(width - 3); j++) {
-                int ind = i * width + j;
+        int offset[16];
+        for(int k = 0; k < 16; k++) {
+            offset[k] = y[k] * width + x[k];
+        }
 
-                float p = lum_flt->data[ind];
+        const unsigned char *arc_table = getArcTable();
 
-                bool bDark[16];
-                bool bBright[16];
-                float v[16];
+        std::vector< float > score(width * height, 0.0f);
+        std::vector< unsigned char > corners_map(width * height, 0);
 
-                float sum = p;
+        //segment test; pixels are processed in blocks
+        const int block = 16;
 
-                for(int k=0; k<16; k++){
-                    float value = (*lum_flt)(j + x[k], i + y[k])[0];
-                    v[k] = value;
-                    sum += value;
-                }
+        #pragma omp parallel for schedule(dynamic)
+        for(int i = 3; i < (height - 3); i++) {
+            float thr[block];
+            int mask_dark[block], mask_bright[block];
 
-                //computing the threshold
-                float thr;
-                if(bComputeThreshold) {
-                    thr = 0.2f * sum / 16.0f;
-                    thr = (thr > 1e-9f ) ? thr : threshold;
+            for(int j0 = 3; j0 < (width - 3); j0 += block) {
+                int nb = MIN(block, width - 3 - j0);
+                int ind = i * width + j0;
+                float *p = &lum_flt->data[ind];
 
+                if(nb == block) {
+                    SegmentTest<block>(p, offset, bComputeThreshold, threshold,
+                                       thr, mask_dark, mask_bright);
                 } else {
-                    thr = threshold;
-                }
-
-                //testing
-                float p_thr_dark   = p - thr;
-                float p_thr_bright = p + thr;
-
-                for(int k=0; k<16; k++){
-                    bDark[k]   = v[k] <= p_thr_dark;
-                    bBright[k] = v[k] >= p_thr_bright;
-                }
-
-                //first test: 0, 4, 8, 12
-                int cDark   = bDark[0]   + bDark[4]   + bDark[8]   + bDark[12];
-                int cBright = bBright[0] + bBright[4] + bBright[8] + bBright[12];
-
-                if((cDark < 3) && (cBright < 3) ){
-                    //corners_map[ind] = false;
-                    continue;
-                }
-
-                //second test: check for 12 continuous true values in bDark or cBright
-                int counter_dark   = 0;
-                int counter_bright = 0;
-
-                //corners_map[ind] = false;
-                for(int k=0; k<16; k++){
-                    if(bDark[k]){
-                        counter_dark++;
-                    } else {
-                        counter_dark = 0;
+                    for(int b = 0; b < nb; b++) {
+                        SegmentTest<1>(p + b, offset, bComputeThreshold, threshold,
+                                       thr + b, mask_dark + b, mask_bright + b);
                     }
+                }
 
-                    if(bBright[k]){
-                        counter_bright++;
-                    } else {
-                        counter_dark = 0;
+                for(int b = 0; b < nb; b++) {
+                    if((arc_table[mask_dark[b]] < arc) && (arc_table[mask_bright[b]] < arc)) {
+                        continue;
                     }
 
-                    if((counter_bright > 11) || (counter_dark > 11)) {
-                        corners_map[ind] = true;
+                    //computing V function
+                    float V_dark   = 0.0f;
+                    float V_bright = 0.0f;
 
-                        //Computing V function
-                        float V_dark   = 0.0f;
-                        float V_bright = 0.0f;
-                        for(int k=0; k<16; k++){
-                            if(bDark[k]) {
-                                V_bright += fabsf(v[k] - p) - thr;
-                            }
+                    for(int k = 0; k < 16; k++) {
+                        float v = p[b + offset[k]];
 
-                            if(bBright[k]) {
-                                V_dark += fabsf(p - v[k]) - thr;
-                            }
+                        if((mask_dark[b] >> k) & 1) {
+                            V_dark += p[b] - v - thr[b];
                         }
-                        V.data[ind] = MAX(V_bright, V_dark);
 
-                        break;
+                        if((mask_bright[b] >> k) & 1) {
+                            V_bright += v - p[b] - thr[b];
+                        }
                     }
+
+                    corners_map[ind + b] = 1;
+                    score[ind + b] = MAX(V_dark, V_bright);
                 }
             }
         }
 
-        //Maximal supression
-        int side = radius * 2 + 1;
-        int *indices = new int[side * side];
+        //maximal suppression
+        std::vector< std::vector< int > > rows(height);
 
-        for(int i=3; i<(height - 3); i++) {
-            for(int j=3; j<(width - 3); j++) {
+        #pragma omp parallel for schedule(dynamic)
+        for(int i = 3; i < (height - 3); i++) {
+            for(int j = 3; j < (width - 3); j++) {
                 int ind = i * width + j;
 
-                if(!corners_map[ind]){
+                if(!corners_map[ind]) {
                     continue;
                 }
 
-                indices[0] = ind;
-                int counter = 1;
+                float V_value = score[ind];
+                bool bMax = true;
 
-                for(int k = -radius; k <= radius; k++) {
+                for(int k = -radius; (k <= radius) && bMax; k++) {
                     int yy = CLAMP(i + k, height);
 
                     for(int l = -radius; l <= radius; l++) {
-
-                        if((l == 0)&&(k == 0)) {
-                            continue;
-                        }
-
                         int xx = CLAMP(j + l, width);
+                        int ind_n = yy * width + xx;
 
-                        ind = yy * width + xx;
-
-                        if(corners_map[ind]){
-                            indices[counter] = ind;
-                            counter++;
+                        if(corners_map[ind_n] && (score[ind_n] > V_value)) {
+                            bMax = false;
+                            break;
                         }
-
                     }
                 }
 
-                //are other corners near-by?
-                if(counter > 1) {
-                    //finding the maximum value
-                    float V_value = V.data[indices[0]];
-                    int index = 0;
+                if(bMax) {
+                    rows[i].push_back(ind);
+                }
+            }
+        }
 
-                    for(int k=1; k<counter; k++){
-                        if(V.data[indices[k]] > V_value) {
-                            V_value = V.data[indices[k]];
-                            index = k;
-                        }
-                    }
+        std::vector< int > candidates;
+        for(int i = 0; i < height; i++) {
+            candidates.insert(candidates.end(), rows[i].begin(), rows[i].end());
+        }
 
-                    if(index == 0){
-                        corners->push_back(Eigen::Vector3f (float(j), float(i), 1.0f) );
-                    }
-                } else {
-                    corners->push_back(Eigen::Vector3f (float(j), float(i), 1.0f) );
-                }
+        if(nBest > 0) {
+            SelectBest(score, candidates, width, height);
+        }
 
-            }
+        for(unsigned int i = 0; i < candidates.size(); i++) {
+            int ind = candidates[i];
+            corners->push_back(Eigen::Vector3f(float(ind % width), float(ind / width), 1.0f));
         }
     }
-\
 };
 
 #endif
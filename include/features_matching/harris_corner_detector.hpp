@@ -22,10 +22,8 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include "image.hpp"
 #include "filtering/filter_luminance.hpp"
-#include "filtering/filter_gaussian_2d.hpp"
-#include "filtering/filter_conv_1d.hpp"
-#include "filtering/filter_max.hpp"
 #include "features_matching/general_corner_detector.hpp"
+#include "features_matching/structure_tensor.hpp"
 
 #ifndef PIC_DISABLE_EIGEN
 #include "externals/Eigen/Dense"
@@ -41,9 +39,8 @@ namespace pic {
 class HarrisCornerDetector: public GeneralCornerDetector
 {
 protected:
-    Image *Ix, *Iy, *Ixy, *ret;
-    Image *Ix2_flt, *Iy2_flt, *Ixy_flt;
-    Image *filtered;
+    Image *ret;
+    StructureTensor tensor;
 
     //Harris Corners detector parameters
     float sigma, threshold;
@@ -63,42 +60,6 @@ protected:
 
         lum = NULL;
 
-        if(Ix != NULL) {
-            delete Ix;
-        }
-
-        Ix = NULL;
-
-        if(Iy != NULL) {
-            delete Iy;
-        }
-
-        Iy = NULL;
-
-        if(Ix2_flt != NULL) {
-            delete Ix2_flt;
-        }
-
-        Ix2_flt = NULL;
-
-        if(Iy2_flt != NULL) {
-            delete Iy2_flt;
-        }
-
-        Iy2_flt = NULL;
-
-        if(Ixy_flt != NULL) {
-            delete Ixy_flt;
-        }
-
-        Ixy_flt = NULL;
-
-        if(filtered != NULL) {
-            delete filtered;
-        }
-
-        filtered = NULL;
-
         if(ret != NULL) {
             delete ret;
         }
@@ -114,13 +75,6 @@ protected:
         width = -1;
         height = -1;
         lum = NULL;
-        Ix = NULL;
-        Iy = NULL;
-        Ixy = NULL;
-        Ix2_flt = NULL;
-        Iy2_flt = NULL;
-        Ixy_flt = NULL;
-        filtered = NULL;
         ret = NULL;
     }
 
@@ -164,6 +118,8 @@ public:
         }
 
         this->threshold = threshold;
+
+        tensor.Update(this->sigma, CR_HARRIS_NOBLE);
     }
 
     /**
@@ -185,7 +141,11 @@ public:
         }
 
         if(img->channels == 1) {
-            lum = img->Clone();
+            if(lum == NULL) {
+                lum = img->Clone();
+            } else {
+                lum->Assign(img);
+            }
         } else {
             lum = FilterLuminance::Execute(img, lum, LT_CIE_LUMINANCE);
         }
@@ -204,90 +164,48 @@ public:
 
         corners->clear();
 
-        float kernel[] = { -1.0f, 0.0f, 1.0f};
-
-        //Gradients
-        Ix = FilterConv1D::Execute(lum, Ix, kernel, 3, true);
-        Iy = FilterConv1D::Execute(lum, Iy, kernel, 3, false);
-
-        if(Ixy == NULL) {
-            Ixy = Ix->Clone();
-        } else {
-            *Ixy = *Ix;
-        }
-
-        *Ixy *= *Iy;
-
-        *Ix *= *Ix;
-        *Iy *= *Iy;
-
-        float eps = 2.2204e-16f;
-
-        //Filtering the values
-        FilterGaussian2D flt(sigma);
-        Ix2_flt = flt.ProcessP(Single(Ix), Ix2_flt);
-        Iy2_flt = flt.ProcessP(Single(Iy), Iy2_flt);
-        Ixy_flt = flt.ProcessP(Single(Ixy), Ixy_flt);
-
+        //gradients, structure tensor, and response in a single pass
         //ret = (Ix2.*Iy2 - Ixy.^2)./(Ix2 + Iy2 + eps);
-        *Ixy_flt *= *Ixy_flt; //Ixy.^2
+        ret = tensor.Response(lum, ret);
 
-        if(ret == NULL) {
-            ret = Ix2_flt->Clone();
-        } else {
-            *ret = *Ix2_flt;
-        }
+        float thr = threshold;
 
-        *ret *= *Iy2_flt; //Ix2.*Iy2
-        *ret -= *Ixy_flt;
+        if(thr < 0.0f) { //the best i-th points
+            int bestPoints = int(-thr);
 
-        *Ix2_flt += *Iy2_flt;
-        *Ix2_flt += eps;
+            ret->sort();
 
-        *ret /= *Ix2_flt;
+            int n = ret->size();
+            thr = ret->dataTMP[MAX(n - 1 - bestPoints, 0)];
+        }
 
         //Maximal supression
-        filtered = FilterMax::Execute(ret, filtered, radius * 2 + 1);
+        std::vector< int > maxima;
+        StructureTensor::LocalMaxima(ret, radius, thr, 1, maxima);
 
         float w = 1.0f;
 
-        if(threshold < 0.0f) { //the best i-th points
-            int bestPoints = int(-threshold);
-
-            ret->sort();
-
-            int n = ret->size();
-            threshold = ret->dataTMP[n - 1 - bestPoints];
-        }
-
         int width = lum->width;
-        int height = lum->height;
         float *data = ret->data;
 
-        for(int i = 1; i < (height - 1); i++) {
-            int tmp = i * width;
+        for(unsigned int k = 0; k < maxima.size(); k++) {
+            int ind = maxima[k];
+            int i = ind / width;
+            int j = ind % width;
 
-            float i_f = float(i);
             float cx, cy, ax, ay, bx, by, x, y;
 
-            for(int j = 1; j < (width - 1); j++) {
-                int ind = tmp + j;
-
-                if((data[ind] == filtered->data[ind]) && (data[ind] > threshold)) {
+            cx = data[ind];
+            ax = (data[ind - 1] + data[ind + 1]) / 2.0f - cx;
+            bx = ax + cx - data[ind - 1];
+            x = -w * bx / (2.0f * ax);
 
-                    cx = data[ind];
-                    ax = (data[ind - 1] + data[ind + 1]) / 2.0f - cx;
-                    bx = ax + cx - data[ind - 1];
-                    x = -w * bx / (2.0f * ax);
+            cy = data[ind];
+            ay = (data[ind - width] + data[ind + width]) / 2.0f - cy;
+            by = ay + cy - data[ind - width];
+            y = -w * by / (2.0f * ay);
 
-                    cy = data[ind];
-                    ay = (data[ind - width] + data[ind + width]) / 2.0f - cy;
-                    by = ay + cy - data[ind - width];
-                    y = -w * by / (2.0f * ay);
-
-                    corners->push_back(Eigen::Vector3f(float(j) + x, i_f + y, data[ind]));
-                }
-            }
+            corners->push_back(Eigen::Vector3f(float(j) + x, float(i) + y, data[ind]));
         }
     }
 };
@@ -0,0 +1,570 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+
+#ifndef PIC_FEATURES_MATCHING_STRUCTURE_TENSOR_HPP
+#define PIC_FEATURES_MATCHING_STRUCTURE_TENSOR_HPP
+
+#include <vector>
+
+#include "base.hpp"
+#include "image.hpp"
+#include "util/math.hpp"
+#include "util/precomputed_gaussian.hpp"
+#include "filtering/filter.hpp"
+#include "filtering/filter_gradient.hpp"
+
+namespace pic {
+
+enum CORNER_RESPONSE {CR_HARRIS_NOBLE, CR_HARRIS, CR_SHI_TOMASI};
+
+/**
+ * @brief The StructureTensor class computes gradients, the structure tensor
+ * and its corner response in a single tile pass. Each tile is loaded with a
+ * halo, and gradients, products, windowed sums and the response are computed
+ * in per-thread buffers; no full-size intermediate images are allocated.
+ * Borders are clamped as in FilterConv1D, so results match a sequence of
+ * separable filters.
+ */
+class StructureTensor
+{
+protected:
+    std::vector< float > window;
+    int radius;
+
+    CORNER_RESPONSE type;
+    float k;
+
+    /**
+     * @brief getKernel returns a normalized Gaussian kernel.
+     * @param sigma
+     * @param kernel
+     * @return It returns the half size of the kernel.
+     */
+    static int getKernel(float sigma, std::vector< float > &kernel)
+    {
+        PrecomputedGaussian pg(sigma);
+        kernel.assign(pg.coeff, pg.coeff + pg.kernelSize);
+        return pg.halfKernelSize;
+    }
+
+    /**
+     * @brief LoadClamped copies the first channel of img in [x0, x1) x [y0, y1)
+     * into buf, clamping coordinates at the borders.
+     * @param img
+     * @param x0
+     * @param x1
+     * @param y0
+     * @param y1
+     * @param buf
+     */
+    static void LoadClamped(Image *img, int x0, int x1, int y0, int y1, float *buf)
+    {
+        int w = x1 - x0;
+        int channels = img->channels;
+
+        for(int y = y0; y < y1; y++) {
+            float *row = &img->data[CLAMP(y, img->height) * img->ystride];
+            float *out = &buf[(y - y0) * w];
+
+            for(int x = x0; x < x1; x++) {
+                out[x - x0] = row[CLAMP(x, img->width) * channels];
+            }
+        }
+    }
+
+    /**
+     * @brief Extend copies a (w_in x h_in) buffer into a (w_out x h_out) one,
+     * where the input starts at (off_x, off_y); missing samples are
+     * replicated from the edges.
+     * @param in
+     * @param w_in
+     * @param h_in
+     * @param off_x
+     * @param off_y
+     * @param out
+     * @param w_out
+     * @param h_out
+     */
+    static void Extend(float *in, int w_in, int h_in, int off_x, int off_y,
+                       float *out, int w_out, int h_out)
+    {
+        for(int y = 0; y < h_out; y++) {
+            float *row_in = &in[CLAMPi(y - off_y, 0, h_in - 1) * w_in];
+            float *row_out = &out[y * w_out];
+
+            int x0 = MIN(MAX(off_x, 0), w_out);
+            int x1 = MAX(MIN(off_x + w_in, w_out), x0);
+
+            for(int x = 0; x < x0; x++) {
+                row_out[x] = row_in[0];
+            }
+
+            for(int x = x0; x < x1; x++) {
+                row_out[x] = row_in[x - off_x];
+            }
+
+            for(int x = x1; x < w_out; x++) {
+                row_out[x] = row_in[w_in - 1];
+            }
+        }
+    }
+
+    /**
+     * @brief ConvolveH convolves the rows [0, h) of in, whose width is
+     * (w + 2 * r), with a horizontal kernel of size (2 * r + 1).
+     * @param in
+     * @param w
+     * @param h
+     * @param kernel
+     * @param r
+     * @param out
+     */
+    static void ConvolveH(float *in, int w, int h, float *kernel, int r, float *out)
+    {
+        int w_in = w + 2 * r;
+        int n = 2 * r + 1;
+
+        for(int y = 0; y < h; y++) {
+            float *row_in = &in[y * w_in];
+            float *row_out = &out[y * w];
+
+            for(int x = 0; x < w; x++) {
+                row_out[x] = 0.0f;
+            }
+
+            for(int t = 0; t < n; t++) {
+                float g = kernel[t];
+                float *src = row_in + t;
+
+                for(int x = 0; x < w; x++) {
+                    row_out[x] += g * src[x];
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief ConvolveV convolves a buffer of (w x (h + 2 * r)) vertically.
+     * @param in
+     * @param w
+     * @param h
+     * @param kernel
+     * @param r
+     * @param out
+     */
+    static void ConvolveV(float *in, int w, int h, float *kernel, int r, float *out)
+    {
+        int n = 2 * r + 1;
+
+        for(int y = 0; y < h; y++) {
+            float *row_out = &out[y * w];
+
+            for(int x = 0; x < w; x++) {
+                row_out[x] = 0.0f;
+            }
+
+            for(int t = 0; t < n; t++) {
+                float g = kernel[t];
+                float *src = &in[(y + t) * w];
+
+                for(int x = 0; x < w; x++) {
+                    row_out[x] += g * src[x];
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief getTiles
+     * @param width
+     * @param height
+     * @param nx
+     * @return
+     */
+    static int getTiles(int width, int height, int &nx)
+    {
+        nx = (width + TILE_SIZE - 1) / TILE_SIZE;
+        int ny = (height + TILE_SIZE - 1) / TILE_SIZE;
+        return nx * ny;
+    }
+
+public:
+
+    /**
+     * @brief StructureTensor
+     * @param sigma is the standard deviation of the Gaussian window.
+     * @param type is the corner response.
+     * @param k is the sensitivity of CR_HARRIS.
+     */
+    StructureTensor(float sigma = 1.0f, CORNER_RESPONSE type = CR_HARRIS_NOBLE, float k = 0.04f)
+    {
+        Update(sigma, type, k);
+    }
+
+    /**
+     * @brief Update
+     * @param sigma
+     * @param type
+     * @param k
+     */
+    void Update(float sigma = 1.0f, CORNER_RESPONSE type = CR_HARRIS_NOBLE, float k = 0.04f)
+    {
+        radius = getKernel(sigma > 0.0f ? sigma : 1.0f, window);
+        this->type = type;
+        this->k = k;
+    }
+
+    /**
+     * @brief Response computes the corner response of the first channel
+     * of img. Gradients are central differences, [-1 0 1].
+     * @param img
+     * @param imgOut is a single channel image.
+     * @return
+     */
+    Image *Response(Image *img, Image *imgOut)
+    {
+        if(img == NULL) {
+            return imgOut;
+        }
+
+        int width  = img->width;
+        int height = img->height;
+
+        if(imgOut == NULL) {
+            imgOut = new Image(1, width, height, 1);
+        } else {
+            if((imgOut->width != width) || (imgOut->height != height) || (imgOut->channels != 1)) {
+                imgOut = new Image(1, width, height, 1);
+            }
+        }
+
+        int r = radius;
+        float *g = &window[0];
+
+        int nx;
+        int nTiles = getTiles(width, height, nx);
+
+        int ext = TILE_SIZE + 2 * r;
+        const float eps = 2.2204e-16f;
+
+        #pragma omp parallel
+        {
+            std::vector< float > lum((ext + 2) * (ext + 2));
+            std::vector< float > p(3 * ext * ext), pe(3 * ext * ext);
+            std::vector< float > h(3 * TILE_SIZE * ext), v(3 * TILE_SIZE * TILE_SIZE);
+
+            #pragma omp for schedule(dynamic)
+            for(int t = 0; t < nTiles; t++) {
+                int x0 = (t % nx) * TILE_SIZE;
+                int y0 = (t / nx) * TILE_SIZE;
+                int x1 = MIN(x0 + TILE_SIZE, width);
+                int y1 = MIN(y0 + TILE_SIZE, height);
+
+                int tw = x1 - x0;
+                int th = y1 - y0;
+
+                //products are computed inside the image and then replicated
+                int xlo = MAX(x0 - r, 0);
+                int xhi = MIN(x1 + r, width);
+                int ylo = MAX(y0 - r, 0);
+                int yhi = MIN(y1 + r, height);
+
+                int cw = xhi - xlo;
+                int ch = yhi - ylo;
+                int lw = cw + 2;
+
+                LoadClamped(img, xlo - 1, xhi + 1, ylo - 1, yhi + 1, &lum[0]);
+
+                float *pxx = &p[0];
+                float *pyy = pxx + cw * ch;
+                float *pxy = pyy + cw * ch;
+
+                for(int y = 0; y < ch; y++) {
+                    float *l_c = &lum[(y + 1) * lw];
+                    float *l_u = &lum[y * lw];
+                    float *l_d = &lum[(y + 2) * lw];
+
+                    float *oxx = &pxx[y * cw];
+                    float *oyy = &pyy[y * cw];
+                    float *oxy = &pxy[y * cw];
+
+                    for(int x = 0; x < cw; x++) {
+                        float gx = l_c[x + 2] - l_c[x];
+                        float gy = l_d[x + 1] - l_u[x + 1];
+
+                        oxx[x] = gx * gx;
+                        oyy[x] = gy * gy;
+                        oxy[x] = gx * gy;
+                    }
+                }
+
+                int ew = tw + 2 * r;
+                int eh = th + 2 * r;
+
+                //windowed sums
+                for(int c = 0; c < 3; c++) {
+                    Extend(&p[c * cw * ch], cw, ch, xlo - (x0 - r), ylo - (y0 - r),
+                           &pe[c * ew * eh], ew, eh);
+
+                    ConvolveH(&pe[c * ew * eh], tw, eh, g, r, &h[c * tw * eh]);
+                    ConvolveV(&h[c * tw * eh], tw, th, g, r, &v[c * tw * th]);
+                }
+
+                float *sxx = &v[0];
+                float *syy = sxx + tw * th;
+                float *sxy = syy + tw * th;
+
+                //response
+                for(int y = 0; y < th; y++) {
+                    float *out = &imgOut->data[(y0 + y) * width + x0];
+                    int ind = y * tw;
+
+                    switch(type) {
+                    case CR_HARRIS_NOBLE: {
+                        for(int x = 0; x < tw; x++) {
+                            float a = sxx[ind + x];
+                            float b = sxy[ind + x];
+                            float c = syy[ind + x];
+                            out[x] = (a * c - b * b) / (a + c + eps);
+                        }
+                    }
+                    break;
+
+                    case CR_HARRIS: {
+                        for(int x = 0; x < tw; x++) {
+                            float a = sxx[ind + x];
+                            float b = sxy[ind + x];
+                            float c = syy[ind + x];
+                            float tr = a + c;
+                            out[x] = (a * c - b * b) - k * tr * tr;
+                        }
+                    }
+                    break;
+
+                    case CR_SHI_TOMASI: {
+                        for(int x = 0; x < tw; x++) {
+                            float a = sxx[ind + x];
+                            float b = sxy[ind + x];
+                            float c = syy[ind + x];
+                            float d = (a - c) * 0.5f;
+                            out[x] = (a + c) * 0.5f - sqrtf(d * d + b * b);
+                        }
+                    }
+                    break;
+                    }
+                }
+            }
+        }
+
+        imgOut->InvalidateCache();
+
+        return imgOut;
+    }
+
+    /**
+     * @brief Gradient computes the gradient of the first channel of img,
+     * optionally smoothed by a Gaussian filter, in a single tile pass. This is
+     * equivalent to FilterGaussian2D followed by FilterGradient.
+     * @param img
+     * @param imgOut is a three channels image: (dx, dy, magnitude).
+     * @param sigma is the standard deviation of the pre-filter; no filtering
+     * is applied when sigma <= 0.
+     * @param type
+     * @return
+     */
+    static Image *Gradient(Image *img, Image *imgOut, float sigma = 0.0f,
+                           GRADIENT_TYPE type = G_SOBEL)
+    {
+        if(img == NULL) {
+            return imgOut;
+        }
+
+        int width  = img->width;
+        int height = img->height;
+
+        if(imgOut == NULL) {
+            imgOut = new Image(1, width, height, 3);
+        } else {
+            if((imgOut->width != width) || (imgOut->height != height) || (imgOut->channels != 3)) {
+                imgOut = new Image(1, width, height, 3);
+            }
+        }
+
+        std::vector< float > kernel;
+        int r = 0;
+        if(sigma > 0.0f) {
+            r = getKernel(sigma, kernel);
+        }
+
+        float mask[3];
+        switch(type) {
+        case G_SOBEL: {
+            mask[0] = 1.0f;
+            mask[1] = 2.0f;
+            mask[2] = 1.0f;
+        }
+        break;
+
+        case G_PREWITT: {
+            mask[0] = 1.0f;
+            mask[1] = 1.0f;
+            mask[2] = 1.0f;
+        }
+        break;
+
+        default: {
+            mask[0] = 0.0f;
+            mask[1] = 1.0f;
+            mask[2] = 0.0f;
+        }
+        break;
+        }
+
+        int nx;
+        int nTiles = getTiles(width, height, nx);
+
+        int ext = TILE_SIZE + 2 + 2 * r;
+
+        #pragma omp parallel
+        {
+            std::vector< float > lum(ext * ext), h(ext * ext), b(ext * ext), be(ext * ext);
+
+            #pragma omp for schedule(dynamic)
+            for(int t = 0; t < nTiles; t++) {
+                int x0 = (t % nx) * TILE_SIZE;
+                int y0 = (t / nx) * TILE_SIZE;
+                int x1 = MIN(x0 + TILE_SIZE, width);
+                int y1 = MIN(y0 + TILE_SIZE, height);
+
+                int tw = x1 - x0;
+                int th = y1 - y0;
+
+                //the smoothed image is computed inside the image and then replicated
+                int xlo = MAX(x0 - 1, 0);
+                int xhi = MIN(x1 + 1, width);
+                int ylo = MAX(y0 - 1, 0);
+                int yhi = MIN(y1 + 1, height);
+
+                int cw = xhi - xlo;
+                int ch = yhi - ylo;
+
+                if(r > 0) {
+                    LoadClamped(img, xlo - r, xhi + r, ylo - r, yhi + r, &lum[0]);
+                    ConvolveH(&lum[0], cw, ch + 2 * r, &kernel[0], r, &h[0]);
+                    ConvolveV(&h[0], cw, ch, &kernel[0], r, &b[0]);
+                } else {
+                    LoadClamped(img, xlo, xhi, ylo, yhi, &b[0]);
+                }
+
+                int ew = tw + 2;
+                int eh = th + 2;
+                Extend(&b[0], cw, ch, xlo - (x0 - 1), ylo - (y0 - 1), &be[0], ew, eh);
+
+                for(int y = 0; y < th; y++) {
+                    float *out = &imgOut->data[(y0 + y) * imgOut->ystride + x0 * 3];
+
+                    float *r0 = &be[y * ew];
+                    float *r1 = &be[(y + 1) * ew];
+                    float *r2 = &be[(y + 2) * ew];
+
+                    for(int x = 0; x < tw; x++) {
+                        float gx = mask[0] * (r0[x + 2] - r0[x]) +
+                                   mask[1] * (r1[x + 2] - r1[x]) +
+                                   mask[2] * (r2[x + 2] - r2[x]);
+
+                        float gy = mask[0] * (r2[x] - r0[x]) +
+                                   mask[1] * (r2[x + 1] - r0[x + 1]) +
+                                   mask[2] * (r2[x + 2] - r0[x + 2]);
+
+                        out[x * 3    ] = gx;
+                        out[x * 3 + 1] = gy;
+                        out[x * 3 + 2] = sqrtf(gx * gx + gy * gy);
+                    }
+                }
+            }
+        }
+
+        imgOut->InvalidateCache();
+
+        return imgOut;
+    }
+
+    /**
+     * @brief LocalMaxima finds the pixels of the first channel of img that
+     * are greater than threshold and not smaller than any other pixel in a
+     * (2 * radius + 1)^2 window (clamped at the borders).
+     * @param img
+     * @param radius
+     * @param threshold
+     * @param border is the number of pixels skipped at the borders.
+     * @param indices is the output list of pixel indices, in scanline order.
+     */
+    static void LocalMaxima(Image *img, int radius, float threshold, int border,
+                            std::vector< int > &indices)
+    {
+        indices.clear();
+
+        if(img == NULL) {
+            return;
+        }
+
+        int width  = img->width;
+        int height = img->height;
+        int channels = img->channels;
+        float *data = img->data;
+
+        std::vector< std::vector< int > > rows(height);
+
+        #pragma omp parallel for schedule(dynamic)
+        for(int i = border; i < (height - border); i++) {
+            for(int j = border; j < (width - border); j++) {
+                float value = data[(i * width + j) * channels];
+
+                if(!(value > threshold)) {
+                    continue;
+                }
+
+                bool bMax = true;
+
+                for(int l = -radius; (l <= radius) && bMax; l++) {
+                    float *row = &data[CLAMP(i + l, height) * width * channels];
+
+                    for(int m = -radius; m <= radius; m++) {
+                        if(row[CLAMP(j + m, width) * channels] > value) {
+                            bMax = false;
+                            break;
+                        }
+                    }
+                }
+
+                if(bMax) {
+                    rows[i].push_back(i * width + j);
+                }
+            }
+        }
+
+        for(int i = 0; i < height; i++) {
+            indices.insert(indices.end(), rows[i].begin(), rows[i].end());
+        }
+    }
+};
+
+} // end namespace pic
+
+#endif /* PIC_FEATURES_MATCHING_STRUCTURE_TENSOR_HPP */
+
@@ -22,8 +22,10 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include "image.hpp"
 #include "filtering/filter_luminance.hpp"
+#include "filtering/filter_gaussian_2d.hpp"
 
 #include "features_matching/general_corner_detector.hpp"
+#include "features_matching/structure_tensor.hpp"
 
 #ifndef PIC_DISABLE_EIGEN
 #include "externals/Eigen/Dense"
@@ -128,7 +130,7 @@ public:
 
         //Filtering the image
         FilterGaussian2D flt(sigma);
-        lum_flt = flt.ProcessP(Single(lum), NULL);
+        lum_flt = flt.ProcessP(Single(lum), lum_flt);
 
         //"rasterizing" a circle
         std::vector< int > x, y;
@@ -160,6 +162,8 @@ public:
 
         Image R(1,width, height, 1);
         R.SetZero();
+
+        #pragma omp parallel for schedule(dynamic)
         for(int i=radius; i<(height - radius - 1); i++) {
             for(int j=radius; j<(width - radius - 1); j++) {
 
@@ -184,67 +188,15 @@ public:
             }
         }
 
-        int side = radius_maxima * 2 + 1;
-        int *indices = new int [side * side];
-
-        for(int i=radius_maxima; i<(height - radius_maxima - 1); i++) {
-
-            int tmp = i * width;
-
-            for(int j=radius_maxima; j<(width - radius_maxima - 1); j++) {
-                int ind = tmp + j;
-
-                if(R.data[ind] <= 0.0f) {
-                    continue;
-                }
-
-                indices[0] = ind;
-                int counter = 1;
-
-                for(int k=-radius_maxima; k<=radius_maxima; k++) {
-                    int yy = CLAMP(i + k, height);
+        //Maximal supression
+        std::vector< int > maxima;
+        StructureTensor::LocalMaxima(&R, radius_maxima, 0.0f, radius_maxima, maxima);
 
-                    for(int l=-radius_maxima; l<=radius_maxima; l++) {
-
-                        if((l==0)&&(k==0)) {
-                            continue;
-                        }
-
-                        int xx = CLAMP(j + l, width);
-
-                        ind = yy * width + xx;
-
-                        if(R.data[ind]>0.0f){
-                            indices[counter] = ind;
-                            counter++;
-                        }
-
-                    }
-                }
-
-                //are other corners near-by?
-                if(counter > 1) {
-                    //finding the maximum value
-                    float R_value = R.data[indices[0]];
-                    int index = 0;
-
-                    for(int k=1; k<counter; k++){
-                        if(R.data[indices[k]] > R_value) {
-                            R_value = R.data[indices[k]];
-                            index = k;
-                        }
-                    }
-
-                    if(index == 0){
-                        corners->push_back(Eigen::Vector3f (float(j), float(i), 1.0f) );
-                    }
-                } else {
-                    corners->push_back(Eigen::Vector3f (float(j), float(i), 1.0f) );
-                }
-            }
+        for(unsigned int i = 0; i < maxima.size(); i++) {
+            int ind = maxima[i];
+            corners->push_back(Eigen::Vector3f(float(ind % width), float(ind / width), 1.0f));
         }
     }
-\
 };
 
 #endif
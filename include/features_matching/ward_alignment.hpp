@@ -22,7 +22,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include "image.hpp"
 #include "image_samplers/image_sampler_bilinear.hpp"
-#include "filtering/filter_downsampler_2d.hpp"
+#include "filtering/filter_reduce_2d.hpp"
 #include "filtering/filter_luminance.hpp"
 
 #ifndef PIC_DISABLE_EIGEN
@@ -186,18 +186,28 @@ public:
         cur_shift = Eigen::Vector2i(0, 0);
         ret_shift = Eigen::Vector2i(0, 0);
 
-        Image *sml_img1 = NULL;
-        Image *sml_img2 = NULL;
+        //Gaussian pyramids with 2x REDUCE steps
+        ImageVec pyr1, pyr2;
+        pyr1.push_back(L1);
+        pyr2.push_back(L2);
 
-        while(shift_bits > 0) {
-            float scale = powf(2.0f, float(-shift_bits));
+        FilterReduce2D flt_reduce;
+
+        for(int i = 1; i <= shift_bits; i++) {
+            Image *sml_img1 = flt_reduce.ProcessP(Single(pyr1[i - 1]), NULL);
+            Image *sml_img2 = flt_reduce.ProcessP(Single(pyr2[i - 1]), NULL);
 
-            sml_img1 = FilterDownSampler2D::Execute(L1, NULL, scale);
-            sml_img2 = FilterDownSampler2D::Execute(L2, NULL, scale);
+            pyr1.push_back(sml_img1);
+            pyr2.push_back(sml_img2);
 
             //tracking memory
             img1_v.push_back(sml_img1);
             img2_v.push_back(sml_img2);
+        }
+
+        while(shift_bits > 0) {
+            Image *sml_img1 = pyr1[shift_bits];
+            Image *sml_img2 = pyr2[shift_bits];
 
             int width  = sml_img1->width;
             int height = sml_img1->height;
@@ -22,18 +22,23 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "filtering/filter.hpp"
 #include "filtering/filter_down_pp.hpp"
 #include "filtering/filter_up_pp.hpp"
+#include "filtering/filter_reduce_2d.hpp"
+#include "filtering/filter_expand_2d.hpp"
 #include "filtering/filter_integral_image.hpp"
 #include "filtering/filter_reconstruct.hpp"
 #include "filtering/filter_local_extrema.hpp"
+#include "filtering/filter_local_laplacian.hpp"
 #include "filtering/filter_warp_2d.hpp"
 #include "filtering/filter_absolute_difference.hpp"
 #include "filtering/filter_anisotropic_diffusion.hpp"
+#include "filtering/filter_anisotropic_kuwahara.hpp"
 #include "filtering/filter_assemble_hdr.hpp"
 #include "filtering/filter_backward_difference.hpp"
 #include "filtering/filter_bilateral_1d.hpp"
 #include "filtering/filter_bilateral_2das.hpp"
 #include "filtering/filter_bilateral_2df.hpp"
 #include "filtering/filter_bilateral_2dg.hpp"
+#include "filtering/filter_bilateral_2dpl.hpp"
 #include "filtering/filter_bilateral_2ds.hpp"
 #include "filtering/filter_bilateral_2dsp.hpp"
 #include "filtering/filter_channel.hpp"
@@ -49,6 +54,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "filtering/filter_diff_gauss_2d.hpp"
 #include "filtering/filter_divergence.hpp"
 #include "filtering/filter_downsampler_2d.hpp"
+#include "filtering/filter_domain_transform.hpp"
 #include "filtering/filter_drago_tmo.hpp"
 #include "filtering/filter_gaussian_1d.hpp"
 #include "filtering/filter_gaussian_2d.hpp"
@@ -64,6 +70,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "filtering/filter_mean.hpp"
 #include "filtering/filter_med.hpp"
 #include "filtering/filter_min.hpp"
+#include "filtering/filter_morphology.hpp"
 #include "filtering/filter_mosaic.hpp"
 #include "filtering/filter_demosaic.hpp"
 #include "filtering/filter_normal.hpp"
@@ -78,6 +85,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "filtering/filter_sampling_map.hpp"
 #include "filtering/filter_sigmoid_tmo.hpp"
 #include "filtering/filter_simple_tmo.hpp"
+#include "filtering/filter_tone_curve.hpp"
 #include "filtering/filter_wls.hpp"
 
 #endif /* PIC_FILTERING_HPP */
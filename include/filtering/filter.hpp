@@ -241,6 +241,8 @@ PIC_INLINE Image *Filter::Process(ImageVec imgIn, Image *imgOut)
     BBox tmpBox(imgOut->width, imgOut->height, imgOut->frames);
     ProcessBBox(imgOut, imgIn, &tmpBox);
 
+    imgOut->InvalidateCache();
+
     return imgOut;
 }
 
@@ -278,6 +280,7 @@ PIC_INLINE Image *Filter::ProcessP(ImageVec imgIn, Image *imgOut)
         BBox box(imgOut->width, imgOut->height);
 
         ProcessBBox(imgOut, imgIn, &box);
+        imgOut->InvalidateCache();
         return imgOut;
     }
 
@@ -295,8 +298,13 @@ PIC_INLINE Image *Filter::ProcessP(ImageVec imgIn, Image *imgOut)
     //Threads join
     for(int i = 0; i < numCores; i++) {
         thrd[i]->join();
+        delete thrd[i];
     }
 
+    delete[] thrd;
+
+    imgOut->InvalidateCache();
+
     return imgOut;
 #else
     return Process(imgIn, imgOut);
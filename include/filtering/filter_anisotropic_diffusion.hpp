@@ -24,7 +24,9 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 namespace pic {
 
 /**
- * @brief The FilterAnsiotropicDiffusion class
+ * @brief The FilterAnsiotropicDiffusion class is a step of Perona-Malik
+ * diffusion; it is a stencil of radius 1, so its iterations are
+ * temporally blocked by FilterIterative.
  */
 class FilterAnsiotropicDiffusion: public Filter
 {
@@ -62,8 +64,8 @@ public:
                                           float k, unsigned int mode, unsigned int iterations)
     {
         FilterAnsiotropicDiffusion ansio_flt(k, mode);
-        FilterIterative iter_flt(&ansio_flt, iterations);
-        imgOut = iter_flt.Process(imgIn, imgOut);
+        FilterIterative iter_flt(&ansio_flt, iterations, 1);
+        imgOut = iter_flt.ProcessP(imgIn, imgOut);
         return imgOut;
     }
 
@@ -90,8 +92,8 @@ public:
         unsigned int iterations = int(ceilf(5.0f * sigma_s));
 
         FilterAnsiotropicDiffusion ansio_flt(sigma_r, 1);
-        FilterIterative iter_flt(&ansio_flt, iterations);
-        imgOut = iter_flt.Process(imgIn, imgOut);
+        FilterIterative iter_flt(&ansio_flt, iterations, 1);
+        imgOut = iter_flt.ProcessP(imgIn, imgOut);
         return imgOut;
     }
 
@@ -120,28 +122,27 @@ void FilterAnsiotropicDiffusion::ProcessBBox(Image *dst, ImageVec src,
     //Filtering
     Image *img = src[0];
     int channels = img->channels;
-
-    float *gN = new float [channels];
-    float *gS = new float [channels];
-    float *gW = new float [channels];
-    float *gE = new float [channels];
+    int width = img->width;
+    int height = img->height;
 
     float k2 = k * k;
 
     for(int j = box->y0; j < box->y1; j++) {
-        for(int i = box->x0; i < box->x1; i++) {
+        float *row  = &img->data[j * img->ystride];
+        float *rowW = &img->data[MAX(j - 1, 0) * img->ystride];
+        float *rowE = &img->data[MIN(j + 1, height - 1) * img->ystride];
+        float *out  = &dst->data[j * dst->ystride];
 
-            float *dst_data  = (*dst)(i  , j);
-            float *img_data  = (*img)(i  , j);
-
-            for(int p = 0; p < channels; p++) {
-                dst_data[p] = img_data[p];
-            }
+        for(int i = box->x0; i < box->x1; i++) {
+            int ind  = i * channels;
+            int indN = MIN(i + 1, width - 1) * channels;
+            int indS = MAX(i - 1, 0) * channels;
 
-            float *img_dataN = (*img)(i + 1, j);
-            float *img_dataS = (*img)(i - 1, j);
-            float *img_dataW = (*img)(i  , j - 1);
-            float *img_dataE = (*img)(i  , j + 1);
+            float *img_data  = &row[ind];
+            float *img_dataN = &row[indN];
+            float *img_dataS = &row[indS];
+            float *img_dataW = &rowW[ind];
+            float *img_dataE = &rowE[ind];
 
             float cN = 0.0f;
             float cS = 0.0f;
@@ -149,15 +150,15 @@ void FilterAnsiotropicDiffusion::ProcessBBox(Image *dst, ImageVec src,
             float cE = 0.0f;
 
             for(int p = 0; p < channels; p++) {
-                gN[p] = img_dataN[p] - img_data[p];
-                gS[p] = img_dataS[p] - img_data[p];
-                gW[p] = img_dataW[p] - img_data[p];
-                gE[p] = img_dataE[p] - img_data[p];
-
-                cN += gN[p] * gN[p];
-                cS += gS[p] * gS[p];
-                cW += gW[p] * gW[p];
-                cE += gE[p] * gE[p];
+                float gN = img_dataN[p] - img_data[p];
+                float gS = img_dataS[p] - img_data[p];
+                float gW = img_dataW[p] - img_data[p];
+                float gE = img_dataE[p] - img_data[p];
+
+                cN += gN * gN;
+                cS += gS * gS;
+                cW += gW * gW;
+                cE += gE * gE;
             }
 
             if(mode == 1) {
@@ -174,8 +175,16 @@ void FilterAnsiotropicDiffusion::ProcessBBox(Image *dst, ImageVec src,
                 cE = 1.0f / (1.0f + cE / k2);
             }
 
+            float *dst_data = &out[ind];
+
             for(int p = 0; p < channels; p++) {
-                dst_data[p] += delta_t *(cN * gN[p] + cS * gS[p] + cW * gW[p] + cE * gE[p]);
+                float gN = img_dataN[p] - img_data[p];
+                float gS = img_dataS[p] - img_data[p];
+                float gW = img_dataW[p] - img_data[p];
+                float gE = img_dataE[p] - img_data[p];
+
+                dst_data[p] = img_data[p] + delta_t * (cN * gN + cS * gS +
+                                                       cW * gW + cE * gE);
             }
         }
     }
@@ -0,0 +1,464 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_FILTERING_FILTER_ANISOTROPIC_KUWAHARA_HPP
+#define PIC_FILTERING_FILTER_ANISOTROPIC_KUWAHARA_HPP
+
+#include <math.h>
+#include <vector>
+
+#include "filtering/filter.hpp"
+#include "filtering/filter_gaussian_2d.hpp"
+
+namespace pic {
+
+/**
+ * @brief The FilterAnisotropicKuwahara class is the generalized anisotropic
+ * Kuwahara filter of Kyprianidis et al. with polynomial sector weights:
+ * eight overlapping sectors of an ellipse, which follows the orientation
+ * and anisotropy of the smoothed structure tensor, are blended according
+ * to their variances. The sector weights, times the Gaussian falloff and
+ * normalized, are tabulated once over the unit disk; each sample only maps
+ * its offset into the disk and reads eight weights. Rows of the ellipse
+ * are walked over their exact span. Values are expected to be in [0, 1].
+ * Unlike FilterKuwahara, this filter is not separable and costs O(r^2)
+ * per pixel: the ellipse's orientation and anisotropy change per pixel,
+ * so its sector sums do not factor into 1D passes or summed-area tables.
+ */
+class FilterAnisotropicKuwahara: public Filter
+{
+protected:
+    float radius, q, alpha, sigma_t;
+
+    //normalized sector weights over the unit disk
+    int tableRes, tableSize;
+    std::vector<float> table;
+
+    /**
+     * @brief BuildTable tabulates, on a (2 * tableRes + 1)^2 grid over the
+     * unit disk, the eight polynomial sector weights multiplied by the
+     * Gaussian falloff and divided by their sum. The falloff is the one of
+     * Kyprianidis et al., exp(-3.125 |v|^2) over a disk of radius 0.5,
+     * i.e. sigma = 0.4; on the unit disk it becomes exp(-0.78125 |v|^2),
+     * i.e. sigma = 0.8 and 1 / (2 * 0.8^2) = 0.78125.
+     */
+    void BuildTable()
+    {
+        const int N = 8;
+        float pi = 3.14159265358979f;
+        float zeta = 0.33f;
+        float sinN = sinf(pi / float(N));
+        float eta = (zeta + cosf(pi / float(N))) / (sinN * sinN);
+        float sqrt2_2 = sqrtf(2.0f) * 0.5f;
+        float sigma = 0.8f;
+        float gauss = 1.0f / (2.0f * sigma * sigma);
+
+        tableRes = 64;
+        tableSize = 2 * tableRes + 1;
+        table.assign(tableSize * tableSize * N, 0.0f);
+
+        for(int v = 0; v < tableSize; v++) {
+            for(int u = 0; u < tableSize; u++) {
+                float vx = float(u - tableRes) / float(tableRes);
+                float vy = float(v - tableRes) / float(tableRes);
+                float d2 = vx * vx + vy * vy;
+
+                if(d2 > 1.0f) {
+                    continue;
+                }
+
+                float w[N];
+                float vxx = zeta - eta * vx * vx;
+                float vyy = zeta - eta * vy * vy;
+                float z;
+
+                z = MAX(0.0f,  vy + vxx); w[0] = z * z;
+                z = MAX(0.0f, -vx + vyy); w[2] = z * z;
+                z = MAX(0.0f, -vy + vxx); w[4] = z * z;
+                z = MAX(0.0f,  vx + vyy); w[6] = z * z;
+
+                float rx = sqrt2_2 * (vx - vy);
+                float ry = sqrt2_2 * (vx + vy);
+                vxx = zeta - eta * rx * rx;
+                vyy = zeta - eta * ry * ry;
+
+                z = MAX(0.0f,  ry + vxx); w[1] = z * z;
+                z = MAX(0.0f, -rx + vyy); w[3] = z * z;
+                z = MAX(0.0f, -ry + vxx); w[5] = z * z;
+                z = MAX(0.0f,  rx + vyy); w[7] = z * z;
+
+                float sum = 0.0f;
+                for(int k = 0; k < N; k++) {
+                    sum += w[k];
+                }
+
+                if(sum <= 0.0f) {
+                    continue;
+                }
+
+                float g = expf(-gauss * d2) / sum;
+                float *t = &table[(v * tableSize + u) * N];
+
+                for(int k = 0; k < N; k++) {
+                    t[k] = w[k] * g;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief ProcessBBox
+     * @param dst
+     * @param src is Double(imgIn, orientation field).
+     * @param box
+     */
+    void ProcessBBox(Image *dst, ImageVec src, BBox *box)
+    {
+        Image *source = src[0];
+        Image *field = src[1];
+        int channels = dst->channels;
+        int width = source->width;
+        int height = source->height;
+
+        const int N = 8;
+        float T = float(tableRes);
+        int last = tableSize - 1;
+
+        std::vector<float> m(N * channels), s(N * channels);
+        float ws[N];
+
+        for(int j = box->y0; j < box->y1; j++) {
+            for(int i = box->x0; i < box->x1; i++) {
+                float *f = (*field)(i, j);
+                float cos_phi = f[0];
+                float sin_phi = f[1];
+                float A = f[2];
+
+                float a = radius * CLAMPi((alpha + A) / alpha, 0.1f, 2.0f);
+                float b = radius * CLAMPi(alpha / (alpha + A), 0.1f, 2.0f);
+
+                int max_y = int(sqrtf(a * a * sin_phi * sin_phi + b * b * cos_phi * cos_phi));
+
+                //the ellipse is mapped onto the unit disk:
+                //vx = ca * x + sa * y, vy = -sb * x + cb * y
+                float ca = cos_phi / a;
+                float sa = sin_phi / a;
+                float cb = cos_phi / b;
+                float sb = sin_phi / b;
+
+                float qA = ca * ca + sb * sb;
+                float qB = ca * sa - sb * cb;
+                float qC = sa * sa + cb * cb;
+
+                for(int k = 0; k < N * channels; k++) {
+                    m[k] = 0.0f;
+                    s[k] = 0.0f;
+                }
+
+                for(int k = 0; k < N; k++) {
+                    ws[k] = 0.0f;
+                }
+
+                for(int y = -max_y; y <= max_y; y++) {
+                    //span of the row inside the ellipse
+                    float B = float(y) * qB;
+                    float D = B * B - qA * (float(y * y) * qC - 1.0f);
+
+                    if(D < 0.0f) {
+                        continue;
+                    }
+
+                    D = sqrtf(D);
+                    int x0 = int(ceilf((-B - D) / qA));
+                    int x1 = int(floorf((-B + D) / qA));
+
+                    float *row = &source->data[CLAMPi(j + y, 0, height - 1) * width * channels];
+
+                    float tx = (ca * float(x0) + sa * float(y)) * T + T + 0.5f;
+                    float ty = (cb * float(y) - sb * float(x0)) * T + T + 0.5f;
+                    float dtx = ca * T;
+                    float dty = -sb * T;
+
+                    for(int x = x0; x <= x1; x++) {
+                        int u = CLAMPi(int(tx), 0, last);
+                        int v = CLAMPi(int(ty), 0, last);
+                        tx += dtx;
+                        ty += dty;
+
+                        const float *w = &table[(v * tableSize + u) * N];
+                        float *c = &row[CLAMPi(i + x, 0, width - 1) * channels];
+
+                        for(int k = 0; k < N; k++) {
+                            float wk = w[k];
+
+                            if(wk <= 0.0f) {
+                                continue;
+                            }
+
+                            float *mk = &m[k * channels];
+                            float *sk = &s[k * channels];
+
+                            for(int l = 0; l < channels; l++) {
+                                float cw = c[l] * wk;
+                                mk[l] += cw;
+                                sk[l] += c[l] * cw;
+                            }
+
+                            ws[k] += wk;
+                        }
+                    }
+                }
+
+                //blending sectors
+                float *out = (*dst)(i, j);
+                float tot = 0.0f;
+                int best = -1;
+                float bestVar = FLT_MAX;
+
+                for(int l = 0; l < channels; l++) {
+                    out[l] = 0.0f;
+                }
+
+                for(int k = 0; k < N; k++) {
+                    if(ws[k] <= 0.0f) {
+                        continue;
+                    }
+
+                    float *mk = &m[k * channels];
+                    float *sk = &s[k * channels];
+                    float sigma2 = 0.0f;
+
+                    for(int l = 0; l < channels; l++) {
+                        mk[l] /= ws[k];
+                        sigma2 += fabsf(sk[l] / ws[k] - mk[l] * mk[l]);
+                    }
+
+                    if(sigma2 < bestVar) {
+                        bestVar = sigma2;
+                        best = k;
+                    }
+
+                    float wk = 1.0f / (1.0f + powf(255.0f * sigma2, 0.5f * q));
+
+                    for(int l = 0; l < channels; l++) {
+                        out[l] += wk * mk[l];
+                    }
+
+                    tot += wk;
+                }
+
+                if(tot > 0.0f) {
+                    for(int l = 0; l < channels; l++) {
+                        out[l] /= tot;
+                    }
+                } else {
+                    float *c = (best >= 0) ? &m[best * channels] : (*source)(i, j);
+
+                    for(int l = 0; l < channels; l++) {
+                        out[l] = c[l];
+                    }
+                }
+            }
+        }
+    }
+
+public:
+
+    /**
+     * @brief FilterAnisotropicKuwahara
+     * @param radius is the radius of the filter in pixels.
+     * @param q is the sharpness of the sectors' blending.
+     * @param alpha is the tuning of the anisotropy; the larger, the less
+     * elongated the ellipses.
+     * @param sigma_t is the standard deviation used for smoothing the
+     * structure tensor.
+     */
+    FilterAnisotropicKuwahara(float radius = 6.0f, float q = 8.0f,
+                              float alpha = 1.0f, float sigma_t = 2.0f)
+    {
+        BuildTable();
+        Update(radius, q, alpha, sigma_t);
+    }
+
+    /**
+     * @brief Update
+     * @param radius
+     * @param q
+     * @param alpha
+     * @param sigma_t
+     */
+    void Update(float radius, float q, float alpha, float sigma_t)
+    {
+        this->radius = radius > 0.0f ? radius : 6.0f;
+        this->q = q > 0.0f ? q : 8.0f;
+        this->alpha = alpha > 0.0f ? alpha : 1.0f;
+        this->sigma_t = sigma_t > 0.0f ? sigma_t : 2.0f;
+    }
+
+    /**
+     * @brief OrientationField computes, from the smoothed structure tensor
+     * of imgIn, the local orientation (cos, sin) and the anisotropy.
+     * @param imgIn
+     * @param sigma_t
+     * @param imgOut
+     * @return
+     */
+    static Image *OrientationField(Image *imgIn, float sigma_t, Image *imgOut = NULL)
+    {
+        int width = imgIn->width;
+        int height = imgIn->height;
+        int channels = imgIn->channels;
+
+        Image tensor(1, width, height, 3);
+
+        //Sobel derivatives
+        #pragma omp parallel for
+
+        for(int j = 0; j < height; j++) {
+            for(int i = 0; i < width; i++) {
+                float *p00 = (*imgIn)(i - 1, j - 1);
+                float *p10 = (*imgIn)(i    , j - 1);
+                float *p20 = (*imgIn)(i + 1, j - 1);
+                float *p01 = (*imgIn)(i - 1, j);
+                float *p21 = (*imgIn)(i + 1, j);
+                float *p02 = (*imgIn)(i - 1, j + 1);
+                float *p12 = (*imgIn)(i    , j + 1);
+                float *p22 = (*imgIn)(i + 1, j + 1);
+
+                float E = 0.0f;
+                float F = 0.0f;
+                float G = 0.0f;
+
+                for(int l = 0; l < channels; l++) {
+                    float gx = ((p20[l] + 2.0f * p21[l] + p22[l]) -
+                                (p00[l] + 2.0f * p01[l] + p02[l])) * 0.25f;
+                    float gy = ((p02[l] + 2.0f * p12[l] + p22[l]) -
+                                (p00[l] + 2.0f * p10[l] + p20[l])) * 0.25f;
+
+                    E += gx * gx;
+                    F += gx * gy;
+                    G += gy * gy;
+                }
+
+                float *t = tensor(i, j);
+                t[0] = E;
+                t[1] = F;
+                t[2] = G;
+            }
+        }
+
+        Image *tensor_s = FilterGaussian2D::Execute(&tensor, NULL, sigma_t);
+
+        if(imgOut == NULL) {
+            imgOut = new Image(1, width, height, 3);
+        }
+
+        #pragma omp parallel for
+
+        for(int ind = 0; ind < width * height; ind++) {
+            float *t = &tensor_s->data[ind * 3];
+            float E = t[0];
+            float F = t[1];
+            float G = t[2];
+
+            float d = sqrtf((E - G) * (E - G) + 4.0f * F * F);
+            float lambda1 = (E + G + d) * 0.5f;
+            float lambda2 = (E + G - d) * 0.5f;
+
+            float tx = lambda1 - E;
+            float ty = -F;
+            float len = sqrtf(tx * tx + ty * ty);
+
+            float *out = &imgOut->data[ind * 3];
+
+            if(len > 0.0f) {
+                out[0] = tx / len;
+                out[1] = ty / len;
+            } else {
+                out[0] = 0.0f;
+                out[1] = 1.0f;
+            }
+
+            float sum = lambda1 + lambda2;
+            out[2] = sum > 0.0f ? (lambda1 - lambda2) / sum : 0.0f;
+        }
+
+        delete tensor_s;
+
+        imgOut->InvalidateCache();
+
+        return imgOut;
+    }
+
+    /**
+     * @brief Process
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *Process(ImageVec imgIn, Image *imgOut)
+    {
+        if(imgIn.empty() || imgIn[0] == NULL) {
+            return imgOut;
+        }
+
+        Image *field = OrientationField(imgIn[0], sigma_t);
+        imgOut = Filter::Process(Double(imgIn[0], field), imgOut);
+        delete field;
+
+        return imgOut;
+    }
+
+    /**
+     * @brief ProcessP
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *ProcessP(ImageVec imgIn, Image *imgOut)
+    {
+        if(imgIn.empty() || imgIn[0] == NULL) {
+            return imgOut;
+        }
+
+        Image *field = OrientationField(imgIn[0], sigma_t);
+        imgOut = Filter::ProcessP(Double(imgIn[0], field), imgOut);
+        delete field;
+
+        return imgOut;
+    }
+
+    /**
+     * @brief Execute
+     * @param imgIn
+     * @param imgOut
+     * @param radius
+     * @param q
+     * @return
+     */
+    static Image *Execute(Image *imgIn, Image *imgOut, float radius,
+                          float q = 8.0f)
+    {
+        FilterAnisotropicKuwahara filter(radius, q);
+        return filter.ProcessP(Single(imgIn), imgOut);
+    }
+};
+
+} // end namespace pic
+
+#endif /* PIC_FILTERING_FILTER_ANISOTROPIC_KUWAHARA_HPP */
+
@@ -25,6 +25,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "filtering/filter_sampling_map.hpp"
 
 #include "point_samplers/sampler_random_m.hpp"
+#include "point_samplers/sampler_cache.hpp"
 
 namespace pic {
 
@@ -127,9 +128,8 @@ FilterBilateral2DAS::~FilterBilateral2DAS()
         delete pg;
     }
        
-    if(ms != NULL) {
-        delete ms;
-    }
+    //ms is owned by MRSamplersCache
+    ms = NULL;
 }
 
 FilterBilateral2DAS::FilterBilateral2DAS(SAMPLER_TYPE type, float sigma_s,
@@ -143,13 +143,15 @@ FilterBilateral2DAS::FilterBilateral2DAS(SAMPLER_TYPE type, float sigma_s,
     pg = new PrecomputedGaussian(sigma_s);
 
     //Poisson samples
+    ms = NULL;
+
     if(mult > 0) {
-        ms = new MRSamplers<2>(type, pg->halfKernelSize, pg->halfKernelSize * mult, 3,
-                               64);
+        ms = MRSamplersCache<2>::getInstance()->get(type, pg->halfKernelSize,
+                pg->halfKernelSize * mult, 3, 64);
     } else if(mult < 0) {
         mult = -mult;
-        ms = new MRSamplers<2>(type, pg->halfKernelSize, pg->halfKernelSize / mult, 3,
-                               64);
+        ms = MRSamplersCache<2>::getInstance()->get(type, pg->halfKernelSize,
+                pg->halfKernelSize / mult, 3, 64);
     }
 }
 
@@ -0,0 +1,220 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_FILTERING_FILTER_BILATERAL_2DPL_HPP
+#define PIC_FILTERING_FILTER_BILATERAL_2DPL_HPP
+
+#include <vector>
+
+#include "filtering/filter.hpp"
+#include "util/permutohedral_lattice.hpp"
+
+namespace pic {
+
+/**
+ * @brief The FilterBilateral2DPL class is a (cross) bilateral filter on
+ * the permutohedral lattice. The feature space is (x, y), plus t for
+ * images with several frames when sigma_t > 0, plus all the channels of
+ * the edge image; so full color and video filtering have linear cost.
+ */
+class FilterBilateral2DPL: public Filter
+{
+protected:
+    float sigma_s, sigma_r, sigma_t;
+
+public:
+
+    /**
+     * @brief FilterBilateral2DPL
+     * @param sigma_s is the spatial standard deviation in pixels.
+     * @param sigma_r is the range standard deviation.
+     * @param sigma_t is the temporal standard deviation in frames;
+     * frames are filtered independently when it is not positive.
+     */
+    FilterBilateral2DPL(float sigma_s, float sigma_r, float sigma_t = -1.0f)
+    {
+        this->sigma_s = sigma_s > 0.0f ? sigma_s : 1.0f;
+        this->sigma_r = sigma_r > 0.0f ? sigma_r : 0.1f;
+        this->sigma_t = sigma_t;
+    }
+
+    /**
+     * @brief Signature
+     * @return
+     */
+    std::string Signature()
+    {
+        return GenBilString("PL", sigma_s, sigma_r);
+    }
+
+    /**
+     * @brief Process
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *Process(ImageVec imgIn, Image *imgOut);
+
+    /**
+     * @brief ProcessP is Process; splat, blur, and slice are parallel.
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *ProcessP(ImageVec imgIn, Image *imgOut)
+    {
+        return Process(imgIn, imgOut);
+    }
+
+    /**
+     * @brief Execute
+     * @param imgIn
+     * @param imgOut
+     * @param sigma_s
+     * @param sigma_r
+     * @return
+     */
+    static Image *Execute(Image *imgIn, Image *imgOut, float sigma_s, float sigma_r)
+    {
+        FilterBilateral2DPL filter(sigma_s, sigma_r);
+        return filter.Process(Single(imgIn), imgOut);
+    }
+
+    /**
+     * @brief Execute
+     * @param imgIn
+     * @param imgEdge
+     * @param imgOut
+     * @param sigma_s
+     * @param sigma_r
+     * @return
+     */
+    static Image *Execute(Image *imgIn, Image *imgEdge, Image *imgOut, float sigma_s,
+                          float sigma_r)
+    {
+        FilterBilateral2DPL filter(sigma_s, sigma_r);
+
+        if(imgEdge == NULL) {
+            return filter.Process(Single(imgIn), imgOut);
+        } else {
+            return filter.Process(Double(imgIn, imgEdge), imgOut);
+        }
+    }
+};
+
+PIC_INLINE Image *FilterBilateral2DPL::Process(ImageVec imgIn, Image *imgOut)
+{
+    if(imgIn.empty() || imgIn[0] == NULL) {
+        return imgOut;
+    }
+
+    imgOut = SetupAux(imgIn, imgOut);
+
+    Image *base = imgIn[0];
+    Image *edge = (imgIn.size() > 1 && imgIn[1] != NULL) ? imgIn[1] : imgIn[0];
+
+    int width = base->width;
+    int height = base->height;
+    int frames = base->frames;
+    int channels = base->channels;
+    int edgeChannels = edge->channels;
+
+    bool bTime = (sigma_t > 0.0f) && (frames > 1);
+
+    int d = 2 + (bTime ? 1 : 0) + edgeChannels;
+    int vd = channels + 1;
+
+    float inv_s = 1.0f / sigma_s;
+    float inv_r = 1.0f / sigma_r;
+    float inv_t = bTime ? (1.0f / sigma_t) : 0.0f;
+
+    //without the time axis, each frame is a separate lattice
+    int nLattices = bTime ? 1 : frames;
+    int nFrames = bTime ? frames : 1;
+    int n = width * height * nFrames;
+
+    std::vector<float> features(n * d);
+    std::vector<float> val(n * vd);
+    std::vector<float> out(n * vd);
+
+    for(int l = 0; l < nLattices; l++) {
+        #pragma omp parallel for schedule(static)
+        for(int i = 0; i < n; i++) {
+            int x = i % width;
+            int y = (i / width) % height;
+            int t = (i / (width * height)) + l;
+
+            float *f = &features[i * d];
+            float *v = &val[i * vd];
+
+            f[0] = float(x) * inv_s;
+            f[1] = float(y) * inv_s;
+
+            int k = 2;
+            if(bTime) {
+                f[k] = float(t) * inv_t;
+                k++;
+            }
+
+            float *e = (*edge)(x, y, t);
+            for(int c = 0; c < edgeChannels; c++) {
+                f[k + c] = e[c] * inv_r;
+            }
+
+            float *b = (*base)(x, y, t);
+            for(int c = 0; c < channels; c++) {
+                v[c] = b[c];
+            }
+
+            v[channels] = 1.0f;
+        }
+
+        PermutohedralLattice::Execute(&features[0], d, &val[0], vd, n, &out[0]);
+
+        #pragma omp parallel for schedule(static)
+        for(int i = 0; i < n; i++) {
+            int x = i % width;
+            int y = (i / width) % height;
+            int t = (i / (width * height)) + l;
+
+            float *o = &out[i * vd];
+            float *dst = (*imgOut)(x, y, t);
+            float w = o[channels];
+
+            if(w > 0.0f) {
+                for(int c = 0; c < channels; c++) {
+                    dst[c] = o[c] / w;
+                }
+            } else {
+                float *b = (*base)(x, y, t);
+
+                for(int c = 0; c < channels; c++) {
+                    dst[c] = b[c];
+                }
+            }
+        }
+    }
+
+    imgOut->InvalidateCache();
+
+    return imgOut;
+}
+
+} // end namespace pic
+
+#endif /* PIC_FILTERING_FILTER_BILATERAL_2DPL_HPP */
+
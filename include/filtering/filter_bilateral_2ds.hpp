@@ -23,6 +23,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "filtering/filter.hpp"
 #include "util/precomputed_gaussian.hpp"
 #include "point_samplers/sampler_random_m.hpp"
+#include "point_samplers/sampler_cache.hpp"
 
 namespace pic {
 
@@ -35,6 +36,7 @@ protected:
     float					sigma_s, sigma_r;
 
     MRSamplers<2>			*ms;
+    bool					bOwnSamplers;
 
     int						halfSizeKernel;
     PrecomputedGaussian		*pg;
@@ -57,8 +59,11 @@ public:
     {
         pg = NULL;
         ms = NULL;
+        bOwnSamplers = false;
     }
 
+    ~FilterBilateral2DS();
+
     /**
      * @brief FilterBilateral2DS
      * @param nameFile
@@ -99,6 +104,15 @@ public:
      */
     void Init(SAMPLER_TYPE type, float sigma_s, float sigma_r, int mult);
 
+    /**
+     * @brief getKernelRadius
+     * @return the largest offset of a sample from the center.
+     */
+    int getKernelRadius()
+    {
+        return pg != NULL ? pg->halfKernelSize : 0;
+    }
+
     /**
      * @brief Signature
      * @return
@@ -272,12 +286,14 @@ public:
     }
 
     /**
-     * @brief PrecomputedKernels
+     * @brief PrecomputedKernels generates the sampling patterns for
+     * sigma_s in {1, 2, 4, ..., 32} and all multipliers, and saves them
+     * in a binary file that can be loaded with LoadPrecomputedKernels.
+     * @param nameFile
+     * @return
      */
-    static void PrecomputedKernels()
+    static bool PrecomputedKernels(std::string nameFile = "bilateral_2ds_kernels.bin")
     {
-        char nameFile[512];
-
         for(int i = 0; i < 6; i++) {
             float sigma_s = powf(2.0f, float(i));
 
@@ -286,33 +302,61 @@ public:
             int nMaxSamples = nSamplesDiv2 * nSamplesDiv2;
             int oldNSamples = -1;
 
-            printf("Computing kernel sigma_s: %f\n", sigma_s);
-
             for(int j = 1; j <= 16; j++) {
-                printf("Multiplier: %d\n", j);
                 nSamples = MIN((nSamplesDiv2 * j), nMaxSamples);
 
                 if(nSamples == oldNSamples) {
                     break;
                 }
 
+                //generating the patterns into the cache
                 FilterBilateral2DS f2DS(sigma_s, 0.01f, j);
-
-                sprintf(nameFile, "kernel_%3.2f_%d.txt", sigma_s, j);
-                f2DS.Write(nameFile);
                 oldNSamples = nSamples;
             }
         }
+
+        return MRSamplersCache<2>::getInstance()->Write(nameFile);
+    }
+
+    /**
+     * @brief LoadPrecomputedKernels loads sampling patterns saved by
+     * PrecomputedKernels into the process-wide cache; filters created
+     * afterwards with matching parameters do not generate them again.
+     * @param nameFile
+     * @return
+     */
+    static bool LoadPrecomputedKernels(std::string nameFile = "bilateral_2ds_kernels.bin")
+    {
+        return MRSamplersCache<2>::getInstance()->Read(nameFile);
     }
 };
 
 PIC_INLINE FilterBilateral2DS::FilterBilateral2DS(std::string nameFile,
         float sigma_r)
 {
+    pg = NULL;
+    ms = NULL;
+    bOwnSamplers = false;
+    sigma_s = 1.0f;
+
     Read(nameFile);
     this->sigma_r = sigma_r;
 }
 
+PIC_INLINE FilterBilateral2DS::~FilterBilateral2DS()
+{
+    if(pg != NULL) {
+        delete pg;
+        pg = NULL;
+    }
+
+    if(bOwnSamplers && ms != NULL) {
+        delete ms;
+    }
+
+    ms = NULL;
+}
+
 PIC_INLINE FilterBilateral2DS::FilterBilateral2DS(SAMPLER_TYPE type,
         float sigma_s, float sigma_r, int mult)
 {
@@ -351,7 +395,9 @@ PIC_INLINE void FilterBilateral2DS::Init(SAMPLER_TYPE type, float sigma_s,
 #endif
 //	nSamples = MIN(	(pg->halfKernelSize*mult),nMaxSamples);
 
-    ms = new MRSamplers<2>(type, pg->halfKernelSize, nSamples, 1, 64);
+    //the patterns are shared by all filters with the same parameters
+    ms = MRSamplersCache<2>::getInstance()->get(type, pg->halfKernelSize, nSamples, 1, 64);
+    bOwnSamplers = false;
 }
 
 PIC_INLINE void FilterBilateral2DS::ProcessBBox(Image *dst, ImageVec src,
@@ -508,12 +554,18 @@ PIC_INLINE bool FilterBilateral2DS::Read(std::string filename)
 {
     //TODO: add the reading of (sigms_s, sigma_r)
     //Precomputation of the Gaussian Kernel
+    if(pg != NULL) {
+        delete pg;
+    }
+
     pg = new PrecomputedGaussian(sigma_s);
 
-    if( ms != NULL) {
+    if(bOwnSamplers && ms != NULL) {
         delete ms;
     }
+
     ms = new MRSamplers<2>();
+    bOwnSamplers = true;
     return ms->Read(filename);
 }
 
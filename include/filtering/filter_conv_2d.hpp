@@ -18,16 +18,255 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #ifndef PIC_FILTERING_FILTER_CONV_2D_HPP
 #define PIC_FILTERING_FILTER_CONV_2D_HPP
 
+#include <vector>
+
+#include "util/fft.hpp"
 #include "filtering/filter.hpp"
 
 namespace pic {
 
 /**
- * @brief The FilterConv2D class
+ * @brief The CONV_2D_MODE enum selects direct or FFT convolution;
+ * C2D_AUTO picks the cheaper one given image and kernel sizes.
+ */
+enum CONV_2D_MODE {C2D_AUTO, C2D_DIRECT, C2D_FFT};
+
+/**
+ * @brief The FilterConv2D class convolves an image with a one channel
+ * kernel. Large kernels are applied with FFTs on overlap-save tiles; the
+ * kernel's spectra are cached, so repeated convolutions with the same
+ * kernel (e.g. iterative deconvolution) skip its forward transform.
+ * Both paths clamp coordinates at the borders.
  */
 class FilterConv2D: public Filter
 {
 protected:
+    /**
+     * @brief The Spectrum struct is a cached kernel's spectrum.
+     */
+    struct Spectrum
+    {
+        std::vector<float> kernel;
+        int k_width, k_height;
+        int t_width, t_height;
+        std::vector<float> re, im;
+    };
+
+    CONV_2D_MODE mode;
+    std::vector<Spectrum *> cache;
+    unsigned int maxCache;
+
+    /**
+     * @brief getTileSize returns the FFT size along a dimension.
+     * @param size is the image size.
+     * @param k_size is the kernel size.
+     * @return
+     */
+    static int getTileSize(int size, int k_size)
+    {
+        int t = FFT::NextPowerOfTwo(MAX(4 * k_size, 128));
+        return MIN(t, FFT::NextPowerOfTwo(size + k_size - 1));
+    }
+
+    /**
+     * @brief getSpectrum returns the spectrum of conv for tiles of
+     * t_width x t_height, normalized for the inverse transform.
+     * @param conv
+     * @param t_width
+     * @param t_height
+     * @return
+     */
+    Spectrum *getSpectrum(Image *conv, int t_width, int t_height)
+    {
+        //the kernel is sampled as in the direct path; taps are odd
+        int c_width_h  = conv->width >> 1;
+        int c_height_h = conv->height >> 1;
+        int k_width  = 2 * c_width_h + 1;
+        int k_height = 2 * c_height_h + 1;
+
+        std::vector<float> kernel(k_width * k_height);
+
+        for(int j = 0; j < k_height; j++) {
+            for(int i = 0; i < k_width; i++) {
+                kernel[j * k_width + i] = (*conv)(i, j)[0];
+            }
+        }
+
+        for(unsigned int i = 0; i < cache.size(); i++) {
+            Spectrum *s = cache[i];
+
+            if((s->t_width == t_width) && (s->t_height == t_height) &&
+               (s->k_width == k_width) && (s->k_height == k_height) &&
+               (s->kernel == kernel)) {
+                return s;
+            }
+        }
+
+        Spectrum *s = new Spectrum;
+        s->kernel = kernel;
+        s->k_width = k_width;
+        s->k_height = k_height;
+        s->t_width = t_width;
+        s->t_height = t_height;
+
+        int n = t_width * t_height;
+        s->re.assign(n, 0.0f);
+        s->im.assign(n, 0.0f);
+
+        //flipped, so that the circular convolution is a correlation
+        float norm = 1.0f / float(n);
+        for(int j = 0; j < k_height; j++) {
+            for(int i = 0; i < k_width; i++) {
+                int ind = (k_height - 1 - j) * t_width + (k_width - 1 - i);
+                s->re[ind] = kernel[j * k_width + i] * norm;
+            }
+        }
+
+        FFT2D fft(t_width, t_height);
+        std::vector<float> tmp(fft.getScratchSize());
+        fft.Transform(&s->re[0], &s->im[0], false, &tmp[0]);
+
+        if(cache.size() >= maxCache) {
+            delete cache[0];
+            cache.erase(cache.begin());
+        }
+
+        cache.push_back(s);
+
+        return s;
+    }
+
+    /**
+     * @brief UseFFT estimates whether the FFT path is cheaper.
+     * @param img
+     * @param conv
+     * @return
+     */
+    bool UseFFT(Image *img, Image *conv)
+    {
+        if(mode != C2D_AUTO) {
+            return mode == C2D_FFT;
+        }
+
+        int k_width  = 2 * (conv->width >> 1) + 1;
+        int k_height = 2 * (conv->height >> 1) + 1;
+
+        int t_width  = getTileSize(img->width, k_width);
+        int t_height = getTileSize(img->height, k_height);
+
+        int b_width  = t_width  - k_width  + 1;
+        int b_height = t_height - k_height + 1;
+
+        double nTiles = double((img->width  + b_width  - 1) / b_width) *
+                        double((img->height + b_height - 1) / b_height);
+
+        double n = double(t_width) * double(t_height);
+        double cost_fft = nTiles * double((img->channels + 1) / 2) *
+                          (10.0 * n * log2(n) + 6.0 * n);
+        //a direct tap reads through clamped coordinates
+        double cost_direct = 4.0 * double(img->nPixels()) *
+                             double(img->channels) * double(k_width * k_height);
+
+        return cost_fft < cost_direct;
+    }
+
+    /**
+     * @brief ProcessFFT convolves the first frame of img using overlap-save
+     * tiles; pairs of channels are transformed together as a complex
+     * signal since the kernel is real.
+     * @param dst
+     * @param img
+     * @param conv
+     */
+    void ProcessFFT(Image *dst, Image *img, Image *conv)
+    {
+        int width = img->width;
+        int height = img->height;
+        int channels = img->channels;
+
+        int c_width_h  = conv->width >> 1;
+        int c_height_h = conv->height >> 1;
+        int k_width  = 2 * c_width_h + 1;
+        int k_height = 2 * c_height_h + 1;
+
+        int t_width  = getTileSize(width, k_width);
+        int t_height = getTileSize(height, k_height);
+
+        int b_width  = t_width  - k_width  + 1;
+        int b_height = t_height - k_height + 1;
+
+        int nx = (width  + b_width  - 1) / b_width;
+        int ny = (height + b_height - 1) / b_height;
+        int nPairs = (channels + 1) / 2;
+        int nJobs = nx * ny * nPairs;
+
+        Spectrum *s = getSpectrum(conv, t_width, t_height);
+        float *k_re = &s->re[0];
+        float *k_im = &s->im[0];
+
+        FFT2D fft(t_width, t_height);
+        int n = t_width * t_height;
+
+        #pragma omp parallel
+        {
+            std::vector<float> re(n), im(n), tmp(fft.getScratchSize());
+
+            #pragma omp for schedule(dynamic, 1)
+            for(int job = 0; job < nJobs; job++) {
+                int pair = job % nPairs;
+                int tile = job / nPairs;
+                int x0 = (tile % nx) * b_width;
+                int y0 = (tile / nx) * b_height;
+
+                int c0 = pair * 2;
+                int c1 = c0 + 1;
+                bool bSecond = c1 < channels;
+
+                //gathering with clamped coordinates
+                for(int j = 0; j < t_height; j++) {
+                    int y = CLAMP(y0 - c_height_h + j, height);
+                    float *row = &img->data[y * img->ystride];
+                    float *p_re = &re[j * t_width];
+                    float *p_im = &im[j * t_width];
+
+                    for(int i = 0; i < t_width; i++) {
+                        int x = CLAMP(x0 - c_width_h + i, width);
+                        float *p = &row[x * channels];
+                        p_re[i] = p[c0];
+                        p_im[i] = bSecond ? p[c1] : 0.0f;
+                    }
+                }
+
+                fft.Transform(&re[0], &im[0], false, &tmp[0]);
+
+                for(int i = 0; i < n; i++) {
+                    float a = re[i];
+                    float b = im[i];
+                    re[i] = a * k_re[i] - b * k_im[i];
+                    im[i] = a * k_im[i] + b * k_re[i];
+                }
+
+                fft.Transform(&re[0], &im[0], true, &tmp[0]);
+
+                //valid samples
+                int w = MIN(b_width, width - x0);
+                int h = MIN(b_height, height - y0);
+
+                for(int j = 0; j < h; j++) {
+                    float *out = &dst->data[(y0 + j) * dst->ystride + x0 * channels];
+                    int ind = (j + k_height - 1) * t_width + (k_width - 1);
+
+                    for(int i = 0; i < w; i++) {
+                        out[i * channels + c0] = re[ind + i];
+
+                        if(bSecond) {
+                            out[i * channels + c1] = im[ind + i];
+                        }
+                    }
+                }
+            }
+        }
+    }
 
     /**
      * @brief ProcessBBox
@@ -80,10 +319,90 @@ public:
 
     /**
      * @brief FilterConv2D
+     * @param mode
+     */
+    FilterConv2D(CONV_2D_MODE mode = C2D_AUTO)
+    {
+        this->mode = mode;
+        maxCache = 8;
+    }
+
+    ~FilterConv2D()
+    {
+        ClearCache();
+    }
+
+    //cached spectra are owned; copies are not allowed
+    FilterConv2D(const FilterConv2D &) = delete;
+    FilterConv2D &operator = (const FilterConv2D &) = delete;
+
+    /**
+     * @brief setMode
+     * @param mode
      */
-    FilterConv2D()
+    void setMode(CONV_2D_MODE mode)
     {
+        this->mode = mode;
+    }
+
+    /**
+     * @brief ClearCache frees cached spectra.
+     */
+    void ClearCache()
+    {
+        for(unsigned int i = 0; i < cache.size(); i++) {
+            delete cache[i];
+        }
+
+        cache.clear();
+    }
+
+    /**
+     * @brief Process
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *Process(ImageVec imgIn, Image *imgOut)
+    {
+        if(imgIn.size() != 2 || imgIn[0] == NULL || imgIn[1] == NULL) {
+            return imgOut;
+        }
+
+        if(!UseFFT(imgIn[0], imgIn[1])) {
+            return Filter::Process(imgIn, imgOut);
+        }
+
+        imgOut = SetupAux(imgIn, imgOut);
+        ProcessFFT(imgOut, imgIn[0], imgIn[1]);
+
+        imgOut->InvalidateCache();
+
+        return imgOut;
+    }
+
+    /**
+     * @brief ProcessP
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *ProcessP(ImageVec imgIn, Image *imgOut)
+    {
+        if(imgIn.size() != 2 || imgIn[0] == NULL || imgIn[1] == NULL) {
+            return imgOut;
+        }
+
+        if(!UseFFT(imgIn[0], imgIn[1])) {
+            return Filter::ProcessP(imgIn, imgOut);
+        }
+
+        imgOut = SetupAux(imgIn, imgOut);
+        ProcessFFT(imgOut, imgIn[0], imgIn[1]);
+
+        imgOut->InvalidateCache();
 
+        return imgOut;
     }
 
     /**
@@ -91,11 +410,13 @@ public:
      * @param img
      * @param conv
      * @param imgOut
+     * @param mode
      * @return
      */
-    static Image *Execute(Image *img, Image *conv, Image *imgOut)
+    static Image *Execute(Image *img, Image *conv, Image *imgOut,
+                          CONV_2D_MODE mode = C2D_AUTO)
     {
-        FilterConv2D flt;
+        FilterConv2D flt(mode);
         return flt.ProcessP(Double(img, conv), imgOut);
     }
 
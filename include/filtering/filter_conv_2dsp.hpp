@@ -40,6 +40,7 @@ public:
     FilterConv2DSP(float *data, int n)
     {
         conv1DFltX = new FilterConv1D(data, n);
+        conv1DFltY = NULL;
 
         InsertFilter(conv1DFltX);
         InsertFilter(conv1DFltX);
@@ -19,19 +19,21 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #define PIC_FILTERING_FILTER_DCT_1D_HPP
 
 #include "filtering/filter.hpp"
+#include "util/fast_dct.hpp"
 
 namespace pic {
 
 /**
- * @brief The FilterDCT1D class
+ * @brief The FilterDCT1D class computes the orthonormal DCT of blocks of
+ * nCoeff samples along one direction.
  */
 class FilterDCT1D: public Filter
 {
 protected:
     int     dirs[3];
-    float   *coeff, sqr[2];
     int     nCoeff;
     bool    bForward;
+    FastDCT dct;
 
     /**
      * @brief ProcessBBox
@@ -58,13 +60,6 @@ public:
     void SetForward()
     {
         this->bForward = true;
-
-        if(coeff != NULL) {
-            delete[] coeff;
-            coeff = NULL;
-        }
-
-        coeff = CreateCoefficientsTransform(nCoeff);
     }
 
     /**
@@ -73,13 +68,6 @@ public:
     void SetInverse()
     {
         this->bForward = false;
-
-        if(coeff != NULL) {
-            delete[] coeff;
-            coeff = NULL;
-        }
-
-        coeff = CreateCoefficientsInverse(nCoeff);
     }
 
     /**
@@ -165,19 +153,10 @@ public:
     void ChangePass(int x, int y, int z);
 };
 
-FilterDCT1D::FilterDCT1D(int nCoeff, bool bForward)
+FilterDCT1D::FilterDCT1D(int nCoeff, bool bForward) : dct(nCoeff)
 {
-    this->coeff = NULL;
-    this->nCoeff = nCoeff;
-
-    if(bForward) {
-        SetForward();
-    } else {
-        SetInverse();
-    }
-
-    sqr[0] = sqrtf(1.0f / float(nCoeff));
-    sqr[1] = sqrtf(2.0f / float(nCoeff));
+    this->nCoeff = dct.getSize();
+    this->bForward = bForward;
 
     dirs[0] = 1;
     dirs[1] = 0;
@@ -186,9 +165,6 @@ FilterDCT1D::FilterDCT1D(int nCoeff, bool bForward)
 
 FilterDCT1D::~FilterDCT1D()
 {
-    if(coeff != NULL) {
-        delete[] coeff;
-    }
 }
 
 void FilterDCT1D::ChangePass(int pass, int tPass)
@@ -227,47 +203,83 @@ void FilterDCT1D::ProcessBBox(Image *dst, ImageVec src, BBox *box)
 
     Image *source = src[0];
 
-    for(int m = box->z0; m < box->z1; m++) {
-        for(int j = box->y0; j < box->y1; j++) {
-            for(int i = box->x0; i < box->x1; i++) {
-                float *tmpDst = (*dst)(i, j, m);
+    //coordinates are (x, y, frame); dirs is (y, x, frame)
+    int axis = 1;
+    if(dirs[1] != 0) {
+        axis = 0;
+    } else {
+        if(dirs[0] == 0 && dirs[2] != 0) {
+            axis = 2;
+        }
+    }
+
+    int across = (axis == 0) ? 1 : 0;
+    int outer = 3 - axis - across;
 
-                for(int l = 0; l < channels; l++) {
-                    tmpDst[l] = 0.0f;
-                }
+    int lo[3] = {box->x0, box->y0, box->z0};
+    int hi[3] = {box->x1, box->y1, box->z1};
 
-                int ind = (j * dirs[0] + i * dirs[1] + m * dirs[2]) % nCoeff;
-                int ind2 = ind * nCoeff;
+    //all the lines of the box across the direction are transformed at once
+    int lanes = (hi[across] - lo[across]) * channels;
+
+    if(lanes <= 0) {
+        return;
+    }
 
-                for(int k = 0; k < nCoeff; k++) { //1D Filtering
-                    int k2 = k - ind;
-                    //Address cj
-                    int cj = j + k2 * dirs[0];
-                    //Address ci
-                    int ci = i + k2 * dirs[1];
-                    //Address cm
-                    int cm = m + k2 * dirs[2];
+    float *buf = new float[nCoeff * lanes];
+    float *tmp = new float[dct.getScratchSize(lanes)];
 
-                    float *tmpSource = (*source)(ci, cj, cm);
+    int p[3];
 
-                    float tmpCoeff = coeff[ind2];
+    for(int o = lo[outer]; o < hi[outer]; o++) {
+        p[outer] = o;
+
+        for(int b = lo[axis] - (lo[axis] % nCoeff); b < hi[axis]; b += nCoeff) {
+            //gather; samples outside the image are clamped
+            for(int k = 0; k < nCoeff; k++) {
+                p[axis] = b + k;
+                float *line = &buf[k * lanes];
+
+                for(int a = lo[across]; a < hi[across]; a++) {
+                    p[across] = a;
+                    float *tmpSource = (*source)(p[0], p[1], p[2]);
+                    float *tmpBuf = &line[(a - lo[across]) * channels];
 
                     for(int l = 0; l < channels; l++) {
-                        tmpDst[l] += tmpSource[l] * tmpCoeff;
+                        tmpBuf[l] = tmpSource[l];
                     }
-
-                    ind2++;
                 }
+            }
+
+            if(bForward) {
+                dct.Forward(buf, lanes, tmp);
+            } else {
+                dct.Inverse(buf, lanes, tmp);
+            }
+
+            //scatter the samples inside the box
+            int k0 = MAX(b, lo[axis]) - b;
+            int k1 = MIN(b + nCoeff, hi[axis]) - b;
+
+            for(int k = k0; k < k1; k++) {
+                p[axis] = b + k;
+                float *line = &buf[k * lanes];
+
+                for(int a = lo[across]; a < hi[across]; a++) {
+                    p[across] = a;
+                    float *tmpDst = (*dst)(p[0], p[1], p[2]);
+                    float *tmpBuf = &line[(a - lo[across]) * channels];
 
-                if(bForward) {
-                    int select = (ind == 0) ? 0 : 1;
                     for(int l = 0; l < channels; l++) {
-                        tmpDst[l] *= sqr[select];
+                        tmpDst[l] = tmpBuf[l];
                     }
                 }
             }
         }
     }
+
+    delete[] buf;
+    delete[] tmp;
 }
 
 } // end namespace pic
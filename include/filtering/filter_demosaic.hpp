@@ -15,233 +15,453 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 */
 
+
 #ifndef PIC_FILTERING_FILTER_DEMOSAIC_HPP
 #define PIC_FILTERING_FILTER_DEMOSAIC_HPP
 
 #include "filtering/filter.hpp"
+#include "util/raw.hpp"
 
 namespace pic {
 
+enum DEMOSAIC_TYPE{DT_BILINEAR, DT_MALVAR_HE_CUTLER, DT_AHD};
+
+enum BAYER_PATTERN{BP_RGGB, BP_BGGR, BP_GRBG, BP_GBRG};
+
 /**
- * @brief The FilterDemosaic class
+ * @brief The FilterDemosaic class reconstructs an RGB image from a Bayer
+ * image. The following methods are available:
+ * \li \c DT_BILINEAR: bilinear interpolation.
+ * \li \c DT_MALVAR_HE_CUTLER: gradient-corrected linear interpolation
+ * (Malvar, He, and Cutler, 2004).
+ * \li \c DT_AHD: adaptive homogeneity-directed demosaicing (Hirakawa and Parks, 2005).
+ *
+ * Each tile is loaded into a small buffer with a mirrored halo, so the
+ * interpolation kernels do not need to clamp coordinates and tiles are
+ * processed in parallel. Input can be a single channel Image or a RAW buffer,
+ * which is converted to float one tile at a time.
  */
 class FilterDemosaic: public Filter
 {
 protected:
 
     /**
-     * @brief SetupAux
-     * @param imgIn
-     * @param imgOut
+     * @brief TileLoader is a function for loading a tile of Bayer data.
+     */
+    typedef void (*TileLoader)(const void *data, int width, int height, float scale,
+                               int ox, int oy, int tw, int th, float *tile);
+
+    DEMOSAIC_TYPE   type;
+    int             cfa[4];
+
+    //RAW input
+    const void      *raw_data;
+    TileLoader      raw_loader;
+    int             raw_width, raw_height;
+    float           raw_scale;
+
+    static const int halo = 6;
+
+    /**
+     * @brief Mirror reflects a coordinate inside [0, n - 1] periodically,
+     * with period 2 * n - 2, so coordinates farther than n from the border
+     * are handled as well; this keeps the parity of the coordinate, so
+     * Bayer colors are preserved.
+     * @param x
+     * @param n
      * @return
      */
-    Image *SetupAux(ImageVec imgIn, Image *imgOut)
+    static inline int Mirror(int x, int n)
     {
-        if(imgOut == NULL) {
-            imgOut = new Image(1, imgIn[0]->width, imgIn[0]->height, 3);
+        if(n < 2) {
+            return 0;
         }
 
-        return imgOut;
+        int p = 2 * n - 2;
+
+        x %= p;
+
+        if(x < 0) {
+            x += p;
+        }
+
+        return (x >= n) ? (p - x) : x;
     }
 
-    //Linear upsampling of green channel with gradient correction
-    void LinearUpSamplingGCGreen(Image *imgIn, Image *imgOut)
+    /**
+     * @brief LoadTile copies a tile with its halo, and it converts values
+     * to float.
+     * @param data
+     * @param width
+     * @param height
+     * @param scale
+     * @param ox
+     * @param oy
+     * @param tw
+     * @param th
+     * @param tile
+     */
+    template<class T>
+    static void LoadTile(const void *data, int width, int height, float scale,
+                         int ox, int oy, int tw, int th, float *tile)
     {
-        int height = imgIn->height;
-        int width = imgIn->width;
-
-        float *dataIn = imgIn->data;
-        float *dataOut = imgOut->data;
-
-        //Copying the original Green pixels into the U16RGB buffer
-        for(int j = 0; j < height; j++) {
-            int tmp = j * width;
-            for(int i = ((j + 1) % 2); i < width; i += 2) {
-                int current = tmp + i;
-                dataOut[current * 3 + 1] = dataIn[current];
+        const T *data_T = (const T *) data;
+
+        for(int j = 0; j < th; j++) {
+            const T *row = &data_T[Mirror(oy + j, height) * width];
+            float *tile_row = &tile[j * tw];
+
+            for(int i = 0; i < tw; i++) {
+                tile_row[i] = float(row[Mirror(ox + i, width)]) * scale;
             }
         }
+    }
 
-        //Edge-aware interpolation for the missing Green pixels
-        //#pragma omp parallel for
-        for(int k = 0; k < 2; k++) {
-            for(int j = k; j < (height); j += 2) {
-                float tmpG, sum, Grad, final;
+    /**
+     * @brief ProcessTileLinear runs bilinear or Malvar-He-Cutler demosaicing
+     * on a tile; each phase of the Bayer pattern is processed
+     * with a fixed kernel.
+     * @param dst
+     * @param box
+     * @param tile
+     * @param tw
+     * @param ox
+     * @param oy
+     * @param bMHC
+     */
+    void ProcessTileLinear(Image *dst, BBox *box, float *tile, int tw,
+                           int ox, int oy, bool bMHC)
+    {
+        int s  = tw;
+        int s2 = tw * 2;
+
+        for(int y = box->y0; y < box->y1; y++) {
+            int ry = y & 1;
 
-                int tmp = j * width;
+            for(int px = 0; px < 2; px++) {
+                int xs = box->x0 + (((box->x0 & 1) != px) ? 1 : 0);
+
+                if(xs >= box->x1) {
+                    continue;
+                }
 
-                for(int i = k; i < (width); i += 2) {
-                    //    -1
-                    //     2
-                    //-1 2 4 2 -1
-                    //     2
-                    //    -1
+                int c = cfa[px + 2 * ry];
 
-                    int current = tmp + i;
+                float *o = &dst->data[(y * dst->width + xs) * 3];
+                const float *p = &tile[(y - oy) * tw + (xs - ox)];
 
-                    tmpG  = (dataIn[imgIn->Address(i + 1, j)] +
-                             dataIn[imgIn->Address(i - 1, j)] +
-                             dataIn[imgIn->Address(i, j + 1)] +
-                             dataIn[imgIn->Address(i, j - 1)]) * 0.25f;
+                if(c == 1) {
+                    //green site: ch is the color of horizontal neighbors
+                    int ch = cfa[(1 - px) + 2 * ry];
+                    int cv = 2 - ch;
 
-                    sum  = (dataIn[imgIn->Address(i + 2, j)] +
-                            dataIn[imgIn->Address(i - 2, j)] +
-                            dataIn[imgIn->Address(i, j + 2)] +
-                            dataIn[imgIn->Address(i, j - 2)]);
+                    for(int x = xs; x < box->x1; x += 2) {
+                        float vh, vv;
 
-                    Grad = dataIn[current] - sum * 0.25f;
+                        if(bMHC) {
+                            float common = 5.0f * p[0] - (p[-s - 1] + p[-s + 1] + p[s - 1] + p[s + 1]);
 
-                    final = tmpG + Grad * 0.5f;
+                            vh = (common + 4.0f * (p[-1] + p[1]) +
+                                  0.5f * (p[-s2] + p[s2]) - (p[-2] + p[2])) * 0.125f;
 
-                    dataOut[current * 3 + 1] = CLAMPi(final, 0.0f, 1.0f);
+                            vv = (common + 4.0f * (p[-s] + p[s]) +
+                                  0.5f * (p[-2] + p[2]) - (p[-s2] + p[s2])) * 0.125f;
+                        } else {
+                            vh = (p[-1] + p[1]) * 0.5f;
+                            vv = (p[-s] + p[s]) * 0.5f;
+                        }
+
+                        o[1]  = p[0];
+                        o[ch] = MAX(vh, 0.0f);
+                        o[cv] = MAX(vv, 0.0f);
+
+                        p += 2;
+                        o += 6;
+                    }
+                } else {
+                    //red or blue site
+                    int co = 2 - c;
+
+                    for(int x = xs; x < box->x1; x += 2) {
+                        float vg, vo;
+
+                        float cross = p[-1] + p[1] + p[-s] + p[s];
+                        float diag = p[-s - 1] + p[-s + 1] + p[s - 1] + p[s + 1];
+
+                        if(bMHC) {
+                            float farSum = p[-2] + p[2] + p[-s2] + p[s2];
+
+                            vg = (4.0f * p[0] + 2.0f * cross - farSum) * 0.125f;
+                            vo = (6.0f * p[0] + 2.0f * diag - 1.5f * farSum) * 0.125f;
+                        } else {
+                            vg = cross * 0.25f;
+                            vo = diag * 0.25f;
+                        }
+
+                        o[c]  = p[0];
+                        o[1]  = MAX(vg, 0.0f);
+                        o[co] = MAX(vo, 0.0f);
+
+                        p += 2;
+                        o += 6;
+                    }
                 }
             }
         }
     }
 
-    //Linear UpSampling with gradients: Red and Blue channels
-    void LinearUpSamplingGCRB(Image *imgIn, Image *imgOut, int sx,
-                                         int sy)
+    /**
+     * @brief RGBtoLab converts a linear RGB color into CIE L*a*b*.
+     * @param rgb
+     * @param lab
+     */
+    static inline void RGBtoLab(const float *rgb, float *lab)
     {
-        int i, j;
-        int shifter = sx + sy;
-
-        int height = imgIn->height;
-        int width = imgIn->width;
-        float *dataIn = imgIn->data;
-        float *data = imgOut->data;
-
-        //Copying the original pixels!
-        //#pragma omp parallel for
-        for(j = sy; j < height; j += 2) {
-            for(i = sx; i < width; i += 2) {
-                int current = j * width + i;
-                data[current * 3 + shifter] = dataIn[current];
+        float X = (0.4124f * rgb[0] + 0.3576f * rgb[1] + 0.1805f * rgb[2]) / 0.95047f;
+        float Y = (0.2126f * rgb[0] + 0.7152f * rgb[1] + 0.0722f * rgb[2]);
+        float Z = (0.0193f * rgb[0] + 0.1192f * rgb[1] + 0.9505f * rgb[2]) / 1.08883f;
+
+        float fx = X > 0.008856f ? cbrtf(X) : (7.787f * X + 16.0f / 116.0f);
+        float fy = Y > 0.008856f ? cbrtf(Y) : (7.787f * Y + 16.0f / 116.0f);
+        float fz = Z > 0.008856f ? cbrtf(Z) : (7.787f * Z + 16.0f / 116.0f);
+
+        lab[0] = 116.0f * fy - 16.0f;
+        lab[1] = 500.0f * (fx - fy);
+        lab[2] = 200.0f * (fy - fz);
+    }
+
+    /**
+     * @brief ProcessTileAHD runs adaptive homogeneity-directed demosaicing
+     * on a tile.
+     * @param dst
+     * @param box
+     * @param tile
+     * @param tw
+     * @param th
+     * @param ox
+     * @param oy
+     */
+    void ProcessTileAHD(Image *dst, BBox *box, float *tile, int tw, int th,
+                        int ox, int oy)
+    {
+        int n = tw * th;
+        int s = tw;
+
+        float *buf = new float[n * 16];
+        float *green[2] = {&buf[0], &buf[n]};
+        float *rgb[2]   = {&buf[n * 2], &buf[n * 5]};
+        float *lab[2]   = {&buf[n * 8], &buf[n * 11]};
+        float *homo[2]  = {&buf[n * 14], &buf[n * 15]};
+
+        int bw = box->x1 - box->x0;
+        int bh = box->y1 - box->y0;
+
+        //1) directional interpolation of green (Hamilton-Adams)
+        for(int j = halo - 4; j < (halo + bh + 4); j++) {
+            int y = oy + j;
+
+            for(int i = halo - 4; i < (halo + bw + 4); i++) {
+                int x = ox + i;
+                int ind = j * tw + i;
+                const float *p = &tile[ind];
+
+                if(cfa[(x & 1) + 2 * (y & 1)] == 1) {
+                    green[0][ind] = p[0];
+                    green[1][ind] = p[0];
+                } else {
+                    float gh = (p[-1] + p[1]) * 0.5f + (2.0f * p[0] - p[-2] - p[2]) * 0.25f;
+                    float gv = (p[-s] + p[s]) * 0.5f + (2.0f * p[0] - p[-2 * s] - p[2 * s]) * 0.25f;
+
+                    green[0][ind] = CLAMPi(gh, MIN(p[-1], p[1]), MAX(p[-1], p[1]));
+                    green[1][ind] = CLAMPi(gv, MIN(p[-s], p[s]), MAX(p[-s], p[s]));
+                }
             }
         }
 
-        //Edge-aware interpolation for the missing Green pixels
-        int ssx = 0;
-        int ssy = 0;
+        //2) red and blue interpolation using color differences, and CIE L*a*b*
+        for(int d = 0; d < 2; d++) {
+            float *G = green[d];
 
-        if(shifter == 0) {
-            ssx = 1;
-            ssy = 0;
-        }
+            for(int j = halo - 2; j < (halo + bh + 2); j++) {
+                int y = oy + j;
+
+                for(int i = halo - 2; i < (halo + bw + 2); i++) {
+                    int x = ox + i;
+                    int ind = j * tw + i;
+                    const float *p = &tile[ind];
+                    const float *g = &G[ind];
+                    float *out = &rgb[d][ind * 3];
+
+                    int c = cfa[(x & 1) + 2 * (y & 1)];
 
-        if(shifter == 2) {
-            ssx = 0;
-            ssy = 1;
+                    if(c == 1) {
+                        int ch = cfa[((x + 1) & 1) + 2 * (y & 1)];
+
+                        out[1]  = p[0];
+                        out[ch] = p[0] + ((p[-1] - g[-1]) + (p[1] - g[1])) * 0.5f;
+                        out[2 - ch] = p[0] + ((p[-s] - g[-s]) + (p[s] - g[s])) * 0.5f;
+                    } else {
+                        out[c] = p[0];
+                        out[1] = g[0];
+                        out[2 - c] = g[0] + ((p[-s - 1] - g[-s - 1]) + (p[-s + 1] - g[-s + 1]) +
+                                             (p[ s - 1] - g[ s - 1]) + (p[ s + 1] - g[ s + 1])) * 0.25f;
+                    }
+
+                    for(int k = 0; k < 3; k++) {
+                        out[k] = MAX(out[k], 0.0f);
+                    }
+
+                    RGBtoLab(out, &lab[d][ind * 3]);
+                }
+            }
         }
 
-        //First Mask
-        //#pragma omp parallel for
-        for(j = ssy; j < (height); j += 2) {
-            float tmp;
-
-            for(i = ssx; i < (width); i += 2) {
-                //
-                //		    0.5
-                //      -1   0  -1
-                //  -1   4   5   4   -1
-                //      -1   0  -1
-                //		    0.5
-                //
-                int current = j * width + i;
-
-                tmp =	5.0f *	dataIn[current] +
-                        4.0f * (dataIn[imgIn->Address(i + 1, j)] +	dataIn[imgIn->Address(i - 1,
-                                j)]) +
-                        0.5f * (dataIn[imgIn->Address(i, j + 2)] +	dataIn[imgIn->Address(i,
-                                j - 2)]) -
-                        (dataIn[imgIn->Address(i + 1, j + 1)] +	dataIn[imgIn->Address(i + 1,
-                                j - 1)] +
-                         dataIn[imgIn->Address(i - 1, j + 1)] +	dataIn[imgIn->Address(i - 1,
-                                 j - 1)] +
-                         dataIn[imgIn->Address(i - 2, j)] +	dataIn[imgIn->Address(i + 2, j)]);
-                tmp /= 8.0f;
-                data[current * 3 + shifter] = CLAMPi(tmp, 0.0f, 1.0f);
+        //3) homogeneity maps
+        const int dx[4] = {-1, 1, 0, 0};
+        const int dy[4] = {0, 0, -1, 1};
+
+        for(int j = halo - 1; j < (halo + bh + 1); j++) {
+            for(int i = halo - 1; i < (halo + bw + 1); i++) {
+                int ind = j * tw + i;
+
+                float ldiff[2][4], abdiff[2][4];
+
+                for(int d = 0; d < 2; d++) {
+                    float *l0 = &lab[d][ind * 3];
+
+                    for(int k = 0; k < 4; k++) {
+                        float *l1 = &lab[d][(ind + dy[k] * tw + dx[k]) * 3];
+
+                        float da = l0[1] - l1[1];
+                        float db = l0[2] - l1[2];
+
+                        ldiff[d][k]  = fabsf(l0[0] - l1[0]);
+                        abdiff[d][k] = da * da + db * db;
+                    }
+                }
+
+                float epsL = MIN(MAX(ldiff[0][0], ldiff[0][1]), MAX(ldiff[1][2], ldiff[1][3]));
+                float epsC = MIN(MAX(abdiff[0][0], abdiff[0][1]), MAX(abdiff[1][2], abdiff[1][3]));
+
+                for(int d = 0; d < 2; d++) {
+                    float counter = 0.0f;
+
+                    for(int k = 0; k < 4; k++) {
+                        if((ldiff[d][k] <= epsL) && (abdiff[d][k] <= epsC)) {
+                            counter += 1.0f;
+                        }
+                    }
+
+                    homo[d][ind] = counter;
+                }
             }
         }
 
-        //Second Mask
-        if(shifter == 0) {
-            ssx = 0;
-            ssy = 1;
+        //4) selection of the most homogeneous direction
+        for(int y = box->y0; y < box->y1; y++) {
+            int j = y - oy;
+            float *o = &dst->data[(y * dst->width + box->x0) * 3];
+
+            for(int x = box->x0; x < box->x1; x++) {
+                int i = x - ox;
+                int ind = j * tw + i;
+
+                float hm[2] = {0.0f, 0.0f};
+
+                for(int d = 0; d < 2; d++) {
+                    for(int k = -1; k <= 1; k++) {
+                        float *h = &homo[d][ind + k * tw];
+                        hm[d] += h[-1] + h[0] + h[1];
+                    }
+                }
+
+                float *c0 = &rgb[0][ind * 3];
+                float *c1 = &rgb[1][ind * 3];
+
+                if(hm[0] > hm[1]) {
+                    o[0] = c0[0];
+                    o[1] = c0[1];
+                    o[2] = c0[2];
+                } else {
+                    if(hm[0] < hm[1]) {
+                        o[0] = c1[0];
+                        o[1] = c1[1];
+                        o[2] = c1[2];
+                    } else {
+                        o[0] = (c0[0] + c1[0]) * 0.5f;
+                        o[1] = (c0[1] + c1[1]) * 0.5f;
+                        o[2] = (c0[2] + c1[2]) * 0.5f;
+                    }
+                }
+
+                o += 3;
+            }
         }
 
-        if(shifter == 2) {
-            ssx = 1;
-            ssy = 0;
+        delete[] buf;
+    }
+
+    /**
+     * @brief ProcessBBox
+     * @param dst
+     * @param src
+     * @param box
+     */
+    void ProcessBBox(Image *dst, ImageVec src, BBox *box)
+    {
+        int ox = box->x0 - halo;
+        int oy = box->y0 - halo;
+        int tw = (box->x1 - box->x0) + 2 * halo;
+        int th = (box->y1 - box->y0) + 2 * halo;
+
+        float *tile = new float[tw * th];
+
+        if(raw_data != NULL) {
+            raw_loader(raw_data, raw_width, raw_height, raw_scale, ox, oy, tw, th, tile);
+        } else {
+            LoadTile<float>(src[0]->data, src[0]->width, src[0]->height, 1.0f,
+                            ox, oy, tw, th, tile);
         }
 
-        //#pragma omp parallel for
-        for(j = ssy; j < (height); j += 2) {
-            float tmp;
-
-            for(i = ssx; i < (width); i += 2) {
-                //
-                //		     -1
-                //       -1   4  -1
-                //  0.5   0   5   0   0.5
-                //       -1   4  -1
-                //		     -1
-                //
-                int current = j * width + i;
-
-                tmp =	5.0f * dataIn[current] +
-                        4.0f * (dataIn[imgIn->Address(i, j + 1)] +	dataIn[imgIn->Address(i,
-                                j - 1)]) +
-                        +0.5f * (dataIn[imgIn->Address(i - 2, j)] +	dataIn[imgIn->Address(i + 2,
-                                 j)]) -
-                        (dataIn[imgIn->Address(i + 1, j + 1)] +	dataIn[imgIn->Address(i + 1,
-                                j - 1)] +
-                         dataIn[imgIn->Address(i - 1, j + 1)] +	dataIn[imgIn->Address(i - 1,
-                                 j - 1)] +
-                         dataIn[imgIn->Address(i, j + 2)] +	dataIn[imgIn->Address(i, j - 2)]);
-
-                tmp /= 8.0f;
-                data[current * 3 + shifter] = CLAMPi(tmp, 0.0f, 1.0f);
-            }
+        switch(type) {
+        case DT_BILINEAR: {
+            ProcessTileLinear(dst, box, tile, tw, ox, oy, false);
         }
+        break;
 
-        //Third Mask
-        if(shifter == 0) {
-            ssx = 1;
-            ssy = 1;
+        case DT_AHD: {
+            ProcessTileAHD(dst, box, tile, tw, th, ox, oy);
         }
+        break;
 
-        if(shifter == 2) {
-            ssx = 0;
-            ssy = 0;
+        default: {
+            ProcessTileLinear(dst, box, tile, tw, ox, oy, true);
         }
+        break;
+        }
+
+        delete[] tile;
+    }
 
-        //#pragma omp parallel for
-        for(j = ssy; j < (height); j += 2) {
-            float tmp;
-
-            for(i = ssx; i < (width); i += 2) {
-                //
-                //		     -3/2
-                //         2   0   2
-                //  -3/2   0   6   0   -3/2
-                //         2   0   2
-                //		     -3/2
-                //
-                int current = j * width + i;
-                tmp =	6.0f *	dataIn[current] +
-                        2.0f * (dataIn[imgIn->Address(i + 1, j + 1)] +	dataIn[imgIn->Address(i + 1,
-                                j - 1)] +
-                                dataIn[imgIn->Address(i - 1, j + 1)] +	dataIn[imgIn->Address(i - 1,
-                                        j - 1)]) -
-                        1.5f * (dataIn[imgIn->Address(i + 2, j)] +	dataIn[imgIn->Address(i - 2,
-                                j)] +
-                                dataIn[imgIn->Address(i, j + 2)] +	dataIn[imgIn->Address(i, j - 2)]);
-
-                tmp /= 8.0f;
-                data[current * 3 + shifter] = CLAMPi(tmp, 0.0f, 1.0f);
+    /**
+     * @brief SetupAux
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *SetupAux(ImageVec imgIn, Image *imgOut)
+    {
+        if(imgOut == NULL) {
+            imgOut = new Image(1, imgIn[0]->width, imgIn[0]->height, 3);
+        } else {
+            if((imgOut->width  != imgIn[0]->width)  ||
+               (imgOut->height != imgIn[0]->height) ||
+               (imgOut->channels != 3)) {
+                imgOut = new Image(1, imgIn[0]->width, imgIn[0]->height, 3);
             }
         }
+
+        return imgOut;
     }
 
 public:
@@ -249,9 +469,51 @@ public:
     /**
      * @brief FilterDemosaic
      * @param type
+     * @param pattern
      */
-    FilterDemosaic() : Filter()
+    FilterDemosaic(DEMOSAIC_TYPE type = DT_MALVAR_HE_CUTLER,
+                   BAYER_PATTERN pattern = BP_RGGB) : Filter()
     {
+        raw_data = NULL;
+        raw_loader = NULL;
+        raw_width = 0;
+        raw_height = 0;
+        raw_scale = 1.0f;
+
+        Update(type, pattern);
+    }
+
+    /**
+     * @brief Update
+     * @param type
+     * @param pattern
+     */
+    void Update(DEMOSAIC_TYPE type, BAYER_PATTERN pattern = BP_RGGB)
+    {
+        this->type = type;
+
+        //color of (x & 1) + 2 * (y & 1); 0 is red, 1 is green, and 2 is blue
+        switch(pattern) {
+        case BP_BGGR: {
+            cfa[0] = 2; cfa[1] = 1; cfa[2] = 1; cfa[3] = 0;
+        }
+        break;
+
+        case BP_GRBG: {
+            cfa[0] = 1; cfa[1] = 0; cfa[2] = 2; cfa[3] = 1;
+        }
+        break;
+
+        case BP_GBRG: {
+            cfa[0] = 1; cfa[1] = 2; cfa[2] = 0; cfa[3] = 1;
+        }
+        break;
+
+        default: {
+            cfa[0] = 0; cfa[1] = 1; cfa[2] = 1; cfa[3] = 2;
+        }
+        break;
+        }
     }
 
     /**
@@ -267,12 +529,11 @@ public:
         width       = imgIn->width;
         height      = imgIn->height;
         channels    = 3;
-        frames      = imgIn->frames;
+        frames      = 1;
     }
 
-
     /**
-      * @brief Filter::Process
+      * @brief Process
       * @param imgIn
       * @param imgOut
       * @return
@@ -280,21 +541,19 @@ public:
     Image *Process(ImageVec imgIn, Image *imgOut)
     {
         if(imgIn[0] == NULL) {
-            return NULL;
+            return imgOut;
         }
 
-        if((!imgIn[0]->isValid()) && (imgIn[0]->channels != 1)) {
+        if((!imgIn[0]->isValid()) || (imgIn[0]->channels != 1)) {
             return imgOut;
         }
 
-        imgOut = SetupAux(imgIn, imgOut);
-
-
-        LinearUpSamplingGCGreen(imgIn[0], imgOut);
-        LinearUpSamplingGCRB(imgIn[0], imgOut, 0, 0);
-        LinearUpSamplingGCRB(imgIn[0], imgOut, 1, 1);
+        //a Bayer pattern needs at least a 2 x 2 cell
+        if((imgIn[0]->width < 2) || (imgIn[0]->height < 2)) {
+            return imgOut;
+        }
 
-        return imgOut;
+        return Filter::Process(imgIn, imgOut);
     }
 
     /**
@@ -305,19 +564,103 @@ public:
      */
     Image *ProcessP(ImageVec imgIn, Image *imgOut)
     {
-        return Process(imgIn, imgOut);
+        if(imgIn[0] == NULL) {
+            return imgOut;
+        }
+
+        if((!imgIn[0]->isValid()) || (imgIn[0]->channels != 1)) {
+            return imgOut;
+        }
+
+        //a Bayer pattern needs at least a 2 x 2 cell
+        if((imgIn[0]->width < 2) || (imgIn[0]->height < 2)) {
+            return imgOut;
+        }
+
+        return Filter::ProcessP(imgIn, imgOut);
+    }
+
+    /**
+     * @brief ProcessRAW demosaics a RAW buffer without converting it
+     * to float beforehand.
+     * @param raw
+     * @param width
+     * @param height
+     * @param scale is applied to RAW values; e.g. 1.0f / 65535.0f for 16-bit data.
+     * @param imgOut
+     * @return
+     */
+    template<class T>
+    Image *ProcessRAW(RAW<T> *raw, int width, int height, float scale, Image *imgOut)
+    {
+        if(raw == NULL) {
+            return imgOut;
+        }
+
+        if((raw->data == NULL) || (raw->nData < (width * height))) {
+            return imgOut;
+        }
+
+        if((width < 2) || (height < 2)) {
+            return imgOut;
+        }
+
+        if(imgOut == NULL) {
+            imgOut = new Image(1, width, height, 3);
+        } else {
+            if((imgOut->width != width) || (imgOut->height != height) ||
+               (imgOut->channels != 3)) {
+                imgOut = new Image(1, width, height, 3);
+            }
+        }
+
+        raw_data = raw->data;
+        raw_loader = &LoadTile<T>;
+        raw_width = width;
+        raw_height = height;
+        raw_scale = scale;
+
+        //the input is read from raw_data; imgOut is only used for its size
+        imgOut = Filter::ProcessP(Single(imgOut), imgOut);
+
+        raw_data = NULL;
+        raw_loader = NULL;
+
+        return imgOut;
     }
 
     /**
      * @brief Execute
      * @param imgIn
      * @param imgOut
+     * @param type
+     * @return
+     */
+    static Image *Execute(Image *imgIn, Image *imgOut,
+                          DEMOSAIC_TYPE type = DT_MALVAR_HE_CUTLER)
+    {
+        FilterDemosaic flt(type);
+        return flt.ProcessP(Single(imgIn), imgOut);
+    }
+
+    /**
+     * @brief ExecuteRAW
+     * @param raw
+     * @param width
+     * @param height
+     * @param scale
+     * @param imgOut
+     * @param type
+     * @param pattern
      * @return
      */
-    static Image *Execute(Image *imgIn, Image *imgOut)
+    template<class T>
+    static Image *ExecuteRAW(RAW<T> *raw, int width, int height, float scale,
+                             Image *imgOut, DEMOSAIC_TYPE type = DT_MALVAR_HE_CUTLER,
+                             BAYER_PATTERN pattern = BP_RGGB)
     {
-        FilterDemosaic flt;
-        return flt.Process(Single(imgIn), imgOut);
+        FilterDemosaic flt(type, pattern);
+        return flt.ProcessRAW(raw, width, height, scale, imgOut);
     }
 };
 
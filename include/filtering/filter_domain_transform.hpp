@@ -0,0 +1,467 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_FILTERING_FILTER_DOMAIN_TRANSFORM_HPP
+#define PIC_FILTERING_FILTER_DOMAIN_TRANSFORM_HPP
+
+#include <math.h>
+#include <vector>
+
+#include "filtering/filter.hpp"
+
+namespace pic {
+
+/**
+ * @brief The DOMAIN_TRANSFORM_TYPE enum: normalized convolution or
+ * recursive filtering.
+ */
+enum DOMAIN_TRANSFORM_TYPE {DTF_NC, DTF_RF};
+
+/**
+ * @brief The FilterDomainTransform class implements the edge-aware
+ * domain transform filter of Gastal and Oliveira 2011. Each iteration is
+ * a horizontal and a vertical 1D pass whose kernel shrinks over
+ * iterations. Rows and columns are processed in parallel; the vertical
+ * recursive pass sweeps whole rows so that inner loops run across
+ * columns and channels.
+ */
+class FilterDomainTransform: public Filter
+{
+protected:
+    float sigma_s, sigma_r;
+    int nIterations;
+    DOMAIN_TRANSFORM_TYPE type;
+
+    /**
+     * @brief Derivatives computes dHdx and dVdy of the domain transform,
+     * 1 + sigma_s / sigma_r * sum_c |I'_c|, of a frame of the edge image.
+     * @param edge
+     * @param frame
+     * @param dHdx is a width x height array.
+     * @param dVdy is a width x height array.
+     * @param stride is the row stride of dHdx and dVdy.
+     */
+    void Derivatives(Image *edge, int frame, float *dHdx, float *dVdy,
+                     int stride)
+    {
+        int width = edge->width;
+        int height = edge->height;
+        int channels = edge->channels;
+        float ratio = sigma_s / sigma_r;
+        float *data = edge->data + frame * edge->tstride;
+
+        #pragma omp parallel for schedule(static)
+        for(int y = 0; y < height; y++) {
+            float *row = data + y * edge->ystride;
+            float *rowUp = data + MAX(y - 1, 0) * edge->ystride;
+
+            for(int x = 0; x < width; x++) {
+                float *p = row + x * channels;
+                float *pl = row + MAX(x - 1, 0) * channels;
+                float *pu = rowUp + x * channels;
+
+                float dh = 0.0f;
+                float dv = 0.0f;
+
+                for(int c = 0; c < channels; c++) {
+                    dh += fabsf(p[c] - pl[c]);
+                    dv += fabsf(p[c] - pu[c]);
+                }
+
+                dHdx[y * stride + x] = 1.0f + ratio * dh;
+                dVdy[y * stride + x] = 1.0f + ratio * dv;
+            }
+        }
+    }
+
+    /**
+     * @brief RecursiveRows applies the recursive filter along each row.
+     * @param J
+     * @param width
+     * @param height
+     * @param channels
+     * @param dHdx
+     * @param a is the feedback coefficient.
+     */
+    static void RecursiveRows(float *J, int width, int height, int channels,
+                              float *dHdx, float a)
+    {
+        float log_a = logf(a);
+
+        #pragma omp parallel
+        {
+            std::vector<float> V(width);
+
+            #pragma omp for schedule(static)
+            for(int y = 0; y < height; y++) {
+                float *row = J + y * width * channels;
+                float *d = dHdx + y * width;
+
+                for(int x = 0; x < width; x++) {
+                    V[x] = expf(d[x] * log_a);
+                }
+
+                //causal
+                for(int x = 1; x < width; x++) {
+                    float v = V[x];
+                    float *p = row + x * channels;
+                    float *q = p - channels;
+
+                    for(int c = 0; c < channels; c++) {
+                        p[c] += v * (q[c] - p[c]);
+                    }
+                }
+
+                //anti-causal
+                for(int x = width - 2; x >= 0; x--) {
+                    float v = V[x + 1];
+                    float *p = row + x * channels;
+                    float *q = p + channels;
+
+                    for(int c = 0; c < channels; c++) {
+                        p[c] += v * (q[c] - p[c]);
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief RecursiveColumns applies the recursive filter along each
+     * column, sweeping rows over bands of columns.
+     * @param J
+     * @param width
+     * @param height
+     * @param channels
+     * @param dVdy
+     * @param a is the feedback coefficient.
+     */
+    static void RecursiveColumns(float *J, int width, int height, int channels,
+                                 float *dVdy, float a)
+    {
+        float log_a = logf(a);
+        int band = 64;
+        int nBands = (width + band - 1) / band;
+
+        #pragma omp parallel
+        {
+            std::vector<float> V(band * height);
+
+            #pragma omp for schedule(static)
+            for(int b = 0; b < nBands; b++) {
+                int x0 = b * band;
+                int x1 = MIN(x0 + band, width);
+                int n = x1 - x0;
+                int stride = width * channels;
+
+                for(int y = 0; y < height; y++) {
+                    float *d = dVdy + y * width + x0;
+                    float *v = &V[y * band];
+
+                    for(int x = 0; x < n; x++) {
+                        v[x] = expf(d[x] * log_a);
+                    }
+                }
+
+                //causal
+                for(int y = 1; y < height; y++) {
+                    float *p = J + y * stride + x0 * channels;
+                    float *q = p - stride;
+                    float *v = &V[y * band];
+
+                    for(int x = 0; x < n; x++) {
+                        float vx = v[x];
+
+                        for(int c = 0; c < channels; c++) {
+                            int i = x * channels + c;
+                            p[i] += vx * (q[i] - p[i]);
+                        }
+                    }
+                }
+
+                //anti-causal
+                for(int y = height - 2; y >= 0; y--) {
+                    float *p = J + y * stride + x0 * channels;
+                    float *q = p + stride;
+                    float *v = &V[(y + 1) * band];
+
+                    for(int x = 0; x < n; x++) {
+                        float vx = v[x];
+
+                        for(int c = 0; c < channels; c++) {
+                            int i = x * channels + c;
+                            p[i] += vx * (q[i] - p[i]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief NormalizedRows applies a box filter of radius r in the
+     * transformed domain along each row.
+     * @param J
+     * @param width
+     * @param height
+     * @param channels
+     * @param dHdx
+     * @param r
+     */
+    static void NormalizedRows(float *J, int width, int height, int channels,
+                               float *dHdx, float r)
+    {
+        #pragma omp parallel
+        {
+            std::vector<float> ct(width);
+            std::vector<double> S((width + 1) * channels);
+
+            #pragma omp for schedule(static)
+            for(int y = 0; y < height; y++) {
+                float *row = J + y * width * channels;
+                float *d = dHdx + y * width;
+
+                //domain transform and prefix sums
+                ct[0] = 0.0f;
+                for(int x = 1; x < width; x++) {
+                    ct[x] = ct[x - 1] + d[x];
+                }
+
+                for(int c = 0; c < channels; c++) {
+                    S[c] = 0.0;
+                }
+
+                for(int x = 0; x < width; x++) {
+                    double *s0 = &S[x * channels];
+                    double *s1 = s0 + channels;
+                    float *p = row + x * channels;
+
+                    for(int c = 0; c < channels; c++) {
+                        s1[c] = s0[c] + double(p[c]);
+                    }
+                }
+
+                int l = 0;
+                int u = 0;
+
+                for(int x = 0; x < width; x++) {
+                    float lo = ct[x] - r;
+                    float hi = ct[x] + r;
+
+                    while(ct[l] < lo) {
+                        l++;
+                    }
+
+                    while((u + 1) < width && ct[u + 1] <= hi) {
+                        u++;
+                    }
+
+                    double *s0 = &S[l * channels];
+                    double *s1 = &S[(u + 1) * channels];
+                    double norm = 1.0 / double(u - l + 1);
+                    float *p = row + x * channels;
+
+                    for(int c = 0; c < channels; c++) {
+                        p[c] = float((s1[c] - s0[c]) * norm);
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Transpose
+     * @param src is a width x height image.
+     * @param dst is a height x width image.
+     * @param width
+     * @param height
+     * @param channels
+     */
+    static void Transpose(float *src, float *dst, int width, int height, int channels)
+    {
+        #pragma omp parallel for schedule(static)
+        for(int x = 0; x < width; x++) {
+            for(int y = 0; y < height; y++) {
+                float *s = src + (y * width + x) * channels;
+                float *t = dst + (x * height + y) * channels;
+
+                for(int c = 0; c < channels; c++) {
+                    t[c] = s[c];
+                }
+            }
+        }
+    }
+
+public:
+
+    /**
+     * @brief FilterDomainTransform
+     * @param sigma_s is the spatial standard deviation in pixels.
+     * @param sigma_r is the range standard deviation.
+     * @param nIterations
+     * @param type
+     */
+    FilterDomainTransform(float sigma_s, float sigma_r, int nIterations = 3,
+                          DOMAIN_TRANSFORM_TYPE type = DTF_RF)
+    {
+        Update(sigma_s, sigma_r, nIterations, type);
+    }
+
+    /**
+     * @brief Update
+     * @param sigma_s
+     * @param sigma_r
+     * @param nIterations
+     * @param type
+     */
+    void Update(float sigma_s, float sigma_r, int nIterations = 3,
+                DOMAIN_TRANSFORM_TYPE type = DTF_RF)
+    {
+        this->sigma_s = sigma_s > 0.0f ? sigma_s : 1.0f;
+        this->sigma_r = sigma_r > 0.0f ? sigma_r : 0.1f;
+        this->nIterations = MAX(nIterations, 1);
+        this->type = type;
+    }
+
+    /**
+     * @brief Signature
+     * @return
+     */
+    std::string Signature()
+    {
+        return GenBilString(type == DTF_RF ? "DTRF" : "DTNC", sigma_s, sigma_r);
+    }
+
+    /**
+     * @brief Process filters imgIn[0]; imgIn[1], when present, is the
+     * edge image. An edge image whose width or height differs from
+     * imgIn[0] is ignored, and imgIn[0] guides itself.
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *Process(ImageVec imgIn, Image *imgOut);
+
+    /**
+     * @brief ProcessP is Process; all passes are parallel.
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *ProcessP(ImageVec imgIn, Image *imgOut)
+    {
+        return Process(imgIn, imgOut);
+    }
+
+    /**
+     * @brief Execute
+     * @param imgIn
+     * @param imgEdge
+     * @param imgOut
+     * @param sigma_s
+     * @param sigma_r
+     * @param nIterations
+     * @param type
+     * @return
+     */
+    static Image *Execute(Image *imgIn, Image *imgEdge, Image *imgOut,
+                          float sigma_s, float sigma_r, int nIterations = 3,
+                          DOMAIN_TRANSFORM_TYPE type = DTF_RF)
+    {
+        FilterDomainTransform filter(sigma_s, sigma_r, nIterations, type);
+
+        if(imgEdge == NULL) {
+            return filter.Process(Single(imgIn), imgOut);
+        } else {
+            return filter.Process(Double(imgIn, imgEdge), imgOut);
+        }
+    }
+};
+
+PIC_INLINE Image *FilterDomainTransform::Process(ImageVec imgIn, Image *imgOut)
+{
+    if(imgIn.empty() || imgIn[0] == NULL) {
+        return imgOut;
+    }
+
+    imgOut = SetupAux(imgIn, imgOut);
+
+    if(imgOut != imgIn[0]) {
+        imgOut->Assign(imgIn[0]);
+    }
+
+    //derivatives of a frame are taken before it is filtered, so the
+    //filter can run in-place
+    Image *edge = imgOut;
+
+    if(imgIn.size() > 1 && imgIn[1] != NULL) {
+        if((imgIn[1]->width == imgIn[0]->width) &&
+           (imgIn[1]->height == imgIn[0]->height)) {
+            edge = imgIn[1];
+        }
+    }
+
+    int width = imgOut->width;
+    int height = imgOut->height;
+    int channels = imgOut->channels;
+    int n = width * height;
+
+    std::vector<float> dHdx(n), dVdy(n), tmp, dVdyT;
+
+    if(type == DTF_NC) {
+        tmp.resize(n * channels);
+        dVdyT.resize(n);
+    }
+
+    float sqrt3 = sqrtf(3.0f);
+    float den = sqrtf(powf(4.0f, float(nIterations)) - 1.0f);
+
+    for(int f = 0; f < imgOut->frames; f++) {
+        float *J = imgOut->data + f * imgOut->tstride;
+
+        Derivatives(edge, MIN(f, edge->frames - 1), &dHdx[0], &dVdy[0], width);
+
+        if(type == DTF_NC) {
+            Transpose(&dVdy[0], &dVdyT[0], width, height, 1);
+        }
+
+        for(int i = 0; i < nIterations; i++) {
+            float sigma_H = sigma_s * sqrt3 * powf(2.0f, float(nIterations - (i + 1))) / den;
+
+            if(type == DTF_RF) {
+                float a = expf(-sqrtf(2.0f) / sigma_H);
+                RecursiveRows(J, width, height, channels, &dHdx[0], a);
+                RecursiveColumns(J, width, height, channels, &dVdy[0], a);
+            } else {
+                float r = sigma_H * sqrt3;
+                NormalizedRows(J, width, height, channels, &dHdx[0], r);
+                Transpose(J, &tmp[0], width, height, channels);
+                NormalizedRows(&tmp[0], height, width, channels, &dVdyT[0], r);
+                Transpose(&tmp[0], J, height, width, channels);
+            }
+        }
+    }
+
+    imgOut->InvalidateCache();
+
+    return imgOut;
+}
+
+} // end namespace pic
+
+#endif /* PIC_FILTERING_FILTER_DOMAIN_TRANSFORM_HPP */
+
@@ -36,45 +36,68 @@ protected:
      */
     void ProcessBBox(Image *dst, ImageVec src, BBox *box)
     {
-        int channels = src[0]->channels;
+        Image *in = src[0];
+
+        int width    = in->width;
+        int height   = in->height;
+        int channels = in->channels;
+
+        //5-tap binomial filter
+        const float kernel[5] = {1.0f, 4.0f, 6.0f, 4.0f, 1.0f};
 
         for(int i2 = box->y0; i2 < box->y1; i2++) {
             int i = i2 << 1;
 
+            float *tmp_ret = &dst->data[i2 * dst->ystride];
+
             for(int j2 = box->x0; j2 < box->x1; j2++) {
                 int j = j2 << 1;
 
-                float *tmp[4];
-                tmp[0] = (*src[0])(j    , i);
-                tmp[1] = (*src[0])(j + 1, i);
-                tmp[2] = (*src[0])(j    , i + 1);
-                tmp[3] = (*src[0])(j + 1, i + 1);
-
-                int counter = 0;
-                float *tmp_ret = (*dst)(j2, i2);
+                float *out = &tmp_ret[j2 * channels];
 
                 for(int l = 0; l < channels; l++) {
-                    tmp_ret[l] = 0.0f;
+                    out[l] = 0.0f;
                 }
 
-                for(unsigned k = 0; k < 4; k++) {
-                    if(distance(tmp[k], value, channels) > threshold) {
-                        counter++;
+                //masked REDUCE: only valid samples are taken into account
+                float weight = 0.0f;
+
+                for(int k = 0; k < 5; k++) {
+                    int y = i + k - 2;
+
+                    if((y < 0) || (y >= height)) {
+                        continue;
+                    }
+
+                    float *row = &in->data[y * in->ystride];
+
+                    for(int m = 0; m < 5; m++) {
+                        int x = j + m - 2;
+
+                        if((x < 0) || (x >= width)) {
+                            continue;
+                        }
+
+                        float *tmp = &row[x * channels];
+
+                        if(distance(tmp, value, channels) > threshold) {
+                            float w = kernel[k] * kernel[m];
+                            weight += w;
 
-                        for(int l = 0; l < channels; l++) {
-                            tmp_ret[l] += tmp[k][l];
+                            for(int l = 0; l < channels; l++) {
+                                out[l] += tmp[l] * w;
+                            }
                         }
                     }
                 }
 
-                if(counter > 0) {
-                    float counter_f = float(counter);
+                if(weight > 0.0f) {
                     for(int l = 0; l < channels; l++) {
-                        tmp_ret[l] /= counter_f;
+                        out[l] /= weight;
                     }
                 } else {
                     for(int l = 0; l < channels; l++) {
-                        tmp_ret[l] = value[l];
+                        out[l] = value[l];
                     }
                 }
             }
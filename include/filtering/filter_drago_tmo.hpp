@@ -20,6 +20,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include "filtering/filter.hpp"
 #include "filtering/filter_luminance.hpp"
+#include "util/tone_curve.hpp"
 
 namespace pic {
 
@@ -32,6 +33,25 @@ protected:
     float constant1, constant2, Lw_Max_scaled, Lw_a_scaled;
     float b, Ld_Max, Lw_Max, Lw_a;
 
+    bool bLUT;
+    float tolerance;
+    ToneCurve curve;
+
+    /**
+     * @brief Ratio computes Ld / L.
+     * @param L
+     * @return
+     */
+    inline float Ratio(float L)
+    {
+        float L_scaled = L / Lw_a_scaled;
+
+        float tmp = powf((L_scaled / Lw_Max_scaled), constant1);
+        float Ld  = constant2 * log1pf(L_scaled) / logf(2.0f + 8.0f * tmp);
+
+        return Ld / L;
+    }
+
     /**
      * @brief ProcessBBox
      * @param dst
@@ -71,10 +91,52 @@ public:
      * @param Lwa
      */
     void Update(float Ld_Max, float b, float Lw_Max, float Lwa);
+
+    /**
+     * @brief setLUT enables the evaluation of the curve with a compiled
+     * ToneCurve instead of calling powf and logf for each pixel.
+     * @param bLUT
+     * @param tolerance is the maximum relative error of the ToneCurve.
+     */
+    void setLUT(bool bLUT, float tolerance = 1e-4f)
+    {
+        this->bLUT = bLUT;
+        this->tolerance = tolerance;
+
+        if(bLUT) {
+            CompileToneCurve(&curve, tolerance);
+        }
+    }
+
+    /**
+     * @brief CompileToneCurve compiles the ratio Ld / L for luminance
+     * values up to 4 * Lw_Max; this can be used with FilterToneCurve.
+     * @param curve
+     * @param tolerance
+     * @param xMax is the upper end of the range; if it is not positive,
+     * it is 4 * Lw_Max.
+     * @return
+     */
+    bool CompileToneCurve(ToneCurve *curve, float tolerance = 1e-4f, float xMax = -1.0f)
+    {
+        if(curve == NULL) {
+            return false;
+        }
+
+        if(xMax <= 0.0f) {
+            xMax = Lw_Max * 4.0f;
+        }
+
+        return curve->Compile([this](float L) {
+            return Ratio(L);
+        }, Lw_Max * 1e-9f, xMax, tolerance);
+    }
 };
 
 FilterDragoTMO::FilterDragoTMO()
 {
+    bLUT = false;
+    tolerance = 1e-4f;
     Update(100.0f, 0.95f, 1e6f, 0.5f);
 }
 
@@ -82,6 +144,8 @@ FilterDragoTMO::FilterDragoTMO()
 FilterDragoTMO::FilterDragoTMO(float Ld_Max, float b, float Lw_Max,
                                float Lw_a)
 {
+    bLUT = false;
+    tolerance = 1e-4f;
     Update(Ld_Max, b, Lw_Max, Lw_a);
 }
 
@@ -119,6 +183,10 @@ void FilterDragoTMO::Update(float Ld_Max, float b, float Lw_Max,
 
     constant1 = logf(b) / logf(0.5f);
     constant2 = (Ld_Max / 100.0f) / (log10f(1.0f + Lw_Max_scaled));
+
+    if(bLUT) {
+        CompileToneCurve(&curve, tolerance);
+    }
 }
 
 Image *FilterDragoTMO::SetupAux(ImageVec imgIn, Image *imgOut)
@@ -150,13 +218,10 @@ void FilterDragoTMO::ProcessBBox(Image *dst, ImageVec src, BBox *box)
             float *dataOut = (*dst   )(i, j);
 
             if(dataLum[0] > 0.0f) {
-                float L_scaled = dataLum[0] / Lw_a_scaled;
-
-                float tmp	= powf((L_scaled / Lw_Max_scaled), constant1);
-                float Ld	= constant2 * logf(1.0f + L_scaled) / logf(2.0f + 8.0f * tmp);
+                float r = bLUT ? curve.Eval(dataLum[0]) : Ratio(dataLum[0]);
 
                 for(int k = 0; k < channels; k++) {
-                    dataOut[k] = (dataIn[k] * Ld) / dataLum[0];
+                    dataOut[k] = dataIn[k] * r;
                 }
             } else {
                 for(int k = 0; k < src[0]->channels; k++) {
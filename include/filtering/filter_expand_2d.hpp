@@ -0,0 +1,270 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+
+#ifndef PIC_FILTERING_FILTER_EXPAND_2D_HPP
+#define PIC_FILTERING_FILTER_EXPAND_2D_HPP
+
+#include "filtering/filter.hpp"
+
+namespace pic {
+
+enum EXPAND_OPERATION{EO_COPY, EO_ADD, EO_SUB};
+
+/**
+ * @brief The FilterExpand2D class is the EXPAND operator of Burt and Adelson;
+ * i.e. a 2x upsampling with a 5-tap binomial filter [1 4 6 4 1] / 16.
+ * The filter is evaluated in its polyphase form, so even samples
+ * have three taps and odd samples have two taps.
+ * When the operation is EO_ADD or EO_SUB, the input is
+ * Double(imgHigh, imgLow), and the output is imgHigh +/- EXPAND(imgLow);
+ * this is the core of Laplacian pyramids.
+ */
+class FilterExpand2D: public Filter
+{
+protected:
+    EXPAND_OPERATION op;
+
+    /**
+     * @brief ProcessBBox
+     * @param dst
+     * @param src
+     * @param box
+     */
+    void ProcessBBox(Image *dst, ImageVec src, BBox *box)
+    {
+        Image *high = NULL;
+        Image *low  = src[0];
+
+        if(op != EO_COPY) {
+            if(src.size() < 2) {
+                return;
+            }
+
+            high = src[0];
+            low  = src[1];
+        }
+
+        int width    = low->width;
+        int height   = low->height;
+        int channels = dst->channels;
+
+        //low resolution columns required by the bounding box
+        int cx0 = CLAMPi((box->x0 >> 1) - 1, 0, width - 1);
+        int cx1 = CLAMPi(((box->x1 - 1) >> 1) + 1, 0, width - 1);
+        int n = (cx1 - cx0 + 1) * channels;
+
+        float *row = new float[n];
+
+        int   ind[3];
+        float weight[3];
+
+        for(int j = box->y0; j < box->y1; j++) {
+            //vertical pass
+            int nTaps = getTaps(j, height, ind, weight);
+
+            float *r = &low->data[ind[0] * low->ystride + cx0 * channels];
+            for(int i = 0; i < n; i++) {
+                row[i] = r[i] * weight[0];
+            }
+
+            for(int k = 1; k < nTaps; k++) {
+                r = &low->data[ind[k] * low->ystride + cx0 * channels];
+                float w = weight[k];
+
+                for(int i = 0; i < n; i++) {
+                    row[i] += r[i] * w;
+                }
+            }
+
+            //horizontal pass
+            float *out = &dst->data[j * dst->ystride];
+            float *in  = (high != NULL) ? &high->data[j * high->ystride] : NULL;
+
+            for(int i = box->x0; i < box->x1; i++) {
+                int nTapsX = getTaps(i, width, ind, weight);
+
+                int c = i * channels;
+
+                for(int k = 0; k < channels; k++) {
+                    float val = 0.0f;
+
+                    for(int l = 0; l < nTapsX; l++) {
+                        val += row[(ind[l] - cx0) * channels + k] * weight[l];
+                    }
+
+                    switch(op) {
+                    case EO_ADD: {
+                        out[c + k] = in[c + k] + val;
+                    }
+                    break;
+
+                    case EO_SUB: {
+                        out[c + k] = in[c + k] - val;
+                    }
+                    break;
+
+                    default: {
+                        out[c + k] = val;
+                    }
+                    break;
+                    }
+                }
+            }
+        }
+
+        delete[] row;
+    }
+
+    /**
+     * @brief SetupAux
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *SetupAux(ImageVec imgIn, Image *imgOut)
+    {
+        int width, height, channels, frames;
+        OutputSize(imgIn[0], width, height, channels, frames);
+
+        if(imgOut == NULL) {
+            imgOut = new Image(1, width, height, channels);
+        } else {
+            if(op == EO_COPY) {
+                //the output size is the one of imgOut (e.g. for odd sizes)
+                if((imgOut->channels != channels) ||
+                   ((imgOut->width  >> 1) != imgIn[0]->width)  ||
+                   ((imgOut->height >> 1) != imgIn[0]->height)) {
+                    imgOut = new Image(1, width, height, channels);
+                }
+            } else {
+                if((imgOut->width  != width)  ||
+                   (imgOut->height != height) ||
+                   (imgOut->channels != channels)) {
+                    imgOut = new Image(1, width, height, channels);
+                }
+            }
+        }
+
+        return imgOut;
+    }
+
+public:
+
+    /**
+     * @brief FilterExpand2D
+     * @param op
+     */
+    FilterExpand2D(EXPAND_OPERATION op = EO_COPY)
+    {
+        this->op = op;
+    }
+
+    /**
+     * @brief getTaps computes the taps of the polyphase binomial filter for
+     * an output coordinate.
+     * @param x is the output coordinate.
+     * @param n is the size of the low resolution input.
+     * @param ind is an array of three elements for the input coordinates.
+     * @param weight is an array of three elements for the weights.
+     * @return It returns the number of taps; i.e. two or three.
+     */
+    static inline int getTaps(int x, int n, int *ind, float *weight)
+    {
+        int x2 = x >> 1;
+
+        if((x & 1) == 0) {
+            ind[0] = CLAMPi(x2 - 1, 0, n - 1);
+            ind[1] = CLAMPi(x2    , 0, n - 1);
+            ind[2] = CLAMPi(x2 + 1, 0, n - 1);
+
+            weight[0] = 0.125f;
+            weight[1] = 0.75f;
+            weight[2] = 0.125f;
+            return 3;
+        } else {
+            ind[0] = CLAMPi(x2    , 0, n - 1);
+            ind[1] = CLAMPi(x2 + 1, 0, n - 1);
+
+            weight[0] = 0.5f;
+            weight[1] = 0.5f;
+            return 2;
+        }
+    }
+
+    /**
+     * @brief Update
+     * @param op
+     */
+    void Update(EXPAND_OPERATION op)
+    {
+        this->op = op;
+    }
+
+    /**
+     * @brief OutputSize
+     * @param imgIn
+     * @param width
+     * @param height
+     * @param channels
+     * @param frames
+     */
+    void OutputSize(Image *imgIn, int &width, int &height, int &channels, int &frames)
+    {
+        if(op == EO_COPY) {
+            width   = imgIn->width  << 1;
+            height  = imgIn->height << 1;
+        } else {
+            width   = imgIn->width;
+            height  = imgIn->height;
+        }
+
+        channels    = imgIn->channels;
+        frames      = 1;
+    }
+
+    /**
+     * @brief Execute
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    static Image *Execute(Image *imgIn, Image *imgOut)
+    {
+        FilterExpand2D flt(EO_COPY);
+        return flt.ProcessP(Single(imgIn), imgOut);
+    }
+
+    /**
+     * @brief Execute
+     * @param fileInput
+     * @param fileOutput
+     * @return
+     */
+    static Image *Execute(std::string fileInput, std::string fileOutput)
+    {
+        Image imgIn(fileInput);
+        Image *out = FilterExpand2D::Execute(&imgIn, NULL);
+        out->Write(fileOutput);
+        return out;
+    }
+};
+
+} // end namespace pic
+
+#endif /* PIC_FILTERING_FILTER_EXPAND_2D_HPP */
+
@@ -102,6 +102,8 @@ public:
             }
         }
 
+        imgOut->InvalidateCache();
+
         return imgOut;
     }
 
@@ -18,26 +18,53 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #ifndef PIC_FILTERING_FILTER_ITERATIVE_HPP
 #define PIC_FILTERING_FILTER_ITERATIVE_HPP
 
+#include <string.h>
+
 #include "filtering/filter.hpp"
 
 namespace pic {
 
 /**
- * @brief The FilterIterative class
+ * @brief The FilterIterative class applies a filter for a number of
+ * iterations. When the filter is a stencil of known radius, iterations
+ * are temporally blocked: each tile is advanced for several iterations
+ * in a local buffer with a halo of radius * iterations pixels, and then
+ * written back; tiles are processed in parallel.
  */
 class FilterIterative: public Filter
 {
 protected:
     Image	*imgTmp[2];
+    Image   *imgRound;
 
     bool		parallel;
     int			iterations;
+    int         radius, blockIterations, blockSize;
 
     /**
      * @brief Destroy
      */
     void Destroy();
 
+    /**
+     * @brief Crop copies a region of img into a new image.
+     * @param img
+     * @param x0
+     * @param y0
+     * @param width
+     * @param height
+     * @return
+     */
+    static Image *Crop(Image *img, int x0, int y0, int width, int height);
+
+    /**
+     * @brief ProcessBlocked runs the temporally blocked iterations.
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *ProcessBlocked(ImageVec imgIn, Image *imgOut);
+
 public:
 
     /**
@@ -49,8 +76,10 @@ public:
      * @brief FilterIterative
      * @param flt
      * @param iterations
+     * @param radius is the radius of flt's stencil; if it is greater than
+     * zero, iterations are temporally blocked.
      */
-    FilterIterative(Filter *flt, int iterations);
+    FilterIterative(Filter *flt, int iterations, int radius = 0);
 
     ~FilterIterative();
 
@@ -69,6 +98,23 @@ public:
      */
     void Update(Filter *flt, int iterations);
 
+    /**
+     * @brief setTemporalBlocking
+     * @param radius is the radius of the filter's stencil; 0 disables
+     * temporal blocking.
+     * @param blockIterations is the number of iterations per tile; if it
+     * is not positive, it is set from radius.
+     * @param blockSize is the size of the tiles that are written back.
+     */
+    void setTemporalBlocking(int radius, int blockIterations = -1,
+                             int blockSize = 4 * TILE_SIZE)
+    {
+        this->radius = MAX(radius, 0);
+        this->blockIterations = blockIterations > 0 ? blockIterations :
+                                MAX(8 / MAX(this->radius, 1), 1);
+        this->blockSize = MAX(blockSize, 8);
+    }
+
     /**
      * @brief Process
      * @param imgIn
@@ -90,19 +136,27 @@ FilterIterative::FilterIterative()
 {
     parallel = false;
     iterations = 0;
+    imgRound = NULL;
 
     for(int i = 0; i < 2; i++) {
         imgTmp[i] = NULL;
     }
+
+    setTemporalBlocking(0);
 }
 
-FilterIterative::FilterIterative(Filter *flt, int iterations)
+FilterIterative::FilterIterative(Filter *flt, int iterations, int radius)
 {
+    parallel = false;
+    this->iterations = 0;
+    imgRound = NULL;
+
     for(int i = 0; i < 2; i++) {
         imgTmp[i] = NULL;
     }
 
     Update(flt, iterations);
+    setTemporalBlocking(radius);
 }
 
 FilterIterative::~FilterIterative()
@@ -125,6 +179,11 @@ void FilterIterative::Destroy()
     for(int i = 0; i < 2; i++) {
         imgTmp[i] = NULL;
     }
+
+    if(imgRound != NULL) {
+        delete imgRound;
+        imgRound = NULL;
+    }
 }
 
 void FilterIterative::Update(Filter *flt, int iterations)
@@ -173,6 +232,13 @@ Image *FilterIterative::Process(ImageVec imgIn, Image *imgOut)
         return imgOut;
     }
 
+    if(radius > 0 && iterations > 1 && imgIn[0]->frames == 1) {
+        imgOut = ProcessBlocked(imgIn, imgOut);
+        imgOut->InvalidateCache();
+        parallel = false;
+        return imgOut;
+    }
+
     //Allocate output
     imgOut = SetupAuxN(imgIn, imgOut);
 
@@ -202,6 +268,126 @@ Image *FilterIterative::ProcessP(ImageVec imgIn, Image *imgOut)
     return Process(imgIn, imgOut);
 }
 
+Image *FilterIterative::Crop(Image *img, int x0, int y0, int width, int height)
+{
+    Image *out = new Image(1, width, height, img->channels);
+
+    int n = width * img->channels;
+
+    for(int j = 0; j < height; j++) {
+        memcpy(&out->data[j * out->ystride],
+               &img->data[(y0 + j) * img->ystride + x0 * img->channels],
+               n * sizeof(float));
+    }
+
+    return out;
+}
+
+Image *FilterIterative::ProcessBlocked(ImageVec imgIn, Image *imgOut)
+{
+    Image *img = imgIn[0];
+
+    if(imgOut == NULL) {
+        imgOut = img->AllocateSimilarOne();
+    }
+
+    if(imgRound != NULL && !imgRound->SimilarType(img)) {
+        delete imgRound;
+        imgRound = NULL;
+    }
+
+    if(imgRound == NULL) {
+        imgRound = img->AllocateSimilarOne();
+    }
+
+    int width = img->width;
+    int height = img->height;
+    int channels = img->channels;
+
+    int nx = (width  + blockSize - 1) / blockSize;
+    int ny = (height + blockSize - 1) / blockSize;
+    int nTiles = nx * ny;
+
+    int nRounds = (iterations + blockIterations - 1) / blockIterations;
+
+    //in-place filtering needs a copy of the input
+    Image *src = img;
+    Image *imgCopy = NULL;
+
+    if(img == imgOut || img == imgRound) {
+        imgCopy = img->Clone();
+        src = imgCopy;
+    }
+
+    int done = 0;
+
+    for(int r = 0; r < nRounds; r++) {
+        //the last round writes into imgOut
+        Image *dst = ((nRounds - 1 - r) % 2) == 0 ? imgOut : imgRound;
+        int T = MIN(blockIterations, iterations - done);
+        int halo = T * radius;
+
+        #pragma omp parallel for schedule(dynamic, 1) if(parallel)
+        for(int t = 0; t < nTiles; t++) {
+            int tx0 = (t % nx) * blockSize;
+            int ty0 = (t / nx) * blockSize;
+            int tx1 = MIN(tx0 + blockSize, width);
+            int ty1 = MIN(ty0 + blockSize, height);
+
+            //the halo is cut at the image's borders, so that local
+            //clamping is the same of the whole image
+            int x0 = MAX(tx0 - halo, 0);
+            int y0 = MAX(ty0 - halo, 0);
+            int x1 = MIN(tx1 + halo, width);
+            int y1 = MIN(ty1 + halo, height);
+
+            ImageVec local;
+            local.push_back(Crop(src, x0, y0, x1 - x0, y1 - y0));
+
+            for(unsigned int i = 1; i < imgIn.size(); i++) {
+                local.push_back(Crop(imgIn[i], x0, y0, x1 - x0, y1 - y0));
+            }
+
+            Image *cur = local[0];
+            Image *other = cur->AllocateSimilarOne();
+
+            for(int it = 0; it < T; it++) {
+                local[0] = cur;
+                filters[0]->Process(local, other);
+
+                Image *tmp = cur;
+                cur = other;
+                other = tmp;
+            }
+
+            //writing back the tile
+            int n = (tx1 - tx0) * channels;
+
+            for(int j = ty0; j < ty1; j++) {
+                memcpy(&dst->data[j * dst->ystride + tx0 * channels],
+                       &cur->data[(j - y0) * cur->ystride + (tx0 - x0) * channels],
+                       n * sizeof(float));
+            }
+
+            delete cur;
+            delete other;
+
+            for(unsigned int i = 1; i < local.size(); i++) {
+                delete local[i];
+            }
+        }
+
+        src = dst;
+        done += T;
+    }
+
+    if(imgCopy != NULL) {
+        delete imgCopy;
+    }
+
+    return imgOut;
+}
+
 } // end namespace pic
 
 #endif /* PIC_FILTERING_FILTER_ITERATIVE_HPP */
@@ -18,12 +18,18 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #ifndef PIC_FILTERING_FILTER_KUWAHARA_HPP
 #define PIC_FILTERING_FILTER_KUWAHARA_HPP
 
+#include <vector>
+
 #include "filtering/filter.hpp"
 
 namespace pic {
 
 /**
- * @brief The FilterKuwahara class
+ * @brief The FilterKuwahara class is the Kuwahara filter: the output is
+ * the mean of the least varying of the four (h + 1) x (h + 1) quadrants
+ * around a pixel, where h = kernelSize / 2. Means and variances are
+ * read in O(1) from summed-area tables of values and squared values
+ * that are built for each tile and its halo.
  */
 class FilterKuwahara: public Filter
 {
@@ -40,144 +46,96 @@ protected:
     void ProcessBBox(Image *dst, ImageVec src, BBox *box)
     {
         int channels = dst->channels;
+        int h = int(halfKernelSize);
 
         Image *source = src[0];
 
-        float *buf = new float[channels * 8];
-
-        int start = 0;
-        float *m00 = &buf[start];
-        start += channels;
-        float *m10 = &buf[start];
-        start += channels;
-        float *m01 = &buf[start];
-        start += channels;
-        float *m11 = &buf[start];
-        start += channels;
-        float *s00 = &buf[start];
-        start += channels;
-        float *s10 = &buf[start];
-        start += channels;
-        float *s01 = &buf[start];
-        start += channels;
-        float *s11 = &buf[start];
-
-        for(int m = box->z0; m < box->z1; m++) {
-            for(int j = box->y0; j < box->y1; j++) {
-                for(int i = box->x0; i < box->x1; i++) {
-                    //1D Filtering
-                    float mean = FLT_MAX;
-                    int indx;
-                    float tmpMean;
-
-                    float *tmpDst = (*dst)(i, j, m);
-
-                    //First block
-                    BBox tmp00(i - halfKernelSize, i + 1, j - halfKernelSize, j + 1);
-                    source->getMeanVal(&tmp00, m00);
-                    source->getVarianceVal(m00, &tmp00, s00);
+        //summed-area tables of the tile and its halo
+        int x0 = box->x0 - h;
+        int y0 = box->y0 - h;
+        int width  = (box->x1 - box->x0) + 2 * h;
+        int height = (box->y1 - box->y0) + 2 * h;
+        int stride = (width + 1) * channels;
 
-                    tmpMean = 0.0f;
+        std::vector<double> S((height + 1) * stride, 0.0);
+        std::vector<double> SS((height + 1) * stride, 0.0);
+        std::vector<double> rs(channels), rss(channels);
 
-                    for(int l = 0; l < channels; l++) {
-                        tmpMean += s00[l];
-                    }
+        double n = double((h + 1) * (h + 1));
+        double inv_n = 1.0 / n;
+        double inv_n1 = 1.0 / MAX(n - 1.0, 1.0);
 
-                    if(tmpMean < mean) {
-                        mean = tmpMean;
-                        indx = 0;
-                    }
+        std::vector<double> mean(channels * 4), var(4);
 
-                    //Second block
-                    BBox tmp01(i, i + halfKernelSize, j - halfKernelSize, j + 1);
-                    source->getMeanVal(&tmp01, m01);
-                    source->getVarianceVal(m01, &tmp01, s01);
+        for(int m = box->z0; m < box->z1; m++) {
+            for(int j = 0; j < height; j++) {
+                double *s0 = &S[j * stride];
+                double *s1 = &S[(j + 1) * stride];
+                double *ss0 = &SS[j * stride];
+                double *ss1 = &SS[(j + 1) * stride];
+
+                for(int l = 0; l < channels; l++) {
+                    rs[l] = 0.0;
+                    rss[l] = 0.0;
+                }
 
-                    tmpMean = 0.0f;
+                for(int i = 0; i < width; i++) {
+                    float *data = (*source)(x0 + i, y0 + j, m);
+                    int ind = (i + 1) * channels;
 
                     for(int l = 0; l < channels; l++) {
-                        tmpMean += s01[l];
-                    }
-
-                    if(tmpMean < mean) {
-                        mean = tmpMean;
-                        indx = 1;
+                        double v = double(data[l]);
+                        rs[l] += v;
+                        rss[l] += v * v;
+                        s1[ind + l] = s0[ind + l] + rs[l];
+                        ss1[ind + l] = ss0[ind + l] + rss[l];
                     }
+                }
+            }
 
-                    //Third block
-                    BBox tmp10(i - halfKernelSize, i + 1, j, j + halfKernelSize);
-                    source->getMeanVal(&tmp10, m10);
-                    source->getVarianceVal(m10, &tmp10, s10);
-
-                    tmpMean = 0.0f;
-
-                    for(int l = 0; l < channels; l++) {
-                        tmpMean += s10[l];
-                    }
+            for(int j = box->y0; j < box->y1; j++) {
+                int ly = j - y0;
 
-                    if(tmpMean < mean) {
-                        mean = tmpMean;
-                        indx = 2;
-                    }
+                for(int i = box->x0; i < box->x1; i++) {
+                    int lx = i - x0;
 
-                    //Fourth block
-                    BBox tmp11(i, i + halfKernelSize, j, j + halfKernelSize);
-                    source->getMeanVal(&tmp11, m11);
-                    source->getVarianceVal(m11, &tmp11, s11);
+                    //quadrants: top-left, top-right, bottom-left, bottom-right
+                    int qx[4] = {lx - h, lx, lx - h, lx};
+                    int qy[4] = {ly - h, ly - h, ly, ly};
 
-                    tmpMean = 0.0f;
+                    int best = 0;
 
-                    for(int l = 0; l < channels; l++) {
-                        tmpMean += s11[l];
-                    }
+                    for(int q = 0; q < 4; q++) {
+                        int a = qy[q] * stride + qx[q] * channels;
+                        int b = qy[q] * stride + (qx[q] + h + 1) * channels;
+                        int c = (qy[q] + h + 1) * stride + qx[q] * channels;
+                        int d = (qy[q] + h + 1) * stride + (qx[q] + h + 1) * channels;
 
-                    if(tmpMean < mean) {
-                        mean = tmpMean;
-                        indx = 3;
-                    }
+                        double *qm = &mean[q * channels];
+                        var[q] = 0.0;
 
-                    //Final filtering
-                    switch(indx) {
-                    case 0: {
                         for(int l = 0; l < channels; l++) {
-                            tmpDst[l] = m00[l];
-                        }
-                    }
-                    break;
+                            double sum = S[d + l] - S[b + l] - S[c + l] + S[a + l];
+                            double sum2 = SS[d + l] - SS[b + l] - SS[c + l] + SS[a + l];
 
-                    case 1: {
-                        for(int l = 0; l < channels; l++) {
-                            tmpDst[l] = m01[l];
+                            qm[l] = sum * inv_n;
+                            var[q] += MAX(sum2 - sum * qm[l], 0.0) * inv_n1;
                         }
-                    }
-                    break;
 
-                    case 2: {
-                        for(int l = 0; l < channels; l++) {
-                            tmpDst[l] = m10[l];
+                        if(var[q] < var[best]) {
+                            best = q;
                         }
                     }
-                    break;
 
-                    case 3: {
-                        for(int l = 0; l < channels; l++) {
-                            tmpDst[l] = m11[l];
-                        }
-                    }
-                    break;
+                    float *tmpDst = (*dst)(i, j, m);
+                    double *qm = &mean[best * channels];
 
-                    default: {
-                        float *tmpSrc = (*source)(i, j, m);
-                        for(int l = 0; l < channels; l++) {
-                            tmpDst[l] = tmpSrc[l];
-                        }
-                    }break;
+                    for(int l = 0; l < channels; l++) {
+                        tmpDst[l] = float(qm[l]);
                     }
                 }
             }
         }
-
-        delete[] buf;
     }
 
 public:
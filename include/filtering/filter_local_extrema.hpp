@@ -18,81 +18,204 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #ifndef PIC_FILTERING_FILTER_LOCAL_EXTREMA_HPP
 #define PIC_FILTERING_FILTER_LOCAL_EXTREMA_HPP
 
+#include <vector>
+
+#include "util/running_extrema.hpp"
 #include "filtering/filter.hpp"
 
 namespace pic {
 
 /**
- * @brief The FilterLocalExtrema class
+ * @brief The ExtremumCount struct is a window extremum and the number of
+ * pixels of the window that reach it.
+ */
+struct ExtremumCount
+{
+    float val;
+    int count;
+};
+
+/**
+ * @brief The FilterLocalExtrema class marks strict local maxima (1) and
+ * strict local minima (-1) of the first channel over kernelSize x
+ * kernelSize windows (cut at borders); a pixel is a strict extremum if no
+ * other pixel of its window has the same or a larger (smaller) value.
+ * Other pixels are marked with 0. Window extrema and the number of pixels
+ * reaching them are computed with separable van Herk/Gil-Werman passes,
+ * so the cost does not depend on kernelSize.
  */
 class FilterLocalExtrema: public Filter
 {
 protected:
 
+    int kernelSize, halfKernelSize;
+
     /**
-     * @brief ProcessBBox
-     * @param dst
-     * @param src
-     * @param box
+     * @brief Merge merges the extrema of two disjoint sets of pixels.
+     * @param a
+     * @param b
+     * @return
      */
-    void ProcessBBox(Image *dst, ImageVec src, BBox *box)
+    template<bool bMax>
+    static inline ExtremumCount Merge(ExtremumCount a, ExtremumCount b)
     {
-        Image *img  = src[0];
+        ExtremumCount ret;
+        ret.val = bMax ? MAX(a.val, b.val) : MIN(a.val, b.val);
+        ret.count = (a.val == ret.val ? a.count : 0) +
+                    (b.val == ret.val ? b.count : 0);
+        return ret;
+    }
 
-        int channels = dst->channels;
+    /**
+     * @brief RunningCount is RunningExtrema over ExtremumCount samples;
+     * samples outside [0, n) are empty instead of clamped, so that no
+     * pixel is counted twice. A window is the suffix of one block and the
+     * prefix of the next one, which are disjoint, hence counts can be
+     * summed; a window aligned to a block is the suffix alone.
+     * @param in
+     * @param out
+     * @param n
+     * @param stride
+     * @param lanes
+     * @param radius
+     * @param g is a scratch buffer of RunningExtremaScratchSize elements.
+     * @param h is a scratch buffer of RunningExtremaScratchSize elements.
+     */
+    template<bool bMax>
+    static void RunningCount(ExtremumCount *in, ExtremumCount *out, int n,
+                             int stride, int lanes, int radius,
+                             ExtremumCount *g, ExtremumCount *h)
+    {
+        int w = 2 * radius + 1;
+        int L = ((n + 2 * radius + w - 1) / w) * w;
 
-        for(int j = box->y0; j < box->y1; j++) {
-            for(int i = box->x0; i < box->x1; i++) {
-                float *dst_data = (*dst)(i, j);
+        ExtremumCount empty;
+        empty.val = bMax ? -FLT_MAX : FLT_MAX;
+        empty.count = 0;
 
-                float *img_data  = (*img)(i, j);
+        //padded samples
+        std::vector<ExtremumCount> pad(lanes, empty);
 
-                float val = 0.0f;
+        for(int b = 0; b < L; b += w) {
+            //prefix within a block
+            for(int i = 0; i < w; i++) {
+                int k = b + i - radius;
+                ExtremumCount *src = ((k >= 0) && (k < n)) ? &in[k * stride] : &pad[0];
+                ExtremumCount *gp = &g[(b + i) * lanes];
 
-                for(int c = 0; c < channels; c++) {
-                    val += img_data[c];
-                }
+                if(i == 0) {
+                    for(int l = 0; l < lanes; l++) {
+                        gp[l] = src[l];
+                    }
+                } else {
+                    ExtremumCount *gq = gp - lanes;
 
-                int counter_higher = 0;
-                int counter_lower = 0;
-                for(int k = -halfKernelSize; k <= halfKernelSize; k++) {
-                    for(int l = -halfKernelSize; l <= halfKernelSize; l++) {
-                        if(l == k) {
-                            continue;
-                        }
-
-                        float *img_data_lk  = (*img)(i + l, j + k);
-
-                        //Accumulation
-                        float val_lk = 0.0f;
-                        for(int c = 0; c < channels; c++) {
-                            val_lk += img_data_lk[c];
-                        }
-
-                        if(val_lk >= val) {
-                            counter_higher++;
-                        }
-
-                        if(val_lk <= val) {
-                            counter_lower++;
-                        }
+                    for(int l = 0; l < lanes; l++) {
+                        gp[l] = Merge<bMax>(gq[l], src[l]);
                     }
                 }
+            }
+
+            //suffix within a block
+            for(int i = w - 1; i >= 0; i--) {
+                int k = b + i - radius;
+                ExtremumCount *src = ((k >= 0) && (k < n)) ? &in[k * stride] : &pad[0];
+                ExtremumCount *hp = &h[(b + i) * lanes];
 
-                if(counter_higher < kernelSize) {
-                    dst_data[0] = 1.0f;
+                if(i == (w - 1)) {
+                    for(int l = 0; l < lanes; l++) {
+                        hp[l] = src[l];
+                    }
                 } else {
-                    if(counter_lower < kernelSize) {
-                        dst_data[0] = -1.0f;
-                    } else {
-                        dst_data[0] = 0.0f;
+                    ExtremumCount *hq = hp + lanes;
+
+                    for(int l = 0; l < lanes; l++) {
+                        hp[l] = Merge<bMax>(hq[l], src[l]);
                     }
                 }
             }
         }
+
+        for(int x = 0; x < n; x++) {
+            ExtremumCount *o = &out[x * stride];
+            ExtremumCount *hp = &h[x * lanes];
+            ExtremumCount *gp = &g[(x + w - 1) * lanes];
+
+            if((x % w) == 0) {
+                for(int l = 0; l < lanes; l++) {
+                    o[l] = hp[l];
+                }
+            } else {
+                for(int l = 0; l < lanes; l++) {
+                    o[l] = Merge<bMax>(hp[l], gp[l]);
+                }
+            }
+        }
     }
 
-    int kernelSize, halfKernelSize;
+    /**
+     * @brief Count2D computes, for each pixel, the extremum of its window
+     * and how many pixels of the window reach it; rows are filtered in
+     * parallel, and columns in parallel bands as in Extrema2D.
+     * @param val
+     * @param out
+     * @param width
+     * @param height
+     * @param bMax
+     */
+    void Count2D(float *val, ExtremumCount *out, int width, int height, bool bMax)
+    {
+        int radius = halfKernelSize;
+
+        #pragma omp parallel for
+
+        for(int i = 0; i < (width * height); i++) {
+            out[i].val = val[i];
+            out[i].count = 1;
+        }
+
+        //horizontal pass
+        #pragma omp parallel
+        {
+            int size = RunningExtremaScratchSize(width, radius, 1);
+            std::vector<ExtremumCount> g(size), h(size);
+
+            #pragma omp for schedule(static)
+            for(int j = 0; j < height; j++) {
+                if(bMax) {
+                    RunningCount<true>(&out[j * width], &out[j * width], width, 1, 1,
+                                       radius, &g[0], &h[0]);
+                } else {
+                    RunningCount<false>(&out[j * width], &out[j * width], width, 1, 1,
+                                        radius, &g[0], &h[0]);
+                }
+            }
+        }
+
+        //vertical pass
+        int band = 64;
+        int nBands = (width + band - 1) / band;
+
+        #pragma omp parallel
+        {
+            int size = RunningExtremaScratchSize(height, radius, band);
+            std::vector<ExtremumCount> g(size), h(size);
+
+            #pragma omp for schedule(static)
+            for(int b = 0; b < nBands; b++) {
+                int l0 = b * band;
+                int lanes = MIN(band, width - l0);
+
+                if(bMax) {
+                    RunningCount<true>(&out[l0], &out[l0], height, width, lanes,
+                                       radius, &g[0], &h[0]);
+                } else {
+                    RunningCount<false>(&out[l0], &out[l0], height, width, lanes,
+                                        radius, &g[0], &h[0]);
+                }
+            }
+        }
+    }
 
     /**
      * @brief SetupAux
@@ -134,6 +257,71 @@ public:
         this->halfKernelSize = kernelSize >> 1;
     }
 
+    /**
+     * @brief Process
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *Process(ImageVec imgIn, Image *imgOut)
+    {
+        if(imgIn.empty() || imgIn[0] == NULL) {
+            return imgOut;
+        }
+
+        imgOut = SetupAux(imgIn, imgOut);
+
+        Image *img = imgIn[0];
+        int n = img->nPixels();
+        int channels = img->channels;
+
+        std::vector<float> val(n);
+        std::vector<ExtremumCount> maxVal(n), minVal(n);
+
+        #pragma omp parallel for
+
+        for(int i = 0; i < n; i++) {
+            val[i] = img->data[i * channels];
+        }
+
+        Count2D(&val[0], &maxVal[0], img->width, img->height, true);
+        Count2D(&val[0], &minVal[0], img->width, img->height, false);
+
+        #pragma omp parallel for
+
+        for(int i = 0; i < n; i++) {
+            float v = val[i];
+            float out = 0.0f;
+
+            if(maxVal[i].val > minVal[i].val) {
+                if((v >= maxVal[i].val) && (maxVal[i].count == 1)) {
+                    out = 1.0f;
+                } else {
+                    if((v <= minVal[i].val) && (minVal[i].count == 1)) {
+                        out = -1.0f;
+                    }
+                }
+            }
+
+            imgOut->data[i] = out;
+        }
+
+        imgOut->InvalidateCache();
+
+        return imgOut;
+    }
+
+    /**
+     * @brief ProcessP is Process; passes are parallel.
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *ProcessP(ImageVec imgIn, Image *imgOut)
+    {
+        return Process(imgIn, imgOut);
+    }
+
     /**
      * @brief Execute
      * @param img
@@ -0,0 +1,301 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_FILTERING_FILTER_LOCAL_LAPLACIAN_HPP
+#define PIC_FILTERING_FILTER_LOCAL_LAPLACIAN_HPP
+
+#include <math.h>
+#include <vector>
+
+#include "filtering/filter.hpp"
+#include "filtering/filter_reduce_2d.hpp"
+#include "filtering/filter_expand_2d.hpp"
+#include "algorithms/pyramid.hpp"
+
+namespace pic {
+
+/**
+ * @brief The FilterLocalLaplacian class implements the local Laplacian
+ * filter of Paris et al. 2011 with the fast approximation of Aubry et al.
+ * 2014: the input is remapped around nSamples intensity values, and the
+ * Laplacian coefficients of these remapped images are interpolated using
+ * the Gaussian pyramid of the input.
+ *
+ * The Gaussian pyramid of the input is shared by all samples. Each remapped
+ * pyramid is streamed level by level into the output pyramid, so a worker
+ * only holds a Gaussian pyramid worth of memory. Samples are processed in
+ * parallel in two phases (even and odd samples); in a phase each pixel
+ * receives at most one contribution, so workers do not need locks.
+ */
+class FilterLocalLaplacian: public Filter
+{
+protected:
+    float sigma_r, alpha, beta;
+    int nSamples;
+
+    FilterReduce2D flt_reduce;
+    FilterExpand2D flt_sub;
+
+    /**
+     * @brief Remap is the point-wise remapping function around g.
+     * @param i
+     * @param g
+     * @return
+     */
+    inline float Remap(float i, float g)
+    {
+        float d = i - g;
+        float ad = fabsf(d);
+        float s = d < 0.0f ? -1.0f : 1.0f;
+
+        if(ad > sigma_r) {
+            return g + s * (beta * (ad - sigma_r) + sigma_r);
+        }
+
+        if(alpha == 1.0f) {
+            return i;
+        }
+
+        //details
+        float x = ad / sigma_r;
+        float fd = powf(x, alpha);
+
+        //avoiding noise amplification for alpha < 1
+        if(alpha < 1.0f) {
+            float t = (x - 0.01f) * 100.0f;
+            t = CLAMPi(t, 0.0f, 1.0f);
+            t = t * t * (3.0f - 2.0f * t);
+            fd = t * fd + (1.0f - t) * x;
+        }
+
+        return g + s * sigma_r * fd;
+    }
+
+    /**
+     * @brief Accumulate adds the Laplacian level lap of the sample gamma
+     * into out, weighted by a hat function of the Gaussian level gau.
+     * @param out
+     * @param lap
+     * @param gau
+     * @param gamma
+     * @param delta is the distance between two samples.
+     */
+    static void Accumulate(Image *out, Image *lap, Image *gau, float gamma,
+                           float delta)
+    {
+        int n = out->size();
+        float inv_delta = 1.0f / delta;
+
+        for(int i = 0; i < n; i++) {
+            float w = 1.0f - fabsf(gau->data[i] - gamma) * inv_delta;
+
+            if(w > 0.0f) {
+                out->data[i] += w * lap->data[i];
+            }
+        }
+    }
+
+public:
+
+    /**
+     * @brief FilterLocalLaplacian
+     * @param sigma_r is the threshold between details and edges.
+     * @param alpha controls details; alpha < 1 enhances them.
+     * @param beta controls edges; beta < 1 compresses the range.
+     * @param nSamples is the number of intensity samples.
+     */
+    FilterLocalLaplacian(float sigma_r = 0.4f, float alpha = 0.25f,
+                         float beta = 1.0f, int nSamples = 10) : flt_sub(EO_SUB)
+    {
+        Update(sigma_r, alpha, beta, nSamples);
+    }
+
+    /**
+     * @brief Update
+     * @param sigma_r
+     * @param alpha
+     * @param beta
+     * @param nSamples
+     */
+    void Update(float sigma_r, float alpha, float beta, int nSamples)
+    {
+        this->sigma_r = sigma_r > 0.0f ? sigma_r : 0.4f;
+        this->alpha = alpha > 0.0f ? alpha : 1.0f;
+        this->beta = MAX(beta, 0.0f);
+        this->nSamples = MAX(nSamples, 2);
+    }
+
+    /**
+     * @brief Process
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *Process(ImageVec imgIn, Image *imgOut);
+
+    /**
+     * @brief ProcessP is Process; samples are processed in parallel.
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *ProcessP(ImageVec imgIn, Image *imgOut)
+    {
+        return Process(imgIn, imgOut);
+    }
+
+    /**
+     * @brief Execute
+     * @param imgIn
+     * @param imgOut
+     * @param sigma_r
+     * @param alpha
+     * @param beta
+     * @param nSamples
+     * @return
+     */
+    static Image *Execute(Image *imgIn, Image *imgOut, float sigma_r,
+                          float alpha, float beta, int nSamples = 10)
+    {
+        FilterLocalLaplacian flt(sigma_r, alpha, beta, nSamples);
+        return flt.Process(Single(imgIn), imgOut);
+    }
+};
+
+PIC_INLINE Image *FilterLocalLaplacian::Process(ImageVec imgIn, Image *imgOut)
+{
+    if(imgIn.empty() || imgIn[0] == NULL) {
+        return imgOut;
+    }
+
+    Image *img = imgIn[0];
+
+    //images thinner than two pixels have no pyramid; they are copied
+    if(MIN(img->width, img->height) < 2) {
+        if(imgOut == NULL) {
+            imgOut = img->Clone();
+        } else {
+            if(imgOut != img) {
+                imgOut->Assign(img);
+            }
+        }
+
+        return imgOut;
+    }
+
+    //shared Gaussian pyramid of the input
+    Pyramid gauss(img, false);
+    Pyramid lapOut(img->width, img->height, img->channels, true);
+
+    int levels = int(gauss.stack.size()) - 1;
+
+    //intensity samples
+    float minVal = FLT_MAX;
+    float maxVal = -FLT_MAX;
+    std::vector<float> levelMin(levels), levelMax(levels);
+
+    for(int l = 0; l < levels; l++) {
+        Image *g = gauss.stack[l];
+        float tMin = FLT_MAX;
+        float tMax = -FLT_MAX;
+
+        for(int i = 0; i < g->size(); i++) {
+            tMin = MIN(tMin, g->data[i]);
+            tMax = MAX(tMax, g->data[i]);
+        }
+
+        levelMin[l] = tMin;
+        levelMax[l] = tMax;
+
+        minVal = MIN(minVal, tMin);
+        maxVal = MAX(maxVal, tMax);
+    }
+
+    if(maxVal <= minVal) {
+        maxVal = minVal + 1e-6f;
+    }
+
+    float delta = (maxVal - minVal) / float(nSamples - 1);
+
+    for(int phase = 0; phase < 2; phase++) {
+        #pragma omp parallel
+        {
+            //streaming workspace of a worker
+            ImageVec work(levels + 1, NULL);
+
+            #pragma omp for schedule(dynamic, 1)
+            for(int k = phase; k < nSamples; k += 2) {
+                float gamma = minVal + float(k) * delta;
+
+                //finest level where the sample has support
+                int last = -1;
+                for(int l = 0; l < levels; l++) {
+                    if(((gamma + delta) > levelMin[l]) &&
+                       ((gamma - delta) < levelMax[l])) {
+                        last = l;
+                    }
+                }
+
+                if(last < 0) {
+                    continue;
+                }
+
+                //remapping
+                if(work[0] == NULL) {
+                    work[0] = img->AllocateSimilarOne();
+                }
+
+                int n = img->size();
+                for(int i = 0; i < n; i++) {
+                    work[0]->data[i] = Remap(img->data[i], gamma);
+                }
+
+                //Laplacian levels are streamed into the output
+                for(int l = 0; l <= last; l++) {
+                    work[l + 1] = flt_reduce.Process(Single(work[l]), work[l + 1]);
+                    flt_sub.Process(Double(work[l], work[l + 1]), work[l]);
+
+                    if(((gamma + delta) > levelMin[l]) &&
+                       ((gamma - delta) < levelMax[l])) {
+                        Accumulate(lapOut.stack[l], work[l], gauss.stack[l],
+                                   gamma, delta);
+                    }
+                }
+            }
+
+            for(unsigned int l = 0; l < work.size(); l++) {
+                if(work[l] != NULL) {
+                    delete work[l];
+                }
+            }
+        }
+    }
+
+    //the residual is the one of the input
+    lapOut.stack[levels]->Assign(gauss.stack[levels]);
+
+    imgOut = lapOut.Reconstruct(imgOut);
+
+    imgOut->InvalidateCache();
+
+    return imgOut;
+}
+
+} // end namespace pic
+
+#endif /* PIC_FILTERING_FILTER_LOCAL_LAPLACIAN_HPP */
+
@@ -18,65 +18,66 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #ifndef PIC_FILTERING_FILTER_MAX_HPP
 #define PIC_FILTERING_FILTER_MAX_HPP
 
+#include "util/running_extrema.hpp"
 #include "filtering/filter.hpp"
 
 namespace pic {
 
 /**
- * @brief The FilterMax class
+ * @brief The FilterMax class computes the maximum over square windows with
+ * the separable van Herk/Gil-Werman algorithm; its cost does not depend
+ * on the window's size.
  */
 class FilterMax: public Filter
 {
 protected:
     int halfSize;
 
+public:
+    /**
+     * @brief FilterMax
+     * @param size
+     */
+    FilterMax(int size)
+    {
+        this->halfSize = checkHalfSize(size);
+    }
+
     /**
-     * @brief ProcessBBox
-     * @param dst
-     * @param src
-     * @param box
+     * @brief Process
+     * @param imgIn
+     * @param imgOut
+     * @return
      */
-    void ProcessBBox(Image *dst, ImageVec src, BBox *box)
+    Image *Process(ImageVec imgIn, Image *imgOut)
     {
-        int width = dst->width;
-        int channels = dst->channels;
-
-        float *data = src[0]->data;
-        
-        for(int j = box->y0; j < box->y1; j++) {
-            int ind = j * width;
-
-            for(int i = box->x0; i < box->x1; i++) {
-                //Central weight
-                int c = (ind + i) * channels;
-
-                for(int ch = 0; ch < channels; ch++) {
-                    float maxVal = -FLT_MAX;
-
-                    for(int k = -halfSize; k <= halfSize; k++) {
-                        int ci = CLAMP((i + k), dst->width);
-
-                        for(int l = -halfSize; l <= halfSize; l++) {
-                            int cj = CLAMP((j + l), dst->height);
-                            float tmp = data[(cj * width + ci) * channels + ch];
-                            maxVal = maxVal > tmp ? maxVal : tmp;
-                        }
-                    }
-
-                    dst->data[c + ch] = maxVal;
-                }
-            }
+        if(imgIn.empty() || imgIn[0] == NULL) {
+            return imgOut;
+        }
+
+        imgOut = SetupAux(imgIn, imgOut);
+
+        Image *img = imgIn[0];
+
+        for(int i = 0; i < img->frames; i++) {
+            Extrema2D(&img->data[i * img->tstride], &imgOut->data[i * imgOut->tstride],
+                      img->width, img->height, img->channels, halfSize, true);
         }
+
+        imgOut->InvalidateCache();
+
+        return imgOut;
     }
 
-public:
     /**
-     * @brief FilterMax
-     * @param size
+     * @brief ProcessP is Process; passes are parallel.
+     * @param imgIn
+     * @param imgOut
+     * @return
      */
-    FilterMax(int size)
+    Image *ProcessP(ImageVec imgIn, Image *imgOut)
     {
-        this->halfSize = checkHalfSize(size);
+        return Process(imgIn, imgOut);
     }
 
     /**
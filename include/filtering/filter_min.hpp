@@ -18,63 +18,67 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #ifndef PIC_FILTERING_FILTER_MIN_HPP
 #define PIC_FILTERING_FILTER_MIN_HPP
 
+#include "util/running_extrema.hpp"
 #include "filtering/filter.hpp"
 
 namespace pic {
 
 /**
- * @brief The FilterMin class
+ * @brief The FilterMin class computes the minimum over square windows with
+ * the separable van Herk/Gil-Werman algorithm; its cost does not depend
+ * on the window's size.
  */
 class FilterMin: public Filter
 {
 protected:
     int halfSize;
 
+public:
+
     /**
-     * @brief ProcessBBox
-     * @param dst
-     * @param src
-     * @param box
+     * @brief FilterMin
+     * @param size
      */
-    void ProcessBBox(Image *dst, ImageVec src, BBox *box)
+    FilterMin(int size)
     {
-        int width = dst->width;
-        int channels = dst->channels;
+        this->halfSize = checkHalfSize(size);
+    }
 
-        float *data = src[0]->data;
+    /**
+     * @brief Process
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *Process(ImageVec imgIn, Image *imgOut)
+    {
+        if(imgIn.empty() || imgIn[0] == NULL) {
+            return imgOut;
+        }
 
-        for(int j = box->y0; j < box->y1; j++) {
-            for(int i = box->x0; i < box->x1; i++) {
-                int c = (j * width + i) * channels;
+        imgOut = SetupAux(imgIn, imgOut);
 
-                for(int ch = 0; ch < channels; ch++) {
-                    float minVal = FLT_MAX;
+        Image *img = imgIn[0];
 
-                    for(int k = -halfSize; k <= halfSize; k++) {
-                        int ci = CLAMP((i + k), dst->width);
+        for(int i = 0; i < img->frames; i++) {
+            Extrema2D(&img->data[i * img->tstride], &imgOut->data[i * imgOut->tstride],
+                      img->width, img->height, img->channels, halfSize, false);
+        }
 
-                        for(int l = -halfSize; l <= halfSize; l++) {
-                            int cj = CLAMP((j + l), dst->height);
-                            float tmp = data[(cj * width + ci) * channels + ch];
-                            minVal = minVal > tmp ? tmp : minVal;
-                        }
-                    }
+        imgOut->InvalidateCache();
 
-                    dst->data[c + ch] = minVal;
-                }
-            }
-        }
+        return imgOut;
     }
 
-public:
-
     /**
-     * @brief FilterMin
-     * @param size
+     * @brief ProcessP is Process; passes are parallel.
+     * @param imgIn
+     * @param imgOut
+     * @return
      */
-    FilterMin(int size)
+    Image *ProcessP(ImageVec imgIn, Image *imgOut)
     {
-        this->halfSize = checkHalfSize(size);
+        return Process(imgIn, imgOut);
     }
 
     /**
@@ -86,7 +90,7 @@ public:
      */
     static Image *Execute(Image *imgIn, Image *imgOut, int size)
     {
-        FilterMed filter(size);
+        FilterMin filter(size);
         return filter.ProcessP(Single(imgIn), imgOut);
     }
 
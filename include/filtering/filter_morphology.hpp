@@ -0,0 +1,176 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_FILTERING_FILTER_MORPHOLOGY_HPP
+#define PIC_FILTERING_FILTER_MORPHOLOGY_HPP
+
+#include "util/running_extrema.hpp"
+#include "filtering/filter.hpp"
+
+namespace pic {
+
+/**
+ * @brief The MORPHOLOGY_OPERATION enum
+ */
+enum MORPHOLOGY_OPERATION {MO_ERODE, MO_DILATE, MO_OPEN, MO_CLOSE,
+                           MO_TOP_HAT, MO_BLACK_HAT};
+
+/**
+ * @brief The FilterMorphology class applies grayscale morphology with
+ * square structuring elements. All operations run in place on the
+ * output with van Herk/Gil-Werman passes, and the residual of top-hat
+ * transforms is fused into the last pass.
+ */
+class FilterMorphology: public Filter
+{
+protected:
+    int halfSize;
+    MORPHOLOGY_OPERATION op;
+
+public:
+
+    /**
+     * @brief FilterMorphology
+     * @param size
+     * @param op
+     */
+    FilterMorphology(int size, MORPHOLOGY_OPERATION op = MO_OPEN)
+    {
+        Update(size, op);
+    }
+
+    /**
+     * @brief Update
+     * @param size
+     * @param op
+     */
+    void Update(int size, MORPHOLOGY_OPERATION op)
+    {
+        this->halfSize = checkHalfSize(size);
+        this->op = op;
+    }
+
+    /**
+     * @brief Process
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *Process(ImageVec imgIn, Image *imgOut)
+    {
+        if(imgIn.empty() || imgIn[0] == NULL) {
+            return imgOut;
+        }
+
+        imgOut = SetupAux(imgIn, imgOut);
+
+        Image *img = imgIn[0];
+
+        //top-hat residuals need the input
+        Image *imgCopy = NULL;
+        if((img == imgOut) && (op == MO_TOP_HAT || op == MO_BLACK_HAT)) {
+            imgCopy = img->Clone();
+            img = imgCopy;
+        }
+
+        int width = img->width;
+        int height = img->height;
+        int channels = img->channels;
+
+        for(int i = 0; i < img->frames; i++) {
+            float *in = &img->data[i * img->tstride];
+            float *out = &imgOut->data[i * imgOut->tstride];
+
+            switch(op) {
+            case MO_ERODE: {
+                Extrema2D(in, out, width, height, channels, halfSize, false);
+            }
+            break;
+
+            case MO_DILATE: {
+                Extrema2D(in, out, width, height, channels, halfSize, true);
+            }
+            break;
+
+            case MO_OPEN: {
+                Extrema2D(in, out, width, height, channels, halfSize, false);
+                Extrema2D(out, out, width, height, channels, halfSize, true);
+            }
+            break;
+
+            case MO_CLOSE: {
+                Extrema2D(in, out, width, height, channels, halfSize, true);
+                Extrema2D(out, out, width, height, channels, halfSize, false);
+            }
+            break;
+
+            case MO_TOP_HAT: {
+                //input - opening
+                Extrema2D(in, out, width, height, channels, halfSize, false);
+                Extrema2D(out, out, width, height, channels, halfSize, true, in, 1.0f);
+            }
+            break;
+
+            case MO_BLACK_HAT: {
+                //closing - input
+                Extrema2D(in, out, width, height, channels, halfSize, true);
+                Extrema2D(out, out, width, height, channels, halfSize, false, in, -1.0f);
+            }
+            break;
+            }
+        }
+
+        if(imgCopy != NULL) {
+            delete imgCopy;
+        }
+
+        imgOut->InvalidateCache();
+
+        return imgOut;
+    }
+
+    /**
+     * @brief ProcessP is Process; passes are parallel.
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *ProcessP(ImageVec imgIn, Image *imgOut)
+    {
+        return Process(imgIn, imgOut);
+    }
+
+    /**
+     * @brief Execute
+     * @param imgIn
+     * @param imgOut
+     * @param size
+     * @param op
+     * @return
+     */
+    static Image *Execute(Image *imgIn, Image *imgOut, int size,
+                          MORPHOLOGY_OPERATION op)
+    {
+        FilterMorphology filter(size, op);
+        return filter.ProcessP(Single(imgIn), imgOut);
+    }
+};
+
+} // end namespace pic
+
+#endif /* PIC_FILTERING_FILTER_MORPHOLOGY_HPP */
+
@@ -0,0 +1,177 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+
+#ifndef PIC_FILTERING_FILTER_REDUCE_2D_HPP
+#define PIC_FILTERING_FILTER_REDUCE_2D_HPP
+
+#include "filtering/filter.hpp"
+
+namespace pic {
+
+/**
+ * @brief The FilterReduce2D class is the REDUCE operator of Burt and Adelson;
+ * i.e. a 2x downsampling with a 5-tap binomial filter [1 4 6 4 1] / 16.
+ * Blurring and decimation are carried out in a single pass, and only the
+ * retained samples are computed.
+ */
+class FilterReduce2D: public Filter
+{
+protected:
+
+    /**
+     * @brief ProcessBBox
+     * @param dst
+     * @param src
+     * @param box
+     */
+    void ProcessBBox(Image *dst, ImageVec src, BBox *box)
+    {
+        Image *in = src[0];
+
+        int width    = in->width;
+        int height   = in->height;
+        int channels = in->channels;
+
+        //input columns required by the bounding box
+        int cx0 = MAX((box->x0 << 1) - 2, 0);
+        int cx1 = MIN((box->x1 << 1), width - 1);
+        int n = (cx1 - cx0 + 1) * channels;
+
+        float *row = new float[n];
+
+        for(int j = box->y0; j < box->y1; j++) {
+            int y = j << 1;
+
+            //vertical pass
+            float *r[5];
+            for(int k = 0; k < 5; k++) {
+                int yk = CLAMPi(y + k - 2, 0, height - 1);
+                r[k] = &in->data[yk * in->ystride + cx0 * channels];
+            }
+
+            for(int i = 0; i < n; i++) {
+                row[i] = (r[0][i] + r[4][i]) +
+                         (r[1][i] + r[3][i]) * 4.0f +
+                          r[2][i] * 6.0f;
+            }
+
+            //horizontal pass only at retained samples
+            float *out = &dst->data[j * dst->ystride];
+
+            for(int i = box->x0; i < box->x1; i++) {
+                int x = i << 1;
+
+                int i0 = (CLAMPi(x - 2, cx0, cx1) - cx0) * channels;
+                int i1 = (CLAMPi(x - 1, cx0, cx1) - cx0) * channels;
+                int i2 = (CLAMPi(x    , cx0, cx1) - cx0) * channels;
+                int i3 = (CLAMPi(x + 1, cx0, cx1) - cx0) * channels;
+                int i4 = (CLAMPi(x + 2, cx0, cx1) - cx0) * channels;
+
+                float *tmp_out = &out[i * channels];
+
+                for(int k = 0; k < channels; k++) {
+                    tmp_out[k] = ((row[i0 + k] + row[i4 + k]) +
+                                  (row[i1 + k] + row[i3 + k]) * 4.0f +
+                                   row[i2 + k] * 6.0f) * (1.0f / 256.0f);
+                }
+            }
+        }
+
+        delete[] row;
+    }
+
+    /**
+     * @brief SetupAux
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *SetupAux(ImageVec imgIn, Image *imgOut)
+    {
+        int width, height, channels, frames;
+        OutputSize(imgIn[0], width, height, channels, frames);
+
+        if(imgOut == NULL) {
+            imgOut = new Image(1, width, height, channels);
+        } else {
+            if((imgOut->width  != width)  ||
+               (imgOut->height != height) ||
+               (imgOut->channels != channels)) {
+                imgOut = new Image(1, width, height, channels);
+            }
+        }
+
+        return imgOut;
+    }
+
+public:
+
+    /**
+     * @brief FilterReduce2D
+     */
+    FilterReduce2D()
+    {
+    }
+
+    /**
+     * @brief OutputSize
+     * @param imgIn
+     * @param width
+     * @param height
+     * @param channels
+     * @param frames
+     */
+    void OutputSize(Image *imgIn, int &width, int &height, int &channels, int &frames)
+    {
+        width       = MAX(imgIn->width  >> 1, 1);
+        height      = MAX(imgIn->height >> 1, 1);
+        channels    = imgIn->channels;
+        frames      = 1;
+    }
+
+    /**
+     * @brief Execute
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    static Image *Execute(Image *imgIn, Image *imgOut)
+    {
+        FilterReduce2D flt;
+        return flt.ProcessP(Single(imgIn), imgOut);
+    }
+
+    /**
+     * @brief Execute
+     * @param fileInput
+     * @param fileOutput
+     * @return
+     */
+    static Image *Execute(std::string fileInput, std::string fileOutput)
+    {
+        Image imgIn(fileInput);
+        Image *out = FilterReduce2D::Execute(&imgIn, NULL);
+        out->Write(fileOutput);
+        return out;
+    }
+};
+
+} // end namespace pic
+
+#endif /* PIC_FILTERING_FILTER_REDUCE_2D_HPP */
+
@@ -23,6 +23,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "image_samplers/image_sampler_bsplines.hpp"
 #include "image_samplers/image_sampler_gaussian.hpp"
 #include "image_samplers/image_sampler_nearest.hpp"
+#include "image_samplers/image_sampler_separable.hpp"
 
 namespace pic {
 
@@ -37,6 +38,35 @@ protected:
     int				width, height;
     bool			swh;
 
+    ImageSamplerNearest isbNearest;
+
+    bool                bKernel;
+    RESAMPLING_KERNEL   kernel;
+    ResamplingTable     tx, ty;
+
+    /**
+     * @brief SetSampler sets the ImageSampler up; when isb is NULL,
+     * the filter's own ImageSamplerNearest is used.
+     * @param isb
+     */
+    void SetSampler(ImageSampler *isb)
+    {
+        this->isb = (isb != NULL) ? isb : &isbNearest;
+        this->bKernel = false;
+    }
+
+    /**
+     * @brief SetKernel sets the separable path up; this is used by
+     * the RESAMPLING_KERNEL constructors.
+     * @param kernel
+     */
+    void SetKernel(RESAMPLING_KERNEL kernel)
+    {
+        this->isb = NULL;
+        this->kernel = kernel;
+        this->bKernel = true;
+    }
+
     /**
      * @brief ProcessBBox
      * @param dst
@@ -57,7 +87,8 @@ public:
     /**
      * @brief FilterSampler2D
      * @param scale
-     * @param isb
+     * @param isb is the sampler; if it is NULL, an ImageSamplerNearest
+     * is used.
      */
     FilterSampler2D(float scale, ImageSampler *isb);
 
@@ -65,7 +96,8 @@ public:
      * @brief FilterSampler2D
      * @param scaleX
      * @param scaleY
-     * @param isb
+     * @param isb is the sampler; if it is NULL, an ImageSamplerNearest
+     * is used.
      */
     FilterSampler2D(float scaleX, float scaleY, ImageSampler *isb);
 
@@ -73,10 +105,38 @@ public:
      * @brief FilterSampler2D
      * @param width
      * @param height
-     * @param isb
+     * @param isb is the sampler; if it is NULL, an ImageSamplerNearest
+     * is used.
      */
     FilterSampler2D(int width, int height, ImageSampler *isb);
 
+    /**
+     * @brief FilterSampler2D
+     * @param scale
+     * @param kernel
+     */
+    FilterSampler2D(float scale, RESAMPLING_KERNEL kernel);
+
+    /**
+     * @brief FilterSampler2D
+     * @param scaleX
+     * @param scaleY
+     * @param kernel
+     */
+    FilterSampler2D(float scaleX, float scaleY, RESAMPLING_KERNEL kernel);
+
+    /**
+     * @brief FilterSampler2D
+     * @param width
+     * @param height
+     * @param kernel
+     */
+    FilterSampler2D(int width, int height, RESAMPLING_KERNEL kernel);
+
+    //isb may point to isbNearest; copies are not allowed
+    FilterSampler2D(const FilterSampler2D &) = delete;
+    FilterSampler2D &operator = (const FilterSampler2D &) = delete;
+
     /**
      * @brief OutputSize
      * @param imgIn
@@ -146,6 +206,37 @@ public:
         return filter.ProcessP(Single(imgIn), imgOut);
     }
 
+    /**
+     * @brief Execute
+     * @param imgIn
+     * @param imgOut
+     * @param scale
+     * @param kernel
+     * @return
+     */
+    static Image *Execute(Image *imgIn, Image *imgOut, float scale,
+                             RESAMPLING_KERNEL kernel)
+    {
+        FilterSampler2D filter(scale, kernel);
+        return filter.ProcessP(Single(imgIn), imgOut);
+    }
+
+    /**
+     * @brief Execute
+     * @param imgIn
+     * @param imgOut
+     * @param width
+     * @param height
+     * @param kernel
+     * @return
+     */
+    static Image *Execute(Image *imgIn, Image *imgOut, int width,
+                             int height, RESAMPLING_KERNEL kernel)
+    {
+        FilterSampler2D filter(width, height, kernel);
+        return filter.ProcessP(Single(imgIn), imgOut);
+    }
+
     /**
      * @brief Execute
      * @param nameIn
@@ -171,11 +262,7 @@ PIC_INLINE FilterSampler2D::FilterSampler2D(float scale,
 
     this->swh = true;
 
-    if(isb == NULL) {
-        this->isb = new ImageSamplerNearest();
-    } else {
-        this->isb = isb;
-    }
+    SetSampler(isb);
 }
 
 PIC_INLINE FilterSampler2D::FilterSampler2D(float scaleX, float scaleY,
@@ -186,11 +273,7 @@ PIC_INLINE FilterSampler2D::FilterSampler2D(float scaleX, float scaleY,
 
     this->swh = true;
 
-    if(isb == NULL) {
-        this->isb = new ImageSamplerNearest();
-    } else {
-        this->isb = isb;
-    }
+    SetSampler(isb);
 }
 
 PIC_INLINE FilterSampler2D::FilterSampler2D(int width, int height,
@@ -201,11 +284,38 @@ PIC_INLINE FilterSampler2D::FilterSampler2D(int width, int height,
 
     this->swh = false;
 
-    if(isb == NULL) {
-        this->isb = new ImageSamplerNearest();
-    } else {
-        this->isb = isb;
-    }
+    SetSampler(isb);
+}
+
+PIC_INLINE FilterSampler2D::FilterSampler2D(float scale,
+        RESAMPLING_KERNEL kernel)
+{
+    this->scale  = scale;
+    this->scaleX = scale;
+    this->scaleY = scale;
+    this->swh = true;
+
+    SetKernel(kernel);
+}
+
+PIC_INLINE FilterSampler2D::FilterSampler2D(float scaleX, float scaleY,
+        RESAMPLING_KERNEL kernel)
+{
+    this->scaleX = scaleX;
+    this->scaleY = scaleY;
+    this->swh = true;
+
+    SetKernel(kernel);
+}
+
+PIC_INLINE FilterSampler2D::FilterSampler2D(int width, int height,
+        RESAMPLING_KERNEL kernel)
+{
+    this->width  = width;
+    this->height = height;
+    this->swh = false;
+
+    SetKernel(kernel);
 }
 
 PIC_INLINE Image *FilterSampler2D::SetupAux(ImageVec imgIn,
@@ -227,6 +337,15 @@ PIC_INLINE Image *FilterSampler2D::SetupAux(ImageVec imgIn,
         scaleY = float(height) / imgIn[0]->heightf;
     }
 
+    if(bKernel) {
+        //the same mapping of ProcessBBox: [0, out - 1] --> [0, in - 1]
+        float sx = imgOut->width  > 1 ? imgIn[0]->width1f  / imgOut->width1f  : 0.0f;
+        float sy = imgOut->height > 1 ? imgIn[0]->height1f / imgOut->height1f : 0.0f;
+
+        tx.Compute(kernel, imgOut->width,  imgIn[0]->width,  sx, 0.0f);
+        ty.Compute(kernel, imgOut->height, imgIn[0]->height, sy, 0.0f);
+    }
+
     return imgOut;
 }
 
@@ -235,6 +354,11 @@ PIC_INLINE void FilterSampler2D::ProcessBBox(Image *dst, ImageVec src,
 {
     Image *source = src[0];
 
+    if(bKernel) {
+        ResampleSeparable(source, dst, &tx, &ty, box);
+        return;
+    }
+
     float inv_height1f = 1.0f / float(box->height - 1);
     float inv_width1f = 1.0f / float(box->width - 1);
 
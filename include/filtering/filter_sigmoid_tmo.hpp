@@ -19,6 +19,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #define PIC_FILTERING_FILTER_SIGMOID_TMO_HPP
 
 #include "filtering/filter.hpp"
+#include "util/tone_curve.hpp"
 
 namespace pic {
 
@@ -74,6 +75,27 @@ public:
     FilterSigmoidTMO(SIGMOID_MODE type, float alpha, float wp, float epsilon,
                      bool temporal);
 
+    /**
+     * @brief CompileToneCurve compiles the ratio Ld / L of the global
+     * operator for three-color images; this can be used with
+     * FilterToneCurve. epsilon has to be set.
+     * @param curve
+     * @param tolerance
+     * @return
+     */
+    bool CompileToneCurve(ToneCurve *curve, float tolerance = 1e-4f)
+    {
+        if((curve == NULL) || (epsilon <= 0.0f)) {
+            return false;
+        }
+
+        float alpha_over_epsilon = alpha / epsilon;
+
+        return curve->Compile([alpha_over_epsilon](float L) {
+            return alpha_over_epsilon / (1.0f + L * alpha_over_epsilon);
+        }, 1e-10f / alpha_over_epsilon, 1e10f / alpha_over_epsilon, tolerance);
+    }
+
     /**
      * @brief Execute
      * @param imgIn
@@ -183,6 +205,10 @@ void FilterSigmoidTMO::ProcessBBox(Image *dst, ImageVec src, BBox *box)
         dataFlt = src[0]->data;
     }
 
+    //the filtered image can be a single-channel luminance
+    bool bFltLum = (src.size() == 2) && (src[1]->channels == 1) &&
+                   (src[0]->channels > 1);
+
     float *dataOut = dst->data;
 
     if(src[0]->channels == 3) {
@@ -197,7 +223,8 @@ void FilterSigmoidTMO::ProcessBBox(Image *dst, ImageVec src, BBox *box)
                 float L		= 0.213f * data[c] + 0.715f * data[c + 1]	+ 0.072f * data[c + 2];
 
                 if(L > 0.0f) {
-                    float L_flt	 = 0.213f * dataFlt[c] + 0.715f * dataFlt[c + 1] + 0.072f *
+                    float L_flt	 = bFltLum ? dataFlt[j * src[1]->ystride + i] :
+                                   0.213f * dataFlt[c] + 0.715f * dataFlt[c + 1] + 0.072f *
                                    dataFlt[c + 2];
                     float Lm	 = L     * alpha_over_epsilon;
                     float Lm_flt = L_flt * alpha_over_epsilon;
@@ -222,14 +249,16 @@ void FilterSigmoidTMO::ProcessBBox(Image *dst, ImageVec src, BBox *box)
 
             for(int i = box->x0; i < box->x1; i++) {
                 int c = js + i * src[0]->xstride; //index
+                int cFlt = bFltLum ? (j * src[1]->ystride + i) : c;
 
                 for(int k = 0; k < src[0]->channels; k++) {
                     int ck = c + k;
+                    int ckFlt = bFltLum ? cFlt : ck;
 
                     switch(type) {
                     case SIG_TMO_WP: {
                         Lm		=	(data   [ck] * alpha) / epsilon;
-                        Lm_Flt	=	(dataFlt[ck] * alpha) / epsilon;
+                        Lm_Flt	=	(dataFlt[ckFlt] * alpha) / epsilon;
 
                         dataOut[ck] = Lm * (1.0f + Lm / wp2) / (1.0f + Lm_Flt);
                         //						dataOut[ck] = (val*(val/wp2+epsilon)/epsilon)/(valFlt+epsilon);
@@ -238,7 +267,7 @@ void FilterSigmoidTMO::ProcessBBox(Image *dst, ImageVec src, BBox *box)
 
                     default: {
                         Lm		=	data   [ck] * alpha;
-                        Lm_Flt	=	dataFlt[ck] * alpha;
+                        Lm_Flt	=	dataFlt[ckFlt] * alpha;
 
                         dataOut[ck] = Lm / (Lm_Flt + epsilon);
                     }
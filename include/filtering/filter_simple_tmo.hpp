@@ -19,6 +19,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #define PIC_FILTERING_FILTER_SIMPLE_TMO_HPP
 
 #include "filtering/filter.hpp"
+#include "util/tone_curve.hpp"
 
 namespace pic {
 
@@ -30,6 +31,10 @@ class FilterSimpleTMO: public Filter
 protected:
     float gamma, fstop, exposure;
 
+    bool bLUT;
+    float tolerance;
+    ToneCurve curve;
+
     /**
      * @brief ProcessBBox
      * @param dst
@@ -53,6 +58,43 @@ public:
      */
     void Update(float gamma, float fstop);
 
+    /**
+     * @brief setLUT enables the evaluation of the curve with a compiled
+     * ToneCurve instead of calling powf for each value.
+     * @param bLUT
+     * @param tolerance is the maximum relative error of the ToneCurve.
+     */
+    void setLUT(bool bLUT, float tolerance = 1e-4f)
+    {
+        this->bLUT = bLUT;
+        this->tolerance = tolerance;
+
+        if(bLUT) {
+            CompileToneCurve(&curve, tolerance);
+        }
+    }
+
+    /**
+     * @brief CompileToneCurve compiles the per-channel curve; this can be
+     * used as the encoding of FilterToneCurve.
+     * @param curve
+     * @param tolerance
+     * @return
+     */
+    bool CompileToneCurve(ToneCurve *curve, float tolerance = 1e-4f)
+    {
+        if(curve == NULL) {
+            return false;
+        }
+
+        float exposure = this->exposure;
+        float gamma = this->gamma;
+
+        return curve->Compile([exposure, gamma](float x) {
+            return powf(x * exposure, gamma);
+        }, 1e-10f / exposure, 1e10f / exposure, tolerance);
+    }
+
     /**
      * @brief Execute
      * @param imgIn
@@ -88,6 +130,8 @@ public:
 
 FilterSimpleTMO::FilterSimpleTMO(float gamma, float fstop)
 {
+    bLUT = false;
+    tolerance = 1e-4f;
     Update(gamma, fstop);
 }
 
@@ -96,6 +140,10 @@ void FilterSimpleTMO::Update(float gamma, float fstop)
     this->gamma = 1.0f / gamma;
     this->fstop = fstop;
     exposure = powf(2.0f, fstop);
+
+    if(bLUT) {
+        CompileToneCurve(&curve, tolerance);
+    }
 }
 
 void FilterSimpleTMO::ProcessBBox(Image *dst, ImageVec src, BBox *box)
@@ -112,8 +160,14 @@ void FilterSimpleTMO::ProcessBBox(Image *dst, ImageVec src, BBox *box)
         for(int i = box->x0; i < box->x1; i++) {
             int c = (ind + i) * channels;
 
-            for(int k = 0; k < channels; k++) {
-                dst->data[c + k] = powf((data[c + k] * exposure), gamma);
+            if(bLUT) {
+                for(int k = 0; k < channels; k++) {
+                    dst->data[c + k] = curve.Eval(data[c + k]);
+                }
+            } else {
+                for(int k = 0; k < channels; k++) {
+                    dst->data[c + k] = powf((data[c + k] * exposure), gamma);
+                }
             }
         }
     }
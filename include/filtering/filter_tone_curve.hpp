@@ -0,0 +1,209 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_FILTERING_FILTER_TONE_CURVE_HPP
+#define PIC_FILTERING_FILTER_TONE_CURVE_HPP
+
+#include "filtering/filter.hpp"
+#include "util/tone_curve.hpp"
+
+namespace pic {
+
+/**
+ * @brief The FilterToneCurve class applies a compiled global tone mapping
+ * curve and a display encoding in a single pass. The tone mapping curve
+ * maps the luminance, L, into the ratio Ld / L, which scales all channels;
+ * the encoding, e.g. gamma or sRGB, is applied to each channel.
+ */
+class FilterToneCurve: public Filter
+{
+protected:
+    ToneCurve *ratio, *encoding;
+
+    /**
+     * @brief Store
+     * @param x
+     * @param out
+     */
+    static inline void Store(float x, float &out)
+    {
+        out = x;
+    }
+
+    /**
+     * @brief Store
+     * @param x
+     * @param out
+     */
+    static inline void Store(float x, unsigned char &out)
+    {
+        out = ToneCurve::ToUChar(x);
+    }
+
+    /**
+     * @brief ToneRow tone maps and encodes n pixels.
+     * @param dataIn
+     * @param dataOut
+     * @param n
+     * @param channels
+     */
+    template<class T>
+    inline void ToneRow(const float *dataIn, T *dataOut, int n, int channels)
+    {
+        if((channels == 3) && (ratio != NULL)) {
+            for(int i = 0; i < n; i++) {
+                const float *p = &dataIn[i * 3];
+                T *q = &dataOut[i * 3];
+
+                float L = 0.213f * p[0] + 0.715f * p[1] + 0.072f * p[2];
+                float r = (L > 0.0f) ? ratio->Eval(L) : 0.0f;
+
+                if(encoding != NULL) {
+                    Store(encoding->Eval(p[0] * r), q[0]);
+                    Store(encoding->Eval(p[1] * r), q[1]);
+                    Store(encoding->Eval(p[2] * r), q[2]);
+                } else {
+                    Store(p[0] * r, q[0]);
+                    Store(p[1] * r, q[1]);
+                    Store(p[2] * r, q[2]);
+                }
+            }
+
+            return;
+        }
+
+        for(int i = 0; i < n; i++) {
+            const float *p = &dataIn[i * channels];
+            T *q = &dataOut[i * channels];
+
+            float r = 1.0f;
+
+            if(ratio != NULL) {
+                float L = 0.0f;
+
+                for(int k = 0; k < channels; k++) {
+                    L += p[k];
+                }
+
+                L /= float(channels);
+
+                r = (L > 0.0f) ? ratio->Eval(L) : 0.0f;
+            }
+
+            for(int k = 0; k < channels; k++) {
+                float v = p[k] * r;
+                Store(encoding != NULL ? encoding->Eval(v) : v, q[k]);
+            }
+        }
+    }
+
+    /**
+     * @brief ProcessBBox
+     * @param dst
+     * @param src
+     * @param box
+     */
+    void ProcessBBox(Image *dst, ImageVec src, BBox *box)
+    {
+        int channels = src[0]->channels;
+        int n = box->x1 - box->x0;
+
+        for(int k = box->z0; k < box->z1; k++) {
+            for(int j = box->y0; j < box->y1; j++) {
+                ToneRow((*src[0])(box->x0, j, k), (*dst)(box->x0, j, k), n,
+                        channels);
+            }
+        }
+    }
+
+public:
+
+    /**
+     * @brief FilterToneCurve
+     * @param ratio is the curve from luminance to Ld / L; if it is NULL
+     * only the encoding is applied.
+     * @param encoding is the per-channel curve; if it is NULL channels
+     * are not encoded.
+     */
+    FilterToneCurve(ToneCurve *ratio = NULL, ToneCurve *encoding = NULL)
+    {
+        Update(ratio, encoding);
+    }
+
+    /**
+     * @brief Update
+     * @param ratio
+     * @param encoding
+     */
+    void Update(ToneCurve *ratio, ToneCurve *encoding)
+    {
+        this->ratio = ratio;
+        this->encoding = encoding;
+    }
+
+    /**
+     * @brief ProcessUChar tone maps and encodes imgIn writing directly
+     * an 8-bit buffer.
+     * @param imgIn
+     * @param dataOut
+     * @return
+     */
+    unsigned char *ProcessUChar(Image *imgIn, unsigned char *dataOut = NULL)
+    {
+        if(imgIn == NULL) {
+            return dataOut;
+        }
+
+        int channels = imgIn->channels;
+
+        if(dataOut == NULL) {
+            dataOut = new unsigned char[imgIn->size()];
+        }
+
+        int rows = imgIn->height * imgIn->frames;
+        int width = imgIn->width;
+
+        #pragma omp parallel for
+
+        for(int j = 0; j < rows; j++) {
+            int ind = j * width * channels;
+            ToneRow(&imgIn->data[ind], &dataOut[ind], width, channels);
+        }
+
+        return dataOut;
+    }
+
+    /**
+     * @brief Execute
+     * @param imgIn
+     * @param imgOut
+     * @param ratio
+     * @param encoding
+     * @return
+     */
+    static Image *Execute(Image *imgIn, Image *imgOut, ToneCurve *ratio,
+                          ToneCurve *encoding = NULL)
+    {
+        FilterToneCurve filter(ratio, encoding);
+        return filter.ProcessP(Single(imgIn), imgOut);
+    }
+};
+
+} // end namespace pic
+
+#endif /* PIC_FILTERING_FILTER_TONE_CURVE_HPP */
+
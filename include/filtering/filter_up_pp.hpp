@@ -20,7 +20,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include "filtering/filter.hpp"
 #include "filtering/filter_down_pp.hpp"
-#include "image_samplers/image_sampler_bilinear.hpp"
+#include "filtering/filter_expand_2d.hpp"
 
 namespace pic {
 
@@ -31,8 +31,6 @@ class FilterUpPP: public Filter
 {
 protected:
 
-    ImageSamplerBilinear isb;
-
     float *value, threshold;
 
     /**
@@ -43,16 +41,43 @@ protected:
      */
     void ProcessBBox(Image *dst, ImageVec src, BBox *box)
     {
+        Image *in = src[0];
+
+        int channels = dst->channels;
+
+        int   indX[3], indY[3];
+        float weightX[3], weightY[3];
+
         for(int i = box->y0; i < box->y1; i++) {
-            float y = float(i) / dst->heightf;
+            int nTapsY = FilterExpand2D::getTaps(i, in->height, indY, weightY);
+
+            float *row = &dst->data[i * dst->ystride];
 
             for(int j = box->x0; j < box->x1; j++) {
-                float x = float(j) / dst->widthf;
+                float *data = &row[j * channels];
+
+                if(FilterDownPP::distance(data, value, channels) >= threshold) {
+                    continue;
+                }
+
+                //EXPAND at missing samples only
+                int nTapsX = FilterExpand2D::getTaps(j, in->width, indX, weightX);
+
+                for(int l = 0; l < channels; l++) {
+                    data[l] = 0.0f;
+                }
+
+                for(int k = 0; k < nTapsY; k++) {
+                    float *tmp_row = &in->data[indY[k] * in->ystride];
 
-                float *data = (*dst)(j, i);
+                    for(int m = 0; m < nTapsX; m++) {
+                        float *tmp = &tmp_row[indX[m] * channels];
+                        float w = weightY[k] * weightX[m];
 
-                if(FilterDownPP::distance(data, value, dst->channels) < threshold) {
-                    isb.SampleImage(src[0], x, y, data);
+                        for(int l = 0; l < channels; l++) {
+                            data[l] += tmp[l] * w;
+                        }
+                    }
                 }
             }
         }
@@ -21,7 +21,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "util/matrix_3_x_3.hpp"
 
 #include "filtering/filter.hpp"
-#include "image_samplers/image_sampler_bilinear.hpp"
+#include "image_samplers/image_sampler_separable.hpp"
 
 namespace pic {
 
@@ -31,11 +31,109 @@ namespace pic {
 class FilterWarp2D: public Filter
 {
 protected:
-    ImageSamplerBilinear    isb;
     Matrix3x3               h, h_inv;
 
     int                     bmin[2], bmax[2];
 
+    //warp coordinates of the output pixel (0, 0)
+    int                     origin[2];
+    bool                    bCanvas;
+
+    RESAMPLING_KERNEL       kernel;
+    bool                    bSeparable;
+    ResamplingTable         tx, ty;
+
+    /**
+     * @brief ClipSpan intersects the interval [t0, t1] with the half-line
+     * c0 + c1 * t >= 0.
+     * @param c0
+     * @param c1
+     * @param t0
+     * @param t1
+     * @return It returns true if the resulting interval is not empty.
+     */
+    static inline bool ClipSpan(float c0, float c1, float &t0, float &t1)
+    {
+        if(fabsf(c1) < 1e-9f) {
+            return c0 >= 0.0f;
+        }
+
+        float t = -c0 / c1;
+
+        if(c1 > 0.0f) {
+            t0 = MAX(t0, t);
+        } else {
+            t1 = MIN(t1, t);
+        }
+
+        return t0 <= t1;
+    }
+
+    /**
+     * @brief RowSpan computes the range of output pixels, [x0, x1), of a
+     * row that are mapped inside the source image.
+     * @param rx is the constant part of the x coordinate for the row.
+     * @param ry is the constant part of the y coordinate for the row.
+     * @param rw is the constant part of the w coordinate for the row.
+     * @param mid
+     * @param width1f
+     * @param height1f
+     * @param x0
+     * @param x1
+     * @return It returns true if the span is not empty.
+     */
+    bool RowSpan(float rx, float ry, float rw, float *mid,
+                 float width1f, float height1f, int &x0, int &x1)
+    {
+        float *m = h_inv.data;
+
+        float shift = mid[0] - float(origin[0]);
+
+        float t0 = float(x0) - shift;
+        float t1 = float(x1 - 1) - shift;
+
+        //w > 0
+        bool bSpan = ClipSpan(rw, m[6], t0, t1);
+
+        //0 <= u <= width - 1
+        bSpan = bSpan && ClipSpan(rx + mid[0] * rw, m[0] + mid[0] * m[6], t0, t1);
+        bSpan = bSpan && ClipSpan((width1f - mid[0]) * rw - rx, (width1f - mid[0]) * m[6] - m[0], t0, t1);
+
+        //0 <= v <= height - 1
+        bSpan = bSpan && ClipSpan(ry + mid[1] * rw, m[3] + mid[1] * m[6], t0, t1);
+        bSpan = bSpan && ClipSpan((height1f - mid[1]) * rw - ry, (height1f - mid[1]) * m[6] - m[3], t0, t1);
+
+        if(!bSpan) {
+            return false;
+        }
+
+        //one pixel of slack for rounding errors; pixels are tested anyway
+        int s0 = int(floorf(t0 + shift)) - 1;
+        int s1 = int(ceilf(t1 + shift)) + 2;
+
+        x0 = MAX(x0, s0);
+        x1 = MIN(x1, s1);
+
+        return x0 < x1;
+    }
+
+    /**
+     * @brief ClearRow sets to zero the pixels [x0, x1) of a row; this
+     * is skipped when warping into a canvas.
+     * @param out
+     * @param x0
+     * @param x1
+     * @param channels
+     */
+    void ClearRow(float *out, int x0, int x1, int channels)
+    {
+        if(bCanvas || x0 >= x1) {
+            return;
+        }
+
+        memset(&out[x0 * channels], 0, sizeof(float) * (x1 - x0) * channels);
+    }
+
     /**
      * @brief ProcessBBox
      * @param dst
@@ -44,9 +142,14 @@ protected:
      */
     void ProcessBBox(Image *dst, ImageVec src, BBox *box)
     {
+        if(bSeparable) {
+            ResampleSeparable(src[0], dst, &tx, &ty, box);
+            return;
+        }
+
         int channels = src[0]->channels;
 
-        float pos[2], mid[2], pos_out[2];
+        float mid[2];
 
         if(bCentroid) {
             mid[0] = src[0]->widthf  * 0.5f;
@@ -56,32 +159,114 @@ protected:
             mid[1] = 0.0f;
         }
 
+        float *m = h_inv.data;
+
+        float width1f  = src[0]->width1f;
+        float height1f = src[0]->height1f;
+
+        //coordinates are computed for blocks of pixels
+        const int block = 8;
+        float u[block], v[block];
+
         for(int j = box->y0; j < box->y1; j++) {
-            pos[1] = float(j + bmin[1]) - mid[1];
+            float py = float(j + origin[1]) - mid[1];
+
+            //the homography is stepped along the scanline
+            float rx = m[1] * py + m[2];
+            float ry = m[4] * py + m[5];
+            float rw = m[7] * py + m[8];
+
+            float *out = &dst->data[j * dst->ystride];
+
+            int x0 = box->x0;
+            int x1 = box->x1;
+
+            if(!RowSpan(rx, ry, rw, mid, width1f, height1f, x0, x1)) {
+                ClearRow(out, box->x0, box->x1, channels);
+                continue;
+            }
+
+            ClearRow(out, box->x0, x0, channels);
+            ClearRow(out, x1, box->x1, channels);
 
-            for(int i = box->x0; i < box->x1; i++) {
-                float *tmp_dst = (*dst)(i, j);
+            for(int i0 = x0; i0 < x1; i0 += block) {
+                float px0 = float(i0 + origin[0]) - mid[0];
 
-                pos[0] = float(i + bmin[0] ) - mid[0];
+                for(int k = 0; k < block; k++) {
+                    float px = px0 + float(k);
 
-                h_inv.Projection(pos, pos_out);
+                    float xw = rx + m[0] * px;
+                    float yw = ry + m[3] * px;
+                    float ww = rw + m[6] * px;
 
-                pos_out[0] += mid[0];
-                pos_out[1] += mid[1];
+                    float inv_ww = ww > 0.0f ? (1.0f / ww) : 1.0f;
 
-                if(pos_out[0] >= 0.0f && pos_out[0] <= src[0]->width1f &&
-                   pos_out[1] >= 0.0f && pos_out[1] <= src[0]->height1f) {
-                    isb.SampleImageUC(src[0], pos_out[0], pos_out[1], tmp_dst);
-                } else {
-                    for(int k=0; k<channels; k++) {
-                        tmp_dst[k] = 0.0f;
+                    u[k] = xw * inv_ww + mid[0];
+                    v[k] = yw * inv_ww + mid[1];
+                }
+
+                int nb = MIN(block, x1 - i0);
+
+                for(int k = 0; k < nb; k++) {
+                    float *tmp_dst = &out[(i0 + k) * channels];
+
+                    if(u[k] >= 0.0f && u[k] <= width1f &&
+                       v[k] >= 0.0f && v[k] <= height1f) {
+                        SampleImageKernelUC(src[0], kernel, u[k], v[k], tmp_dst);
+                    } else {
+                        if(!bCanvas) {
+                            for(int l = 0; l < channels; l++) {
+                                tmp_dst[l] = 0.0f;
+                            }
+                        }
                     }
                 }
             }
         }
     }
 
+    /**
+     * @brief SetupSeparable checks whether the inverse transform is a
+     * scaling plus a translation; in such case, per-column and per-row
+     * weight tables are computed.
+     * @param imgIn
+     * @param imgOut
+     */
+    void SetupSeparable(Image *imgIn, Image *imgOut)
+    {
+        float *m = h_inv.data;
+
+        const float eps = 1e-7f;
+
+        bSeparable = (fabsf(m[1]) < eps) && (fabsf(m[3]) < eps) &&
+                     (fabsf(m[6]) < eps) && (fabsf(m[7]) < eps) &&
+                     (m[8] > 0.0f);
+
+        if(!bSeparable) {
+            return;
+        }
+
+        float mid[2];
+
+        if(bCentroid) {
+            mid[0] = imgIn->widthf  * 0.5f;
+            mid[1] = imgIn->heightf * 0.5f;
+        } else {
+            mid[0] = 0.0f;
+            mid[1] = 0.0f;
+        }
+
+        float sx = m[0] / m[8];
+        float sy = m[4] / m[8];
+        float ox = m[2] / m[8];
+        float oy = m[5] / m[8];
+
+        tx.Compute(kernel, imgOut->width, imgIn->width, sx,
+                   sx * (float(origin[0]) - mid[0]) + ox + mid[0], true);
 
+        ty.Compute(kernel, imgOut->height, imgIn->height, sy,
+                   sy * (float(origin[1]) - mid[1]) + oy + mid[1], true);
+    }
 
     /**
      * @brief SetupAux
@@ -91,25 +276,28 @@ protected:
      */
     Image *SetupAux(ImageVec imgIn, Image *imgOut)
     {
-        if(imgOut != NULL) {
-            return imgOut;
-        }
-
         if(!bSameSize) {
             ComputingBoundingBox(h, imgIn[0]->widthf, imgIn[0]->heightf, bmin, bmax, bCentroid);
-            imgOut = new Image(1, bmax[0] - bmin[0], bmax[1] - bmin[1], imgIn[0]->channels);
         } else {
             bmin[0] = 0;
             bmin[1] = 0;
 
             bmax[0] = imgIn[0]->width;
             bmax[1] = imgIn[0]->height;
+        }
 
-            imgOut = new Image(1, imgIn[0]->width, imgIn[0]->height, imgIn[0]->channels);
+        if(imgOut == NULL) {
+            imgOut = new Image(1, bmax[0] - bmin[0], bmax[1] - bmin[1], imgIn[0]->channels);
         }
 
+        origin[0] = bmin[0];
+        origin[1] = bmin[1];
+        bCanvas = false;
+
+        SetupSeparable(imgIn[0], imgOut);
+
         return imgOut;
-    }    
+    }
 
     bool bSameSize, bCentroid;
 
@@ -122,6 +310,9 @@ public:
     {
         this->bCentroid = false;
         this->bSameSize = false;
+        this->kernel = RK_BILINEAR;
+        this->bSeparable = false;
+        this->bCanvas = false;
 
         h.Identity();
         h_inv.Identity();
@@ -132,10 +323,14 @@ public:
      * @param h
      * @param bSameSize
      * @param bCentroid
+     * @param kernel
      */
-    FilterWarp2D(Matrix3x3 h, bool bSameSize = false, bool bCentroid = false)
+    FilterWarp2D(Matrix3x3 h, bool bSameSize = false, bool bCentroid = false,
+                 RESAMPLING_KERNEL kernel = RK_BILINEAR)
     {
-        Update(h, bSameSize, bCentroid);
+        this->bSeparable = false;
+        this->bCanvas = false;
+        Update(h, bSameSize, bCentroid, kernel);
     }
 
     /**
@@ -216,11 +411,14 @@ public:
      * @param h
      * @param bSameSize
      * @param bCentroid
+     * @param kernel
      */
-    void Update(Matrix3x3 h, bool bSameSize, bool bCentroid = false)
+    void Update(Matrix3x3 h, bool bSameSize, bool bCentroid = false,
+                RESAMPLING_KERNEL kernel = RK_BILINEAR)
     {
         this->bSameSize = bSameSize;
         this->bCentroid = bCentroid;
+        this->kernel = kernel;
 
         this->h = h;
         h.Inverse(&h_inv);
@@ -245,17 +443,116 @@ public:
             width  = imgIn->width;
             height = imgIn->height;
         }
-\
+
         frames   = imgIn->frames;
         channels = imgIn->channels;
     }
 
-    static Image *Execute(Image *img, Image *imgOut, Matrix3x3 h, bool bSameSize = false, bool bCentroid = false)
+    /**
+     * @brief ProcessCanvas warps imgIn directly into canvas, which can be
+     * larger than the warped image (e.g., a mosaic). The canvas pixel (0, 0)
+     * corresponds to the warp coordinates (canvas_x, canvas_y). Only the
+     * sub-rectangle of canvas covered by the warped image is processed, and
+     * canvas pixels that do not receive a sample are left untouched.
+     * @param imgIn
+     * @param canvas
+     * @param canvas_x
+     * @param canvas_y
+     * @return
+     */
+    Image *ProcessCanvas(Image *imgIn, Image *canvas, int canvas_x = 0, int canvas_y = 0)
     {
-        FilterWarp2D flt(h, bSameSize, bCentroid);
+        if(imgIn == NULL || canvas == NULL) {
+            return canvas;
+        }
+
+        if(imgIn->channels != canvas->channels) {
+            return canvas;
+        }
+
+        if(!bSameSize) {
+            ComputingBoundingBox(h, imgIn->widthf, imgIn->heightf, bmin, bmax, bCentroid);
+        } else {
+            bmin[0] = 0;
+            bmin[1] = 0;
+
+            bmax[0] = imgIn->width;
+            bmax[1] = imgIn->height;
+        }
+
+        //sub-rectangle of the canvas covered by the warped image
+        int x0 = MAX(bmin[0] - canvas_x, 0);
+        int y0 = MAX(bmin[1] - canvas_y, 0);
+        int x1 = MIN(bmax[0] - canvas_x, canvas->width);
+        int y1 = MIN(bmax[1] - canvas_y, canvas->height);
+
+        if(x0 >= x1 || y0 >= y1) {
+            return canvas;
+        }
+
+        origin[0] = canvas_x;
+        origin[1] = canvas_y;
+        bCanvas = true;
+        bSeparable = false;
+
+        ImageVec src = Single(imgIn);
+
+        int nx = (x1 - x0 + TILE_SIZE - 1) / TILE_SIZE;
+        int ny = (y1 - y0 + TILE_SIZE - 1) / TILE_SIZE;
+        int nTiles = nx * ny;
+
+        #pragma omp parallel for schedule(dynamic)
+        for(int t = 0; t < nTiles; t++) {
+            int tx0 = x0 + (t % nx) * TILE_SIZE;
+            int ty0 = y0 + (t / nx) * TILE_SIZE;
+
+            BBox box(tx0, MIN(tx0 + TILE_SIZE, x1), ty0, MIN(ty0 + TILE_SIZE, y1));
+            ProcessBBox(canvas, src, &box);
+        }
+
+        bCanvas = false;
+
+        canvas->InvalidateCache();
+
+        return canvas;
+    }
+
+    /**
+     * @brief Execute
+     * @param img
+     * @param imgOut
+     * @param h
+     * @param bSameSize
+     * @param bCentroid
+     * @param kernel
+     * @return
+     */
+    static Image *Execute(Image *img, Image *imgOut, Matrix3x3 h, bool bSameSize = false,
+                          bool bCentroid = false, RESAMPLING_KERNEL kernel = RK_BILINEAR)
+    {
+        FilterWarp2D flt(h, bSameSize, bCentroid, kernel);
         imgOut = flt.ProcessP(Single(img), imgOut);
         return imgOut;
     }
+
+    /**
+     * @brief ExecuteCanvas
+     * @param img
+     * @param canvas
+     * @param h
+     * @param canvas_x
+     * @param canvas_y
+     * @param bCentroid
+     * @param kernel
+     * @return
+     */
+    static Image *ExecuteCanvas(Image *img, Image *canvas, Matrix3x3 h,
+                                int canvas_x = 0, int canvas_y = 0, bool bCentroid = false,
+                                RESAMPLING_KERNEL kernel = RK_BILINEAR)
+    {
+        FilterWarp2D flt(h, false, bCentroid, kernel);
+        return flt.ProcessCanvas(img, canvas, canvas_x, canvas_y);
+    }
 };
 
 } // end namespace pic
@@ -130,6 +130,8 @@ protected:
             imgOut->data[i] = float(x(i));
         }
 
+        imgOut->InvalidateCache();
+
         return imgOut;
     }
 
@@ -272,6 +274,8 @@ protected:
 
         }
 
+        imgOut->InvalidateCache();
+
         return imgOut;
     }
 
@@ -142,9 +142,11 @@ public:
             tmp_value[i] = value;
         }
 
-        return pp.Process(img, NULL, tmp_value);
+        ImageGL *imgOut = pp.Process(img, NULL, tmp_value);
 
-        delete tmp_value;
+        delete[] tmp_value;
+
+        return imgOut;
     }
 
     /**
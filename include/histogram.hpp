@@ -220,6 +220,137 @@ public:
         }
     }
 
+    /**
+     * @brief Calculate computes the histogram of the luminance from its
+     * LuminanceStatistics without scanning the image again. Values are
+     * the centers of the log2 bins of stats; non-positive values are
+     * assumed to be zero. This is an approximation: the counts of the 64
+     * bins per octave of stats are spread over the bins they overlap, so
+     * on clustered data the result can differ from the per-pixel histogram
+     * by more than one bin.
+     * @param stats is the luminance statistics of an image; please see
+     * Image::getLuminanceStatistics.
+     * @param type is the domain space for histogram computations.
+     * @param nBin is the number of bins of the Histogram to be computed.
+     */
+    void Calculate(const LuminanceStatistics *stats, VALUE_SPACE type, int nBin)
+    {
+        if(stats == NULL) {
+            return;
+        }
+
+        if(nBin < 1) {
+            nBin = 256;
+        }
+
+        if(type == VS_LDR) {
+            nBin = 256;
+        }
+
+        if(bin != NULL) {
+            delete[] bin;
+        }
+
+        bin = new unsigned int[nBin];
+        memset((void *)bin, 0, nBin * sizeof(unsigned int));
+        this->nBin = nBin;
+        this->type = type;
+
+        int nNonPositive = stats->nValid - stats->nPositive;
+
+        fMin = Transform(nNonPositive > 0 ? 0.0f : stats->minPositiveVal, type);
+        fMax = Transform(stats->maxVal, type);
+
+        if(type == VS_LDR) {
+            fMin = 0.0f;
+            fMax = 1.0f;
+        }
+
+        float deltaMaxMin = MAX(fMax - fMin, 1e-9f);
+        float nBinf = float(nBin - 1);
+
+        if(nNonPositive > 0) {
+            int indx = int(((Transform(0.0f, type) - fMin) * nBinf) / deltaMaxMin);
+            bin[CLAMP(indx, nBin)] += nNonPositive;
+        }
+
+        //the count of a bin of stats is spread uniformly over its extent
+        std::vector<double> acc(nBin, 0.0);
+        int nBinStats = int(stats->histogram.size());
+
+        for(int i = 0; i < nBinStats; i++) {
+            unsigned int c = stats->histogram[i];
+
+            if(c == 0) {
+                continue;
+            }
+
+            float v0 = MAX(LuminanceStatistics::getBinValue(i, 0.0f), stats->minPositiveVal);
+            float v1 = MIN(LuminanceStatistics::getBinValue(i + 1, 0.0f), stats->maxVal);
+
+            double u0 = double(((Transform(v0, type) - fMin) * nBinf) / deltaMaxMin);
+            double u1 = double(((Transform(v1, type) - fMin) * nBinf) / deltaMaxMin);
+
+            int i0 = int(u0);
+            int i1 = int(u1);
+
+            if((i1 <= i0) || (u1 <= u0)) {
+                acc[CLAMPi(i0, 0, nBin - 1)] += double(c);
+                continue;
+            }
+
+            double density = double(c) / (u1 - u0);
+
+            for(int j = i0; j <= i1; j++) {
+                double overlap = MIN(u1, double(j + 1)) - MAX(u0, double(j));
+
+                if(overlap > 0.0) {
+                    acc[CLAMPi(j, 0, nBin - 1)] += overlap * density;
+                }
+            }
+        }
+
+        //rounding with carry to preserve the total count
+        double carry = 0.0;
+
+        for(int i = 0; i < nBin; i++) {
+            double v = acc[i] + carry;
+            double r = floor(v + 0.5);
+            carry = v - r;
+            bin[i] += (unsigned int) MAX(r, 0.0);
+        }
+    }
+
+    /**
+     * @brief Transform converts a value into the space of the Histogram
+     * as in Calculate.
+     * @param val
+     * @param type
+     * @return
+     */
+    static float Transform(float val, VALUE_SPACE type)
+    {
+        float epsilon = 1e-6f;
+
+        switch(type) {
+            case VS_LOG_2: {
+                return logf(val + epsilon) / logf(2.0f);
+            }
+
+            case VS_LOG_E: {
+                return logf(val + epsilon);
+            }
+
+            case VS_LOG_10: {
+                return log10f(val + epsilon);
+            }
+
+            default: {
+                return val;
+            }
+        }
+    }
+
     /**
      * @brief Ceiling limits the maximum value of the histogram using Ward
      * algorithm.
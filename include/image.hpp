@@ -33,6 +33,8 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "util/low_dynamic_range.hpp"
 
 #include "util/math.hpp"
+#include "util/tone_curve.hpp"
+#include "util/luminance_statistics.hpp"
 
 //IO formats
 #include "io/bmp.hpp"
@@ -110,6 +112,12 @@ public:
      */
     float *dataTMP;
 
+    /**
+     * @brief lumStats caches the luminance statistics; see
+     * getLuminanceStatistics.
+     */
+    LuminanceStatistics *lumStats;
+
     /**
      * @brief dataUC is a buffer for rendering 8-bit images.
      */
@@ -312,6 +320,13 @@ public:
      */
     void ApplyFunction(float(*func)(float));
 
+    /**
+     * @brief ApplyFunction is an operator that applies
+     * a compiled ToneCurve to all values in data; this is
+     * faster than calling an expensive function per value.
+     */
+    void ApplyFunction(const ToneCurve *curve);
+
     /**
      * @brief getMaxVal computes the maximum value for the current Image.
      * @param box is the bounding box where to compute the function. If it
@@ -420,6 +435,27 @@ public:
      */
     void sort();
 
+    /**
+     * @brief getLuminanceStatistics returns the luminance statistics of the
+     * Image, which are computed in a single pass and cached until the Image
+     * is modified.
+     * @param imgLum is an optional single-channel Image with the same size;
+     * if it is not NULL, the luminance is stored in it during the pass and
+     * the statistics are cached on imgLum as well.
+     * @return This function returns a pointer owned by the Image; it is
+     * valid until InvalidateCache is called. Writing data directly does not
+     * invalidate the cache: without imgLum, the statistics are stale unless
+     * InvalidateCache is called after such writes.
+     */
+    LuminanceStatistics *getLuminanceStatistics(Image *imgLum);
+
+    /**
+     * @brief InvalidateCache releases cached data (sorted values and
+     * luminance statistics). Methods of Image and filters call it when
+     * they modify data; it has to be called after writing data directly.
+     */
+    void InvalidateCache();
+
     /**
      * @brief getdataUC
      * @return
@@ -831,6 +867,7 @@ PIC_INLINE void Image::SetNULL()
     channels = -1;
 
     dataTMP = NULL;
+    lumStats = NULL;
     data = NULL;
     dataUC = NULL;
     dataRGBE = NULL;
@@ -937,6 +974,10 @@ PIC_INLINE void Image::Destroy()
         delete[] dataTMP;
     }
 
+    if(lumStats != NULL) {
+        delete lumStats;
+    }
+
     if(dataUC != NULL) {
         delete[] dataUC;
     }
@@ -1000,6 +1041,8 @@ PIC_INLINE void Image::AllocateAux()
 
 PIC_INLINE void Image::Assign(const Image *imgIn)
 {
+    InvalidateCache();
+
     if(imgIn == NULL) {
         return;
     }
@@ -1019,6 +1062,8 @@ PIC_INLINE void Image::Assign(const Image *imgIn)
 
 PIC_INLINE void Image::clamp(float a = 0.0f, float b = 1.0f)
 {
+    InvalidateCache();
+
     int n = size();
 
     #pragma omp parallel for
@@ -1030,6 +1075,8 @@ PIC_INLINE void Image::clamp(float a = 0.0f, float b = 1.0f)
 
 PIC_INLINE void Image::removeSpecials()
 {
+    InvalidateCache();
+
     int n = size();
     #pragma omp parallel for
 
@@ -1073,6 +1120,8 @@ PIC_INLINE bool Image::isValid()
 
 PIC_INLINE void Image::CopySubImage(Image *imgIn, int startX, int startY)
 {
+    InvalidateCache();
+
     if(imgIn == NULL) {
         return;
     }
@@ -1131,6 +1180,8 @@ PIC_INLINE void Image::CopySubImage(Image *imgIn, int startX, int startY)
 
 PIC_INLINE void Image::ScaleCosine()
 {
+    InvalidateCache();
+
     int half_h = height >> 1;
 
     #pragma omp parallel for
@@ -1151,7 +1202,9 @@ PIC_INLINE void Image::ScaleCosine()
 
 PIC_INLINE void Image::ApplyFunction(float(*func)(float))
 {
-    int size = width * height * channels;
+    InvalidateCache();
+
+    int size = this->size();
     #pragma omp parallel for
 
     for(int i = 0; i < size; i++) {
@@ -1159,6 +1212,15 @@ PIC_INLINE void Image::ApplyFunction(float(*func)(float))
     }
 }
 
+PIC_INLINE void Image::ApplyFunction(const ToneCurve *curve)
+{
+    InvalidateCache();
+
+    if(curve != NULL) {
+        curve->Apply(data, data, size());
+    }
+}
+
 PIC_INLINE void Image::sort()
 {
     int size = frames * width * height * channels;
@@ -1171,6 +1233,47 @@ PIC_INLINE void Image::sort()
     std::sort(dataTMP, dataTMP + size);
 }
 
+PIC_INLINE LuminanceStatistics *Image::getLuminanceStatistics(
+    Image *imgLum = NULL)
+{
+    if(data == NULL) {
+        return NULL;
+    }
+
+    bool bLum = (imgLum != NULL) && (imgLum != this) &&
+                (imgLum->channels == 1) && (imgLum->nPixels() == nPixels());
+
+    if((lumStats != NULL) && (!bLum)) {
+        return lumStats;
+    }
+
+    if(lumStats == NULL) {
+        lumStats = new LuminanceStatistics();
+    }
+
+    lumStats->Compute(data, nPixels(), channels, bLum ? imgLum->data : NULL);
+
+    if(bLum) {
+        imgLum->InvalidateCache();
+        imgLum->lumStats = new LuminanceStatistics(*lumStats);
+    }
+
+    return lumStats;
+}
+
+PIC_INLINE void Image::InvalidateCache()
+{
+    if(dataTMP != NULL) {
+        delete[] dataTMP;
+        dataTMP = NULL;
+    }
+
+    if(lumStats != NULL) {
+        delete lumStats;
+        lumStats = NULL;
+    }
+}
+
 PIC_INLINE float Image::getMedVal(float perCent = 0.5f)
 {
     if(dataTMP == NULL) {
@@ -1200,6 +1303,8 @@ PIC_INLINE float Image::getGT(float val)
 
 PIC_INLINE void Image::Blend(Image *img, Image *weight)
 {
+    InvalidateCache();
+
     if(img == NULL || weight == NULL) {
         return;
     }
@@ -1231,6 +1336,8 @@ PIC_INLINE void Image::Blend(Image *img, Image *weight)
 
 PIC_INLINE void Image::Minimum(Image *img)
 {
+    InvalidateCache();
+
     if(!SimilarType(img)) {
         return;
     }
@@ -1246,6 +1353,8 @@ PIC_INLINE void Image::Minimum(Image *img)
 
 PIC_INLINE void Image::Maximum(Image *img)
 {
+    InvalidateCache();
+
     if(!SimilarType(img)) {
         return;
     }
@@ -1261,6 +1370,8 @@ PIC_INLINE void Image::Maximum(Image *img)
 
 PIC_INLINE void Image::SetZero()
 {
+    InvalidateCache();
+
     int size = frames * height * width * channels;
 //	memset(data, 0, size * sizeof(float));
 
@@ -1273,6 +1384,8 @@ PIC_INLINE void Image::SetZero()
 
 PIC_INLINE void Image::SetRand()
 {
+    InvalidateCache();
+
     std::mt19937 m(rand() % 10000);
     int size = frames * height * width * channels;
 
@@ -1541,6 +1654,8 @@ PIC_INLINE float *Image::getLogMeanVal(BBox *box = NULL, float *ret = NULL)
 
 PIC_INLINE void Image::ConvertFromMask(bool *mask, int width, int height)
 {
+    InvalidateCache();
+
     if((mask == NULL) || (width < 1) || (height < 1)) {
         return;
     }
@@ -1612,6 +1727,8 @@ PIC_INLINE bool *Image::ConvertToMask(float *color = NULL, float threshold = 0.5
 PIC_INLINE void Image::ConvertFromQImage(const QImage *img,
         LDR_type typeLoad = LT_NONE, int readerCounter = 0)
 {
+    InvalidateCache();
+
     bool bAlpha = img->hasAlphaChannel();
 
     if(img->depth() == 1) {
@@ -1749,6 +1866,8 @@ PIC_INLINE QImage *Image::ConvertToQImage(QImage *image = NULL,
 PIC_INLINE bool Image::Read(std::string nameFile,
                                LDR_type typeLoad = LT_NOR_GAMMA)
 {
+    InvalidateCache();
+
     this->nameFile = nameFile;
 
     this->typeLoad = typeLoad;
@@ -2050,11 +2169,15 @@ PIC_INLINE void Image::operator =(const Image &a)
 
 PIC_INLINE void Image::operator =(const float &a)
 {
+    InvalidateCache();
+
     BufferAssign(data, size(), a);
 }
 
 PIC_INLINE void Image::operator +=(const float &a)
 {
+    InvalidateCache();
+
     BufferAdd(data, size(), a);
 }
 
@@ -2067,6 +2190,8 @@ PIC_INLINE Image Image::operator +(const float &a) const
 
 PIC_INLINE void Image::operator +=(const Image &a)
 {
+    InvalidateCache();
+
     if(SimilarType(&a)) {
         BufferAdd(data, a.data, size());
     } else {
@@ -2086,6 +2211,8 @@ PIC_INLINE Image Image::operator +(const Image &a) const
 
 PIC_INLINE void Image::operator *=(const float &a)
 {
+    InvalidateCache();
+
     BufferMul(data, size(), a);
 }
 
@@ -2098,6 +2225,8 @@ PIC_INLINE Image Image::operator *(const float &a) const
 
 PIC_INLINE void Image::operator *=(const Image &a)
 {
+    InvalidateCache();
+
     if(SimilarType(&a)) {
         BufferMul(data, a.data, size());
     } else {
@@ -2116,6 +2245,8 @@ PIC_INLINE Image Image::operator *(const Image &a) const
 
 PIC_INLINE void Image::operator -=(const float &a)
 {
+    InvalidateCache();
+
     BufferSub(data, size(), a);
 }
 
@@ -2128,6 +2259,8 @@ PIC_INLINE Image Image::operator -(const float &a) const
 
 PIC_INLINE void Image::operator -=(const Image &a)
 {
+    InvalidateCache();
+
     if(SimilarType(&a)) {
         BufferSub(data, a.data, size());
     } else {
@@ -2146,6 +2279,8 @@ PIC_INLINE Image Image::operator -(const Image &a) const
 
 PIC_INLINE void Image::operator /=(const float &a)
 {
+    InvalidateCache();
+
     BufferDiv(data, size(), a);
 }
 
@@ -2158,6 +2293,8 @@ PIC_INLINE Image Image::operator /(const float &a) const
 
 PIC_INLINE void Image::operator /=(const Image &a)
 {
+    InvalidateCache();
+
     if(SimilarType(&a)) {
         BufferDiv(data, a.data, size());
     } else {
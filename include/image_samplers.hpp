@@ -23,6 +23,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "image_samplers/image_sampler_bsplines.hpp"
 #include "image_samplers/image_sampler_gaussian.hpp"
 #include "image_samplers/image_sampler_nearest.hpp"
+#include "image_samplers/image_sampler_separable.hpp"
 
 #endif /* PIC_IMAGE_SAMPLERS_HPP */
 
@@ -0,0 +1,411 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+
+#ifndef PIC_IMAGE_SAMPLERS_IMAGE_SAMPLER_SEPARABLE_HPP
+#define PIC_IMAGE_SAMPLERS_IMAGE_SAMPLER_SEPARABLE_HPP
+
+#include <vector>
+
+#include "image.hpp"
+#include "util/bbox.hpp"
+#include "util/image_sampler.hpp"
+
+namespace pic {
+
+enum RESAMPLING_KERNEL{RK_NEAREST, RK_BILINEAR, RK_BICUBIC, RK_LANCZOS};
+
+/**
+ * @brief getResamplingKernelRadius returns the support radius of a kernel.
+ * @param kernel
+ * @return
+ */
+inline float getResamplingKernelRadius(RESAMPLING_KERNEL kernel)
+{
+    switch(kernel) {
+    case RK_NEAREST:
+        return 0.5f;
+
+    case RK_BILINEAR:
+        return 1.0f;
+
+    case RK_BICUBIC:
+        return 2.0f;
+
+    case RK_LANCZOS:
+        return 3.0f;
+    }
+
+    return 1.0f;
+}
+
+/**
+ * @brief EvaluateResamplingKernel evaluates a kernel at x.
+ * @param kernel
+ * @param x
+ * @return
+ */
+inline float EvaluateResamplingKernel(RESAMPLING_KERNEL kernel, float x)
+{
+    x = fabsf(x);
+
+    switch(kernel) {
+    case RK_NEAREST:
+        return x < 0.5f ? 1.0f : 0.0f;
+
+    case RK_BILINEAR:
+        return x < 1.0f ? (1.0f - x) : 0.0f;
+
+    case RK_BICUBIC: {
+        //Keys' cubic convolution with a = -0.5
+        if(x < 1.0f) {
+            return (1.5f * x - 2.5f) * x * x + 1.0f;
+        }
+
+        if(x < 2.0f) {
+            return ((-0.5f * x + 2.5f) * x - 4.0f) * x + 2.0f;
+        }
+
+        return 0.0f;
+    }
+
+    case RK_LANCZOS: {
+        if(x < 1e-6f) {
+            return 1.0f;
+        }
+
+        if(x < 3.0f) {
+            float px = C_PI * x;
+            return 3.0f * sinf(px) * sinf(px / 3.0f) / (px * px);
+        }
+
+        return 0.0f;
+    }
+    }
+
+    return 0.0f;
+}
+
+/**
+ * @brief The ResamplingTable class stores, for each output coordinate
+ * of a separable transform (scaling and translation), the input coordinates
+ * and the weights of the kernel's taps. An output coordinate i is mapped
+ * to the input coordinate u = i * scale + offset.
+ */
+class ResamplingTable
+{
+public:
+    int                         taps;
+    std::vector< int >          index;
+    std::vector< float >        weight;
+    std::vector< unsigned char> valid;
+
+    /**
+     * @brief ResamplingTable
+     */
+    ResamplingTable()
+    {
+        taps = 0;
+    }
+
+    /**
+     * @brief Compute computes the table. The nearest kernel rounds to the
+     * closest sample, as EvaluateResamplingKernel and SampleImageKernelUC
+     * do; the bilinear kernel matches ImageSamplerBilinear; bicubic and
+     * Lanczos kernels are widened when minifying in order to avoid aliasing.
+     * @param kernel
+     * @param nOut is the number of output samples.
+     * @param nIn is the number of input samples.
+     * @param scale
+     * @param offset
+     * @param bCheck if it is true, output samples mapped outside
+     * [0, nIn - 1] are marked as not valid.
+     */
+    void Compute(RESAMPLING_KERNEL kernel, int nOut, int nIn, float scale,
+                 float offset, bool bCheck = false)
+    {
+        float support = getResamplingKernelRadius(kernel);
+        float kScale = 1.0f;
+
+        if((kernel == RK_BICUBIC || kernel == RK_LANCZOS) && (fabsf(scale) > 1.0f)) {
+            kScale = fabsf(scale);
+            support *= kScale;
+        }
+
+        switch(kernel) {
+        case RK_NEAREST:
+            taps = 1;
+            break;
+
+        case RK_BILINEAR:
+            taps = 2;
+            break;
+
+        default:
+            taps = int(ceilf(support)) * 2;
+            break;
+        }
+
+        index.resize(nOut * taps);
+        weight.resize(nOut * taps);
+        valid.resize(nOut);
+
+        float nIn1 = float(nIn - 1);
+
+        for(int i = 0; i < nOut; i++) {
+            float u = float(i) * scale + offset;
+
+            valid[i] = (!bCheck) || ((u >= 0.0f) && (u <= nIn1));
+
+            int   *ind = &index[i * taps];
+            float *w   = &weight[i * taps];
+
+            switch(kernel) {
+            case RK_NEAREST: {
+                ind[0] = CLAMP(int(CLAMPi(u, 0.0f, nIn1) + 0.5f), nIn);
+                w[0] = 1.0f;
+            }
+            break;
+
+            case RK_BILINEAR: {
+                float uf = floorf(u);
+                int iu = int(uf);
+
+                ind[0] = CLAMP(iu, nIn);
+                ind[1] = CLAMP(iu + 1, nIn);
+                w[1] = u - uf;
+                w[0] = 1.0f - w[1];
+            }
+            break;
+
+            default: {
+                int start = int(floorf(u)) - (taps / 2) + 1;
+                float sum = 0.0f;
+
+                for(int k = 0; k < taps; k++) {
+                    int x = start + k;
+                    ind[k] = CLAMP(x, nIn);
+                    w[k] = EvaluateResamplingKernel(kernel, (u - float(x)) / kScale);
+                    sum += w[k];
+                }
+
+                if(sum > 0.0f) {
+                    for(int k = 0; k < taps; k++) {
+                        w[k] /= sum;
+                    }
+                }
+            }
+            break;
+            }
+        }
+    }
+};
+
+/**
+ * @brief ResampleSeparable resamples an image given a table for columns
+ * and a table for rows. Each output row is computed with a vertical pass,
+ * which runs on contiguous memory, followed by a horizontal pass.
+ * @param src
+ * @param dst
+ * @param tx
+ * @param ty
+ * @param box
+ */
+inline void ResampleSeparable(Image *src, Image *dst, ResamplingTable *tx,
+                              ResamplingTable *ty, BBox *box)
+{
+    int channels = src->channels;
+
+    //input columns required by the bounding box
+    int c0 = src->width;
+    int c1 = -1;
+
+    for(int i = box->x0; i < box->x1; i++) {
+        for(int k = 0; k < tx->taps; k++) {
+            int x = tx->index[i * tx->taps + k];
+            c0 = MIN(c0, x);
+            c1 = MAX(c1, x);
+        }
+    }
+
+    if(c1 < c0) {
+        return;
+    }
+
+    int n = (c1 - c0 + 1) * channels;
+    float *row = new float[n];
+
+    for(int j = box->y0; j < box->y1; j++) {
+        float *out = &dst->data[j * dst->ystride];
+
+        if(!ty->valid[j]) {
+            for(int i = box->x0 * channels; i < box->x1 * channels; i++) {
+                out[i] = 0.0f;
+            }
+
+            continue;
+        }
+
+        //vertical pass
+        int   *ind = &ty->index[j * ty->taps];
+        float *w   = &ty->weight[j * ty->taps];
+
+        float *r = &src->data[ind[0] * src->ystride + c0 * channels];
+        float w0 = w[0];
+
+        for(int i = 0; i < n; i++) {
+            row[i] = r[i] * w0;
+        }
+
+        for(int k = 1; k < ty->taps; k++) {
+            r = &src->data[ind[k] * src->ystride + c0 * channels];
+            float wk = w[k];
+
+            for(int i = 0; i < n; i++) {
+                row[i] += r[i] * wk;
+            }
+        }
+
+        //horizontal pass
+        for(int i = box->x0; i < box->x1; i++) {
+            float *tmp_out = &out[i * channels];
+
+            if(!tx->valid[i]) {
+                for(int c = 0; c < channels; c++) {
+                    tmp_out[c] = 0.0f;
+                }
+
+                continue;
+            }
+
+            int   *indx = &tx->index[i * tx->taps];
+            float *wx   = &tx->weight[i * tx->taps];
+
+            for(int c = 0; c < channels; c++) {
+                float val = 0.0f;
+
+                for(int k = 0; k < tx->taps; k++) {
+                    val += row[(indx[k] - c0) * channels + c] * wx[k];
+                }
+
+                tmp_out[c] = val;
+            }
+        }
+    }
+
+    delete[] row;
+}
+
+/**
+ * @brief SampleImageKernelUC samples an image in unnormalized coordinates
+ * [0,width-1]x[0,height-1] with a kernel; taps outside the image are clamped.
+ * @param img
+ * @param kernel
+ * @param x
+ * @param y
+ * @param vOut
+ */
+inline void SampleImageKernelUC(Image *img, RESAMPLING_KERNEL kernel, float x,
+                                float y, float *vOut)
+{
+    int channels = img->channels;
+
+    switch(kernel) {
+    case RK_NEAREST: {
+        int ix = CLAMP(int(x + 0.5f), img->width);
+        int iy = CLAMP(int(y + 0.5f), img->height);
+        float *p = &img->data[iy * img->ystride + ix * channels];
+
+        for(int c = 0; c < channels; c++) {
+            vOut[c] = p[c];
+        }
+    }
+    break;
+
+    case RK_BILINEAR: {
+        float xx = floorf(x);
+        float yy = floorf(y);
+        float dx = x - xx;
+        float dy = y - yy;
+
+        int ix = CLAMP(int(xx), img->width);
+        int iy = CLAMP(int(yy), img->height);
+        int ix1 = CLAMP(ix + 1, img->width);
+        int iy1 = CLAMP(iy + 1, img->height);
+
+        float *p0 = &img->data[iy  * img->ystride];
+        float *p1 = &img->data[iy1 * img->ystride];
+
+        for(int c = 0; c < channels; c++) {
+            vOut[c] = Bilinear<float>(p0[ix * channels + c], p0[ix1 * channels + c],
+                                      p1[ix * channels + c], p1[ix1 * channels + c],
+                                      dx, dy);
+        }
+    }
+    break;
+
+    default: {
+        const int maxTaps = 6;
+        int taps = int(getResamplingKernelRadius(kernel)) * 2;
+
+        int   indX[maxTaps], indY[maxTaps];
+        float wX[maxTaps], wY[maxTaps];
+
+        int sx = int(floorf(x)) - (taps / 2) + 1;
+        int sy = int(floorf(y)) - (taps / 2) + 1;
+
+        float sumX = 0.0f;
+        float sumY = 0.0f;
+
+        for(int k = 0; k < taps; k++) {
+            indX[k] = CLAMP(sx + k, img->width);
+            indY[k] = CLAMP(sy + k, img->height);
+
+            wX[k] = EvaluateResamplingKernel(kernel, x - float(sx + k));
+            wY[k] = EvaluateResamplingKernel(kernel, y - float(sy + k));
+
+            sumX += wX[k];
+            sumY += wY[k];
+        }
+
+        float norm = 1.0f / (sumX * sumY);
+
+        for(int c = 0; c < channels; c++) {
+            vOut[c] = 0.0f;
+        }
+
+        for(int l = 0; l < taps; l++) {
+            float *r = &img->data[indY[l] * img->ystride];
+
+            for(int k = 0; k < taps; k++) {
+                float w = wY[l] * wX[k] * norm;
+                float *p = &r[indX[k] * channels];
+
+                for(int c = 0; c < channels; c++) {
+                    vOut[c] += p[c] * w;
+                }
+            }
+        }
+    }
+    break;
+    }
+}
+
+} // end namespace pic
+
+#endif /* PIC_IMAGE_SAMPLERS_IMAGE_SAMPLER_SEPARABLE_HPP */
+
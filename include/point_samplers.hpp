@@ -22,8 +22,10 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "point_samplers/sampler_bridson.hpp"
 #include "point_samplers/sampler_dart_throwing.hpp"
 #include "point_samplers/sampler_monte_carlo.hpp"
+#include "point_samplers/sampler_poisson_grid.hpp"
 #include "point_samplers/sampler_random.hpp"
 #include "point_samplers/sampler_random_m.hpp"
+#include "point_samplers/sampler_cache.hpp"
 
 #endif /* PIC_POINT_SAMPLERS_HPP */
 
@@ -22,6 +22,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <random>
 #include "util/math.hpp"
 #include "util/vec.hpp"
+#include "point_samplers/sampler_poisson_grid.hpp"
 
 namespace pic {
 
@@ -63,17 +64,16 @@ void BridsonSampler(std::mt19937 *m, float radius, std::vector<float> &samples,
     }
 
     //Step 0: Creating an N-grid
-//	Grid<N> grid(0.999f * radius / sqrtf(float(N)));
+    PoissonGrid<N> grid(radius);
+    std::vector< Vec<N, float> > &vecSamples = grid.points;
 
     //Step 1: Initial sample
     Vec<N, float> x0 = randomPoint<N>(m);
 
-    std::vector< Vec<N, float> > vecSamples;
     std::vector<int> activeList;
 
-    vecSamples.push_back(x0);
+    grid.insert(x0);
     activeList.push_back(0);
-//	grid.setValue(0, x0);
 
     //Step 2: active list
     while(!activeList.empty()) {
@@ -93,12 +93,10 @@ void BridsonSampler(std::mt19937 *m, float radius, std::vector<float> &samples,
             //checking if the generated sample is in the bounding box
             if(insideVecBBox(x)) {
                 //checking if sample does not have neighbors in grid with distance radius
-                if(checkNeighborsBruteForce(vecSamples, x, radius)) {
-                    vecSamples.push_back(x);
-                    int value = vecSamples.size() - 1;
+                if(grid.check(x)) {
+                    int value = grid.insert(x);
 
                     activeList.push_back(value);
-                    //                grid.setValue(value, x);
                     bCheckSuccess = true;
                 }
             }
@@ -0,0 +1,255 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_POINT_SAMPLERS_SAMPLER_CACHE_HPP
+#define PIC_POINT_SAMPLERS_SAMPLER_CACHE_HPP
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "point_samplers/sampler_random_m.hpp"
+
+namespace pic {
+
+/**
+ * @brief The MRSamplersCache class is a process-wide, thread-safe cache of
+ * MRSamplers keyed by (type, window, nSamples, nLevels, nSamplers).
+ * Returned samplers are shared: they must not be updated or deleted.
+ * The cache can be saved to and loaded from a compact binary file.
+ */
+template<unsigned int N>
+class MRSamplersCache
+{
+protected:
+    std::mutex mutex;
+    std::map<std::vector<int>, MRSamplers<N> *> cache;
+
+    /**
+     * @brief MRSamplersCache
+     */
+    MRSamplersCache()
+    {
+    }
+
+    /**
+     * @brief insert adds samplers to the cache; it takes ownership and
+     * keeps the previous entry if the key is already present.
+     * @param ms
+     * @return
+     */
+    MRSamplers<N> *insert(MRSamplers<N> *ms)
+    {
+        std::vector<int> key = ms->getKey();
+        typename std::map<std::vector<int>, MRSamplers<N> *>::iterator it = cache.find(key);
+
+        if(it != cache.end()) {
+            delete ms;
+            return it->second;
+        }
+
+        cache[key] = ms;
+        return ms;
+    }
+
+public:
+
+    ~MRSamplersCache()
+    {
+        Clear();
+    }
+
+    /**
+     * @brief getInstance
+     * @return
+     */
+    static MRSamplersCache<N> *getInstance()
+    {
+        static MRSamplersCache<N> instance;
+        return &instance;
+    }
+
+    /**
+     * @brief get returns the samplers for a set of parameters; they are
+     * generated on the first request. Generation runs outside the lock,
+     * so misses on different keys do not wait for each other; if two
+     * threads miss the same key, the first inserted entry is kept.
+     * @param type
+     * @param window
+     * @param nSamples
+     * @param nLevels
+     * @param nSamplers
+     * @return
+     */
+    MRSamplers<N> *get(SAMPLER_TYPE type, Vec<N, int> window, int nSamples,
+                       int nLevels, int nSamplers)
+    {
+        std::vector<int> key = MRSamplers<N>::getKey(type, window, nSamples, nLevels, nSamplers);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            typename std::map<std::vector<int>, MRSamplers<N> *>::iterator it = cache.find(key);
+
+            if(it != cache.end()) {
+                return it->second;
+            }
+        }
+
+        MRSamplers<N> *ms = new MRSamplers<N>(type, window, nSamples, nLevels, nSamplers);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        return insert(ms);
+    }
+
+    /**
+     * @brief size
+     * @return
+     */
+    int size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return int(cache.size());
+    }
+
+    /**
+     * @brief Clear deletes all the samplers; pointers returned by get
+     * are no longer valid.
+     */
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        typename std::map<std::vector<int>, MRSamplers<N> *>::iterator it;
+        for(it = cache.begin(); it != cache.end(); it++) {
+            delete it->second;
+        }
+
+        cache.clear();
+    }
+
+    /**
+     * @brief Write saves the cache as: the magic "PICMRS", the version,
+     * N, the number of entries, and then each MRSamplers::WriteBinary.
+     * @param name
+     * @return
+     */
+    bool Write(std::string name)
+    {
+        FILE *file = fopen(name.c_str(), "wb");
+
+        if(file == NULL) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        char magic[8] = {'P', 'I', 'C', 'M', 'R', 'S', 1, char(N)};
+        fwrite(magic, 1, 8, file);
+
+        int32_t n = int32_t(cache.size());
+        fwrite(&n, sizeof(int32_t), 1, file);
+
+        bool bRet = true;
+        typename std::map<std::vector<int>, MRSamplers<N> *>::iterator it;
+        for(it = cache.begin(); it != cache.end(); it++) {
+            bRet = bRet && it->second->WriteBinary(file);
+        }
+
+        fclose(file);
+        return bRet;
+    }
+
+    /**
+     * @brief Read loads a file written by Write with a single read and
+     * merges its entries into the cache.
+     * @param name
+     * @return
+     */
+    bool Read(std::string name)
+    {
+        FILE *file = fopen(name.c_str(), "rb");
+
+        if(file == NULL) {
+            return false;
+        }
+
+        fseek(file, 0, SEEK_END);
+        long length = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        if(length < 12) {
+            fclose(file);
+            return false;
+        }
+
+        std::vector<char> buffer(length);
+        size_t nRead = fread(&buffer[0], 1, length, file);
+        fclose(file);
+
+        if(long(nRead) != length) {
+            return false;
+        }
+
+        const char *ptr = &buffer[0];
+        const char *end = ptr + length;
+
+        char magic[8] = {'P', 'I', 'C', 'M', 'R', 'S', 1, char(N)};
+        if(memcmp(ptr, magic, 8) != 0) {
+            return false;
+        }
+
+        ptr += 8;
+
+        int32_t n;
+        memcpy(&n, ptr, sizeof(int32_t));
+        ptr += sizeof(int32_t);
+
+        //entries are parsed outside the lock
+        std::vector< MRSamplers<N> * > entries;
+        bool bRet = true;
+
+        for(int i = 0; i < n; i++) {
+            MRSamplers<N> *ms = new MRSamplers<N>();
+
+            if(!ms->ReadBinary(ptr, end)) {
+                delete ms;
+                bRet = false;
+                break;
+            }
+
+            entries.push_back(ms);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for(unsigned int i = 0; i < entries.size(); i++) {
+            insert(entries[i]);
+        }
+
+        return bRet;
+    }
+};
+
+} // end namespace pic
+
+#endif /* PIC_POINT_SAMPLERS_SAMPLER_CACHE_HPP */
+
@@ -22,6 +22,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include "util/vec.hpp"
 #include "util/math.hpp"
+#include "point_samplers/sampler_poisson_grid.hpp"
 
 namespace pic {
 
@@ -38,35 +39,30 @@ template<unsigned int N>
 void DartThrowingSampler(std::mt19937 *m, float radius2, int nSamples,
                          std::vector<float> &samples)
 {
-    float dist2, delta;
     Vec<N, float> val;
 
-    int counter = 0;
+    PoissonGrid<N> grid(sqrtf(radius2));
 
-    while(counter < (nSamples * CONST_DARTTHROWING)) {
+    //samples of previous levels are obstacles as well
+    for(unsigned int i = 0; i < samples.size(); i += N) {
         for(unsigned int j = 0; j < N; j++) {
-            val[j] = ( Random((*m)()) * 2.0f - 1.0f);
+            val[j] = samples[i + j];
         }
 
-        bool bFlag = true;
-
-        for(unsigned int i = 0; i < samples.size(); i += N) {
-            dist2 = 0.0f;
-
-            for(unsigned int j = 0; j < N; j++) {
-                delta = val[j] - samples[i + j];
-                dist2 += delta * delta;
-            }
+        grid.insert(val);
+    }
 
-            bFlag = dist2 >= radius2;
+    int counter = 0;
 
-            if(!bFlag) {
-                break;
-            }
+    while(counter < (nSamples * CONST_DARTTHROWING)) {
+        for(unsigned int j = 0; j < N; j++) {
+            val[j] = ( Random((*m)()) * 2.0f - 1.0f);
         }
 
-        if(bFlag) {
-            if(val.lengthSq() <= 1.0f) {
+        if(val.lengthSq() <= 1.0f) {
+            if(grid.check(val)) {
+                grid.insert(val);
+
                 for(unsigned int j = 0; j < N; j++) {
                     samples.push_back(val[j]);
                 }
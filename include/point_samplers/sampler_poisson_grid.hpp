@@ -0,0 +1,461 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_POINT_SAMPLERS_SAMPLER_POISSON_GRID_HPP
+#define PIC_POINT_SAMPLERS_SAMPLER_POISSON_GRID_HPP
+
+#include <math.h>
+#include <vector>
+#include <random>
+
+#include "util/math.hpp"
+#include "util/vec.hpp"
+#include "util/point_samplers.hpp"
+
+namespace pic {
+
+/**
+ * @brief The PoissonGrid class is a background grid over [-1, 1]^N
+ * for Poisson-disk queries. Cells have size radius / sqrt(N), so each
+ * query visits a constant number of cells. Samples are linked per cell,
+ * so the grid also accepts sets that do not satisfy the disk
+ * condition. When bToroidal is true the domain wraps around, which
+ * produces tileable sets.
+ */
+template<unsigned int N>
+class PoissonGrid
+{
+protected:
+    float radius2, invCellSize;
+    int   nCells, range;
+    bool  bToroidal;
+
+    std::vector<int> head, next;
+    std::vector< Vec<N, int> > offsets;
+
+    /**
+     * @brief getCoord computes the cell coordinates of a point.
+     * @param x
+     * @return
+     */
+    Vec<N, int> getCoord(const Vec<N, float> &x)
+    {
+        Vec<N, int> c;
+
+        for(unsigned int i = 0; i < N; i++) {
+            int ci = int(floorf((x[i] + 1.0f) * invCellSize));
+            c[i] = CLAMPi(ci, 0, nCells - 1);
+        }
+
+        return c;
+    }
+
+    /**
+     * @brief getIndex
+     * @param c
+     * @return
+     */
+    int getIndex(const Vec<N, int> &c)
+    {
+        int index = 0;
+
+        for(int i = int(N) - 1; i >= 0; i--) {
+            index = index * nCells + c[i];
+        }
+
+        return index;
+    }
+
+public:
+    float radius;
+    std::vector< Vec<N, float> > points;
+
+    /**
+     * @brief PoissonGrid
+     * @param radius is the minimum distance between samples.
+     * @param bToroidal
+     * @param maxCells is the maximum number of cells of the grid.
+     */
+    PoissonGrid(float radius, bool bToroidal = false, int maxCells = 1 << 22)
+    {
+        this->radius = radius;
+        this->radius2 = radius * radius;
+        this->bToroidal = bToroidal;
+
+        float cellSize = radius / sqrtf(float(N));
+
+        nCells = MAX(int(ceilf(2.0f / cellSize)), 1);
+
+        //bounding the memory for tiny radii: cells get larger and
+        //simply hold more than one sample
+        while(powint(nCells, N) > maxCells && nCells > 1) {
+            nCells = (nCells + 1) >> 1;
+        }
+
+        invCellSize = float(nCells) / 2.0f;
+        cellSize = 2.0f / float(nCells);
+        range = MAX(int(ceilf(radius / cellSize)), 1);
+
+        if(bToroidal) {
+            range = MIN(range, nCells >> 1);
+        }
+
+        head.assign(powint(nCells, N), -1);
+
+        //neighborhood offsets
+        int side = range * 2 + 1;
+        int nOffsets = powint(side, N);
+
+        for(int i = 0; i < nOffsets; i++) {
+            Vec<N, int> o;
+            int tmp = i;
+
+            for(unsigned int j = 0; j < N; j++) {
+                o[j] = (tmp % side) - range;
+                tmp /= side;
+            }
+
+            offsets.push_back(o);
+        }
+    }
+
+    /**
+     * @brief distanceSq computes the squared distance between two points
+     * taking into account the wrapping of the domain.
+     * @param a
+     * @param b
+     * @return
+     */
+    float distanceSq(const Vec<N, float> &a, const Vec<N, float> &b)
+    {
+        float d2 = 0.0f;
+
+        for(unsigned int i = 0; i < N; i++) {
+            float d = fabsf(a[i] - b[i]);
+
+            if(bToroidal && d > 1.0f) {
+                d = 2.0f - d;
+            }
+
+            d2 += d * d;
+        }
+
+        return d2;
+    }
+
+    /**
+     * @brief check returns true if x has no samples closer than radius.
+     * @param x
+     * @return
+     */
+    bool check(const Vec<N, float> &x)
+    {
+        Vec<N, int> c = getCoord(x);
+
+        for(unsigned int i = 0; i < offsets.size(); i++) {
+            Vec<N, int> cn;
+            bool bInside = true;
+
+            for(unsigned int j = 0; j < N; j++) {
+                int v = c[j] + offsets[i][j];
+
+                if(bToroidal) {
+                    v = (v + nCells) % nCells;
+                } else {
+                    if(v < 0 || v >= nCells) {
+                        bInside = false;
+                        break;
+                    }
+                }
+
+                cn[j] = v;
+            }
+
+            if(!bInside) {
+                continue;
+            }
+
+            for(int k = head[getIndex(cn)]; k != -1; k = next[k]) {
+                if(distanceSq(x, points[k]) < radius2) {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief insert adds a sample to the grid.
+     * @param x
+     * @return It returns the index of the sample.
+     */
+    int insert(const Vec<N, float> &x)
+    {
+        int index = getIndex(getCoord(x));
+        int k = int(points.size());
+
+        points.push_back(x);
+        next.push_back(head[index]);
+        head[index] = k;
+
+        return k;
+    }
+};
+
+/**
+ * @brief PoissonGridSampler generates a maximal-ish Poisson-disk set in
+ * [-1, 1]^N using phase groups: cells are colored so that cells of the
+ * same color are at least radius apart, and all the cells of a color
+ * throw darts in parallel. Each cell draws from its own generator, seeded
+ * from m, the cell, and the pass, so the result does not depend on the
+ * number of threads.
+ * @param m
+ * @param radius
+ * @param samples
+ * @param kSamples is the number of darts per cell and pass.
+ * @param nPasses
+ * @param bToroidal generates a tileable set.
+ */
+template<unsigned int N>
+void PoissonGridSampler(std::mt19937 *m, float radius, std::vector<float> &samples,
+                        int kSamples = 8, int nPasses = 4, bool bToroidal = false)
+{
+    if(radius <= 0.0f) {
+        return;
+    }
+
+    kSamples = MAX(kSamples, 1);
+    nPasses = MAX(nPasses, 1);
+
+    //one sample per cell at most
+    float cellSize = radius / sqrtf(float(N));
+    int nCells = MAX(int(ceilf(2.0f / cellSize)), 1);
+    int range = int(ceilf(radius * float(nCells) / 2.0f - 1e-6f));
+
+    //on a torus, colors must tile the grid exactly
+    if(bToroidal) {
+        while((nCells % (range + 1)) != 0) {
+            nCells++;
+            range = int(ceilf(radius * float(nCells) / 2.0f - 1e-6f));
+        }
+    }
+
+    cellSize = 2.0f / float(nCells);
+    float radius2 = radius * radius;
+
+    int period = range + 1;
+    int nTotCells = powint(nCells, N);
+    int nColors = powint(period, N);
+    int side = range * 2 + 1;
+    int nOffsets = powint(side, N);
+
+    std::vector<float> pos(nTotCells * N);
+    std::vector<char> bFilled(nTotCells, 0);
+
+    unsigned int seed = (*m)();
+
+    for(int pass = 0; pass < nPasses; pass++) {
+        for(int color = 0; color < nColors; color++) {
+            //cells of this color
+            Vec<N, int> c0, nc;
+            int nColorCells = 1;
+            int tmp = color;
+
+            for(unsigned int j = 0; j < N; j++) {
+                c0[j] = tmp % period;
+                tmp /= period;
+                nc[j] = (nCells - c0[j] + period - 1) / period;
+                nColorCells *= MAX(nc[j], 0);
+            }
+
+            #pragma omp parallel for schedule(dynamic, 64)
+            for(int i = 0; i < nColorCells; i++) {
+                Vec<N, int> c;
+                int tmp_i = i;
+                int index = 0;
+
+                for(int j = int(N) - 1; j >= 0; j--) {
+                    c[j] = c0[j] + (tmp_i % nc[j]) * period;
+                    tmp_i /= nc[j];
+                }
+
+                for(int j = int(N) - 1; j >= 0; j--) {
+                    index = index * nCells + c[j];
+                }
+
+                if(bFilled[index]) {
+                    continue;
+                }
+
+                std::minstd_rand rnd(seed ^ (unsigned int)(index * 2654435761u) ^
+                                     (unsigned int)(pass * 40503u + 1));
+
+                for(int k = 0; k < kSamples; k++) {
+                    Vec<N, float> x;
+                    bool bInside = true;
+
+                    for(unsigned int j = 0; j < N; j++) {
+                        float u = float(rnd() - rnd.min()) / float(rnd.max() - rnd.min());
+                        x[j] = (float(c[j]) + u) * cellSize - 1.0f;
+                        bInside = bInside && (x[j] <= 1.0f);
+                    }
+
+                    if(!bInside) {
+                        continue;
+                    }
+
+                    bool bValid = true;
+
+                    for(int o = 0; o < nOffsets && bValid; o++) {
+                        int tmp_o = o;
+                        int nIndex = 0;
+                        int mul = 1;
+                        bool bCell = true;
+
+                        for(unsigned int j = 0; j < N; j++) {
+                            int v = c[j] + (tmp_o % side) - range;
+                            tmp_o /= side;
+
+                            if(bToroidal) {
+                                v = (v + nCells) % nCells;
+                            } else {
+                                if(v < 0 || v >= nCells) {
+                                    bCell = false;
+                                    break;
+                                }
+                            }
+
+                            nIndex += v * mul;
+                            mul *= nCells;
+                        }
+
+                        if(!bCell || !bFilled[nIndex]) {
+                            continue;
+                        }
+
+                        float *p = &pos[nIndex * N];
+                        float d2 = 0.0f;
+
+                        for(unsigned int j = 0; j < N; j++) {
+                            float d = fabsf(x[j] - p[j]);
+
+                            if(bToroidal && d > 1.0f) {
+                                d = 2.0f - d;
+                            }
+
+                            d2 += d * d;
+                        }
+
+                        bValid = d2 >= radius2;
+                    }
+
+                    if(bValid) {
+                        float *p = &pos[index * N];
+
+                        for(unsigned int j = 0; j < N; j++) {
+                            p[j] = x[j];
+                        }
+
+                        bFilled[index] = 1;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    for(int i = 0; i < nTotCells; i++) {
+        if(bFilled[i]) {
+            for(unsigned int j = 0; j < N; j++) {
+                samples.push_back(pos[i * N + j]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief PoissonTileSampler fills [-1, 1]^N with copies of a precomputed
+ * tileable Poisson-disk set. The set is scaled to the requested radius
+ * and shifted by a random offset, so every call returns a different
+ * pattern at almost no cost.
+ * @param m
+ * @param radius
+ * @param samples
+ */
+template<unsigned int N>
+void PoissonTileSampler(std::mt19937 *m, float radius, std::vector<float> &samples)
+{
+    if(radius <= 0.0f) {
+        return;
+    }
+
+    //radius of the tile for about 4096 samples
+    static const float tileRadius = 2.0f * POISSON_RHO / powf(4096.0f, 1.0f / float(N));
+
+    static const std::vector<float> tile = [] {
+        std::mt19937 m_tile(42);
+        std::vector<float> tmp;
+        PoissonGridSampler<N>(&m_tile, tileRadius, tmp, 16, 8, true);
+        return tmp;
+    }();
+
+    //the tile spans [-1, 1]^N, i.e. a side of 2 * scale once rescaled
+    float scale = radius / tileRadius;
+    float side = 2.0f * scale;
+
+    Vec<N, float> offset;
+    Vec<N, int> nTiles;
+    int nTot = 1;
+
+    for(unsigned int j = 0; j < N; j++) {
+        offset[j] = Random((*m)()) * side;
+        nTiles[j] = int(ceilf((2.0f + offset[j]) / side));
+        nTot *= nTiles[j];
+    }
+
+    for(int t = 0; t < nTot; t++) {
+        Vec<N, float> shift;
+        int tmp = t;
+
+        for(unsigned int j = 0; j < N; j++) {
+            shift[j] = float(tmp % nTiles[j]) * side - offset[j] - 1.0f;
+            tmp /= nTiles[j];
+        }
+
+        for(unsigned int i = 0; i < tile.size(); i += N) {
+            Vec<N, float> x;
+            bool bInside = true;
+
+            for(unsigned int j = 0; j < N; j++) {
+                x[j] = (tile[i + j] + 1.0f) * scale + shift[j];
+                bInside = bInside && (x[j] >= -1.0f) && (x[j] <= 1.0f);
+            }
+
+            if(bInside) {
+                for(unsigned int j = 0; j < N; j++) {
+                    samples.push_back(x[j]);
+                }
+            }
+        }
+    }
+}
+
+} // end namespace pic
+
+#endif /* PIC_POINT_SAMPLERS_SAMPLER_POISSON_GRID_HPP */
+
@@ -33,6 +33,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "point_samplers/sampler_monte_carlo.hpp"
 #include "point_samplers/sampler_dart_throwing.hpp"
 #include "point_samplers/sampler_bridson.hpp"
+#include "point_samplers/sampler_poisson_grid.hpp"
 
 namespace pic {
 
@@ -289,6 +290,14 @@ template <unsigned int N> PIC_INLINE void RandomSampler<N>::Update(
         case ST_PATTERN:
             PatternMethodSampler< N >(nSamples, samples);
             break;
+
+        case ST_POISSON_GRID:
+            PoissonGridSampler< N >(m, tmpRadius, samples);
+            break;
+
+        case ST_POISSON_TILE:
+            PoissonTileSampler< N >(m, tmpRadius, samples);
+            break;
         }
 
         levels.push_back(samples.size());
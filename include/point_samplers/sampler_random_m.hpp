@@ -19,6 +19,9 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #define PIC_POINT_SAMPLERS_SAMPLER_RANDOM_M_HPP
 
 #include <random>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
 #include "util/math.hpp"
 
 #include "point_samplers/sampler_random.hpp"
@@ -57,6 +60,47 @@ public:
     MRSamplers(SAMPLER_TYPE type, Vec<N, int> window, int nSamples, int nLevels,
                int nSamplers);
 
+    ~MRSamplers();
+
+    //samplers are owned; copies are not allowed
+    MRSamplers(const MRSamplers &) = delete;
+    MRSamplers &operator = (const MRSamplers &) = delete;
+
+    /**
+     * @brief getKey returns the parameters that generated the samplers:
+     * (type, window, nSamples, nLevels, nSamplers).
+     * @return
+     */
+    std::vector<int> getKey()
+    {
+        return getKey(type, oldWindow, oldSamples, nLevels, nSamplers);
+    }
+
+    /**
+     * @brief getKey
+     * @param type
+     * @param window
+     * @param nSamples
+     * @param nLevels
+     * @param nSamplers
+     * @return
+     */
+    static std::vector<int> getKey(SAMPLER_TYPE type, Vec<N, int> window,
+                                   int nSamples, int nLevels, int nSamplers)
+    {
+        std::vector<int> key;
+        key.push_back(int(type));
+
+        for(unsigned int i = 0; i < N; i++) {
+            key.push_back(window[i]);
+        }
+
+        key.push_back(nSamples);
+        key.push_back(nLevels);
+        key.push_back(nSamplers);
+        return key;
+    }
+
     /**
      * @brief update
      * @param window
@@ -85,17 +129,48 @@ public:
      * @return
      */
     bool Read(std::string name);
+
+    /**
+     * @brief WriteBinary appends the samplers to a binary file; integer
+     * coordinates are stored as 16-bit values.
+     * @param file
+     * @return
+     */
+    bool WriteBinary(FILE *file);
+
+    /**
+     * @brief ReadBinary reads the samplers from a memory buffer written by
+     * WriteBinary and advances ptr. On failure, neither the object nor
+     * ptr are modified.
+     * @param ptr
+     * @param end
+     * @return
+     */
+    bool ReadBinary(const char *&ptr, const char *end);
 };
 
 template <unsigned int N> PIC_INLINE MRSamplers<N>::MRSamplers()
 {
     samplers = NULL;
+    type = ST_BRIDSON;
     nSamplers = -1;
     oldWindow = 0;
     oldSamples = -1;
     nLevels = -1;
 }
 
+template <unsigned int N> PIC_INLINE MRSamplers<N>::~MRSamplers()
+{
+    if(samplers != NULL) {
+        for(int i = 0; i < nSamplers; i++) {
+            delete samplers[i];
+        }
+
+        delete[] samplers;
+        samplers = NULL;
+    }
+}
+
 template <unsigned int N> PIC_INLINE MRSamplers<N>::MRSamplers(
     SAMPLER_TYPE type, Vec<N, int> window, int nSamples, int nLevels, int nSamplers)
 {
@@ -121,7 +196,7 @@ PIC_INLINE bool MRSamplers<N>::update(Vec<N, int> window, int nSamples)
         return false;
     }
 
-    //#pragma omp parallel for
+    #pragma omp parallel for
     for(int i = 0; i < nSamplers; i++) {
         samplers[i]->Update(type, window, nSamples, nLevels);
     }
@@ -245,6 +320,151 @@ PIC_INLINE bool MRSamplers<N>::Write(std::string name)
     return true;
 }
 
+template <unsigned int N>
+PIC_INLINE bool MRSamplers<N>::WriteBinary(FILE *file)
+{
+    if(file == NULL || samplers == NULL) {
+        return false;
+    }
+
+    int32_t header[4 + N];
+    header[0] = int32_t(type);
+    header[1] = nSamplers;
+    header[2] = nLevels;
+    header[3] = oldSamples;
+
+    for(unsigned int i = 0; i < N; i++) {
+        header[4 + i] = oldWindow[i];
+    }
+
+    fwrite(header, sizeof(int32_t), 4 + N, file);
+
+    std::vector<int16_t> tmp;
+    for(int i = 0; i < nSamplers; i++) {
+        RandomSampler<N> *rs = samplers[i];
+
+        int32_t sizes[2];
+        sizes[0] = int32_t(rs->levelsR.size());
+        sizes[1] = int32_t(rs->samplesR.size());
+        fwrite(sizes, sizeof(int32_t), 2, file);
+
+        for(unsigned int j = 0; j < rs->levelsR.size(); j++) {
+            int32_t level = rs->levelsR[j];
+            fwrite(&level, sizeof(int32_t), 1, file);
+        }
+
+        tmp.resize(rs->samplesR.size());
+        for(unsigned int j = 0; j < rs->samplesR.size(); j++) {
+            tmp[j] = int16_t(rs->samplesR[j]);
+        }
+
+        if(!tmp.empty()) {
+            fwrite(&tmp[0], sizeof(int16_t), tmp.size(), file);
+        }
+    }
+
+    return true;
+}
+
+template <unsigned int N>
+PIC_INLINE bool MRSamplers<N>::ReadBinary(const char *&ptr, const char *end)
+{
+    int32_t header[4 + N];
+    const char *cur = ptr;
+
+    if((end - cur) < long(sizeof(header))) {
+        return false;
+    }
+
+    memcpy(header, cur, sizeof(header));
+    cur += sizeof(header);
+
+    if(header[1] < 1) {
+        return false;
+    }
+
+    Vec<N, int> window;
+    for(unsigned int i = 0; i < N; i++) {
+        window[i] = header[4 + i];
+    }
+
+    //loading into temporaries; the object is swapped only on success
+    std::vector< RandomSampler<N> * > tmp;
+    bool bRet = true;
+
+    for(int i = 0; (i < header[1]) && bRet; i++) {
+        int32_t sizes[2];
+        if((end - cur) < long(sizeof(sizes))) {
+            bRet = false;
+            break;
+        }
+
+        memcpy(sizes, cur, sizeof(sizes));
+        cur += sizeof(sizes);
+
+        long bytes = long(sizes[0]) * long(sizeof(int32_t)) +
+                     long(sizes[1]) * long(sizeof(int16_t));
+
+        if(sizes[0] < 0 || sizes[1] < 0 || (end - cur) < bytes) {
+            bRet = false;
+            break;
+        }
+
+        RandomSampler<N> *rs = new RandomSampler<N>();
+        rs->window = window;
+        rs->nSamples = header[3];
+
+        rs->levelsR.resize(sizes[0]);
+        for(int j = 0; j < sizes[0]; j++) {
+            int32_t level;
+            memcpy(&level, cur, sizeof(int32_t));
+            cur += sizeof(int32_t);
+            rs->levelsR[j] = level;
+        }
+
+        rs->samplesR.resize(sizes[1]);
+        for(int j = 0; j < sizes[1]; j++) {
+            int16_t value;
+            memcpy(&value, cur, sizeof(int16_t));
+            cur += sizeof(int16_t);
+            rs->samplesR[j] = value;
+        }
+
+        tmp.push_back(rs);
+    }
+
+    if(!bRet) {
+        for(unsigned int i = 0; i < tmp.size(); i++) {
+            delete tmp[i];
+        }
+
+        return false;
+    }
+
+    if(samplers != NULL) {
+        for(int i = 0; i < nSamplers; i++) {
+            delete samplers[i];
+        }
+
+        delete[] samplers;
+    }
+
+    type = SAMPLER_TYPE(header[0]);
+    nSamplers = header[1];
+    nLevels = header[2];
+    oldSamples = header[3];
+    oldWindow = window;
+
+    samplers = new RandomSampler<N> *[nSamplers];
+    for(int i = 0; i < nSamplers; i++) {
+        samplers[i] = tmp[i];
+    }
+
+    ptr = cur;
+
+    return true;
+}
+
 } // end namespace pic
 
 #endif /* PIC_POINT_SAMPLERS_SAMPLER_RANDOM_M_HPP */
@@ -21,6 +21,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "filtering/filter.hpp"
 #include "filtering/filter_luminance.hpp"
 #include "filtering/filter_drago_tmo.hpp"
+#include "filtering/filter_domain_transform.hpp"
 
 namespace pic {
 
@@ -36,11 +37,11 @@ namespace pic {
 Image *DragoTMO(Image *imgIn, float Ld_Max = 100.0f, float b = 0.95f, Image *imgOut = NULL)
 {
     //Computing luminance and its statistics
-    FilterLuminance filterLum;
-    Image *imgLum = filterLum.ProcessP(Single(imgIn), NULL);
+    Image *imgLum = new Image(imgIn->frames, imgIn->width, imgIn->height, 1);
+    LuminanceStatistics *stats = imgIn->getLuminanceStatistics(imgLum);
 
-    float Lw_Max = imgLum->getMaxVal()[0];
-    float Lw_a = imgLum->getMaxVal()[0];
+    float Lw_Max = stats->maxVal;
+    float Lw_a = stats->logMeanVal;
 
     //tone mapping
     FilterDragoTMO filterDrago(Ld_Max, b, Lw_Max, Lw_a);
@@ -51,6 +52,62 @@ Image *DragoTMO(Image *imgIn, float Ld_Max = 100.0f, float b = 0.95f, Image *img
     return imgOut;
 }
 
+/**
+ * @brief DragoLocalTMO tone maps an image using Drago et al. 2003 tone
+ * mapping operator on a base layer, which is the log-luminance filtered
+ * with the domain transform; the detail layer is kept as it is.
+ * @param imgIn
+ * @param Ld_Max
+ * @param b
+ * @param imgOut
+ * @param sigma_s is the spatial sigma; if it is negative, it is set to
+ * 2% of the largest side of imgIn.
+ * @param sigma_r is the range sigma in log10 units.
+ * @return
+ */
+Image *DragoLocalTMO(Image *imgIn, float Ld_Max = 100.0f, float b = 0.95f,
+                     Image *imgOut = NULL, float sigma_s = -1.0f,
+                     float sigma_r = 0.4f)
+{
+    //Computing luminance and its statistics
+    Image *imgLum = new Image(imgIn->frames, imgIn->width, imgIn->height, 1);
+    LuminanceStatistics *stats = imgIn->getLuminanceStatistics(imgLum);
+
+    float Lw_Max = stats->maxVal;
+    float Lw_a = stats->logMeanVal;
+
+    if(sigma_s <= 0.0f) {
+        sigma_s = 0.02f * float(MAX(imgIn->width, imgIn->height));
+    }
+
+    //base layer
+    float *data = imgLum->data;
+    int n = imgLum->size();
+
+    #pragma omp parallel for
+
+    for(int i = 0; i < n; i++) {
+        data[i] = logf(MAX(data[i], 1e-9f));
+    }
+
+    FilterDomainTransform::Execute(imgLum, NULL, imgLum, sigma_s,
+                                   sigma_r * logf(10.0f));
+
+    #pragma omp parallel for
+
+    for(int i = 0; i < n; i++) {
+        data[i] = expf(data[i]);
+    }
+
+    //tone mapping: the ratio imgIn / base keeps the detail layer
+    FilterDragoTMO filterDrago(Ld_Max, b, Lw_Max, Lw_a);
+    imgOut = filterDrago.ProcessP(Double(imgIn, imgLum), imgOut);
+
+    delete imgLum;
+
+    return imgOut;
+}
+
 } // end namespace pic
 
 #endif /* PIC_TONE_MAPPING_DRAGO_TMO_HPP */
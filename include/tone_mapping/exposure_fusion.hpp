@@ -27,101 +27,332 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 namespace pic {
 
 /**
- * @brief ExposureFusion
- * @param imgIn
- * @param wC
- * @param wE
- * @param wS
- * @param imgOut
- * @return
+ * @brief The ExposureFusionStream class blends exposures using Laplacian
+ * pyramids. Pyramids and temporary images are kept as workspaces, so they
+ * are reused across calls (e.g. for the frames of a bracketed video).
+ * Exposures can be processed as a whole with Process, or streamed one
+ * at a time with Reset, Add, and Reconstruct. Only the blend is fused
+ * (Pyramid::MulAdd); the pyramids of each exposure and of its weights
+ * are built with separate passes.
  */
-Image *ExposureFusion(ImageVec imgIn, float wC = 1.0f, float wE = 1.0f,
-                      float wS = 1.0f, Image *imgOut = NULL)
+class ExposureFusionStream
 {
-    int n = imgIn.size();
+protected:
+    FilterLuminance             flt_lum;
+    FilterExposureFusionWeights flt_weights;
+
+    Image    *lum, *acc;
+    ImageVec weights;
+
+    Pyramid  *pW, *pI, *pOut, *pAcc;
+
+    int      width, height, channels, counter;
+
+    /**
+     * @brief Release
+     */
+    void Release()
+    {
+        for(unsigned int i = 0; i < weights.size(); i++) {
+            delete weights[i];
+        }
+
+        weights.clear();
+
+        if(lum != NULL) {
+            delete lum;
+            lum = NULL;
+        }
+
+        if(acc != NULL) {
+            delete acc;
+            acc = NULL;
+        }
+
+        if(pW != NULL) {
+            delete pW;
+            pW = NULL;
+        }
+
+        if(pI != NULL) {
+            delete pI;
+            pI = NULL;
+        }
+
+        if(pOut != NULL) {
+            delete pOut;
+            pOut = NULL;
+        }
+
+        if(pAcc != NULL) {
+            delete pAcc;
+            pAcc = NULL;
+        }
+    }
 
-    if(n < 2) {
-        return imgOut;
+    /**
+     * @brief Allocate allocates workspaces; this happens only when
+     * the size of the input changes.
+     * @param width
+     * @param height
+     * @param channels
+     */
+    void Allocate(int width, int height, int channels)
+    {
+        if((this->width == width) && (this->height == height) &&
+           (this->channels == channels) && (pOut != NULL)) {
+            return;
+        }
+
+        Release();
+
+        this->width = width;
+        this->height = height;
+        this->channels = channels;
+
+        lum  = new Image(1, width, height, 1);
+        acc  = new Image(1, width, height, 1);
+
+        pW   = new Pyramid(width, height, 1, false);
+        pI   = new Pyramid(width, height, channels, true);
+        pOut = new Pyramid(width, height, channels, true);
+        pAcc = new Pyramid(width, height, 1, false);
     }
 
-    //Computing weights values
-    int channels = imgIn[0]->channels;
-    int width = imgIn[0]->width;
-    int height = imgIn[0]->height;
+    /**
+     * @brief getWeights computes the fusion weights of an exposure.
+     * @param img
+     * @param weights
+     * @return
+     */
+    Image *getWeights(Image *img, Image *weights)
+    {
+        lum = flt_lum.ProcessP(Single(img), lum);
+        return flt_weights.ProcessP(Double(lum, img), weights);
+    }
 
-    Image *lum     = new Image(1, width, height, 1);
-    Image *weights = new Image(1, width, height, 1);
-    Image *acc     = new Image(1, width, height, 1);
+    /**
+     * @brief RemoveNegative
+     * @param imgOut
+     */
+    void RemoveNegative(Image *imgOut)
+    {
+        #pragma omp parallel for
+        for(int i = 0; i < imgOut->size(); i++) {
+            imgOut->data[i] = MAX(imgOut->data[i], 0.0f);
+        }
+
+        imgOut->InvalidateCache();
+    }
 
-    acc->SetZero();
+public:
+
+    /**
+     * @brief ExposureFusionStream
+     * @param wC is the weight for contrast.
+     * @param wE is the weight for well-exposedness.
+     * @param wS is the weight for saturation.
+     */
+    ExposureFusionStream(float wC = 1.0f, float wE = 1.0f, float wS = 1.0f) :
+        flt_weights(wC, wE, wS)
+    {
+        lum  = NULL;
+        acc  = NULL;
+
+        pW   = NULL;
+        pI   = NULL;
+        pOut = NULL;
+        pAcc = NULL;
+
+        width = -1;
+        height = -1;
+        channels = -1;
+        counter = 0;
+    }
 
-    FilterLuminance flt_lum;
-    FilterExposureFusionWeights flt_weights(wC, wE, wS);
+    ~ExposureFusionStream()
+    {
+        Release();
+    }
 
-    for(int j = 0; j < n; j++) {
-        #ifdef PIC_DEBUG
-            printf("Processing image %d\n", j);
-        #endif
+    //workspaces are owned; copies are not allowed
+    ExposureFusionStream(const ExposureFusionStream &) = delete;
+    ExposureFusionStream &operator = (const ExposureFusionStream &) = delete;
+
+    /**
+     * @brief Reset starts a new streamed fusion.
+     * @param width
+     * @param height
+     * @param channels
+     */
+    void Reset(int width, int height, int channels)
+    {
+        Allocate(width, height, channels);
+
+        pOut->SetValue(0.0f);
+        pAcc->SetValue(0.0f);
+        counter = 0;
+    }
 
-        lum = flt_lum.ProcessP(Single(imgIn[j]), lum);
+    /**
+     * @brief Add blends an exposure into the current streamed fusion.
+     * Since the weights' sum is not known in advance, normalization is
+     * carried out per level in Reconstruct using the Gaussian pyramid of
+     * the weights' sum.
+     * @param img
+     */
+    void Add(Image *img)
+    {
+        if(img == NULL) {
+            return;
+        }
+
+        if(counter == 0) {
+            Reset(img->width, img->height, img->channels);
+        }
+
+        if((img->width != width) || (img->height != height) ||
+           (img->channels != channels)) {
+            return;
+        }
+
+        if(weights.empty()) {
+            weights.push_back(NULL);
+        }
+
+        weights[0] = getWeights(img, weights[0]);
+
+        pW->Update(weights[0]);
+        pI->Update(img);
+
+        pOut->MulAdd(pI, pW);
+        pAcc->Add(pW);
+
+        counter++;
+    }
 
-        weights = flt_weights.ProcessP(Double(lum, imgIn[j]), weights);
+    /**
+     * @brief Reconstruct returns the result of a streamed fusion.
+     * @param imgOut
+     * @return
+     */
+    Image *Reconstruct(Image *imgOut = NULL)
+    {
+        if(counter < 1) {
+            return imgOut;
+        }
+
+        //per level normalization
+        for(unsigned int i = 0; i < pOut->stack.size(); i++) {
+            Image *out = pOut->stack[i];
+            Image *w = pAcc->stack[i];
+            int n = out->nPixels();
+
+            #pragma omp parallel for
+            for(int j = 0; j < n; j++) {
+                float val = w->data[j];
+                val = val > 0.0f ? (1.0f / val) : 0.0f;
+
+                int c = j * channels;
+
+                for(int k = 0; k < channels; k++) {
+                    out->data[c + k] *= val;
+                }
+            }
+        }
+
+        counter = 0;
+
+        imgOut = pOut->Reconstruct(imgOut);
+        RemoveNegative(imgOut);
 
-        *acc += *weights;
+        return imgOut;
     }
 
-    for(int i=0; i<acc->size(); i++) {
-        acc->data[i] = acc->data[i] > 0.0f ? acc->data[i] : 1.0f;
-    }
+    /**
+     * @brief Process fuses a stack of exposures. Weights are computed once
+     * per exposure and the pyramids are blended with a fused multiply-add.
+     * @param imgIn
+     * @param imgOut
+     * @return
+     */
+    Image *Process(ImageVec imgIn, Image *imgOut = NULL)
+    {
+        int n = imgIn.size();
 
-    //Accumulation Pyramid
-    #ifdef PIC_DEBUG
-        printf("Blending...");
-    #endif
+        if(n < 2) {
+            return imgOut;
+        }
 
-    Pyramid *pW   = new Pyramid(width, height, 1, false);
-    Pyramid *pI   = new Pyramid(width, height, channels, true);
-    Pyramid *pOut = new Pyramid(width, height, channels, true);
+        Allocate(imgIn[0]->width, imgIn[0]->height, imgIn[0]->channels);
 
-    pOut->SetValue(0.0f);
+        //Computing weights values
+        while(int(weights.size()) < n) {
+            weights.push_back(NULL);
+        }
 
-    for(int j = 0; j < n; j++) {
-        lum = flt_lum.ProcessP(Single(imgIn[j]), lum);
-        weights = flt_weights.ProcessP(Double(lum, imgIn[j]), weights);
+        acc->SetZero();
 
-        //normalization
-        *weights /= *acc;
+        for(int j = 0; j < n; j++) {
+            #ifdef PIC_DEBUG
+                printf("Processing image %d\n", j);
+            #endif
 
-        pW->Update(weights);
-        pI->Update(imgIn[j]);
+            weights[j] = getWeights(imgIn[j], weights[j]);
 
-        pI->Mul(pW);
+            *acc += *weights[j];
+        }
 
-        pOut->Add(pI);
-    }
+        #pragma omp parallel for
+        for(int i = 0; i < acc->size(); i++) {
+            acc->data[i] = acc->data[i] > 0.0f ? (1.0f / acc->data[i]) : 1.0f;
+        }
 
-    #ifdef PIC_DEBUG
-        printf(" ok\n");
-    #endif
+        //Accumulation Pyramid
+        #ifdef PIC_DEBUG
+            printf("Blending...");
+        #endif
 
-    //final result
-    imgOut = pOut->Reconstruct(imgOut);
+        pOut->SetValue(0.0f);
 
-    #pragma omp parallel for
-    for(int i = 0; i < imgOut->size(); i++) {
-        imgOut->data[i] = MAX(imgOut->data[i], 0.0f);
-    }
+        for(int j = 0; j < n; j++) {
+            //normalization
+            *weights[j] *= *acc;
+
+            pW->Update(weights[j]);
+            pI->Update(imgIn[j]);
 
-    //free the memory
-    delete pW;
-    delete pOut;
-    delete pI;
+            pOut->MulAdd(pI, pW);
+        }
+
+        #ifdef PIC_DEBUG
+            printf(" ok\n");
+        #endif
 
-    delete acc;
-    delete weights;
-    delete lum;
+        //final result
+        imgOut = pOut->Reconstruct(imgOut);
+        RemoveNegative(imgOut);
 
-    return imgOut;
+        counter = 0;
+
+        return imgOut;
+    }
+};
+
+/**
+ * @brief ExposureFusion
+ * @param imgIn
+ * @param wC
+ * @param wE
+ * @param wS
+ * @param imgOut
+ * @return
+ */
+Image *ExposureFusion(ImageVec imgIn, float wC = 1.0f, float wE = 1.0f,
+                      float wS = 1.0f, Image *imgOut = NULL)
+{
+    ExposureFusionStream ef(wC, wE, wS);
+    return ef.Process(imgIn, imgOut);
 }
 
 } // end namespace pic
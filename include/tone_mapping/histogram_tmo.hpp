@@ -19,6 +19,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #define PIC_TONE_MAPPING_HISTOGRAM_TMO_HPP
 
 #include <vector>
+#include <algorithm>
 #include "image.hpp"
 #include "filtering/filter_luminance.hpp"
 
@@ -32,39 +33,49 @@ namespace pic {
  */
 inline Image *HistogramTMO(Image *imgOut, Image *imgIn)
 {
+    if(imgIn == NULL) {
+        return imgOut;
+    }
+
     if(imgOut == NULL) {
         imgOut = imgIn->Clone();
+    } else {
+        imgOut->Assign(imgIn);
     }
 
-    Image *lum    = FilterLuminance::Execute(imgIn, NULL, LT_CIE_LUMINANCE);	//Luminance
-    Image *lumOld = lum->Clone();
-    lum->sort();
-
-    int size = lum->width * lum->height * lum->frames;
+    //Luminance and its histogram
+    Image *lum = new Image(imgIn->frames, imgIn->width, imgIn->height, 1);
+    LuminanceStatistics *stats = imgIn->getLuminanceStatistics(lum);
 
     float table[257];
 
     for(int i = 1; i <= 256; i++) {
-        table[i] = lum->getMedVal(float(i) / 256.0f);
+        table[i] = stats->getPercentile(float(i) / 256.0f);
     }
 
-    table[0] = lum->getMinVal()[0];
+    table[0] = stats->minVal;
+
+    int size = lum->nPixels();
+    int channels = imgOut->channels;
 
-    std::vector<float> v(table, table + 257);
+    #pragma omp parallel for
 
     for(int i = 0; i < size; i++) {
-        std::vector<float>::iterator low = std::lower_bound(v.begin(), v.end(),
-                                           lum->data[i]);
-        lum->data[i] = powf(float(low - v.begin()) / 256.0f, 2.2f);
-    }
+        float L = lum->data[i];
+        float *low = std::lower_bound(table, table + 257, L);
+        float Ld = powf(float(low - table) / 256.0f, 2.2f);
+        float ratio = Ld / L;
+
+        float *p = &imgOut->data[i * channels];
 
-    *imgOut /= *lumOld;
-    *imgOut *= *lum;
+        for(int k = 0; k < channels; k++) {
+            p[k] *= ratio;
+        }
+    }
 
     imgOut->removeSpecials();
 
     delete lum;
-    delete lumOld;
 
     return imgOut;
 }
@@ -46,18 +46,18 @@ Image *LischinskiTMO(Image *imgIn, Image *imgOut = NULL,
         alpha = 0.5f;
     }
 
-    //extract luminance
-    FilterLuminance fltLum;
-    Image *lum = fltLum.ProcessP(Single(imgIn), NULL);
+    //extract luminance and its statistics
+    Image *lum = new Image(imgIn->frames, imgIn->width, imgIn->height, 1);
+    LuminanceStatistics *stats = imgIn->getLuminanceStatistics(lum);
 
     Image *lum_log = lum->Clone();
     lum_log->ApplyFunction(log2f);
 
-    float maxL = lum->getMaxVal()[0];
-    float minL = lum->getMinVal()[0];
+    float maxL = stats->maxVal;
+    float minL = stats->minVal;
     float maxL_log = log2f(maxL);
     float minL_log = log2f(minL);
-    float Lav = lum->getLogMeanVal()[0];
+    float Lav = stats->logMeanVal;
 
     int Z = int(ceilf(maxL_log - minL_log));
 
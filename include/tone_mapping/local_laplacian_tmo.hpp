@@ -0,0 +1,108 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_TONE_MAPPING_LOCAL_LAPLACIAN_TMO_HPP
+#define PIC_TONE_MAPPING_LOCAL_LAPLACIAN_TMO_HPP
+
+#include <algorithm>
+#include <vector>
+
+#include "filtering/filter_luminance.hpp"
+#include "filtering/filter_local_laplacian.hpp"
+
+namespace pic {
+
+/**
+ * @brief LocalLaplacianTMO tone maps an image filtering its log-luminance
+ * with the local Laplacian filter (Paris et al. 2011); the output
+ * log-luminance is then fitted to the display's dynamic range.
+ * @param imgIn
+ * @param imgOut
+ * @param alpha controls details; alpha < 1 enhances them.
+ * @param beta controls edges; beta < 1 compresses the range.
+ * @param sigma_r is the threshold between details and edges in log units;
+ * the default is log(2.5).
+ * @param nSamples
+ * @param Ld_range is the display's contrast ratio.
+ * @return
+ */
+Image *LocalLaplacianTMO(Image *imgIn, Image *imgOut = NULL, float alpha = 1.0f,
+                         float beta = 0.0f, float sigma_r = 0.9163f,
+                         int nSamples = 10, float Ld_range = 100.0f)
+{
+    if(imgIn == NULL) {
+        return NULL;
+    }
+
+    if(imgOut == NULL) {
+        imgOut = imgIn->Clone();
+    } else {
+        imgOut->Assign(imgIn);
+    }
+
+    //log-luminance
+    Image *lum = new Image(imgIn->frames, imgIn->width, imgIn->height, 1);
+    imgIn->getLuminanceStatistics(lum);
+    int n = lum->size();
+
+    #pragma omp parallel for
+
+    for(int i = 0; i < n; i++) {
+        lum->data[i] = logf(MAX(lum->data[i], 1e-9f));
+    }
+
+    Image *lumFlt = FilterLocalLaplacian::Execute(lum, NULL, sigma_r, alpha,
+                    beta, nSamples);
+
+    //fitting the output to the display using robust extrema
+    std::vector<float> tmp(lumFlt->data, lumFlt->data + n);
+    int i_lo = int(float(n - 1) * 0.005f);
+    int i_hi = int(float(n - 1) * 0.995f);
+    std::nth_element(tmp.begin(), tmp.begin() + i_lo, tmp.end());
+    float v_lo = tmp[i_lo];
+    std::nth_element(tmp.begin(), tmp.begin() + i_hi, tmp.end());
+    float v_hi = tmp[i_hi];
+
+    float range = v_hi - v_lo;
+    float scale = (range > logf(Ld_range)) ? logf(Ld_range) / range : 1.0f;
+
+    int channels = imgOut->channels;
+
+    #pragma omp parallel for
+
+    for(int i = 0; i < n; i++) {
+        float Ld = expf((lumFlt->data[i] - v_hi) * scale);
+        float ratio = Ld / expf(lum->data[i]);
+        float *p = &imgOut->data[i * channels];
+
+        for(int c = 0; c < channels; c++) {
+            p[c] *= ratio;
+        }
+    }
+
+    imgOut->removeSpecials();
+
+    delete lumFlt;
+    delete lum;
+
+    return imgOut;
+}
+
+} // end namespace pic
+
+#endif /* PIC_TONE_MAPPING_LOCAL_LAPLACIAN_TMO_HPP */
+
@@ -21,6 +21,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "util/string.hpp"
 #include "filtering/filter.hpp"
 #include "filtering/filter_bilateral_2ds.hpp"
+#include "filtering/filter_domain_transform.hpp"
 #include "filtering/filter_luminance.hpp"
 #include "filtering/filter_sigmoid_tmo.hpp"
 
@@ -89,25 +90,25 @@ inline float EstimateWhitePoint(float LMax, float LMin)
  * @param alpha
  * @param whitePoint
  * @param phi
+ * @param bDomainTransform uses the domain transform filter instead of
+ * the bilateral filter for computing the local adaptation.
  * @return
  */
 Image *ReinhardTMO(Image *imgIn, Image *imgOut = NULL, float alpha = 0.18f,
-                      float whitePoint = -1.0f, float phi = 8.0f)
+                      float whitePoint = -1.0f, float phi = 8.0f,
+                      bool bDomainTransform = false)
 {
     if(imgIn == NULL) {
         return NULL;
     }
 
-    if(imgOut == NULL) {
-        imgOut = imgIn->Clone();
-    }
-
-    //luminance image
-    Image *lum = FilterLuminance::Execute(imgIn, NULL, LT_CIE_LUMINANCE);
+    //luminance image and its statistics in a single pass
+    Image *lum = new Image(imgIn->frames, imgIn->width, imgIn->height, 1);
+    LuminanceStatistics *stats = imgIn->getLuminanceStatistics(lum);
 
-    float LMax = lum->getMaxVal()[0];
-    float LMin = lum->getMinVal()[0];
-    float LogAverage = lum->getLogMeanVal()[0];
+    float LMax = stats->maxVal;
+    float LMin = stats->minVal;
+    float LogAverage = stats->logMeanVal;
 
     if(alpha <= 0.0f) {
         alpha = EstimateAlpha(LMax, LMin, LogAverage);
@@ -125,20 +126,22 @@ Image *ReinhardTMO(Image *imgIn, Image *imgOut = NULL, float alpha = 0.18f,
 
     float sigma_r = powf(2.0f, phi) * alpha / (s_max * s_max);
 
-    Image *filteredLum = FilterBilateral2DS::Execute(lum, NULL, sigma_s,
-                            sigma_r);
+    Image *filteredLum;
 
-    lum->ApplyFunction(&SigmoidInv);
+    if(bDomainTransform) {
+        filteredLum = FilterDomainTransform::Execute(lum, NULL, NULL, sigma_s,
+                      sigma_r);
+    } else {
+        filteredLum = FilterBilateral2DS::Execute(lum, NULL, sigma_s,
+                      sigma_r);
+    }
 
     filteredLum->ApplyFunction(&SigmoidInv);
 
-    //Applying a sigmoid filter
+    //Applying a sigmoid filter; the HDR luminance is replaced by the LDR
+    //one in the same pass
     FilterSigmoidTMO fSTMO(SIG_TMO, alpha, whitePoint, LogAverage);
-    Image *tonemapped = fSTMO.Process(Double(lum, filteredLum), NULL);
-
-    //Removing HDR luminance and replacing it with LDR one
-    *imgOut /= *lum;
-    *imgOut *= *tonemapped;
+    imgOut = fSTMO.ProcessP(Double(imgIn, filteredLum), imgOut);
 
     imgOut->removeSpecials();
 
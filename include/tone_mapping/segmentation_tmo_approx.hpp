@@ -30,6 +30,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "filtering/filter_luminance.hpp"
 #include "filtering/filter_iterative.hpp"
 #include "filtering/filter_bilateral_2ds.hpp"
+#include "filtering/filter_domain_transform.hpp"
 
 namespace pic {
 
@@ -48,6 +49,7 @@ protected:
 
 public:
     float					minVal, maxVal;
+    bool					bDomainTransform;
 
     /**
      * @brief Segmentation
@@ -67,6 +69,8 @@ public:
         minVal = 0.0f;
 
         perCent  = 0.005f;
+
+        bDomainTransform = false;
     }
 
     ~Segmentation()
@@ -114,7 +118,8 @@ public:
         //Create filters
         if(fltIt == NULL) {
             fltBil = new FilterBilateral2DS(1.0f, nLayer);
-            fltIt  = new FilterIterative(fltBil, iterations);
+            fltIt  = new FilterIterative(fltBil, iterations,
+                                         fltBil->getKernelRadius());
         }
 
 #ifdef PIC_DEBUG
@@ -127,6 +132,22 @@ public:
         return imgOut;
     }
 
+    /**
+     * @brief SegmentationDomainTransform replaces the iterative bilateral
+     * filter with a single domain transform filter; iterating a bilateral
+     * filter with sigma_s = 1 for n times spreads as sigma_s = sqrt(n).
+     * @param imgIn
+     * @return
+     */
+    Image *SegmentationDomainTransform(Image *imgIn)
+    {
+        ComputeStatistics(imgIn);
+
+        FilterDomainTransform flt(sqrtf(float(iterations)), nLayer);
+
+        return flt.ProcessP(Single(imgIn), imgIn_flt);
+    }
+
     Image *SegmentationSuperPixels(Image *imgIn, int nSuperPixels = 4096)
     {
         Slic sp;
@@ -149,14 +170,16 @@ public:
             imgOut = new Image(1, imgIn->width, imgIn->height, 1);
         }
 
-        //Compute luminance
-        FilterLuminance::Execute(imgIn, imgOut, LT_CIE_LUMINANCE);
-
-        //Get min and max value
-        maxVal = imgOut->getMaxVal()[0];
-        minVal = imgOut->getMinVal()[0] + 1e-9f;
+        //Get min and max value of the luminance; imgIn may have been
+        //written directly since a previous call, so no cache is used
+        LuminanceStatistics stats;
+        stats.Compute(imgIn->data, imgIn->nPixels(), imgIn->channels, NULL);
+        maxVal = stats.maxVal;
+        minVal = stats.minVal + 1e-9f;
 
-        Image *imgIn_flt = SegmentationBilatearal(imgIn);
+        Image *imgIn_flt = bDomainTransform ?
+                           SegmentationDomainTransform(imgIn) :
+                           SegmentationBilatearal(imgIn);
 
         //Thresholding
         float minShift = floorf(log10f(minVal));
@@ -0,0 +1,428 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_TONE_MAPPING_VIDEO_TMO_HPP
+#define PIC_TONE_MAPPING_VIDEO_TMO_HPP
+
+#include <vector>
+#include <thread>
+
+#include "image.hpp"
+#include "util/luminance_statistics.hpp"
+#include "util/tone_curve.hpp"
+#include "filtering/filter_tone_curve.hpp"
+#include "filtering/filter_drago_tmo.hpp"
+#include "tone_mapping/reinhard_tmo.hpp"
+
+namespace pic {
+
+enum VIDEO_TMO_TYPE {VTMO_REINHARD, VTMO_DRAGO, VTMO_HISTOGRAM};
+
+/**
+ * @brief The VideoTMO class tone maps a stream of frames with a global
+ * operator: Reinhard et al. 2002 (global operator with white point), Drago
+ * et al. 2003, or histogram equalization. Statistics are computed on a
+ * subsampled grid and exponentially smoothed across frames to avoid
+ * flickering; the curve is compiled into a ToneCurve and applied together
+ * with the display encoding in a single pass. When the next frame is
+ * passed to Process, its statistics are computed by a worker thread while
+ * the current frame is mapped.
+ */
+class VideoTMO
+{
+protected:
+    VIDEO_TMO_TYPE type;
+
+    float alpha, whitePoint, Ld_Max, b;
+    float smoothing, tolerance;
+    int step;
+
+    //smoothed statistics
+    bool bState;
+    float key, LMax, LMin, zeroFraction;
+    std::vector<float> histogram, cdf;
+
+    //pipelined statistics
+    LuminanceStatistics stats[2];
+    int current;
+    Image *pending;
+
+    //curves
+    ToneCurve ratio, encoding;
+    bool bEncoding;
+    FilterToneCurve fltTone;
+    FilterDragoTMO fltDrago;
+
+    /**
+     * @brief ComputeStatistics
+     * @param stats
+     * @param img
+     * @param step
+     */
+    static void ComputeStatistics(LuminanceStatistics *stats, Image *img,
+                                  int step)
+    {
+        stats->ComputeGrid(img->data, img->width, img->height, img->channels,
+                           step);
+    }
+
+    /**
+     * @brief Blend blends in the log-domain a smoothed value with the
+     * value of the current frame.
+     * @param state
+     * @param value
+     * @param w
+     * @return
+     */
+    static float Blend(float state, float value, float w)
+    {
+        state = MAX(state, 1e-9f);
+        value = MAX(value, 1e-9f);
+        return expf((1.0f - w) * logf(state) + w * logf(value));
+    }
+
+    /**
+     * @brief UpdateState blends the statistics of the current frame into
+     * the smoothed state.
+     * @param s
+     */
+    void UpdateState(LuminanceStatistics *s)
+    {
+        if(s->nValid < 1) {
+            return;
+        }
+
+        float w = bState ? smoothing : 1.0f;
+
+        float frameMax = s->getPercentile(0.999f);
+        float frameMin = s->minPositiveVal > 0.0f ? s->minPositiveVal : 1e-9f;
+
+        key  = Blend(key,  s->logMeanVal, w);
+        LMax = Blend(LMax, frameMax, w);
+        LMin = Blend(LMin, frameMin, w);
+
+        if(type == VTMO_HISTOGRAM) {
+            int nBins = int(s->histogram.size());
+
+            if(int(histogram.size()) != nBins) {
+                histogram.assign(nBins, 0.0f);
+                cdf.assign(nBins + 1, 0.0f);
+            }
+
+            float invN = 1.0f / float(s->nValid);
+            float w1 = 1.0f - w;
+
+            for(int i = 0; i < nBins; i++) {
+                histogram[i] = w1 * histogram[i] + w * float(s->histogram[i]) * invN;
+            }
+
+            zeroFraction = w1 * zeroFraction +
+                           w * float(s->nValid - s->nPositive) * invN;
+
+            //cumulative distribution, normalized
+            float acc = zeroFraction;
+
+            for(int i = 0; i < nBins; i++) {
+                cdf[i] = acc;
+                acc += histogram[i];
+            }
+
+            cdf[nBins] = acc;
+
+            if(acc > 0.0f) {
+                float invAcc = 1.0f / acc;
+
+                for(int i = 0; i <= nBins; i++) {
+                    cdf[i] *= invAcc;
+                }
+            }
+        }
+
+        bState = true;
+    }
+
+    /**
+     * @brief CDF evaluates the smoothed cumulative distribution.
+     * @param L
+     * @return
+     */
+    float CDF(float L) const
+    {
+        if(L <= 0.0f) {
+            return cdf.empty() ? 0.0f : cdf[0];
+        }
+
+        int bin = LuminanceStatistics::getBin(L);
+
+        if(bin >= int(histogram.size())) {
+            return 1.0f;
+        }
+
+        float v0 = LuminanceStatistics::getBinValue(bin, 0.0f);
+        float v1 = LuminanceStatistics::getBinValue(bin + 1, 0.0f);
+        float t = (L - v0) / (v1 - v0);
+
+        return cdf[bin] + t * (cdf[bin + 1] - cdf[bin]);
+    }
+
+    /**
+     * @brief Compile compiles the ratio Ld / L from the smoothed state.
+     * @param s is the statistics of the current frame, used for the range.
+     */
+    void Compile(LuminanceStatistics *s)
+    {
+        float frameMin = (s->minPositiveVal > 0.0f) ? s->minPositiveVal : LMin;
+        float frameMax = s->maxVal;
+        float xMin = MIN(LMin, frameMin) * 0.25f;
+        float xMax = MAX(LMax, frameMax) * 4.0f;
+
+        switch(type) {
+        case VTMO_DRAGO: {
+            fltDrago.Update(Ld_Max, b, LMax, key);
+            fltDrago.CompileToneCurve(&ratio, tolerance, xMax);
+        }
+        break;
+
+        case VTMO_HISTOGRAM: {
+            ratio.Compile([this](float L) {
+                return powf(CDF(L), 2.2f) / L;
+            }, xMin, xMax, tolerance);
+        }
+        break;
+
+        default: {
+            float a = alpha;
+
+            if(a <= 0.0f) {
+                a = EstimateAlpha(LMax, LMin, key);
+            }
+
+            float scale = a / key;
+            float Lw = (whitePoint > 0.0f) ? whitePoint : LMax * scale;
+            float invLw2 = 1.0f / MAX(Lw * Lw, 1e-9f);
+
+            ratio.Compile([scale, invLw2](float L) {
+                float Lm = L * scale;
+                return scale * (1.0f + Lm * invLw2) / (1.0f + Lm);
+            }, xMin, xMax, tolerance);
+        }
+        break;
+        }
+    }
+
+    /**
+     * @brief Prepare computes the statistics (if they were not computed
+     * in the previous call), updates the state, compiles the curve, and
+     * starts the worker for the next frame.
+     * @param frame
+     * @param next
+     * @return
+     */
+    std::thread *Prepare(Image *frame, Image *next)
+    {
+        if(frame != pending) {
+            ComputeStatistics(&stats[current], frame, step);
+        }
+
+        UpdateState(&stats[current]);
+        Compile(&stats[current]);
+
+        fltTone.Update(&ratio, bEncoding ? &encoding : NULL);
+
+        if((next == NULL) || (next == frame) || (!next->isValid())) {
+            return NULL;
+        }
+
+        return new std::thread(&VideoTMO::ComputeStatistics,
+                               &stats[1 - current], next, step);
+    }
+
+    /**
+     * @brief Finish waits for the worker.
+     * @param worker
+     * @param next
+     */
+    void Finish(std::thread *worker, Image *next)
+    {
+        if(worker != NULL) {
+            worker->join();
+            delete worker;
+
+            current = 1 - current;
+            pending = next;
+        } else {
+            pending = NULL;
+        }
+    }
+
+public:
+
+    /**
+     * @brief VideoTMO
+     * @param type
+     * @param smoothing is the weight of the current frame in the
+     * exponential smoothing of statistics; 1 disables smoothing.
+     * @param step is the step of the grid where statistics are computed.
+     */
+    VideoTMO(VIDEO_TMO_TYPE type = VTMO_REINHARD, float smoothing = 0.1f,
+             int step = 4)
+    {
+        this->type = type;
+        this->smoothing = CLAMPi(smoothing, 1e-3f, 1.0f);
+        this->step = MAX(step, 1);
+
+        alpha = 0.18f;
+        whitePoint = -1.0f;
+        Ld_Max = 100.0f;
+        b = 0.95f;
+        tolerance = 1e-3f;
+
+        bEncoding = false;
+
+        Reset();
+    }
+
+    /**
+     * @brief Reset clears the temporal state, e.g. at a scene cut.
+     */
+    void Reset()
+    {
+        bState = false;
+        key = LMax = LMin = 1.0f;
+        zeroFraction = 0.0f;
+        histogram.clear();
+        cdf.clear();
+
+        current = 0;
+        pending = NULL;
+    }
+
+    /**
+     * @brief setReinhard sets the parameters of Reinhard et al. 2002.
+     * @param alpha is the key; if it is negative it is estimated.
+     * @param whitePoint is the white point in scaled luminance; if it is
+     * negative it is the robust maximum.
+     */
+    void setReinhard(float alpha = 0.18f, float whitePoint = -1.0f)
+    {
+        this->alpha = alpha;
+        this->whitePoint = whitePoint;
+    }
+
+    /**
+     * @brief setDrago sets the parameters of Drago et al. 2003.
+     * @param Ld_Max
+     * @param b
+     */
+    void setDrago(float Ld_Max = 100.0f, float b = 0.95f)
+    {
+        this->Ld_Max = Ld_Max;
+        this->b = b;
+    }
+
+    /**
+     * @brief setGamma sets a gamma display encoding; if gamma is not
+     * positive the encoding is disabled.
+     * @param gamma
+     */
+    void setGamma(float gamma = 2.2f)
+    {
+        bEncoding = gamma > 0.0f;
+
+        if(bEncoding) {
+            encoding.CompileGamma(gamma);
+        }
+    }
+
+    /**
+     * @brief setsRGB sets the sRGB display encoding.
+     */
+    void setsRGB()
+    {
+        bEncoding = true;
+        encoding.CompilesRGB();
+    }
+
+    /**
+     * @brief Process tone maps a frame.
+     * @param frame is the current frame.
+     * @param imgOut is the output; it can be reused across frames.
+     * @param next is the next frame, if available; its statistics are
+     * computed while frame is mapped, and they are used in the next call
+     * if that call receives next as frame.
+     * @return
+     */
+    Image *Process(Image *frame, Image *imgOut = NULL, Image *next = NULL)
+    {
+        if(frame == NULL) {
+            return imgOut;
+        }
+
+        if(!frame->isValid()) {
+            return imgOut;
+        }
+
+        std::thread *worker = Prepare(frame, next);
+
+        imgOut = fltTone.ProcessP(Single(frame), imgOut);
+
+        Finish(worker, next);
+
+        return imgOut;
+    }
+
+    /**
+     * @brief ProcessUChar tone maps a frame into an 8-bit buffer.
+     * @param frame
+     * @param dataOut
+     * @param next
+     * @return
+     */
+    unsigned char *ProcessUChar(Image *frame, unsigned char *dataOut = NULL,
+                                Image *next = NULL)
+    {
+        if(frame == NULL) {
+            return dataOut;
+        }
+
+        if(!frame->isValid()) {
+            return dataOut;
+        }
+
+        std::thread *worker = Prepare(frame, next);
+
+        dataOut = fltTone.ProcessUChar(frame, dataOut);
+
+        Finish(worker, next);
+
+        return dataOut;
+    }
+
+    /**
+     * @brief getKey returns the smoothed log-mean luminance.
+     * @return
+     */
+    float getKey()
+    {
+        return key;
+    }
+};
+
+} // end namespace pic
+
+#endif /* PIC_TONE_MAPPING_VIDEO_TMO_HPP */
+
@@ -71,13 +71,15 @@ inline Image *WardHistogramTMO(Image *imgIn, Image *imgOut = NULL,
     int fScaleX = int((2.0f * tanf(viewAngleWidth / 2.0f) / 0.01745f));
     int fScaleY = int((2.0f * tanf(viewAngleHeight / 2.0f) / 0.01745f));
 
-    Image *L = FilterLuminance::Execute(imgIn, NULL, LT_CIE_LUMINANCE);	//Luminance
+    Image *L = new Image(imgIn->frames, imgIn->width, imgIn->height, 1);
+    imgIn->getLuminanceStatistics(L);	//Luminance
 
     ImageSamplerBilinear isb;
     Image *Lscaled = FilterSampler2D::Execute(L, NULL, fScaleX, fScaleY, &isb);
 
-    float LMin = Lscaled->getGT(0.0f);
-    float LMax = Lscaled->getMaxVal()[0];
+    LuminanceStatistics *stats = Lscaled->getLuminanceStatistics();
+    float LMin = stats->minPositiveVal;
+    float LMax = stats->maxVal;
     float LlMax = logf(LMax);
     float LlMin = logf(LMin);
 
@@ -85,7 +87,7 @@ inline Image *WardHistogramTMO(Image *imgIn, Image *imgOut = NULL,
     float LldMin = logf(LdMin);
 
     Histogram h;
-    h.Calculate(Lscaled, VS_LOG_E, nBin);
+    h.Calculate(stats, VS_LOG_E, nBin);
     h.Ceiling();
 
     unsigned int *Pcum = NULL;
@@ -112,6 +114,7 @@ inline Image *WardHistogramTMO(Image *imgIn, Image *imgOut = NULL,
     imgOut->removeSpecials();
 
     delete L;
+    delete Lscaled;
     delete[] Pcum;
     delete[] x;
     delete[] PcumNorm;
@@ -22,10 +22,13 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "util/indexed_array.hpp"
 #include "util/bbox.hpp"
 #include "util/buffer.hpp"
+#include "util/running_extrema.hpp"
 #include "util/mask.hpp"
 #include "util/cached_table.hpp"
 #include "util/compability.hpp"
 //#include "util/convert_raw_to_images.hpp"
+#include "util/fast_dct.hpp"
+#include "util/fft.hpp"
 #include "util/file_lister.hpp"
 
 #ifndef PIC_DISABLE_OPENGL
@@ -47,7 +50,9 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "util/math.hpp"
 #include "util/matrix_3_x_3.hpp"
 #include "util/eigen_util.hpp"
+#include "util/ransac.hpp"
 #include "util/computer_vision_functions.hpp"
+#include "util/permutohedral_lattice.hpp"
 #include "util/point_samplers.hpp"
 #include "util/precomputed_difference_of_gaussians.hpp"
 #include "util/precomputed_gaussian.hpp"
@@ -55,6 +60,8 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "util/string.hpp"
 #include "util/tile.hpp"
 #include "util/tile_list.hpp"
+#include "util/tone_curve.hpp"
+#include "util/luminance_statistics.hpp"
 #include "util/vec.hpp"
 #include "util/warp_square_circle.hpp"
 #include "util/rasterizer.hpp"
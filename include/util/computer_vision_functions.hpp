@@ -24,6 +24,8 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include "util/math.hpp"
 
+#include "util/ransac.hpp"
+
 #include "features_matching/general_corner_detector.hpp"
 
 #ifndef PIC_DISABLE_EIGEN
@@ -44,7 +46,7 @@ namespace pic {
  * @param points1 is an array of points computed from image 2.
  * @return It returns the homography matrix H.
  */
-Eigen::Matrix3d estimateHomography(std::vector< Eigen::Vector2f > points0, std::vector< Eigen::Vector2f > points1)
+Eigen::Matrix3d estimateHomography(const std::vector< Eigen::Vector2f > &points0, const std::vector< Eigen::Vector2f > &points1)
 {
     Eigen::Matrix3d  H;
 
@@ -121,70 +123,108 @@ Eigen::Matrix3d estimateHomography(std::vector< Eigen::Vector2f > points0, std::
     return H / H(2, 2);
 }
 
+/**
+ * @brief The RansacHomography class is the homography model for Ransac;
+ * the residual is the squared transfer error of points0 into points1.
+ */
+class RansacHomography
+{
+protected:
+    std::vector< Eigen::Vector2f > sub_points0, sub_points1;
+
+public:
+    typedef Eigen::Matrix3d Type;
+
+    static const int nSubSet = 4;
+
+    /**
+     * @brief Estimate
+     * @param pts
+     * @param ind
+     * @param n
+     * @param H
+     * @return
+     */
+    bool Estimate(const RansacPoints &pts, const unsigned int *ind, int n, Type &H)
+    {
+        sub_points0.resize(n);
+        sub_points1.resize(n);
+
+        for(int i = 0; i < n; i++) {
+            unsigned int k = ind[i];
+            sub_points0[i] = Eigen::Vector2f(float(pts.x0[k]), float(pts.y0[k]));
+            sub_points1[i] = Eigen::Vector2f(float(pts.x1[k]), float(pts.y1[k]));
+        }
+
+        H = estimateHomography(sub_points0, sub_points1);
+
+        for(int i = 0; i < 9; i++) {
+            if(!std::isfinite(H.data()[i])) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Residuals
+     * @param H
+     * @param pts
+     * @param i0
+     * @param i1
+     * @param res
+     */
+    void Residuals(const Type &H, const RansacPoints &pts, unsigned int i0, unsigned int i1, double *res)
+    {
+        double h0 = H(0, 0), h1 = H(0, 1), h2 = H(0, 2);
+        double h3 = H(1, 0), h4 = H(1, 1), h5 = H(1, 2);
+        double h6 = H(2, 0), h7 = H(2, 1), h8 = H(2, 2);
+
+        const double *x0 = &pts.x0[i0];
+        const double *y0 = &pts.y0[i0];
+        const double *x1 = &pts.x1[i0];
+        const double *y1 = &pts.y1[i0];
+
+        int n = int(i1 - i0);
+
+        for(int i = 0; i < n; i++) {
+            double w = h6 * x0[i] + h7 * y0[i] + h8;
+
+            double dx = x1[i] - (h0 * x0[i] + h1 * y0[i] + h2) / w;
+            double dy = y1[i] - (h3 * x0[i] + h4 * y0[i] + h5) / w;
+
+            res[i] = dx * dx + dy * dy;
+        }
+    }
+};
+
 /**
  * @brief estimateHomographyRansac computes the homography such that: points1 = H * points0
  * @param points0
  * @param points1
  * @param inliers
- * @param maxIterations
+ * @param maxIterations is the maximum number of iterations; the actual number
+ * is adapted to the inlier ratio.
+ * @param threshold is the maximum squared transfer error of an inlier.
  * @return
  */
-Eigen::Matrix3d estimateHomographyRansac(std::vector< Eigen::Vector2f > points0, std::vector< Eigen::Vector2f > points1,
+Eigen::Matrix3d estimateHomographyRansac(const std::vector< Eigen::Vector2f > &points0, const std::vector< Eigen::Vector2f > &points1,
                                          std::vector< unsigned int > &inliers, unsigned int maxIterations = 100, double threshold = 4.0)
 {
     if(points0.size() < 5) {
         return estimateHomography(points0, points1);
     }
 
-    Eigen::Matrix3d H;
-    int nSubSet = 4;
-
-    std::mt19937 m(rand() % 10000);
-
-    unsigned int n = points0.size();
-
-    unsigned int *subSet = new unsigned int [nSubSet];
-
-    inliers.clear();
-
-    for(unsigned int i = 0; i < maxIterations; i++) {       
+    RansacPoints pts;
+    pts.Set(points0, points1);
 
-        getPermutation(m, subSet, nSubSet, n);
-
-        std::vector< Eigen::Vector2f > sub_points0;
-        std::vector< Eigen::Vector2f > sub_points1;
+    Ransac< RansacHomography > ransac(RansacHomography(), 0.99, true, true, rand() % 10000);
 
-        for(int j = 0; j < nSubSet; j++) {
-            sub_points0.push_back(points0[subSet[j]]);
-            sub_points1.push_back(points1[subSet[j]]);
-        }
-
-        Eigen::Matrix3d tmpH = estimateHomography(sub_points0, sub_points1);
-
-        //is it a good one?
-        std::vector< unsigned int > tmp_inliers;
-
-        for(unsigned int j = 0; j < n; j++) {
-            Eigen::Vector3d point_hom = Eigen::Vector3d(points0[j][0], points0[j][1], 1.0);
-            Eigen::Vector3d pp = tmpH * point_hom;
-            pp /= pp[2];
-
-            double dx = points1[j][0] - pp[0];
-            double dy = points1[j][1] - pp[1];
-            double squared_diff = (dx * dx) + (dy * dy);
-
-            if(squared_diff < threshold) {
-                tmp_inliers.push_back(j);
-            }
-        }
+    Eigen::Matrix3d H;
+    H.setZero();
 
-        //getting the inliers
-        if(tmp_inliers.size() > inliers.size()) {
-            H = tmpH;
-            inliers.clear();
-            inliers.assign(tmp_inliers.begin(), tmp_inliers.end());
-        }
-    }
+    ransac.Execute(pts, inliers, H, maxIterations, threshold);
 
     //improving estimate with inliers only
     if(inliers.size() > 3) {
@@ -213,7 +253,7 @@ Eigen::Matrix3d estimateHomographyRansac(std::vector< Eigen::Vector2f > points0,
  * @param points1 is an array of points computed from image 2.
  * @return It returns the fundamental matrix, F_{1,2}.
  */
-Eigen::Matrix3d estimateFundamental(std::vector< Eigen::Vector2f > points0, std::vector< Eigen::Vector2f > points1)
+Eigen::Matrix3d estimateFundamental(const std::vector< Eigen::Vector2f > &points0, const std::vector< Eigen::Vector2f > &points1)
 {
     Eigen::Matrix3d F;
 
@@ -291,72 +331,141 @@ Eigen::Matrix3d estimateFundamental(std::vector< Eigen::Vector2f > points0, std:
 }
 
 /**
- * @brief estimateFundamentalRansac
- * @param points0
- * @param points1
- * @param inliers
- * @param maxIterations
- * @return
+ * @brief The RansacFundamental class is the fundamental matrix model for
+ * Ransac; the residual is the distance of points1 from the epipolar line of
+ * points0.
  */
-Eigen::Matrix3d estimateFundamentalRansac(std::vector< Eigen::Vector2f > points0, std::vector< Eigen::Vector2f > points1,
-                                          std::vector< unsigned int > &inliers, unsigned int maxIterations = 100, double threshold = 0.01)
+class RansacFundamental
 {
-    if(points0.size() < 9) {
-        return estimateFundamental(points0, points1);
-    }
-
-    Eigen::Matrix3d F;
-    int nSubSet = 8;
-
-    std::mt19937 m(rand() % 10000);
-
-    unsigned int n = points0.size();
+protected:
+    std::vector< Eigen::Vector2f > sub_points0, sub_points1;
+
+public:
+    typedef Eigen::Matrix3d Type;
+
+    static const int nSubSet = 8;
+
+    /**
+     * @brief Estimate
+     * @param pts
+     * @param ind
+     * @param n
+     * @param F
+     * @return
+     */
+    bool Estimate(const RansacPoints &pts, const unsigned int *ind, int n, Type &F)
+    {
+        sub_points0.resize(n);
+        sub_points1.resize(n);
+
+        for(int i = 0; i < n; i++) {
+            unsigned int k = ind[i];
+            sub_points0[i] = Eigen::Vector2f(float(pts.x0[k]), float(pts.y0[k]));
+            sub_points1[i] = Eigen::Vector2f(float(pts.x1[k]), float(pts.y1[k]));
+        }
 
-    unsigned int *subSet = new unsigned int [nSubSet];
+        F = estimateFundamental(sub_points0, sub_points1);
 
-    inliers.clear();
+        for(int i = 0; i < 9; i++) {
+            if(!std::isfinite(F.data()[i])) {
+                return false;
+            }
+        }
 
-    for(unsigned int i = 0; i < maxIterations; i++) {
-        getPermutation(m, subSet, nSubSet, n);
+        return true;
+    }
 
-        std::vector< Eigen::Vector2f > sub_points0;
-        std::vector< Eigen::Vector2f > sub_points1;
+    /**
+     * @brief Residuals
+     * @param F
+     * @param pts
+     * @param i0
+     * @param i1
+     * @param res
+     */
+    void Residuals(const Type &F, const RansacPoints &pts, unsigned int i0, unsigned int i1, double *res)
+    {
+        double f0 = F(0, 0), f1 = F(0, 1), f2 = F(0, 2);
+        double f3 = F(1, 0), f4 = F(1, 1), f5 = F(1, 2);
+        double f6 = F(2, 0), f7 = F(2, 1), f8 = F(2, 2);
+
+        const double *x0 = &pts.x0[i0];
+        const double *y0 = &pts.y0[i0];
+        const double *x1 = &pts.x1[i0];
+        const double *y1 = &pts.y1[i0];
+
+        int n = int(i1 - i0);
+
+        for(int i = 0; i < n; i++) {
+            double l0 = f0 * x0[i] + f1 * y0[i] + f2;
+            double l1 = f3 * x0[i] + f4 * y0[i] + f5;
+            double l2 = f6 * x0[i] + f7 * y0[i] + f8;
+
+            double n0 = sqrt(l0 * l0 + l1 * l1);
+            double scale = n0 > 0.0 ? (1.0 / n0) : 1.0;
+
+            res[i] = fabs((l0 * x1[i] + l1 * y1[i] + l2) * scale);
+        }
+    }
+};
 
-        for(int j = 0; j < nSubSet; j++) {
-            unsigned int k = subSet[j];
-            sub_points0.push_back(points0[k]);
-            sub_points1.push_back(points1[k]);
+/**
+ * @brief The RansacEssential class is the essential matrix model for Ransac;
+ * points have to be normalized by the inverse of the intrinsics matrices.
+ */
+class RansacEssential: public RansacFundamental
+{
+public:
+
+    /**
+     * @brief Estimate
+     * @param pts
+     * @param ind
+     * @param n
+     * @param E
+     * @return
+     */
+    bool Estimate(const RansacPoints &pts, const unsigned int *ind, int n, Type &E)
+    {
+        if(!RansacFundamental::Estimate(pts, ind, n, E)) {
+            return false;
         }
 
-        Eigen::Matrix3d tmpF = estimateFundamental(sub_points0, sub_points1);
+        //enforcing two equal singular values
+        Eigen::JacobiSVD< Eigen::Matrix3d > svdE(E, Eigen::ComputeFullU | Eigen::ComputeFullV);
+        Eigen::Vector3d De(1.0, 1.0, 0.0);
 
-        //is it a good one?
-        std::vector< unsigned int > tmp_inliers;
+        E = svdE.matrixU() * DiagonalMatrix(De) * Eigen::Transpose< const Eigen::Matrix3d >(svdE.matrixV());
+        return true;
+    }
+};
 
-        for(unsigned int j = 0; j < n; j++) {
-            Eigen::Vector3d p0 = Eigen::Vector3d(points0[j][0], points0[j][1], 1.0);
-            Eigen::Vector3d p1 = Eigen::Vector3d(points1[j][0], points1[j][1], 1.0);
+/**
+ * @brief estimateFundamentalRansac
+ * @param points0
+ * @param points1
+ * @param inliers
+ * @param maxIterations is the maximum number of iterations; the actual number
+ * is adapted to the inlier ratio.
+ * @param threshold
+ * @return
+ */
+Eigen::Matrix3d estimateFundamentalRansac(const std::vector< Eigen::Vector2f > &points0, const std::vector< Eigen::Vector2f > &points1,
+                                          std::vector< unsigned int > &inliers, unsigned int maxIterations = 100, double threshold = 0.01)
+{
+    if(points0.size() < 9) {
+        return estimateFundamental(points0, points1);
+    }
 
-            Eigen::Vector3d tmpF_p0 = tmpF * p0;
-            double n0 = sqrt(tmpF_p0[0] * tmpF_p0[0] + tmpF_p0[1] * tmpF_p0[1]);
-            if(n0 >  0.0) {
-                tmpF_p0 /= n0;
-            }
+    RansacPoints pts;
+    pts.Set(points0, points1);
 
-            double err = fabs(tmpF_p0.dot(p1));
+    Ransac< RansacFundamental > ransac(RansacFundamental(), 0.99, true, true, rand() % 10000);
 
-            if(err < threshold){
-                tmp_inliers.push_back(j);
-            }
-        }
+    Eigen::Matrix3d F;
+    F.setZero();
 
-        //getting the inliers
-        if(tmp_inliers.size() > inliers.size()) {
-            F = tmpF;
-            inliers.clear();
-            inliers.assign(tmp_inliers.begin(), tmp_inliers.end());
-        }
-    }
+    ransac.Execute(pts, inliers, F, maxIterations, threshold);
 
     //improving estimate with inliers only
     if(inliers.size() > 7) {
@@ -379,6 +488,51 @@ Eigen::Matrix3d estimateFundamentalRansac(std::vector< Eigen::Vector2f > points0
     return F;
 }
 
+/**
+ * @brief estimateEssentialRansac estimates the essential matrix between two
+ * calibrated cameras.
+ * @param points0
+ * @param points1
+ * @param K0 is the intrinsics matrix of camera 0.
+ * @param K1 is the intrinsics matrix of camera 1.
+ * @param inliers
+ * @param maxIterations
+ * @param threshold is in normalized image coordinates.
+ * @return
+ */
+Eigen::Matrix3d estimateEssentialRansac(const std::vector< Eigen::Vector2f > &points0, const std::vector< Eigen::Vector2f > &points1,
+                                        Eigen::Matrix3d &K0, Eigen::Matrix3d &K1,
+                                        std::vector< unsigned int > &inliers, unsigned int maxIterations = 100, double threshold = 1e-3)
+{
+    Eigen::Matrix3d E;
+    E.setZero();
+
+    if(points0.size() < 9) {
+        return E;
+    }
+
+    Eigen::Matrix3d K0_inv = K0.inverse();
+    Eigen::Matrix3d K1_inv = K1.inverse();
+
+    std::vector< Eigen::Vector2f > n_points0, n_points1;
+
+    for(unsigned int i = 0; i < points0.size(); i++) {
+        Eigen::Vector3d p0 = K0_inv * Eigen::Vector3d(points0[i][0], points0[i][1], 1.0);
+        Eigen::Vector3d p1 = K1_inv * Eigen::Vector3d(points1[i][0], points1[i][1], 1.0);
+
+        n_points0.push_back(Eigen::Vector2f(float(p0[0] / p0[2]), float(p0[1] / p0[2])));
+        n_points1.push_back(Eigen::Vector2f(float(p1[0] / p1[2]), float(p1[1] / p1[2])));
+    }
+
+    RansacPoints pts;
+    pts.Set(n_points0, n_points1);
+
+    Ransac< RansacEssential > ransac(RansacEssential(), 0.99, true, true, rand() % 10000);
+    ransac.Execute(pts, inliers, E, maxIterations, threshold);
+
+    return E;
+}
+
 /**
  * @brief noramalizeFundamentalMatrix
  * @param F
@@ -410,7 +410,7 @@ Eigen::Matrix3f MatrixConvert(Matrix3x3 &mat)
  * @param points
  * @return
  */
-Eigen::Vector3f ComputeNormalizationTransform(std::vector< Eigen::Vector2f > &points)
+Eigen::Vector3f ComputeNormalizationTransform(const std::vector< Eigen::Vector2f > &points)
 {
     Eigen::Vector3f ret;
 
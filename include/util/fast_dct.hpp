@@ -0,0 +1,741 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_UTIL_FAST_DCT_HPP
+#define PIC_UTIL_FAST_DCT_HPP
+
+#include <string.h>
+
+#include "util/math.hpp"
+
+namespace pic {
+
+enum FAST_DCT_TYPE {FDT_AAN8, FDT_SPLIT, FDT_FFT, FDT_TABLE};
+
+/**
+ * @brief The FastDCT class computes orthonormal 1D DCT-II (forward)
+ * and DCT-III (inverse) transforms of size n. Every transform works on
+ * n elements of 'lanes' interleaved floats (element k of lane l is
+ * data[k * lanes + l]) so that the inner loops run over contiguous
+ * memory: channels, pixels of a row, or whole block rows at once.
+ * Sizes 8 and 16 use butterflies (AAN and an even/odd split on
+ * top of it), powers of two from 32 on use a radix-2 FFT, and any other
+ * size falls back to a separable cosine table.
+ */
+class FastDCT
+{
+protected:
+    int size;
+    FAST_DCT_TYPE type;
+    float *table, *scale;
+    float *tw_re, *tw_im;
+    int *perm;
+    FastDCT *half;
+
+    /**
+     * @brief ForwardAAN8 is the AAN butterfly for size 8; its outputs are
+     * scaled by 'scale' to obtain an orthonormal DCT-II.
+     * @param d
+     * @param lanes
+     */
+    void ForwardAAN8(float *d, int lanes)
+    {
+        float *d0 = d;
+        float *d1 = d0 + lanes;
+        float *d2 = d1 + lanes;
+        float *d3 = d2 + lanes;
+        float *d4 = d3 + lanes;
+        float *d5 = d4 + lanes;
+        float *d6 = d5 + lanes;
+        float *d7 = d6 + lanes;
+
+        for(int l = 0; l < lanes; l++) {
+            float t0 = d0[l] + d7[l];
+            float t7 = d0[l] - d7[l];
+            float t1 = d1[l] + d6[l];
+            float t6 = d1[l] - d6[l];
+            float t2 = d2[l] + d5[l];
+            float t5 = d2[l] - d5[l];
+            float t3 = d3[l] + d4[l];
+            float t4 = d3[l] - d4[l];
+
+            //even part
+            float t10 = t0 + t3;
+            float t13 = t0 - t3;
+            float t11 = t1 + t2;
+            float t12 = t1 - t2;
+
+            d0[l] = (t10 + t11) * scale[0];
+            d4[l] = (t10 - t11) * scale[4];
+
+            float z1 = (t12 + t13) * 0.707106781f;
+            d2[l] = (t13 + z1) * scale[2];
+            d6[l] = (t13 - z1) * scale[6];
+
+            //odd part
+            t10 = t4 + t5;
+            t11 = t5 + t6;
+            t12 = t6 + t7;
+
+            float z5 = (t10 - t12) * 0.382683433f;
+            float z2 = 0.541196100f * t10 + z5;
+            float z4 = 1.306562965f * t12 + z5;
+            float z3 = t11 * 0.707106781f;
+
+            float z11 = t7 + z3;
+            float z13 = t7 - z3;
+
+            d5[l] = (z13 + z2) * scale[5];
+            d3[l] = (z13 - z2) * scale[3];
+            d1[l] = (z11 + z4) * scale[1];
+            d7[l] = (z11 - z4) * scale[7];
+        }
+    }
+
+    /**
+     * @brief InverseAAN8 is the AAN butterfly for the inverse of size 8;
+     * its inputs are prescaled by 'scale + 8'.
+     * @param d
+     * @param lanes
+     */
+    void InverseAAN8(float *d, int lanes)
+    {
+        float *in_scale = scale + 8;
+
+        float *d0 = d;
+        float *d1 = d0 + lanes;
+        float *d2 = d1 + lanes;
+        float *d3 = d2 + lanes;
+        float *d4 = d3 + lanes;
+        float *d5 = d4 + lanes;
+        float *d6 = d5 + lanes;
+        float *d7 = d6 + lanes;
+
+        for(int l = 0; l < lanes; l++) {
+            //even part
+            float t0 = d0[l] * in_scale[0];
+            float t1 = d2[l] * in_scale[2];
+            float t2 = d4[l] * in_scale[4];
+            float t3 = d6[l] * in_scale[6];
+
+            float t10 = t0 + t2;
+            float t11 = t0 - t2;
+            float t13 = t1 + t3;
+            float t12 = (t1 - t3) * 1.414213562f - t13;
+
+            t0 = t10 + t13;
+            t3 = t10 - t13;
+            t1 = t11 + t12;
+            t2 = t11 - t12;
+
+            //odd part
+            float t4 = d1[l] * in_scale[1];
+            float t5 = d3[l] * in_scale[3];
+            float t6 = d5[l] * in_scale[5];
+            float t7 = d7[l] * in_scale[7];
+
+            float z13 = t6 + t5;
+            float z10 = t6 - t5;
+            float z11 = t4 + t7;
+            float z12 = t4 - t7;
+
+            t7 = z11 + z13;
+            t11 = (z11 - z13) * 1.414213562f;
+
+            float z5 = (z10 + z12) * 1.847759065f;
+            t10 = 1.082392200f * z12 - z5;
+            t12 = -2.613125930f * z10 + z5;
+
+            t6 = t12 - t7;
+            t5 = t11 - t6;
+            t4 = t10 + t5;
+
+            d0[l] = t0 + t7;
+            d7[l] = t0 - t7;
+            d1[l] = t1 + t6;
+            d6[l] = t1 - t6;
+            d2[l] = t2 + t5;
+            d5[l] = t2 - t5;
+            d4[l] = t3 + t4;
+            d3[l] = t3 - t4;
+        }
+    }
+
+    /**
+     * @brief MulTable computes out[k] = sum_n mat[k * n + n] * in[n].
+     * @param mat
+     * @param n
+     * @param in
+     * @param out
+     * @param lanes
+     */
+    static void MulTable(float *mat, int n, float *in, float *out, int lanes)
+    {
+        for(int k = 0; k < n; k++) {
+            float *o = &out[k * lanes];
+            float *m = &mat[k * n];
+
+            for(int l = 0; l < lanes; l++) {
+                o[l] = 0.0f;
+            }
+
+            for(int i = 0; i < n; i++) {
+                float *s = &in[i * lanes];
+                float c = m[i];
+
+                for(int l = 0; l < lanes; l++) {
+                    o[l] += c * s[l];
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief FFT is an in-place radix-2 FFT on bit-reversed input;
+     * sign selects the direction of the twiddles.
+     * @param re
+     * @param im
+     * @param lanes
+     * @param sign
+     */
+    void FFT(float *re, float *im, int lanes, float sign)
+    {
+        for(int len = 2; len <= size; len <<= 1) {
+            int half_len = len >> 1;
+            int step = size / len;
+
+            for(int i = 0; i < size; i += len) {
+                for(int j = 0; j < half_len; j++) {
+                    float wr = tw_re[j * step];
+                    float wi = tw_im[j * step] * sign;
+
+                    float *ar = &re[(i + j) * lanes];
+                    float *ai = &im[(i + j) * lanes];
+                    float *br = &re[(i + j + half_len) * lanes];
+                    float *bi = &im[(i + j + half_len) * lanes];
+
+                    for(int l = 0; l < lanes; l++) {
+                        float tr = br[l] * wr - bi[l] * wi;
+                        float ti = br[l] * wi + bi[l] * wr;
+                        br[l] = ar[l] - tr;
+                        bi[l] = ai[l] - ti;
+                        ar[l] += tr;
+                        ai[l] += ti;
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Release frees memory.
+     */
+    void Release()
+    {
+        if(table != NULL) {
+            delete[] table;
+            table = NULL;
+        }
+
+        if(scale != NULL) {
+            delete[] scale;
+            scale = NULL;
+        }
+
+        if(tw_re != NULL) {
+            delete[] tw_re;
+            tw_re = NULL;
+        }
+
+        if(tw_im != NULL) {
+            delete[] tw_im;
+            tw_im = NULL;
+        }
+
+        if(perm != NULL) {
+            delete[] perm;
+            perm = NULL;
+        }
+
+        if(half != NULL) {
+            delete half;
+            half = NULL;
+        }
+    }
+
+public:
+
+    /**
+     * @brief FastDCT
+     * @param size
+     */
+    FastDCT(int size = 8)
+    {
+        table = NULL;
+        scale = NULL;
+        tw_re = NULL;
+        tw_im = NULL;
+        perm = NULL;
+        half = NULL;
+        this->size = 0;
+
+        Setup(size);
+    }
+
+    ~FastDCT()
+    {
+        Release();
+    }
+
+    //tables are owned; copies are not allowed
+    FastDCT(const FastDCT &) = delete;
+    FastDCT &operator = (const FastDCT &) = delete;
+
+    /**
+     * @brief Setup precomputes the tables for a given size.
+     * @param size
+     */
+    void Setup(int size)
+    {
+        if(size < 1) {
+            size = 8;
+        }
+
+        if(size == this->size) {
+            return;
+        }
+
+        Release();
+
+        this->size = size;
+
+        int n = size;
+        double pi = 3.14159265358979323846;
+        double size2 = double(size * 2);
+
+        if(n == 8) {
+            type = FDT_AAN8;
+
+            //the AAN outputs are scaled by 1 / (2 * sqrt(2) * aan[k]) and the
+            //inverse inputs by aan[k] / (2 * sqrt(2)), where aan[0] = 1 and
+            //aan[k] = sqrt(2) * cos(k * pi / 16)
+            scale = new float[16];
+            for(int k = 0; k < 8; k++) {
+                double aan = (k == 0) ? 1.0 : sqrt(2.0) * cos(double(k) * pi / 16.0);
+                scale[k    ] = float(1.0 / (2.0 * sqrt(2.0) * aan));
+                scale[k + 8] = float(aan / (2.0 * sqrt(2.0)));
+            }
+            return;
+        }
+
+        bool bPow2 = (n & (n - 1)) == 0;
+
+        if(n == 16) {
+            type = FDT_SPLIT;
+
+            //the even coefficients are a DCT of half size, the odd
+            //ones a (n / 2) x (n / 2) cosine table
+            half = new FastDCT(n >> 1);
+
+            int h = n >> 1;
+            table = new float[h * h];
+            double s = sqrt(2.0 / double(n));
+
+            for(int k = 0; k < h; k++) {
+                for(int i = 0; i < h; i++) {
+                    double val = double((2 * k + 1) * (2 * i + 1));
+                    table[k * h + i] = float(s * cos(pi * val / size2));
+                }
+            }
+            return;
+        }
+
+        if(bPow2 && n >= 32) {
+            type = FDT_FFT;
+
+            tw_re = new float[n];
+            tw_im = new float[n];
+            scale = new float[n * 2];
+            perm = new int[n * 2];
+
+            for(int k = 0; k < n; k++) {
+                double a = -2.0 * pi * double(k) / double(n);
+                tw_re[k] = float(cos(a));
+                tw_im[k] = float(sin(a));
+
+                //orthonormal weight times the half-sample shift
+                double w = sqrt((k == 0 ? 1.0 : 2.0) / double(n));
+                double b = pi * double(k) / size2;
+                scale[k * 2    ] = float(w * cos(b));
+                scale[k * 2 + 1] = float(w * sin(b));
+            }
+
+            //bit-reversal of the even/odd reordering
+            int bits = 0;
+            while((1 << bits) < n) {
+                bits++;
+            }
+
+            int h = n >> 1;
+            for(int i = 0; i < n; i++) {
+                int r = 0;
+                for(int b = 0; b < bits; b++) {
+                    r |= ((i >> b) & 1) << (bits - 1 - b);
+                }
+
+                //perm[r] is the input sample feeding FFT slot r
+                perm[r] = (i < h) ? (2 * i) : (2 * (n - 1 - i) + 1);
+                perm[n + r] = i;
+            }
+            return;
+        }
+
+        type = FDT_TABLE;
+
+        table = new float[n * n];
+
+        for(int k = 0; k < n; k++) {
+            double s = sqrt((k == 0 ? 1.0 : 2.0) / double(n));
+            for(int i = 0; i < n; i++) {
+                double val = double(k * (2 * i + 1));
+                table[k * n + i] = float(s * cos(pi * val / size2));
+            }
+        }
+    }
+
+    /**
+     * @brief getSize
+     * @return
+     */
+    int getSize()
+    {
+        return size;
+    }
+
+    /**
+     * @brief getScratchSize returns the number of floats of the scratch
+     * buffer needed by Forward/Inverse.
+     * @param lanes
+     * @return
+     */
+    int getScratchSize(int lanes)
+    {
+        return size * lanes * 2;
+    }
+
+    /**
+     * @brief getBlockScratchSize returns the number of floats of the scratch
+     * buffer needed by Forward2D/Inverse2D.
+     * @param channels
+     * @return
+     */
+    int getBlockScratchSize(int channels)
+    {
+        return size * size * channels * 3;
+    }
+
+    /**
+     * @brief Forward computes the orthonormal DCT-II in-place.
+     * @param data is an array of size * lanes floats.
+     * @param lanes is the number of interleaved signals.
+     * @param tmp is a scratch buffer of getScratchSize(lanes) floats.
+     */
+    void Forward(float *data, int lanes, float *tmp)
+    {
+        int n = size;
+
+        switch(type) {
+        case FDT_AAN8: {
+            ForwardAAN8(data, lanes);
+        }
+        break;
+
+        case FDT_SPLIT: {
+            int h = n >> 1;
+            float *s = tmp;
+            float *d = tmp + h * lanes;
+
+            for(int i = 0; i < h; i++) {
+                float *a = &data[i * lanes];
+                float *b = &data[(n - 1 - i) * lanes];
+                float *si = &s[i * lanes];
+                float *di = &d[i * lanes];
+
+                for(int l = 0; l < lanes; l++) {
+                    si[l] = (a[l] + b[l]) * 0.707106781f;
+                    di[l] = a[l] - b[l];
+                }
+            }
+
+            half->Forward(s, lanes, NULL);
+
+            for(int k = 0; k < h; k++) {
+                float *o = &data[(2 * k) * lanes];
+                float *si = &s[k * lanes];
+
+                for(int l = 0; l < lanes; l++) {
+                    o[l] = si[l];
+                }
+            }
+
+            //odd coefficients
+            for(int k = 0; k < h; k++) {
+                float *o = &data[(2 * k + 1) * lanes];
+                float *m = &table[k * h];
+
+                for(int l = 0; l < lanes; l++) {
+                    o[l] = 0.0f;
+                }
+
+                for(int i = 0; i < h; i++) {
+                    float *di = &d[i * lanes];
+                    float c = m[i];
+
+                    for(int l = 0; l < lanes; l++) {
+                        o[l] += c * di[l];
+                    }
+                }
+            }
+        }
+        break;
+
+        case FDT_FFT: {
+            float *re = tmp;
+            float *im = tmp + n * lanes;
+
+            for(int r = 0; r < n; r++) {
+                float *src = &data[perm[r] * lanes];
+                float *dr = &re[r * lanes];
+                float *di = &im[r * lanes];
+
+                for(int l = 0; l < lanes; l++) {
+                    dr[l] = src[l];
+                    di[l] = 0.0f;
+                }
+            }
+
+            FFT(re, im, lanes, 1.0f);
+
+            //X[k] = w_k * Re(exp(-i * pi * k / (2n)) * V[k])
+            for(int k = 0; k < n; k++) {
+                float c = scale[k * 2];
+                float s = scale[k * 2 + 1];
+                float *o = &data[k * lanes];
+                float *vr = &re[k * lanes];
+                float *vi = &im[k * lanes];
+
+                for(int l = 0; l < lanes; l++) {
+                    o[l] = c * vr[l] + s * vi[l];
+                }
+            }
+        }
+        break;
+
+        case FDT_TABLE: {
+            memcpy(tmp, data, sizeof(float) * n * lanes);
+            MulTable(table, n, tmp, data, lanes);
+        }
+        break;
+        }
+    }
+
+    /**
+     * @brief Inverse computes the orthonormal DCT-III in-place.
+     * @param data is an array of size * lanes floats.
+     * @param lanes is the number of interleaved signals.
+     * @param tmp is a scratch buffer of getScratchSize(lanes) floats.
+     */
+    void Inverse(float *data, int lanes, float *tmp)
+    {
+        int n = size;
+
+        switch(type) {
+        case FDT_AAN8: {
+            InverseAAN8(data, lanes);
+        }
+        break;
+
+        case FDT_SPLIT: {
+            int h = n >> 1;
+            float *e = tmp;
+            float *o = tmp + h * lanes;
+
+            for(int k = 0; k < h; k++) {
+                float *src = &data[(2 * k) * lanes];
+                float *ek = &e[k * lanes];
+
+                for(int l = 0; l < lanes; l++) {
+                    ek[l] = src[l] * 0.707106781f;
+                }
+            }
+
+            half->Inverse(e, lanes, NULL);
+
+            //odd part: transpose of the odd table
+            for(int i = 0; i < h; i++) {
+                float *oi = &o[i * lanes];
+
+                for(int l = 0; l < lanes; l++) {
+                    oi[l] = 0.0f;
+                }
+
+                for(int k = 0; k < h; k++) {
+                    float *src = &data[(2 * k + 1) * lanes];
+                    float c = table[k * h + i];
+
+                    for(int l = 0; l < lanes; l++) {
+                        oi[l] += c * src[l];
+                    }
+                }
+            }
+
+            for(int i = 0; i < h; i++) {
+                float *a = &data[i * lanes];
+                float *b = &data[(n - 1 - i) * lanes];
+                float *ei = &e[i * lanes];
+                float *oi = &o[i * lanes];
+
+                for(int l = 0; l < lanes; l++) {
+                    a[l] = ei[l] + oi[l];
+                    b[l] = ei[l] - oi[l];
+                }
+            }
+        }
+        break;
+
+        case FDT_FFT: {
+            float *re = tmp;
+            float *im = tmp + n * lanes;
+
+            //W[k] = w_k * X[k] * exp(i * pi * k / (2n)), loaded bit-reversed
+            for(int r = 0; r < n; r++) {
+                int k = perm[n + r];
+                float c = scale[k * 2];
+                float s = scale[k * 2 + 1];
+                float *src = &data[k * lanes];
+                float *dr = &re[r * lanes];
+                float *di = &im[r * lanes];
+
+                for(int l = 0; l < lanes; l++) {
+                    dr[l] = c * src[l];
+                    di[l] = s * src[l];
+                }
+            }
+
+            FFT(re, im, lanes, -1.0f);
+
+            //x[2i] = Re(y[i]) and x[2i + 1] = Re(y[n - 1 - i])
+            int h = n >> 1;
+            for(int i = 0; i < n; i++) {
+                int j = (i < h) ? (2 * i) : (2 * (n - 1 - i) + 1);
+                float *dst = &data[j * lanes];
+                float *src = &re[i * lanes];
+
+                for(int l = 0; l < lanes; l++) {
+                    dst[l] = src[l];
+                }
+            }
+        }
+        break;
+
+        case FDT_TABLE: {
+            memcpy(tmp, data, sizeof(float) * n * lanes);
+
+            for(int i = 0; i < n; i++) {
+                float *o = &data[i * lanes];
+
+                for(int l = 0; l < lanes; l++) {
+                    o[l] = 0.0f;
+                }
+
+                for(int k = 0; k < n; k++) {
+                    float *s = &tmp[k * lanes];
+                    float c = table[k * n + i];
+
+                    for(int l = 0; l < lanes; l++) {
+                        o[l] += c * s[l];
+                    }
+                }
+            }
+        }
+        break;
+        }
+    }
+
+    /**
+     * @brief Forward2D computes the orthonormal 2D DCT-II of a block in-place.
+     * Both passes run with size * channels lanes: the block is transposed
+     * once so that the row pass works along its first index too.
+     * @param block is a size x size block of 'channels' interleaved floats
+     * stored by rows.
+     * @param channels
+     * @param tmp is a scratch buffer of getBlockScratchSize(channels) floats.
+     */
+    void Forward2D(float *block, int channels, float *tmp)
+    {
+        int lanes = size * channels;
+        float *tr = tmp + size * lanes * 2;
+
+        Transpose(block, tr, channels);
+        Forward(tr, lanes, tmp);
+        Transpose(tr, block, channels);
+        Forward(block, lanes, tmp);
+    }
+
+    /**
+     * @brief Inverse2D computes the orthonormal 2D DCT-III of a block in-place.
+     * @param block is a size x size block of 'channels' interleaved floats
+     * stored by rows.
+     * @param channels
+     * @param tmp is a scratch buffer of getBlockScratchSize(channels) floats.
+     */
+    void Inverse2D(float *block, int channels, float *tmp)
+    {
+        int lanes = size * channels;
+        float *tr = tmp + size * lanes * 2;
+
+        Inverse(block, lanes, tmp);
+        Transpose(block, tr, channels);
+        Inverse(tr, lanes, tmp);
+        Transpose(tr, block, channels);
+    }
+
+    /**
+     * @brief Transpose transposes a size x size block of pixels.
+     * @param src
+     * @param dst
+     * @param channels
+     */
+    void Transpose(float *src, float *dst, int channels)
+    {
+        for(int y = 0; y < size; y++) {
+            for(int x = 0; x < size; x++) {
+                float *s = &src[(y * size + x) * channels];
+                float *d = &dst[(x * size + y) * channels];
+
+                for(int c = 0; c < channels; c++) {
+                    d[c] = s[c];
+                }
+            }
+        }
+    }
+};
+
+} // end namespace pic
+
+#endif /* PIC_UTIL_FAST_DCT_HPP */
+
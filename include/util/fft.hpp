@@ -0,0 +1,316 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_UTIL_FFT_HPP
+#define PIC_UTIL_FFT_HPP
+
+#include <math.h>
+
+#include "util/math.hpp"
+
+namespace pic {
+
+/**
+ * @brief The FFT class computes unnormalized 1D complex DFTs of size n,
+ * where n is a power of two, with an iterative radix-2 algorithm. As in
+ * FastDCT, every transform works on n elements of 'lanes' interleaved
+ * floats (element k of lane l is re[k * lanes + l]) so that butterflies
+ * run over contiguous memory.
+ */
+class FFT
+{
+protected:
+    int size;
+    float *tw_re, *tw_im;
+    int *rev;
+
+    /**
+     * @brief Release frees memory.
+     */
+    void Release()
+    {
+        if(tw_re != NULL) {
+            delete[] tw_re;
+            tw_re = NULL;
+        }
+
+        if(tw_im != NULL) {
+            delete[] tw_im;
+            tw_im = NULL;
+        }
+
+        if(rev != NULL) {
+            delete[] rev;
+            rev = NULL;
+        }
+    }
+
+public:
+
+    /**
+     * @brief FFT
+     * @param size
+     */
+    FFT(int size = 0)
+    {
+        this->size = 0;
+        tw_re = NULL;
+        tw_im = NULL;
+        rev = NULL;
+
+        Setup(size);
+    }
+
+    ~FFT()
+    {
+        Release();
+    }
+
+    //tables are owned; copies are not allowed
+    FFT(const FFT &) = delete;
+    FFT &operator = (const FFT &) = delete;
+
+    /**
+     * @brief NextPowerOfTwo
+     * @param n
+     * @return
+     */
+    static int NextPowerOfTwo(int n)
+    {
+        int p = 1;
+
+        while(p < n) {
+            p <<= 1;
+        }
+
+        return p;
+    }
+
+    /**
+     * @brief Setup precomputes twiddles and the bit reversal; size
+     * is rounded up to a power of two.
+     * @param size
+     */
+    void Setup(int size)
+    {
+        size = NextPowerOfTwo(MAX(size, 1));
+
+        if(size == this->size) {
+            return;
+        }
+
+        Release();
+
+        this->size = size;
+
+        int half = MAX(size >> 1, 1);
+        tw_re = new float[half];
+        tw_im = new float[half];
+
+        double pi = 3.14159265358979323846;
+        for(int i = 0; i < half; i++) {
+            double angle = -2.0 * pi * double(i) / double(size);
+            tw_re[i] = float(cos(angle));
+            tw_im[i] = float(sin(angle));
+        }
+
+        int logn = 0;
+        while((1 << logn) < size) {
+            logn++;
+        }
+
+        rev = new int[size];
+        for(int i = 0; i < size; i++) {
+            int r = 0;
+
+            for(int b = 0; b < logn; b++) {
+                r |= ((i >> b) & 1) << (logn - 1 - b);
+            }
+
+            rev[i] = r;
+        }
+    }
+
+    /**
+     * @brief getSize
+     * @return
+     */
+    int getSize()
+    {
+        return size;
+    }
+
+    /**
+     * @brief Transform computes an in-place DFT; the inverse is not
+     * normalized.
+     * @param re
+     * @param im
+     * @param lanes
+     * @param bInverse
+     */
+    void Transform(float *re, float *im, int lanes, bool bInverse)
+    {
+        //bit reversal
+        for(int i = 0; i < size; i++) {
+            int j = rev[i];
+
+            if(j > i) {
+                float *ar = &re[i * lanes];
+                float *ai = &im[i * lanes];
+                float *br = &re[j * lanes];
+                float *bi = &im[j * lanes];
+
+                for(int l = 0; l < lanes; l++) {
+                    float t = ar[l];
+                    ar[l] = br[l];
+                    br[l] = t;
+
+                    t = ai[l];
+                    ai[l] = bi[l];
+                    bi[l] = t;
+                }
+            }
+        }
+
+        float sign = bInverse ? -1.0f : 1.0f;
+
+        for(int len = 2; len <= size; len <<= 1) {
+            int half_len = len >> 1;
+            int step = size / len;
+
+            for(int i = 0; i < size; i += len) {
+                for(int j = 0; j < half_len; j++) {
+                    float wr = tw_re[j * step];
+                    float wi = tw_im[j * step] * sign;
+
+                    float *ar = &re[(i + j) * lanes];
+                    float *ai = &im[(i + j) * lanes];
+                    float *br = &re[(i + j + half_len) * lanes];
+                    float *bi = &im[(i + j + half_len) * lanes];
+
+                    for(int l = 0; l < lanes; l++) {
+                        float tr = br[l] * wr - bi[l] * wi;
+                        float ti = br[l] * wi + bi[l] * wr;
+                        br[l] = ar[l] - tr;
+                        bi[l] = ai[l] - ti;
+                        ar[l] += tr;
+                        ai[l] += ti;
+                    }
+                }
+            }
+        }
+    }
+};
+
+/**
+ * @brief The FFT2D class computes unnormalized 2D complex DFTs of
+ * width x height planar arrays (re[y * width + x]), where width and height
+ * are powers of two. The vertical pass treats a whole row as lanes; the
+ * horizontal pass gathers blocks of rows so that it works on lanes too.
+ */
+class FFT2D
+{
+protected:
+    FFT fx, fy;
+    int width, height;
+
+public:
+
+    /**
+     * @brief FFT2D
+     * @param width
+     * @param height
+     */
+    FFT2D(int width = 1, int height = 1)
+    {
+        Setup(width, height);
+    }
+
+    //the 1D engines own their tables; copies are not allowed
+    FFT2D(const FFT2D &) = delete;
+    FFT2D &operator = (const FFT2D &) = delete;
+
+    /**
+     * @brief Setup
+     * @param width
+     * @param height
+     */
+    void Setup(int width, int height)
+    {
+        fx.Setup(width);
+        fy.Setup(height);
+        this->width = fx.getSize();
+        this->height = fy.getSize();
+    }
+
+    /**
+     * @brief getScratchSize
+     * @return the number of floats of the scratch buffer of Transform.
+     */
+    int getScratchSize()
+    {
+        return 2 * width * 8;
+    }
+
+    /**
+     * @brief Transform computes an in-place 2D DFT.
+     * @param re
+     * @param im
+     * @param bInverse
+     * @param tmp is a buffer of getScratchSize() floats.
+     */
+    void Transform(float *re, float *im, bool bInverse, float *tmp)
+    {
+        //horizontal pass, 8 rows at once
+        float *t_re = tmp;
+        float *t_im = tmp + width * 8;
+
+        for(int y0 = 0; y0 < height; y0 += 8) {
+            int lanes = MIN(8, height - y0);
+
+            for(int r = 0; r < lanes; r++) {
+                float *s_re = &re[(y0 + r) * width];
+                float *s_im = &im[(y0 + r) * width];
+
+                for(int x = 0; x < width; x++) {
+                    t_re[x * lanes + r] = s_re[x];
+                    t_im[x * lanes + r] = s_im[x];
+                }
+            }
+
+            fx.Transform(t_re, t_im, lanes, bInverse);
+
+            for(int r = 0; r < lanes; r++) {
+                float *s_re = &re[(y0 + r) * width];
+                float *s_im = &im[(y0 + r) * width];
+
+                for(int x = 0; x < width; x++) {
+                    s_re[x] = t_re[x * lanes + r];
+                    s_im[x] = t_im[x * lanes + r];
+                }
+            }
+        }
+
+        //vertical pass
+        fy.Transform(re, im, width, bInverse);
+    }
+};
+
+} // end namespace pic
+
+#endif /* PIC_UTIL_FFT_HPP */
+
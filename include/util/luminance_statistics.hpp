@@ -0,0 +1,320 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_UTIL_LUMINANCE_STATISTICS_HPP
+#define PIC_UTIL_LUMINANCE_STATISTICS_HPP
+
+#include <vector>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include "base.hpp"
+#include "util/math.hpp"
+
+namespace pic {
+
+/**
+ * @brief The LuminanceStatistics class computes in a single parallel sweep
+ * the luminance of an image and its statistics: minimum, maximum, minimum
+ * positive value, mean, log-mean, and a log2 histogram. The histogram has
+ * 2^LS_BITS bins per octave, indexed by the bit pattern of the luminance,
+ * so it covers all positive floats without knowing the range in advance;
+ * percentiles are interpolated within a bin.
+ */
+class LuminanceStatistics
+{
+protected:
+
+    /**
+     * @brief FloatToBits
+     * @param x
+     * @return
+     */
+    static inline unsigned int FloatToBits(float x)
+    {
+        unsigned int u;
+        memcpy(&u, &x, sizeof(unsigned int));
+        return u;
+    }
+
+    /**
+     * @brief BitsToFloat
+     * @param u
+     * @return
+     */
+    static inline float BitsToFloat(unsigned int u)
+    {
+        float x;
+        memcpy(&x, &u, sizeof(float));
+        return x;
+    }
+
+public:
+    enum {LS_BITS = 6, LS_SHIFT = 23 - LS_BITS};
+
+    float minVal, maxVal, minPositiveVal, meanVal, logMeanVal;
+    int nPixels, nValid, nPositive;
+
+    //histogram of positive values
+    std::vector<unsigned int> histogram;
+
+    /**
+     * @brief LuminanceStatistics
+     */
+    LuminanceStatistics()
+    {
+        minVal = maxVal = minPositiveVal = meanVal = logMeanVal = 0.0f;
+        nPixels = nValid = nPositive = 0;
+    }
+
+    /**
+     * @brief Luminance computes the luminance of a pixel; CIE weights are
+     * used for three channels, otherwise the mean of the channels.
+     * @param data
+     * @param channels
+     * @return
+     */
+    static inline float Luminance(const float *data, int channels)
+    {
+        if(channels == 3) {
+            return 0.213f * data[0] + 0.715f * data[1] + 0.072f * data[2];
+        }
+
+        if(channels == 1) {
+            return data[0];
+        }
+
+        float L = 0.0f;
+
+        for(int k = 0; k < channels; k++) {
+            L += data[k];
+        }
+
+        return L / float(channels);
+    }
+
+    /**
+     * @brief getBin returns the histogram bin of a positive value.
+     * @param x
+     * @return
+     */
+    static inline int getBin(float x)
+    {
+        return int(FloatToBits(x) >> LS_SHIFT);
+    }
+
+    /**
+     * @brief getBinValue returns the value at position alpha in [0, 1]
+     * of a histogram bin.
+     * @param bin
+     * @param alpha
+     * @return
+     */
+    static inline float getBinValue(int bin, float alpha = 0.5f)
+    {
+        unsigned int offset = (unsigned int)(alpha * float(1 << LS_SHIFT));
+        offset = MIN(offset, (1u << LS_SHIFT) - 1);
+        return BitsToFloat((unsigned int)(bin << LS_SHIFT) + offset);
+    }
+
+    /**
+     * @brief Compute computes the statistics; non-finite values are skipped.
+     * The log-mean is exp(mean(log(L + 1e-6))) as in Image::getLogMeanVal.
+     * @param data
+     * @param nPixels
+     * @param channels
+     * @param dataLum is an optional buffer of nPixels values where the
+     * luminance is stored.
+     */
+    void Compute(const float *data, int nPixels, int channels,
+                 float *dataLum = NULL)
+    {
+        ComputeAux(data, nPixels, 1, 0, channels, channels, dataLum);
+    }
+
+    /**
+     * @brief ComputeGrid computes the statistics of the pixels of a
+     * width x height frame on a grid with a given step; e.g. step = 4
+     * reads one pixel every 16.
+     * @param data
+     * @param width
+     * @param height
+     * @param channels
+     * @param step
+     */
+    void ComputeGrid(const float *data, int width, int height, int channels,
+                     int step)
+    {
+        step = MAX(step, 1);
+        int nx = (width  + step - 1) / step;
+        int ny = (height + step - 1) / step;
+
+        ComputeAux(data, nx, ny, width * channels * step, channels * step,
+                   channels, NULL);
+    }
+
+protected:
+
+    /**
+     * @brief ComputeAux computes the statistics of nx * ny pixels, where
+     * the pixel (i, j) is at data[j * rowStride + i * colStride].
+     * @param data
+     * @param nx
+     * @param ny
+     * @param rowStride
+     * @param colStride
+     * @param channels
+     * @param dataLum
+     */
+    void ComputeAux(const float *data, int nx, int ny, int rowStride,
+                    int colStride, int channels, float *dataLum)
+    {
+        int nBins = int(0x7F800000u >> LS_SHIFT);
+        histogram.assign(nBins, 0);
+
+        int nPixels = nx * ny;
+        this->nPixels = nPixels;
+
+        double sum = 0.0, sumLog = 0.0;
+        float tMin = FLT_MAX, tMax = -FLT_MAX, tMinPos = FLT_MAX;
+        int tValid = 0, tPositive = 0;
+
+        #pragma omp parallel
+        {
+            std::vector<unsigned int> h(nBins, 0);
+            double l_sum = 0.0, l_sumLog = 0.0;
+            float l_min = FLT_MAX, l_max = -FLT_MAX, l_minPos = FLT_MAX;
+            int l_valid = 0, l_positive = 0;
+
+            #pragma omp for nowait
+
+            for(int i = 0; i < nPixels; i++) {
+                int y = i / nx;
+                int x = i - y * nx;
+                float L = Luminance(&data[y * rowStride + x * colStride], channels);
+
+                if(dataLum != NULL) {
+                    dataLum[i] = L;
+                }
+
+                if(!((L >= -FLT_MAX) && (L <= FLT_MAX))) {
+                    continue;
+                }
+
+                l_valid++;
+                l_sum += L;
+                l_sumLog += logf(L + 1e-6f);
+                l_min = MIN(l_min, L);
+                l_max = MAX(l_max, L);
+
+                if(L > 0.0f) {
+                    l_positive++;
+                    l_minPos = MIN(l_minPos, L);
+                    h[getBin(L)]++;
+                }
+            }
+
+            #pragma omp critical
+            {
+                sum += l_sum;
+                sumLog += l_sumLog;
+                tMin = MIN(tMin, l_min);
+                tMax = MAX(tMax, l_max);
+                tMinPos = MIN(tMinPos, l_minPos);
+                tValid += l_valid;
+                tPositive += l_positive;
+
+                for(int i = 0; i < nBins; i++) {
+                    histogram[i] += h[i];
+                }
+            }
+        }
+
+        nValid = tValid;
+        nPositive = tPositive;
+
+        if(nValid > 0) {
+            minVal = tMin;
+            maxVal = tMax;
+            meanVal = float(sum / double(nValid));
+            logMeanVal = float(exp(sumLog / double(nValid)));
+        } else {
+            minVal = maxVal = meanVal = logMeanVal = 0.0f;
+        }
+
+        minPositiveVal = (nPositive > 0) ? tMinPos : 0.0f;
+    }
+
+public:
+
+    /**
+     * @brief getPercentile returns the value at perCent in [0, 1] of
+     * the sorted luminance values; non-positive values are returned as
+     * minVal.
+     * @param perCent
+     * @return
+     */
+    float getPercentile(float perCent) const
+    {
+        if(nValid < 1) {
+            return 0.0f;
+        }
+
+        perCent = CLAMPi(perCent, 0.0f, 1.0f);
+        double rank = double(perCent) * double(nValid - 1);
+
+        int nNonPositive = nValid - nPositive;
+
+        if(rank < double(nNonPositive)) {
+            return minVal;
+        }
+
+        rank -= double(nNonPositive);
+
+        double count = 0.0;
+        int nBins = int(histogram.size());
+
+        for(int i = getBin(minPositiveVal); i < nBins; i++) {
+            double c = double(histogram[i]);
+
+            if((count + c) > rank) {
+                float alpha = float((rank - count + 0.5) / c);
+                float val = getBinValue(i, alpha);
+                return CLAMPi(val, minPositiveVal, maxVal);
+            }
+
+            count += c;
+        }
+
+        return maxVal;
+    }
+
+    /**
+     * @brief getMedian
+     * @return
+     */
+    float getMedian() const
+    {
+        return getPercentile(0.5f);
+    }
+};
+
+} // end namespace pic
+
+#endif /* PIC_UTIL_LUMINANCE_STATISTICS_HPP */
+
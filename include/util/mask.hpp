@@ -18,8 +18,12 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #ifndef PIC_UTIL_MASK_HPP
 #define PIC_UTIL_MASK_HPP
 
+#include <string.h>
+#include <vector>
+
 #include "base.hpp"
 #include "util/math.hpp"
+#include "util/running_extrema.hpp"
 
 namespace pic {
 
@@ -74,16 +78,64 @@ PIC_INLINE bool *MaskRemoveIsolatedPixels(bool *dataIn, bool *dataOut,
 }
 
 /**
- * @brief MaskErode erodes a mask.
+ * @brief MaskShiftBits shifts a row of packed bits; out(x) = in(x + shift),
+ * and bits out of the row are zeros.
+ * @param in
+ * @param out
+ * @param nWords
+ * @param shift
+ */
+PIC_INLINE void MaskShiftBits(unsigned long long *in, unsigned long long *out,
+                              int nWords, int shift)
+{
+    int q = (shift >= 0 ? shift : -shift) >> 6;
+    int s = (shift >= 0 ? shift : -shift) & 63;
+
+    for(int i = 0; i < nWords; i++) {
+        unsigned long long v = 0;
+
+        if(shift >= 0) {
+            int i0 = i + q;
+
+            if(i0 < nWords) {
+                v = in[i0] >> s;
+
+                if(s > 0 && (i0 + 1) < nWords) {
+                    v |= in[i0 + 1] << (64 - s);
+                }
+            }
+        } else {
+            int i0 = i - q;
+
+            if(i0 >= 0) {
+                v = in[i0] << s;
+
+                if(s > 0 && (i0 - 1) >= 0) {
+                    v |= in[i0 - 1] >> (64 - s);
+                }
+            }
+        }
+
+        out[i] = v;
+    }
+}
+
+/**
+ * @brief MaskMorphology dilates or erodes a mask with a square of
+ * kernelSize x kernelSize pixels. Rows are packed in 64-bit words: the
+ * horizontal pass doubles shifted ors, and the vertical pass is a running
+ * or (van Herk/Gil-Werman) over words. Erosion is the negated dilation of
+ * the negated mask.
  * @param dataIn
  * @param dataOut
  * @param width
  * @param height
  * @param kernelSize
+ * @param bDilate
  * @return
  */
-PIC_INLINE bool *MaskErode(bool *dataIn, bool *dataOut, int width, int height,
-                           int kernelSize = 3)
+PIC_INLINE bool *MaskMorphology(bool *dataIn, bool *dataOut, int width, int height,
+                                int kernelSize, bool bDilate)
 {
     if(dataIn == NULL) {
         return dataOut;
@@ -93,34 +145,110 @@ PIC_INLINE bool *MaskErode(bool *dataIn, bool *dataOut, int width, int height,
         dataOut = new bool[width * height];
     }
 
-    int halfKernelSize = kernelSize >> 1;
+    int radius = kernelSize >> 1;
+    int w = 2 * radius + 1;
+    int nWords = (width + 63) >> 6;
 
-    #pragma omp parallel for
+    std::vector<unsigned long long> bits(nWords * height);
 
-    for(int i = 0; i < height; i++) {
-        int ind = i * width;
+    //packing and horizontal pass; rows are packed with an offset of radius
+    //bits so that windows at the left border are not lost
+    int nWordsExt = (width + 2 * radius + 63) >> 6;
 
-        for(int j = 0; j < width; j++) {
-            int c = ind + j;
+    #pragma omp parallel
+    {
+        std::vector<unsigned long long> a(nWordsExt), t(nWordsExt);
 
-            bool out = false;
+        #pragma omp for schedule(static)
+        for(int j = 0; j < height; j++) {
+            bool *row = &dataIn[j * width];
 
-            for(int k = -halfKernelSize; k <= halfKernelSize; k++) {
-                int ci = CLAMP((i + k), height) * width;
+            for(int i = 0; i < nWordsExt; i++) {
+                a[i] = 0;
+            }
+
+            for(int i = 0; i < width; i++) {
+                if(row[i] == bDilate) {
+                    int x = i + radius;
+                    a[x >> 6] |= 1ULL << (x & 63);
+                }
+            }
+
+            //a(x) = or over [x, x + p) of the shifted row, which is
+            //the or over [x - radius, x - radius + p) of the row
+            int p = 1;
+            while((p << 1) <= w) {
+                MaskShiftBits(&a[0], &t[0], nWordsExt, p);
+
+                for(int i = 0; i < nWordsExt; i++) {
+                    a[i] |= t[i];
+                }
 
-                for(int l = -halfKernelSize; l <= halfKernelSize; l++) {
-                    int cj = CLAMP((j + l), width);
-                    out = out || (!dataIn[ci + cj]);
+                p <<= 1;
+            }
+
+            if(p < w) {
+                MaskShiftBits(&a[0], &t[0], nWordsExt, w - p);
+
+                for(int i = 0; i < nWordsExt; i++) {
+                    a[i] |= t[i];
                 }
             }
 
-            dataOut[c] = !out;
+            memcpy(&bits[j * nWords], &a[0], nWords * sizeof(unsigned long long));
+        }
+    }
+
+    //vertical pass
+    int band = 16;
+    int nBands = (nWords + band - 1) / band;
+
+    #pragma omp parallel
+    {
+        int size = RunningExtremaScratchSize(height, radius, band);
+        std::vector<unsigned long long> g(size), h(size);
+
+        #pragma omp for schedule(static)
+        for(int b = 0; b < nBands; b++) {
+            int l0 = b * band;
+            int lanes = MIN(band, nWords - l0);
+
+            RunningExtrema<unsigned long long, RunningOr<unsigned long long> >
+                (&bits[l0], &bits[l0], height, nWords, lanes, radius, &g[0], &h[0]);
+        }
+    }
+
+    //unpacking
+    #pragma omp parallel for
+
+    for(int j = 0; j < height; j++) {
+        unsigned long long *row = &bits[j * nWords];
+        bool *out = &dataOut[j * width];
+
+        for(int i = 0; i < width; i++) {
+            bool v = ((row[i >> 6] >> (i & 63)) & 1ULL) != 0;
+            out[i] = bDilate ? v : !v;
         }
     }
 
     return dataOut;
 }
 
+/**
+ * @brief MaskErode erodes a mask.
+ * @param dataIn
+ * @param dataOut
+ * @param width
+ * @param height
+ * @param kernelSize
+ * @return
+ */
+PIC_INLINE bool *MaskErode(bool *dataIn, bool *dataOut, int width, int height,
+                           int kernelSize = 3)
+{
+    return MaskMorphology(dataIn, dataOut, width, height, kernelSize, false);
+}
+
 /**
  * @brief MaskDilate dilates a mask.
  * @param dataIn
@@ -133,40 +261,39 @@ PIC_INLINE bool *MaskErode(bool *dataIn, bool *dataOut, int width, int height,
 PIC_INLINE bool *MaskDilate(bool *dataIn, bool *dataOut, int width, int height,
                             int kernelSize = 3)
 {
-    if(dataIn == NULL) {
-        return dataOut;
-    }
-
-    if(dataOut == NULL) {
-        dataOut = new bool[width * height];
-    }
-
-    int halfKernelSize = kernelSize >> 1;
-
-    #pragma omp parallel for
-
-    for(int i = 0; i < height; i++) {
-        int ind = i * width;
-
-        for(int j = 0; j < width; j++) {
-            int c = ind + j;
-
-            bool out = false;
-
-            for(int k = -halfKernelSize; k <= halfKernelSize; k++) {
-                int ci = CLAMP((i + k), height) * width;
-
-                for(int l = -halfKernelSize; l <= halfKernelSize; l++) {
-                    int cj = CLAMP((j + l), width);
-                    out = out || (dataIn[ci + cj]);
-                }
-            }
+    return MaskMorphology(dataIn, dataOut, width, height, kernelSize, true);
+}
 
-            dataOut[c] = out;
-        }
-    }
+/**
+ * @brief MaskOpen erodes and then dilates a mask.
+ * @param dataIn
+ * @param dataOut
+ * @param width
+ * @param height
+ * @param kernelSize
+ * @return
+ */
+PIC_INLINE bool *MaskOpen(bool *dataIn, bool *dataOut, int width, int height,
+                          int kernelSize = 3)
+{
+    dataOut = MaskMorphology(dataIn, dataOut, width, height, kernelSize, false);
+    return MaskMorphology(dataOut, dataOut, width, height, kernelSize, true);
+}
 
-    return dataOut;
+/**
+ * @brief MaskClose dilates and then erodes a mask.
+ * @param dataIn
+ * @param dataOut
+ * @param width
+ * @param height
+ * @param kernelSize
+ * @return
+ */
+PIC_INLINE bool *MaskClose(bool *dataIn, bool *dataOut, int width, int height,
+                           int kernelSize = 3)
+{
+    dataOut = MaskMorphology(dataIn, dataOut, width, height, kernelSize, true);
+    return MaskMorphology(dataOut, dataOut, width, height, kernelSize, false);
 }
 
 /**
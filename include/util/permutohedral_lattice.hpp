@@ -0,0 +1,504 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_UTIL_PERMUTOHEDRAL_LATTICE_HPP
+#define PIC_UTIL_PERMUTOHEDRAL_LATTICE_HPP
+
+#include <math.h>
+#include <vector>
+
+namespace pic {
+
+/**
+ * @brief The PermutohedralLattice class implements Gaussian filtering in
+ * a d-dimensional feature space using the permutohedral lattice of
+ * Adams et al. 2010: values are splatted onto the lattice vertices
+ * enclosing each point, blurred along the d + 1 lattice axes, and sliced
+ * back. Features must be already divided by their standard deviations.
+ * The cost is linear in the number of points and in d. Vertex values are
+ * stored as one array per value channel (SoA).
+ */
+class PermutohedralLattice
+{
+protected:
+    int d, vd, n, nVertices;
+
+    //per point, during Splat only: enclosing simplex and barycentric weights
+    std::vector<int>   greedy;
+    std::vector<int>   rank;
+    std::vector<float> barycentric;
+    std::vector<int>   offset;
+
+    std::vector<float> scaleFactor;
+
+    //hash table of lattice vertices
+    std::vector<int>   keys;
+    std::vector<int>   table;
+    unsigned int       mask;
+
+    std::vector<float> values, valuesTmp;
+    std::vector<int>   canonical;
+
+    /**
+     * @brief hash
+     * @param key
+     * @return
+     */
+    unsigned int hash(const int *key)
+    {
+        unsigned int k = 0;
+
+        for(int i = 0; i < d; i++) {
+            k += (unsigned int)(key[i]);
+            k *= 2531011u;
+        }
+
+        return k;
+    }
+
+    /**
+     * @brief find looks up a vertex.
+     * @param key
+     * @param bInsert inserts the vertex when it is missing.
+     * @return It returns the index of the vertex or -1.
+     */
+    int find(const int *key, bool bInsert)
+    {
+        unsigned int h = hash(key) & mask;
+
+        while(true) {
+            int index = table[h];
+
+            if(index == -1) {
+                if(!bInsert) {
+                    return -1;
+                }
+
+                index = nVertices;
+                nVertices++;
+                keys.insert(keys.end(), key, key + d);
+                table[h] = index;
+
+                //keeping the load factor under 0.5
+                if(nVertices * 2 > int(table.size())) {
+                    Grow();
+                }
+
+                return index;
+            }
+
+            const int *k = &keys[index * d];
+            bool bEqual = true;
+
+            for(int i = 0; i < d && bEqual; i++) {
+                bEqual = (k[i] == key[i]);
+            }
+
+            if(bEqual) {
+                return index;
+            }
+
+            h = (h + 1) & mask;
+        }
+    }
+
+    /**
+     * @brief Grow doubles the hash table.
+     */
+    void Grow()
+    {
+        table.assign(table.size() * 2, -1);
+        mask = (unsigned int)(table.size() - 1);
+
+        for(int i = 0; i < nVertices; i++) {
+            unsigned int h = hash(&keys[i * d]) & mask;
+
+            while(table[h] != -1) {
+                h = (h + 1) & mask;
+            }
+
+            table[h] = i;
+        }
+    }
+
+    /**
+     * @brief getKey computes the key of a vertex of the simplex of a point.
+     * @param g is the closest remainder-0 point.
+     * @param r is the rank of the differential.
+     * @param remainder
+     * @param key
+     */
+    void getKey(const int *g, const int *r, int remainder, int *key)
+    {
+        const int *c = &canonical[remainder * (d + 1)];
+
+        for(int i = 0; i < d; i++) {
+            key[i] = g[i] + c[r[i]];
+        }
+    }
+
+    /**
+     * @brief Elevate embeds a point in the lattice and finds its
+     * enclosing simplex.
+     * @param position
+     * @param elevated is a scratch array of 2 * d + 3 floats.
+     * @param g
+     * @param r
+     * @param b
+     */
+    void Elevate(const float *position, float *elevated, int *g, int *r, float *b)
+    {
+        int d1 = d + 1;
+
+        //elevating onto the hyperplane
+        float sm = 0.0f;
+        for(int i = d; i > 0; i--) {
+            float cf = position[i - 1] * scaleFactor[i - 1];
+            elevated[i] = sm - float(i) * cf;
+            sm += cf;
+        }
+        elevated[0] = sm;
+
+        //closest remainder-0 point
+        int sum = 0;
+        float down_factor = 1.0f / float(d1);
+
+        for(int i = 0; i <= d; i++) {
+            float v = elevated[i] * down_factor;
+            int up = int(ceilf(v)) * d1;
+            int down = int(floorf(v)) * d1;
+
+            if(float(up) - elevated[i] < elevated[i] - float(down)) {
+                g[i] = up;
+            } else {
+                g[i] = down;
+            }
+
+            sum += g[i];
+        }
+
+        sum /= d1;
+
+        //ranking the differential
+        for(int i = 0; i <= d; i++) {
+            r[i] = 0;
+        }
+
+        for(int i = 0; i < d; i++) {
+            for(int j = i + 1; j <= d; j++) {
+                if((elevated[i] - float(g[i])) < (elevated[j] - float(g[j]))) {
+                    r[i]++;
+                } else {
+                    r[j]++;
+                }
+            }
+        }
+
+        //wrapping to a remainder-0 point
+        if(sum > 0) {
+            for(int i = 0; i <= d; i++) {
+                if(r[i] >= d1 - sum) {
+                    g[i] -= d1;
+                    r[i] += sum - d1;
+                } else {
+                    r[i] += sum;
+                }
+            }
+        } else {
+            if(sum < 0) {
+                for(int i = 0; i <= d; i++) {
+                    if(r[i] < -sum) {
+                        g[i] += d1;
+                        r[i] += d1 + sum;
+                    } else {
+                        r[i] += sum;
+                    }
+                }
+            }
+        }
+
+        //barycentric coordinates
+        float *bTmp = elevated + d1;
+        for(int i = 0; i <= d + 1; i++) {
+            bTmp[i] = 0.0f;
+        }
+
+        for(int i = 0; i <= d; i++) {
+            float delta = (elevated[i] - float(g[i])) * down_factor;
+            bTmp[d - r[i]] += delta;
+            bTmp[d + 1 - r[i]] -= delta;
+        }
+
+        bTmp[0] += 1.0f + bTmp[d + 1];
+
+        for(int i = 0; i <= d; i++) {
+            b[i] = bTmp[i];
+        }
+    }
+
+public:
+
+    /**
+     * @brief PermutohedralLattice
+     */
+    PermutohedralLattice()
+    {
+        d = vd = n = nVertices = 0;
+        mask = 0;
+    }
+
+    /**
+     * @brief getNumberOfVertices
+     * @return
+     */
+    int getNumberOfVertices()
+    {
+        return nVertices;
+    }
+
+    /**
+     * @brief Splat builds the lattice and splats the values onto it. The
+     * simplices are found in parallel; the vertex sums are gathered in
+     * parallel as well. Per-point data is released before returning, so
+     * only the lattice is kept.
+     * @param features is an array of n * d floats.
+     * @param d is the dimension of the feature space.
+     * @param val is an array of n * vd floats.
+     * @param vd is the number of values per point.
+     * @param n is the number of points.
+     */
+    void Splat(const float *features, int d, const float *val, int vd, int n)
+    {
+        this->d = d;
+        this->vd = vd;
+        this->n = n;
+
+        int d1 = d + 1;
+
+        canonical.resize(d1 * d1);
+        for(int i = 0; i <= d; i++) {
+            for(int j = 0; j <= d - i; j++) {
+                canonical[i * d1 + j] = i;
+            }
+
+            for(int j = d - i + 1; j <= d; j++) {
+                canonical[i * d1 + j] = i - d1;
+            }
+        }
+
+        //std. dev. of the lattice blur is matched to the unit variance
+        scaleFactor.resize(d);
+        float inv_std_dev = sqrtf(2.0f / 3.0f) * float(d1);
+        for(int i = 0; i < d; i++) {
+            scaleFactor[i] = inv_std_dev / sqrtf(float((i + 1) * (i + 2)));
+        }
+
+        greedy.resize(n * d1);
+        rank.resize(n * d1);
+        barycentric.resize(n * d1);
+        offset.resize(n * d1);
+
+        #pragma omp parallel
+        {
+            std::vector<float> elevated(2 * d1 + 1);
+
+            #pragma omp for schedule(static)
+            for(int i = 0; i < n; i++) {
+                Elevate(&features[i * d], &elevated[0],
+                        &greedy[i * d1], &rank[i * d1], &barycentric[i * d1]);
+            }
+        }
+
+        //building the vertex table
+        nVertices = 0;
+        keys.clear();
+        keys.reserve(n * d);
+
+        unsigned int tableSize = 1;
+        while(tableSize < (unsigned int)(n * 2)) {
+            tableSize <<= 1;
+        }
+
+        table.assign(tableSize, -1);
+        mask = tableSize - 1;
+
+        std::vector<int> key(d);
+        for(int i = 0; i < n; i++) {
+            for(int j = 0; j <= d; j++) {
+                getKey(&greedy[i * d1], &rank[i * d1], j, &key[0]);
+                offset[i * d1 + j] = find(&key[0], true);
+            }
+        }
+
+        std::vector<int>().swap(greedy);
+        std::vector<int>().swap(rank);
+
+        //gathering contributions per vertex
+        std::vector<int> start(nVertices + 1, 0);
+        for(int i = 0; i < (n * d1); i++) {
+            start[offset[i] + 1]++;
+        }
+
+        for(int i = 0; i < nVertices; i++) {
+            start[i + 1] += start[i];
+        }
+
+        std::vector<int> entries(n * d1);
+        std::vector<int> pos(start.begin(), start.end() - 1);
+        for(int i = 0; i < (n * d1); i++) {
+            entries[pos[offset[i]]++] = i;
+        }
+
+        values.assign(vd * nVertices, 0.0f);
+
+        #pragma omp parallel for schedule(dynamic, 256)
+        for(int v = 0; v < nVertices; v++) {
+            for(int k = start[v]; k < start[v + 1]; k++) {
+                int e = entries[k];
+                const float *p = &val[(e / d1) * vd];
+                float w = barycentric[e];
+
+                for(int c = 0; c < vd; c++) {
+                    values[c * nVertices + v] += w * p[c];
+                }
+            }
+        }
+
+        std::vector<float>().swap(barycentric);
+        std::vector<int>().swap(offset);
+    }
+
+    /**
+     * @brief Blur blurs the lattice along each of its d + 1 axes with
+     * the kernel [1 2 1] / 4.
+     */
+    void Blur()
+    {
+        std::vector<int> neighbors(nVertices * 2);
+        valuesTmp.resize(values.size());
+
+        for(int j = 0; j <= d; j++) {
+            //neighbors along the j-th axis
+            #pragma omp parallel
+            {
+                std::vector<int> n1(d), n2(d);
+
+                #pragma omp for schedule(static)
+                for(int v = 0; v < nVertices; v++) {
+                    const int *key = &keys[v * d];
+
+                    for(int k = 0; k < d; k++) {
+                        n1[k] = key[k] + 1;
+                        n2[k] = key[k] - 1;
+                    }
+
+                    if(j < d) {
+                        n1[j] = key[j] - d;
+                        n2[j] = key[j] + d;
+                    }
+
+                    neighbors[v * 2    ] = find(&n1[0], false);
+                    neighbors[v * 2 + 1] = find(&n2[0], false);
+                }
+            }
+
+            #pragma omp parallel for schedule(static)
+            for(int v = 0; v < nVertices; v++) {
+                int i1 = neighbors[v * 2];
+                int i2 = neighbors[v * 2 + 1];
+
+                for(int c = 0; c < vd; c++) {
+                    const float *src = &values[c * nVertices];
+                    float val = src[v] * 0.5f;
+
+                    if(i1 >= 0) {
+                        val += src[i1] * 0.25f;
+                    }
+
+                    if(i2 >= 0) {
+                        val += src[i2] * 0.25f;
+                    }
+
+                    valuesTmp[c * nVertices + v] = val;
+                }
+            }
+
+            values.swap(valuesTmp);
+        }
+    }
+
+    /**
+     * @brief Slice interpolates the blurred values at the input points;
+     * their simplices are recomputed instead of being kept from Splat.
+     * @param features is the array of n * d floats passed to Splat.
+     * @param out is an array of n * vd floats.
+     */
+    void Slice(const float *features, float *out)
+    {
+        int d1 = d + 1;
+
+        #pragma omp parallel
+        {
+            std::vector<float> elevated(2 * d1 + 1), b(d1);
+            std::vector<int> g(d1), r(d1), key(d);
+
+            #pragma omp for schedule(static)
+            for(int i = 0; i < n; i++) {
+                Elevate(&features[i * d], &elevated[0], &g[0], &r[0], &b[0]);
+
+                float *o = &out[i * vd];
+
+                for(int c = 0; c < vd; c++) {
+                    o[c] = 0.0f;
+                }
+
+                for(int j = 0; j <= d; j++) {
+                    getKey(&g[0], &r[0], j, &key[0]);
+                    int v = find(&key[0], false);
+                    float w = b[j];
+
+                    for(int c = 0; c < vd; c++) {
+                        o[c] += w * values[c * nVertices + v];
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Execute filters values with a Gaussian in feature space.
+     * @param features
+     * @param d
+     * @param val
+     * @param vd
+     * @param n
+     * @param out
+     */
+    static void Execute(const float *features, int d, const float *val, int vd,
+                        int n, float *out)
+    {
+        PermutohedralLattice lattice;
+        lattice.Splat(features, d, val, vd, n);
+        lattice.Blur();
+        lattice.Slice(features, out);
+    }
+};
+
+} // end namespace pic
+
+#endif /* PIC_UTIL_PERMUTOHEDRAL_LATTICE_HPP */
+
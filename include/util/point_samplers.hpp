@@ -46,9 +46,11 @@ inline float PoissonRadius(int nSamples)
 	-ST_POISSON: poisson sampling
 	-ST_POISSON_M: multiple poisson sampling
 	-ST_MONTECARLO: classic montecarlo
-	-ST_MONTECARLO_S: stratifield montecarlo*/
+	-ST_MONTECARLO_S: stratifield montecarlo
+	-ST_POISSON_GRID: parallel grid poisson sampling
+	-ST_POISSON_TILE: precomputed tileable poisson sampling*/
 
-enum SAMPLER_TYPE {ST_BRIDSON, ST_DARTTHROWING, ST_PATTERN, ST_MONTECARLO, ST_MONTECARLO_S};
+enum SAMPLER_TYPE {ST_BRIDSON, ST_DARTTHROWING, ST_PATTERN, ST_MONTECARLO, ST_MONTECARLO_S, ST_POISSON_GRID, ST_POISSON_TILE};
 
 } // end namespace pic
 
@@ -0,0 +1,476 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+
+#ifndef PIC_UTIL_RANSAC_HPP
+#define PIC_UTIL_RANSAC_HPP
+
+#include <vector>
+#include <random>
+#include <math.h>
+
+#include "base.hpp"
+#include "util/math.hpp"
+
+namespace pic {
+
+/**
+ * @brief The RansacPoints class stores a set of 2D correspondences as
+ * a structure of arrays, so that residuals can be computed with contiguous
+ * loops.
+ */
+class RansacPoints
+{
+public:
+    std::vector< double > x0, y0, x1, y1;
+    unsigned int n;
+
+    /**
+     * @brief RansacPoints
+     */
+    RansacPoints()
+    {
+        n = 0;
+    }
+
+    /**
+     * @brief Set copies the correspondences points0[i] <-> points1[i].
+     * @param points0
+     * @param points1
+     */
+    template<class T>
+    void Set(const std::vector< T > &points0, const std::vector< T > &points1)
+    {
+        n = MIN(points0.size(), points1.size());
+
+        x0.resize(n);
+        y0.resize(n);
+        x1.resize(n);
+        y1.resize(n);
+
+        for(unsigned int i = 0; i < n; i++) {
+            x0[i] = points0[i][0];
+            y0[i] = points0[i][1];
+            x1[i] = points1[i][0];
+            y1[i] = points1[i][1];
+        }
+    }
+};
+
+/**
+ * @brief The Ransac class is a generic RANSAC engine. Model has to provide:
+ * - typedef Type; the model type (e.g., a 3x3 matrix).
+ * - static const int nSubSet; the size of a minimal sample.
+ * - bool Estimate(const RansacPoints &pts, const unsigned int *ind, int n, Type &M);
+ *   it fits M to the n correspondences in ind; it returns false for
+ *   degenerate fits.
+ * - void Residuals(const Type &M, const RansacPoints &pts, unsigned int i0, unsigned int i1, double *res);
+ *   it computes the residuals of correspondences [i0, i1) into res.
+ * A Model instance is copied for each thread, so it can store scratch buffers.
+ *
+ * Hypotheses are generated and scored in parallel batches; each hypothesis
+ * has its own random generator seeded by (seed, iteration), so results do not
+ * depend on the number of threads. The number of iterations is adapted to
+ * the inlier ratio of the best model, bad hypotheses are rejected early with
+ * Wald's sequential probability ratio test (SPRT), and every new best model
+ * can be refined with a local optimization step (LO-RANSAC).
+ */
+template<class Model>
+class Ransac
+{
+protected:
+    Model model;
+
+    //SPRT
+    double epsilon, delta, logA;
+    bool bSPRTActive;
+
+    /**
+     * @brief UpdateSPRT updates the SPRT threshold, A, given the
+     * current estimates of epsilon and delta.
+     */
+    void UpdateSPRT()
+    {
+        bSPRTActive = bSPRT && (epsilon > 0.0) && (epsilon < 1.0) && (delta < epsilon);
+
+        if(!bSPRTActive) {
+            return;
+        }
+
+        double C = (1.0 - delta) * log((1.0 - delta) / (1.0 - epsilon)) +
+                   delta * log(delta / epsilon);
+
+        //cost of a hypothesis in residual evaluations
+        double K = 200.0 * C + 1.0;
+
+        double A = K;
+        for(int i = 0; i < 10; i++) {
+            A = K + log(A);
+        }
+
+        logA = log(A);
+    }
+
+    /**
+     * @brief Score counts the inliers of M. It returns -1 when M is rejected
+     * by the SPRT or when it cannot beat bestCount.
+     * @param m
+     * @param M
+     * @param pts
+     * @param threshold
+     * @param res is a buffer of at least block values.
+     * @param bestCount
+     * @param bEarly enables early rejection.
+     * @return
+     */
+    int Score(Model &m, typename Model::Type &M, const RansacPoints &pts,
+              double threshold, double *res, int bestCount, bool bEarly)
+    {
+        double log_in  = 0.0;
+        double log_out = 0.0;
+
+        if(bEarly && bSPRTActive) {
+            log_in  = log(delta / epsilon);
+            log_out = log((1.0 - delta) / (1.0 - epsilon));
+        }
+
+        int count = 0;
+        double logL = 0.0;
+
+        for(unsigned int i0 = 0; i0 < pts.n; i0 += block) {
+            unsigned int i1 = MIN(i0 + block, pts.n);
+
+            m.Residuals(M, pts, i0, i1, res);
+
+            int c = 0;
+            int nb = int(i1 - i0);
+            for(int k = 0; k < nb; k++) {
+                c += (res[k] < threshold) ? 1 : 0;
+            }
+
+            count += c;
+
+            if(!bEarly) {
+                continue;
+            }
+
+            if(bSPRTActive) {
+                logL += double(c) * log_in + double(nb - c) * log_out;
+
+                if(logL > logA) {
+                    return -1;
+                }
+            }
+
+            if((count + int(pts.n - i1)) <= bestCount) {
+                return -1;
+            }
+        }
+
+        return count;
+    }
+
+    /**
+     * @brief getInliers
+     * @param M
+     * @param pts
+     * @param threshold
+     * @param inliers
+     */
+    void getInliers(typename Model::Type &M, const RansacPoints &pts, double threshold,
+                    std::vector< unsigned int > &inliers)
+    {
+        std::vector< double > res(block);
+
+        inliers.clear();
+
+        for(unsigned int i0 = 0; i0 < pts.n; i0 += block) {
+            unsigned int i1 = MIN(i0 + block, pts.n);
+
+            model.Residuals(M, pts, i0, i1, &res[0]);
+
+            for(unsigned int i = i0; i < i1; i++) {
+                if(res[i - i0] < threshold) {
+                    inliers.push_back(i);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief LocalOptimization refits the best model to its inliers
+     * while the number of inliers grows.
+     * @param pts
+     * @param threshold
+     * @param M
+     * @param count
+     */
+    void LocalOptimization(const RansacPoints &pts, double threshold,
+                           typename Model::Type &M, int &count)
+    {
+        std::vector< unsigned int > tmp_inliers;
+        std::vector< double > res(block);
+
+        for(int i = 0; i < 4; i++) {
+            getInliers(M, pts, threshold, tmp_inliers);
+
+            if(int(tmp_inliers.size()) <= Model::nSubSet) {
+                return;
+            }
+
+            typename Model::Type M_lo;
+            if(!model.Estimate(pts, &tmp_inliers[0], int(tmp_inliers.size()), M_lo)) {
+                return;
+            }
+
+            int count_lo = Score(model, M_lo, pts, threshold, &res[0], count, false);
+
+            if(count_lo > count) {
+                M = M_lo;
+                count = count_lo;
+            } else {
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief DrawSample draws nSample distinct indices in [0, n).
+     * @param rng
+     * @param sample
+     * @param nSample
+     * @param n
+     */
+    static void DrawSample(std::minstd_rand &rng, unsigned int *sample, int nSample, unsigned int n)
+    {
+        int index = 0;
+        while(index < nSample) {
+            sample[index] = rng() % n;
+
+            bool flag = true;
+            for(int j = 0; j < index; j++) {
+                if(sample[index] == sample[j]) {
+                    flag = false;
+                    break;
+                }
+            }
+
+            if(flag) {
+                index++;
+            }
+        }
+    }
+
+public:
+    //number of correspondences scored at once
+    static const unsigned int block = 64;
+
+    //number of hypotheses generated in parallel
+    static const unsigned int batch = 16;
+
+    double          confidence;
+    bool            bSPRT, bLocalOptimization;
+    unsigned int    seed;
+
+    //statistics of the last execution
+    unsigned int    nIterations, nRejected;
+
+    /**
+     * @brief Ransac
+     * @param model
+     * @param confidence is the probability of having drawn at least
+     * one outlier-free sample when the engine stops.
+     * @param bSPRT
+     * @param bLocalOptimization
+     * @param seed
+     */
+    Ransac(Model model = Model(), double confidence = 0.99, bool bSPRT = true,
+           bool bLocalOptimization = true, unsigned int seed = 1)
+    {
+        this->model = model;
+        this->confidence = confidence;
+        this->bSPRT = bSPRT;
+        this->bLocalOptimization = bLocalOptimization;
+        this->seed = seed;
+
+        nIterations = 0;
+        nRejected = 0;
+    }
+
+    /**
+     * @brief getIterations computes the number of iterations needed to draw
+     * an outlier-free sample with probability confidence.
+     * @param inlier_ratio
+     * @param nSubSet
+     * @param confidence
+     * @param maxIterations
+     * @return
+     */
+    static unsigned int getIterations(double inlier_ratio, int nSubSet,
+                                      double confidence, unsigned int maxIterations)
+    {
+        if(inlier_ratio <= 0.0) {
+            return maxIterations;
+        }
+
+        double ws = pow(inlier_ratio, double(nSubSet));
+
+        if(ws >= 1.0) {
+            return MIN(maxIterations, batch);
+        }
+
+        double den = log(1.0 - ws);
+
+        if(den >= 0.0) {
+            return maxIterations;
+        }
+
+        double N = ceil(log(1.0 - confidence) / den);
+
+        if(N >= double(maxIterations)) {
+            return maxIterations;
+        }
+
+        return MAX(1, (unsigned int)(N));
+    }
+
+    /**
+     * @brief Execute estimates a model from pts.
+     * @param pts
+     * @param inliers is the output list of inliers of the returned model.
+     * @param M is the output model.
+     * @param maxIterations
+     * @param threshold
+     * @return It returns true if a model was found.
+     */
+    bool Execute(const RansacPoints &pts, std::vector< unsigned int > &inliers,
+                 typename Model::Type &M, unsigned int maxIterations, double threshold)
+    {
+        inliers.clear();
+        nIterations = 0;
+        nRejected = 0;
+
+        const int nSubSet = Model::nSubSet;
+
+        if(int(pts.n) < nSubSet) {
+            return false;
+        }
+
+        int bestCount = -1;
+        double n_f = double(pts.n);
+
+        epsilon = 0.0;
+        delta = 0.01;
+        UpdateSPRT();
+
+        std::vector< typename Model::Type > models(batch);
+        std::vector< int > counts(batch);
+
+        unsigned int N = maxIterations;
+
+        while(nIterations < N) {
+            int nb = int(MIN(batch, N - nIterations));
+            int bestCount_batch = bestCount;
+
+            #pragma omp parallel
+            {
+                Model m = model;
+                std::vector< unsigned int > sample(nSubSet);
+                std::vector< double > res(block);
+
+                #pragma omp for schedule(dynamic)
+                for(int b = 0; b < nb; b++) {
+                    std::minstd_rand rng((seed * 2654435761u) ^ (nIterations + b + 1));
+                    rng.discard(2);
+
+                    DrawSample(rng, &sample[0], nSubSet, pts.n);
+
+                    counts[b] = -2;
+
+                    if(m.Estimate(pts, &sample[0], nSubSet, models[b])) {
+                        counts[b] = Score(m, models[b], pts, threshold, &res[0], bestCount_batch, true);
+                    }
+                }
+            }
+
+            nIterations += nb;
+
+            //reduction; the first best hypothesis wins for determinism
+            int best_b = -1;
+            double bad_ratio = 0.0;
+            int nBad = 0;
+
+            for(int b = 0; b < nb; b++) {
+                if(counts[b] == -1) {
+                    nRejected++;
+                }
+
+                if(counts[b] > bestCount) {
+                    if(best_b >= 0) {
+                        bad_ratio += double(counts[best_b]) / n_f;
+                        nBad++;
+                    }
+
+                    bestCount = counts[b];
+                    best_b = b;
+                } else {
+                    if(counts[b] >= 0) {
+                        bad_ratio += double(counts[b]) / n_f;
+                        nBad++;
+                    }
+                }
+            }
+
+            if(best_b >= 0) {
+                M = models[best_b];
+
+                if(bLocalOptimization) {
+                    LocalOptimization(pts, threshold, M, bestCount);
+                }
+
+                N = getIterations(double(bestCount) / n_f, nSubSet, confidence, maxIterations);
+            }
+
+            //updating SPRT parameters
+            if(nBad > 0) {
+                delta = 0.95 * delta + 0.05 * MAX(bad_ratio / double(nBad), 1e-3);
+            }
+
+            epsilon = MAX(bestCount, 0) / n_f;
+            UpdateSPRT();
+        }
+
+        if(bestCount < 0) {
+            return false;
+        }
+
+        getInliers(M, pts, threshold, inliers);
+
+        return true;
+    }
+};
+
+template<class Model>
+const unsigned int Ransac<Model>::block;
+
+template<class Model>
+const unsigned int Ransac<Model>::batch;
+
+} // end namespace pic
+
+#endif /* PIC_UTIL_RANSAC_HPP */
+
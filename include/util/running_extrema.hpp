@@ -0,0 +1,245 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_UTIL_RUNNING_EXTREMA_HPP
+#define PIC_UTIL_RUNNING_EXTREMA_HPP
+
+#include <float.h>
+#include <string.h>
+#include <vector>
+
+#include "base.hpp"
+#include "util/math.hpp"
+
+namespace pic {
+
+/**
+ * @brief The RunningMin struct is the min operator of RunningExtrema.
+ */
+template<class T>
+struct RunningMin
+{
+    static inline T apply(T a, T b)
+    {
+        return a < b ? a : b;
+    }
+};
+
+/**
+ * @brief The RunningMax struct is the max operator of RunningExtrema.
+ */
+template<class T>
+struct RunningMax
+{
+    static inline T apply(T a, T b)
+    {
+        return a > b ? a : b;
+    }
+};
+
+/**
+ * @brief The RunningOr struct is the bitwise or operator of
+ * RunningExtrema; it dilates bit-packed masks.
+ */
+template<class T>
+struct RunningOr
+{
+    static inline T apply(T a, T b)
+    {
+        return a | b;
+    }
+};
+
+/**
+ * @brief RunningExtremaScratchSize
+ * @param n
+ * @param radius
+ * @param lanes
+ * @return the number of elements of each scratch buffer of RunningExtrema.
+ */
+PIC_INLINE int RunningExtremaScratchSize(int n, int radius, int lanes)
+{
+    int w = 2 * radius + 1;
+    return ((n + 2 * radius + w - 1) / w) * w * lanes;
+}
+
+/**
+ * @brief RunningExtrema is the van Herk/Gil-Werman running min/max over
+ * windows of 2 * radius + 1 samples with clamped borders; it costs three
+ * Op::apply per sample regardless of the radius. Element k of lane l is
+ * in[k * stride + l], so lanes can be the channels of a row, or whole rows
+ * when filtering columns. in and out can be the same buffer.
+ * @param in
+ * @param out
+ * @param n
+ * @param stride
+ * @param lanes
+ * @param radius
+ * @param g is a scratch buffer of RunningExtremaScratchSize elements.
+ * @param h is a scratch buffer of RunningExtremaScratchSize elements.
+ * @param base if it is not NULL, out = sign * (base - extrema); this fuses
+ * top-hat transforms into the last pass.
+ * @param sign
+ */
+template<class T, class Op>
+PIC_INLINE void RunningExtrema(T *in, T *out, int n, int stride, int lanes,
+                               int radius, T *g, T *h,
+                               T *base = NULL, T sign = T(1))
+{
+    int w = 2 * radius + 1;
+    int L = ((n + 2 * radius + w - 1) / w) * w;
+
+    for(int b = 0; b < L; b += w) {
+        //prefix within a block
+        T *src = &in[CLAMP(b - radius, n) * stride];
+        T *gp = &g[b * lanes];
+
+        for(int l = 0; l < lanes; l++) {
+            gp[l] = src[l];
+        }
+
+        for(int i = 1; i < w; i++) {
+            src = &in[CLAMP(b + i - radius, n) * stride];
+            gp = &g[(b + i) * lanes];
+            T *gq = gp - lanes;
+
+            for(int l = 0; l < lanes; l++) {
+                gp[l] = Op::apply(gq[l], src[l]);
+            }
+        }
+
+        //suffix within a block
+        src = &in[CLAMP(b + w - 1 - radius, n) * stride];
+        T *hp = &h[(b + w - 1) * lanes];
+
+        for(int l = 0; l < lanes; l++) {
+            hp[l] = src[l];
+        }
+
+        for(int i = w - 2; i >= 0; i--) {
+            src = &in[CLAMP(b + i - radius, n) * stride];
+            hp = &h[(b + i) * lanes];
+            T *hq = hp + lanes;
+
+            for(int l = 0; l < lanes; l++) {
+                hp[l] = Op::apply(hq[l], src[l]);
+            }
+        }
+    }
+
+    for(int x = 0; x < n; x++) {
+        T *o = &out[x * stride];
+        T *hp = &h[x * lanes];
+        T *gp = &g[(x + w - 1) * lanes];
+
+        if(base == NULL) {
+            for(int l = 0; l < lanes; l++) {
+                o[l] = Op::apply(hp[l], gp[l]);
+            }
+        } else {
+            T *bp = &base[x * stride];
+
+            for(int l = 0; l < lanes; l++) {
+                o[l] = sign * (bp[l] - Op::apply(hp[l], gp[l]));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Extrema2D computes a separable min or max filter over
+ * (2 * radius + 1)^2 windows of a width x height x channels buffer;
+ * rows are filtered in parallel, and columns are filtered in parallel
+ * bands with whole row segments as lanes. in and out can be the same buffer.
+ * @param in
+ * @param out
+ * @param width
+ * @param height
+ * @param channels
+ * @param radius
+ * @param bMax
+ * @param base if it is not NULL, out = sign * (base - extrema).
+ * @param sign
+ */
+PIC_INLINE void Extrema2D(float *in, float *out, int width, int height,
+                          int channels, int radius, bool bMax,
+                          float *base = NULL, float sign = 1.0f)
+{
+    if(radius < 1) {
+        if(out != in) {
+            memcpy(out, in, sizeof(float) * width * height * channels);
+        }
+
+        if(base != NULL) {
+            for(int i = 0; i < width * height * channels; i++) {
+                out[i] = sign * (base[i] - out[i]);
+            }
+        }
+
+        return;
+    }
+
+    int stride = width * channels;
+
+    //horizontal pass
+    #pragma omp parallel
+    {
+        int size = RunningExtremaScratchSize(width, radius, channels);
+        std::vector<float> g(size), h(size);
+
+        #pragma omp for schedule(static)
+        for(int j = 0; j < height; j++) {
+            if(bMax) {
+                RunningExtrema<float, RunningMax<float> >(&in[j * stride], &out[j * stride],
+                        width, channels, channels, radius, &g[0], &h[0]);
+            } else {
+                RunningExtrema<float, RunningMin<float> >(&in[j * stride], &out[j * stride],
+                        width, channels, channels, radius, &g[0], &h[0]);
+            }
+        }
+    }
+
+    //vertical pass
+    int band = 64;
+    int nBands = (stride + band - 1) / band;
+
+    #pragma omp parallel
+    {
+        int size = RunningExtremaScratchSize(height, radius, band);
+        std::vector<float> g(size), h(size);
+
+        #pragma omp for schedule(static)
+        for(int b = 0; b < nBands; b++) {
+            int l0 = b * band;
+            int lanes = MIN(band, stride - l0);
+            float *base_b = base != NULL ? &base[l0] : NULL;
+
+            if(bMax) {
+                RunningExtrema<float, RunningMax<float> >(&out[l0], &out[l0],
+                        height, stride, lanes, radius, &g[0], &h[0], base_b, sign);
+            } else {
+                RunningExtrema<float, RunningMin<float> >(&out[l0], &out[l0],
+                        height, stride, lanes, radius, &g[0], &h[0], base_b, sign);
+            }
+        }
+    }
+}
+
+} // end namespace pic
+
+#endif /* PIC_UTIL_RUNNING_EXTREMA_HPP */
+
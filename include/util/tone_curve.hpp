@@ -0,0 +1,304 @@
+/*
+
+PICCANTE
+The hottest HDR imaging library!
+http://vcg.isti.cnr.it/piccante
+
+Copyright (C) 2014
+Visual Computing Laboratory - ISTI CNR
+http://vcg.isti.cnr.it
+First author: Francesco Banterle
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+*/
+
+#ifndef PIC_UTIL_TONE_CURVE_HPP
+#define PIC_UTIL_TONE_CURVE_HPP
+
+#include <vector>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include "base.hpp"
+#include "util/math.hpp"
+
+namespace pic {
+
+/**
+ * @brief The ToneCurve class bakes a global function, e.g. a global
+ * tone mapping curve or a display encoding, into a table sampled in the
+ * log-domain. Nodes are the floats whose lowest (23 - bits) mantissa bits
+ * are zero, so each octave is split into 2^bits segments and a lookup only
+ * needs integer operations on the bit pattern of the input. Values are
+ * linearly interpolated between nodes.
+ */
+class ToneCurve
+{
+protected:
+    std::vector<float> table;
+    unsigned int iMin, iMax, mask;
+    int bits, shift;
+    float xMin, xMax, yMin, yMax, y0, slope0, invScale, maxError;
+    bool bZero;
+
+    /**
+     * @brief FloatToBits
+     * @param x
+     * @return
+     */
+    static inline unsigned int FloatToBits(float x)
+    {
+        unsigned int u;
+        memcpy(&u, &x, sizeof(unsigned int));
+        return u;
+    }
+
+    /**
+     * @brief BitsToFloat
+     * @param u
+     * @return
+     */
+    static inline float BitsToFloat(unsigned int u)
+    {
+        float x;
+        memcpy(&x, &u, sizeof(float));
+        return x;
+    }
+
+public:
+
+    /**
+     * @brief ToneCurve
+     */
+    ToneCurve()
+    {
+        iMin = iMax = mask = 0;
+        bits = shift = 0;
+        xMin = xMax = yMin = yMax = y0 = slope0 = invScale = 0.0f;
+        maxError = FLT_MAX;
+        bZero = false;
+    }
+
+    /**
+     * @brief Compile samples func in [xMin, xMax] increasing the number of
+     * nodes per octave until the relative error, measured in the middle of
+     * each segment, is below tolerance or 2^maxBits nodes per octave are
+     * reached. Inputs above xMax return func(xMax); inputs in [0, xMin] are
+     * linearly interpolated from func(0) when it is finite, otherwise
+     * they return func(xMin).
+     * @param func is a function or a functor from float to float.
+     * @param xMin
+     * @param xMax
+     * @param tolerance
+     * @param maxBits
+     * @return It returns true if the tolerance is met.
+     */
+    template<class T>
+    bool Compile(T func, float xMin, float xMax, float tolerance = 1e-4f,
+                 int maxBits = 12)
+    {
+        xMin = MAX(xMin, FLT_MIN);
+        maxBits = CLAMPi(maxBits, 1, 16);
+
+        if(!(xMax > xMin)) {
+            table.clear();
+            maxError = FLT_MAX;
+            return false;
+        }
+
+        for(bits = 1; bits <= maxBits; bits++) {
+            shift = 23 - bits;
+            mask = (1u << shift) - 1;
+
+            iMin = FloatToBits(xMin) >> shift;
+            iMax = (FloatToBits(xMax) + mask) >> shift;
+
+            int n = int(iMax - iMin) + 1;
+            table.resize(n);
+
+            for(int k = 0; k < n; k++) {
+                table[k] = func(BitsToFloat((iMin + k) << shift));
+            }
+
+            //measuring the error in the middle of each segment
+            unsigned int half = 1u << (shift - 1);
+            maxError = 0.0f;
+
+            for(int k = 0; k < (n - 1); k++) {
+                float x_m = BitsToFloat(((iMin + k) << shift) + half);
+                float y = func(x_m);
+                float y_m = (table[k] + table[k + 1]) * 0.5f;
+
+                float err = fabsf(y_m - y) / MAX(fabsf(y), FLT_MIN);
+
+                if(!(err <= maxError)) {
+                    maxError = (err == err) ? err : FLT_MAX;
+                }
+            }
+
+            if((maxError <= tolerance) || (n > (1 << 20))) {
+                break;
+            }
+        }
+
+        bits = MIN(bits, maxBits);
+        invScale = 1.0f / float(1u << shift);
+
+        this->xMin = BitsToFloat(iMin << shift);
+        this->xMax = BitsToFloat(iMax << shift);
+        yMin = table.front();
+        yMax = table.back();
+
+        y0 = func(0.0f);
+        bZero = (y0 == y0) && (fabsf(y0) <= FLT_MAX);
+        slope0 = bZero ? (yMin - y0) / this->xMin : 0.0f;
+
+        return maxError <= tolerance;
+    }
+
+    /**
+     * @brief CompileGamma compiles the display encoding x^(1 / gamma)
+     * for x in [0, 1]; inputs above 1 are clamped.
+     * @param gamma
+     * @param tolerance
+     * @return
+     */
+    bool CompileGamma(float gamma = 2.2f, float tolerance = 1e-4f)
+    {
+        if(gamma <= 0.0f) {
+            gamma = 2.2f;
+        }
+
+        float invGamma = 1.0f / gamma;
+        return Compile([invGamma](float x) {
+            return powf(x, invGamma);
+        }, 1.0f / float(1 << 24), 1.0f, tolerance);
+    }
+
+    /**
+     * @brief CompilesRGB compiles the sRGB display encoding for x in [0, 1];
+     * inputs above 1 are clamped.
+     * @param tolerance
+     * @return
+     */
+    bool CompilesRGB(float tolerance = 1e-4f)
+    {
+        return Compile([](float x) {
+            return (x <= 0.0031308f) ? (12.92f * x) :
+                   (1.055f * powf(x, 1.0f / 2.4f) - 0.055f);
+        }, 1.0f / float(1 << 24), 1.0f, tolerance);
+    }
+
+    /**
+     * @brief isValid
+     * @return
+     */
+    bool isValid() const
+    {
+        return !table.empty();
+    }
+
+    /**
+     * @brief getMaxError returns the relative error measured while compiling.
+     * @return
+     */
+    float getMaxError() const
+    {
+        return maxError;
+    }
+
+    /**
+     * @brief getSize returns the number of nodes.
+     * @return
+     */
+    int getSize() const
+    {
+        return int(table.size());
+    }
+
+    /**
+     * @brief Eval evaluates the compiled curve.
+     * @param x
+     * @return
+     */
+    inline float Eval(float x) const
+    {
+        if(!(x > xMin)) {
+            if(x > 0.0f) {
+                return bZero ? (y0 + x * slope0) : yMin;
+            } else {
+                return bZero ? y0 : yMin;
+            }
+        }
+
+        if(x >= xMax) {
+            return yMax;
+        }
+
+        unsigned int u = FloatToBits(x);
+        const float *t = &table[(u >> shift) - iMin];
+        float alpha = float(u & mask) * invScale;
+
+        return t[0] + alpha * (t[1] - t[0]);
+    }
+
+    /**
+     * @brief Apply evaluates the curve for an array of values; dataIn and
+     * dataOut can be the same array.
+     * @param dataIn
+     * @param dataOut
+     * @param size
+     */
+    void Apply(const float *dataIn, float *dataOut, int size) const
+    {
+        #pragma omp parallel for
+
+        for(int i = 0; i < size; i++) {
+            dataOut[i] = Eval(dataIn[i]);
+        }
+    }
+
+    /**
+     * @brief ApplyUChar evaluates the curve for an array of values and
+     * quantizes the result, which is assumed in [0, 1], to 8-bit.
+     * @param dataIn
+     * @param dataOut
+     * @param size
+     * @return
+     */
+    unsigned char *ApplyUChar(const float *dataIn, unsigned char *dataOut,
+                              int size) const
+    {
+        if(dataOut == NULL) {
+            dataOut = new unsigned char[size];
+        }
+
+        #pragma omp parallel for
+
+        for(int i = 0; i < size; i++) {
+            dataOut[i] = ToUChar(Eval(dataIn[i]));
+        }
+
+        return dataOut;
+    }
+
+    /**
+     * @brief ToUChar quantizes a value in [0, 1] to 8-bit.
+     * @param x
+     * @return
+     */
+    static inline unsigned char ToUChar(float x)
+    {
+        float v = x * 255.0f + 0.5f;
+        return (unsigned char) (v > 0.0f ? (v < 255.0f ? int(v) : 255) : 0);
+    }
+};
+
+} // end namespace pic
+
+#endif /* PIC_UTIL_TONE_CURVE_HPP */
+
@@ -228,7 +228,7 @@ Vec<N, float> annulusSampling(std::mt19937 *m, Vec<N, float> center, float radiu
 
         float t = x.lengthSq();
 
-        if((t < 1.0f) || (t > 4.0f)) {
+        if((t >= 1.0f) && (t <= 4.0f)) {
             break;
         }
     }